@@ -6,8 +6,16 @@
 #include <type_traits>
 #include <span>
 #include <memory>
+#include <vector>
+#include <string_view>
 #include <memory_resource>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #include <bela/os.hpp>
+#include <bela/phmap.hpp>
 #include <bela/base.hpp>
 #include <bela/time.hpp>
 
@@ -27,6 +35,19 @@ template <typename T> T *Allocate(size_t n = 1) { return reinterpret_cast<T *>(p
 template <typename T> void Deallocate(T *data, size_t n = 1) { pool.deallocate(data, sizeof(T) * n); }
 } // namespace archive_internal
 
+// CRC32 (IEEE 802.3) shared by all archive formats. The kernel is selected at runtime: SSE4.2+PCLMULQDQ
+// (chromium_zlib crc32_simd.c) on x86/x64, ARMv8 CRC32 instructions on ARM64, slicing-by-16 otherwise.
+namespace crc32 {
+enum class Kernel : int { SlicingBy16 = 0, PCLMUL = 1, ARMv8 = 2 };
+bool Supported(Kernel k);
+Kernel Detect();
+std::wstring_view KernelName(Kernel k);
+// Update compatible with zlib crc32(): previous is the finalized crc of the preceding data (0 for none)
+uint32_t Update(const void *data, size_t length, uint32_t previous = 0);
+// UpdateWith force kernel, fallback to slicing-by-16 when not supported (benchmark and tests)
+uint32_t UpdateWith(Kernel k, const void *data, size_t length, uint32_t previous = 0);
+} // namespace crc32
+
 class Buffer {
 private:
   void MoveFrom(Buffer &&other) {
@@ -70,6 +91,55 @@ private:
   size_t pos_{0};
 };
 
+// Arena bump allocator for strings decoded from archive headers, blocks never move so views into them stay valid
+// until Reset. The tar reader resets it per entry and keeps the largest block, the zip reader reserves one block for
+// the names of its central directory.
+class Arena {
+public:
+  Arena() = default;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  Arena(Arena &&) noexcept = default;
+  Arena &operator=(Arena &&) noexcept = default;
+  char *Allocate(size_t n);
+  std::string_view Concat(std::string_view a, std::string_view b, std::string_view c);
+  // Reserve start a block of at least n bytes, the next n bytes of allocations are contiguous
+  void Reserve(size_t n);
+  void Reset();
+
+private:
+  struct block {
+    std::unique_ptr<char[]> data;
+    size_t size{0};
+  };
+  std::vector<block> blocks;
+  size_t used{0}; // bytes used in blocks.back()
+};
+
+// DirCache directories known to exist under one extraction, shared by the threads of the extractor. MakeDir creates
+// the missing ancestors top-down, so every directory is created once whatever the entry order and later requests
+// for it cost a lookup instead of a stat and a mkdir. The lock only guards the cache, threads create directories in
+// parallel and a directory two of them race for is created by one and found existing by the other.
+class DirCache {
+public:
+  DirCache() = default;
+  DirCache(const DirCache &) = delete;
+  DirCache &operator=(const DirCache &) = delete;
+  // MakeDir create dir and its missing parents
+  bool MakeDir(std::wstring_view dir, bela::error_code &ec);
+  // MakeParent create the directory containing path
+  bool MakeParent(std::wstring_view path, bela::error_code &ec);
+  // Created directories created, Cached requests answered without a system call
+  size_t Created() const { return created; }
+  size_t Cached() const { return cached; }
+
+private:
+  std::mutex mtx;
+  bela::flat_hash_set<std::wstring> known;
+  std::atomic_size_t created{0};
+  std::atomic_size_t cached{0};
+};
+
 class FD {
 private:
   void Free() {
@@ -99,12 +169,139 @@ public:
   // Discard file changes
   bool Discard();
   bool Write(const void *data, size_t bytes, bela::error_code &ec);
+  // SetSparse mark the file sparse, ranges skipped by Seek then take no disk space (NTFS, ReFS)
+  bool SetSparse(bela::error_code &ec);
+  // Seek move the file pointer forward by offset bytes, a write past the end leaves a hole
+  bool Seek(int64_t offset, bela::error_code &ec);
+  // Truncate set the end of file at the file pointer
+  bool Truncate(bela::error_code &ec);
+  // Preallocate reserve size bytes of disk space, the end of file stays where the writes leave it
+  bool Preallocate(int64_t size, bela::error_code &ec);
 
 private:
   HANDLE fd{INVALID_HANDLE_VALUE};
 };
+
+// FileSink writes sinkBlockSize blocks, the 64 KB (or smaller) decoder chunks are gathered so the file grows by whole
+// aligned blocks. Files of preallocateMin bytes or more get their final size allocated before the first write.
+constexpr size_t sinkBlockSize = 1024 * 1024;
+constexpr int64_t preallocateMin = 64 * 1024;
+
+namespace archive_internal {
+struct SinkFile {
+  FD fd;
+  std::wstring path;
+};
+} // namespace archive_internal
+
+// WriteBehind I/O thread of a sequential extractor. FileSink hands it full blocks and the final close, the decoder
+// goes on with the next chunk while the thread writes; closing is where Windows Defender scans the new file, so many
+// small files gain the most. At most maxBlocks blocks are in flight, a sink waits for a free one. The first write
+// error cancels the queued requests and fails the next Write, Wait reports it.
+class WriteBehind {
+public:
+  WriteBehind(size_t maxBlocks_ = 16);
+  WriteBehind(const WriteBehind &) = delete;
+  WriteBehind &operator=(const WriteBehind &) = delete;
+  ~WriteBehind();
+  // Wait finish the queued requests and stop the thread, returns the first write error
+  bool Wait(bela::error_code &ec);
+  bool Failed() const { return failed; }
+
+private:
+  friend class FileSink;
+  enum class Op : int { Write, Close, Discard };
+  struct request {
+    std::shared_ptr<archive_internal::SinkFile> file;
+    Buffer block;
+    bela::Time mtime;
+    Op op{Op::Write};
+  };
+  Buffer acquire();
+  void release(Buffer &&b);
+  void submit(request &&r);
+  void process(request &r);
+  void run();
+  void fail(bela::error_code &&ec);
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<request> queue;
+  std::vector<Buffer> free;
+  size_t maxBlocks{16};
+  size_t allocated{0};
+  bela::error_code firstEc;
+  std::atomic_bool failed{false};
+  bool closed{false};
+  std::thread worker;
+};
+
+// FileSink output of one extracted file of known size: preallocated, written in blocks, on the WriteBehind thread when
+// one is given. Close sets the modification time after the data so no later write touches it, a sink destroyed
+// without Close discards the file.
+class FileSink {
+public:
+  FileSink(FD &&fd, std::wstring_view path, int64_t size, WriteBehind *wb_ = nullptr);
+  FileSink(const FileSink &) = delete;
+  FileSink &operator=(const FileSink &) = delete;
+  ~FileSink() { Discard(); }
+  bool Write(const void *data, size_t len, bela::error_code &ec);
+  // Close write the buffered data, set the modification time and close the file. With a WriteBehind the request is
+  // only queued, WriteBehind::Wait reports its errors.
+  bool Close(bela::Time mtime, bela::error_code &ec);
+  void Discard();
+
+private:
+  bool flush(bela::error_code &ec);
+  std::shared_ptr<archive_internal::SinkFile> file;
+  WriteBehind *wb{nullptr};
+  Buffer block;
+  size_t blockSize{sinkBlockSize};
+  bool done{false};
+};
+
+// MappedFile read-only view of a whole file through MapViewOfFile. The mapping does not own the file handle.
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&o) noexcept { MoveFrom(std::move(o)); }
+  MappedFile &operator=(MappedFile &&o) noexcept {
+    MoveFrom(std::move(o));
+    return *this;
+  }
+  ~MappedFile() { Unmap(); }
+  bool Map(HANDLE fd, int64_t size, bela::error_code &ec);
+  void Unmap();
+  [[nodiscard]] bool Mapped() const { return data_ != nullptr; }
+  [[nodiscard]] const uint8_t *data() const { return data_; }
+  [[nodiscard]] size_t size() const { return size_; }
+  // At pointer to [pos, pos + len) of the mapping, nullptr when not mapped or out of range
+  [[nodiscard]] const uint8_t *At(int64_t pos, uint64_t len) const {
+    if (data_ == nullptr || pos < 0 || static_cast<uint64_t>(pos) > size_ || len > size_ - static_cast<size_t>(pos)) {
+      return nullptr;
+    }
+    return data_ + pos;
+  }
+
+private:
+  void MoveFrom(MappedFile &&o) {
+    Unmap();
+    data_ = o.data_;
+    o.data_ = nullptr;
+    size_ = o.size_;
+    o.size_ = 0;
+    mapping = o.mapping;
+    o.mapping = nullptr;
+  }
+  const uint8_t *data_{nullptr};
+  size_t size_{0};
+  HANDLE mapping{nullptr};
+};
+
 std::optional<std::wstring> PathCat(std::wstring_view root, std::string_view sub);
-std::optional<FD> NewFD(std::wstring_view path, bela::error_code &ec, bool overwrite = false);
+// NewFD create path, its parent directories through dirs when not nullptr
+std::optional<FD> NewFD(std::wstring_view path, bela::error_code &ec, bool overwrite = false, DirCache *dirs = nullptr);
 bool NewSymlink(std::wstring_view path, std::wstring_view linkname, bela::error_code &ec, bool overwrite = false);
 } // namespace baulk::archive
 
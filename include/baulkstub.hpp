@@ -0,0 +1,24 @@
+// baulk launcher stub layout, shared by baulk-stub and the baulk patcher
+#ifndef BAULK_STUB_HPP
+#define BAULK_STUB_HPP
+#include <cstdint>
+#include <cstddef>
+
+namespace baulk::stub {
+// section holding the target slot, baulk locates it by name in the section table
+#define BAULK_STUB_SECTION ".bkslot"
+constexpr char SlotSection[8] = {'.', 'b', 'k', 's', 'l', 'o', 't', 0};
+constexpr wchar_t SlotMagic[8] = {L'B', L'K', L'S', L'T', L'U', L'B', L'1', 0};
+// wchar_t, including the terminating null
+constexpr uint32_t TargetCapacity = 4096;
+struct Slot {
+  wchar_t magic[8];
+  uint32_t capacity;
+  uint32_t length; // 0: not patched
+  wchar_t target[TargetCapacity];
+};
+static_assert(sizeof(wchar_t) == 2, "UTF-16 slot");
+static_assert(offsetof(Slot, target) == 24, "Slot layout");
+} // namespace baulk::stub
+
+#endif
@@ -0,0 +1,268 @@
+// baulk compiled link metadata, written by baulk next to baulk.linkmeta.json and mapped by baulk-lnk
+#ifndef BAULK_LINKMETA_HPP
+#define BAULK_LINKMETA_HPP
+#include <bela/base.hpp>
+#include <bela/mapview.hpp>
+#include <vector>
+#include <string>
+#include <optional>
+#include <cstring>
+#include <algorithm>
+
+namespace baulk::linkmeta {
+[[maybe_unused]] constexpr std::wstring_view LinkMetaTableName = L"baulk.linkmeta.bin";
+constexpr uint8_t tableMagic[8] = {'B', 'K', 'L', 'I', 'N', 'K', 'S', 0};
+constexpr uint32_t tableVersion = 1;
+constexpr uint32_t flagConsole = 0x1;
+
+struct TableHeader {
+  uint8_t magic[8];
+  uint32_t version;
+  uint32_t count;    // slots, about 1.25 slots per link
+  uint32_t poolsize; // wchar_t count
+  uint32_t buckets;  // displacements
+};
+struct TableString {
+  uint32_t offset;
+  uint32_t length;
+};
+struct TableEntry {
+  TableString alias; // launcher file name, 7z.exe
+  TableString pkg;   // package name
+  TableString path;  // relative path in package, bin\7z.exe
+  uint32_t flags;
+  uint32_t reserved;
+};
+static_assert(sizeof(TableHeader) == 24, "TableHeader layout");
+static_assert(sizeof(TableEntry) == 32, "TableEntry layout");
+
+struct Link {
+  std::wstring_view alias;
+  std::wstring_view pkg;
+  std::wstring_view path;
+  bool console{true};
+};
+
+inline wchar_t foldASCII(wchar_t c) { return (c >= 'A' && c <= 'Z') ? static_cast<wchar_t>(c + ('a' - 'A')) : c; }
+
+// FNV-1a over case folded UTF-16 units, seed selects the hash function of the displacement.
+// The murmur3 finalizer decorrelates the seeded functions.
+inline uint32_t Hash(std::wstring_view key, uint32_t seed) {
+  uint32_t h = 2166136261u;
+  for (auto c : key) {
+    auto u = static_cast<uint16_t>(foldASCII(c));
+    h ^= u & 0xFF;
+    h *= 16777619u;
+    h ^= u >> 8;
+    h *= 16777619u;
+  }
+  h += seed * 0x9E3779B9u;
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h;
+}
+
+inline bool EqualsFold(std::wstring_view a, std::wstring_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (foldASCII(a[i]) != foldASCII(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Table reader over mapped memory, layout: header | int32 displacements[buckets] | entries[count] | pool
+class Table {
+public:
+  Table() = default;
+  Table(const Table &) = delete;
+  Table &operator=(const Table &) = delete;
+  bool Open(std::wstring_view file, bela::error_code &ec) {
+    if (!mv.MappingView(file, ec, sizeof(TableHeader))) {
+      return false;
+    }
+    return Open(mv.subview(), ec);
+  }
+  bool Open(bela::MemView v, bela::error_code &ec) {
+    if (!v.StartsWith(tableMagic)) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"link table magic mismatch");
+      return false;
+    }
+    TableHeader hdr;
+    memcpy(&hdr, v.data(), sizeof(hdr));
+    if (hdr.version != tableVersion) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"link table version ", hdr.version, L" unsupported");
+      return false;
+    }
+    auto required = sizeof(TableHeader) + static_cast<uint64_t>(hdr.buckets) * sizeof(int32_t) +
+                    static_cast<uint64_t>(hdr.count) * sizeof(TableEntry) +
+                    static_cast<uint64_t>(hdr.poolsize) * sizeof(wchar_t);
+    if (required > v.size() || (hdr.count != 0 && hdr.buckets == 0)) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"link table truncated");
+      return false;
+    }
+    count = hdr.count;
+    buckets = hdr.buckets;
+    auto p = v.data() + sizeof(TableHeader);
+    displacements = reinterpret_cast<const int32_t *>(p);
+    p += buckets * sizeof(int32_t);
+    entries = reinterpret_cast<const TableEntry *>(p);
+    p += count * sizeof(TableEntry);
+    pool = reinterpret_cast<const wchar_t *>(p);
+    poolsize = hdr.poolsize;
+    return true;
+  }
+  size_t size() const { return count; }
+  std::optional<Link> Lookup(std::wstring_view alias) const {
+    if (count == 0 || buckets == 0) {
+      return std::nullopt;
+    }
+    auto d = displacements[Hash(alias, 0) % buckets];
+    auto slot = d < 0 ? static_cast<uint32_t>(-d - 1) : Hash(alias, static_cast<uint32_t>(d)) % count;
+    if (slot >= count) {
+      return std::nullopt;
+    }
+    const auto &e = entries[slot];
+    auto name = str(e.alias);
+    // keys not in the table land on an arbitrary slot
+    if (!EqualsFold(name, alias)) {
+      return std::nullopt;
+    }
+    return std::make_optional(Link{name, str(e.pkg), str(e.path), (e.flags & flagConsole) != 0});
+  }
+
+private:
+  bela::MapView mv;
+  const int32_t *displacements{nullptr};
+  const TableEntry *entries{nullptr};
+  const wchar_t *pool{nullptr};
+  size_t poolsize{0};
+  size_t count{0};
+  size_t buckets{0};
+  std::wstring_view str(const TableString &s) const {
+    if (static_cast<size_t>(s.offset) + s.length > poolsize) {
+      return L"";
+    }
+    return std::wstring_view{pool + s.offset, s.length};
+  }
+};
+
+inline bool LessFold(std::wstring_view a, std::wstring_view b) {
+  auto n = (std::min)(a.size(), b.size());
+  for (size_t i = 0; i < n; i++) {
+    auto ca = foldASCII(a[i]);
+    auto cb = foldASCII(b[i]);
+    if (ca != cb) {
+      return ca < cb;
+    }
+  }
+  return a.size() < b.size();
+}
+
+constexpr uint32_t maxDisplacement = 1u << 20;
+
+// Encode build the table with hash and displace (CHD): 4 links per bucket, 0.8 load factor.
+// Case insensitive duplicate aliases keep the first, an empty result means no displacement was found.
+inline std::string Encode(std::vector<Link> links) {
+  std::stable_sort(links.begin(), links.end(), [](const Link &a, const Link &b) { return LessFold(a.alias, b.alias); });
+  links.erase(std::unique(links.begin(), links.end(),
+                          [](const Link &a, const Link &b) { return EqualsFold(a.alias, b.alias); }),
+              links.end());
+  const auto n = static_cast<uint32_t>(links.size());
+  const auto nb = (std::max)((n + 3) / 4, 1u);
+  const auto m = n + n / 4 + 1;
+  std::vector<int32_t> displacements(nb, 0);
+  std::vector<int64_t> slots(m, -1); // slot -> link index
+  std::vector<std::vector<uint32_t>> buckets(nb);
+  for (uint32_t i = 0; i < n; i++) {
+    buckets[Hash(links[i].alias, 0) % nb].push_back(i);
+  }
+  std::vector<uint32_t> order(nb);
+  for (uint32_t i = 0; i < nb; i++) {
+    order[i] = i;
+  }
+  // place crowded buckets first while most slots are free
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+  std::vector<uint32_t> placed;
+  for (auto b : order) {
+    const auto &keys = buckets[b];
+    if (keys.size() <= 1) {
+      break;
+    }
+    uint32_t d = 1;
+    for (; d < maxDisplacement; d++) {
+      placed.clear();
+      for (auto k : keys) {
+        auto slot = Hash(links[k].alias, d) % m;
+        if (slots[slot] != -1 || std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+          break;
+        }
+        placed.push_back(slot);
+      }
+      if (placed.size() == keys.size()) {
+        break;
+      }
+    }
+    if (d == maxDisplacement) {
+      return "";
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+      slots[placed[i]] = keys[i];
+    }
+    displacements[b] = static_cast<int32_t>(d);
+  }
+  // single key buckets point directly at a free slot
+  uint32_t free = 0;
+  for (auto b : order) {
+    if (buckets[b].size() != 1) {
+      continue;
+    }
+    while (slots[free] != -1) {
+      free++;
+    }
+    slots[free] = buckets[b][0];
+    displacements[b] = -static_cast<int32_t>(free) - 1;
+  }
+  std::wstring pool;
+  auto add = [&](std::wstring_view sv) {
+    TableString s{static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(sv.size())};
+    pool.append(sv);
+    return s;
+  };
+  std::vector<TableEntry> entries(m, TableEntry{{0, 0}, {0, 0}, {0, 0}, 0, 0});
+  for (uint32_t i = 0; i < m; i++) {
+    if (slots[i] == -1) {
+      continue;
+    }
+    const auto &link = links[static_cast<size_t>(slots[i])];
+    auto &e = entries[i];
+    e.alias = add(link.alias);
+    e.pkg = add(link.pkg);
+    e.path = add(link.path);
+    e.flags = link.console ? flagConsole : 0;
+  }
+  TableHeader hdr;
+  memcpy(hdr.magic, tableMagic, sizeof(tableMagic));
+  hdr.version = tableVersion;
+  hdr.count = m;
+  hdr.poolsize = static_cast<uint32_t>(pool.size());
+  hdr.buckets = nb;
+  std::string buffer;
+  buffer.reserve(sizeof(hdr) + nb * sizeof(int32_t) + m * sizeof(TableEntry) + pool.size() * sizeof(wchar_t));
+  buffer.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+  buffer.append(reinterpret_cast<const char *>(displacements.data()), displacements.size() * sizeof(int32_t));
+  buffer.append(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(TableEntry));
+  buffer.append(reinterpret_cast<const char *>(pool.data()), pool.size() * sizeof(wchar_t));
+  return buffer;
+}
+
+} // namespace baulk::linkmeta
+
+#endif
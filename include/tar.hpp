@@ -5,6 +5,9 @@
 #include <bela/io.hpp>
 #include <bela/phmap.hpp>
 #include <memory>
+#include <functional>
+#include <vector>
+#include <span>
 
 namespace baulk::archive::tar {
 constexpr long ErrNotTarFile = 754320;
@@ -146,6 +149,13 @@ struct gnutar_header {
   char padding[17];
 };
 
+// GNU sparse extension block, follows a 'S' header whose isextended is set
+struct gnutar_sparse_header {
+  gnu_sparse sparse[21];
+  char isextended[1];
+  char padding[7];
+};
+
 // GNU sparse entry
 struct sparseEntry {
   int64_t Offset{0};
@@ -156,11 +166,13 @@ struct sparseEntry {
 using sparseDatas = std::vector<sparseEntry>;
 using pax_records_t = bela::flat_hash_map<std::string, std::string>;
 
+// Header string fields view the Reader arena, they are valid until the next call to Reader::Next
 struct Header {
-  std::string Name;
-  std::string LinkName;
-  std::string Uname;
-  std::string Gname;
+  std::string_view Name;
+  std::string_view LinkName;
+  std::string_view Uname;
+  std::string_view Gname;
+  std::string_view PAX; // "%d key=value\n" records of the entry's extended header
   int64_t Size{0};
   int64_t SparseSize{0};
   int64_t Mode{0};
@@ -169,14 +181,23 @@ struct Header {
   bela::Time ChangeTime;
   int64_t Devmajor{0};
   int64_t Devminor{0};
-  pax_records_t Xattrs;
-  pax_records_t PAXRecords;
   int UID{0};
   int GID{0};
   int Format{0};
   char Typeflag{0};
+  // Sparse data fragments of a sparse file at their logical offsets, the rest of the file is holes. Size is the
+  // logical size and the last fragment ends at Size. Empty for other entries.
+  std::span<const sparseEntry> Sparse;
+  // PAXRecord value of the last key record in PAX
+  std::optional<std::string_view> PAXRecord(std::string_view key) const;
+  // PAXRecords and Xattrs copy the records, only callers that keep them pay for the maps
+  pax_records_t PAXRecords() const;
+  pax_records_t Xattrs() const;
 };
+
 using Writer = std::function<bool(const void *data, size_t len, bela::error_code &ec)>;
+// Hole skip len bytes of zeros of a sparse file
+using Hole = std::function<bool(int64_t len, bela::error_code &ec)>;
 struct ExtractReader {
   virtual ssize_t Read(void *buffer, size_t len, bela::error_code &ec) = 0;
   virtual bool Discard(int64_t len, bela::error_code &ec) = 0;
@@ -193,6 +214,7 @@ public:
   ~FileReader();
   ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
   ssize_t ReadAt(void *buffer, size_t len, int64_t pos, bela::error_code &ec);
+  bool ReadFullAt(void *buffer, size_t len, int64_t pos, bela::error_code &ec);
   bool PositionAt(int64_t pos, bela::error_code &ec);
   bool Discard(int64_t len, bela::error_code& ec);
   bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
@@ -215,21 +237,187 @@ public:
   std::optional<Header> Next(bela::error_code &ec);
   bela::ssize_t Read(void *buffer, size_t size, bela::error_code &ec);
   bool ReadFull(void *buffer, size_t size, bela::error_code &ec);
+  // Read, ReadFull and WriteTo return the logical data of sparse files, holes read as zeros
   bool WriteTo(const Writer &w, int64_t filesize, bela::error_code &ec);
+  // WriteTo sparse files: data fragments go to w, holes to hole
+  bool WriteTo(const Writer &w, const Hole &hole, int64_t filesize, bela::error_code &ec);
+  // HeaderOffset decompressed stream offset of the first header block of the last entry, PAX and GNU long name
+  // headers included. DataOffset is where its data starts.
+  int64_t HeaderOffset() const { return headerOffset; }
+  int64_t DataOffset() const { return dataOffset; }
 
 private:
   bela::ssize_t readInternal(void *buffer, size_t size, bela::error_code &ec);
   bool discard(int64_t bytes, bela::error_code &ec);
-  bool readHeader(Header &h, bela::error_code &ec);
-  bool parsePAX(int64_t paxSize, pax_records_t &paxHdrs, bela::error_code &ec);
+  bool readHeader(Header &h, const ustar_header *&hdr, bela::error_code &ec);
+  bool readBody(int64_t size, std::string_view &body, bela::error_code &ec);
+  bool parsePAX(int64_t paxSize, std::string_view &pax, bela::error_code &ec);
   bool handleSparseFile(Header &h, const gnutar_header *th, bela::error_code &ec);
-  bool readOldGNUSparseMap(Header &h, sparseDatas &spd, const gnutar_header *th, bela::error_code &ec);
-  bool readGNUSparsePAXHeaders(Header &h, sparseDatas &spd, bela::error_code &ec);
-  bool readGNUSparseMap1x0(sparseDatas &spd, bela::error_code &ec);
+  bool readOldGNUSparseMap(Header &h, const gnutar_header *th, bela::error_code &ec);
+  bool readGNUSparsePAXHeaders(Header &h, bool &found, bela::error_code &ec);
+  bool readGNUSparseMap1x0(bela::error_code &ec);
+  bela::ssize_t readSparse(void *buffer, size_t size, bela::error_code &ec);
+  bool writeSparse(const Writer &w, const Hole &hole, int64_t size, bela::error_code &ec);
   ExtractReader *r{nullptr};
+  Arena arena;
   int64_t remainingSize{0};
   int64_t paddingSize{0};
+  int64_t offset{0}; // bytes consumed from r
+  int64_t headerOffset{0};
+  int64_t dataOffset{0};
+  sparseDatas sparse; // fragments of the current sparse entry
+  size_t sparseNext{0};
+  int64_t sparsePos{0}; // logical offset in the current sparse entry
 };
+
+// IndexEntry location of an entry in the decompressed tar stream
+struct IndexEntry {
+  std::string Name;
+  std::string LinkName;
+  int64_t HeaderOffset{0};
+  int64_t DataOffset{0};
+  int64_t Size{0};
+  int64_t Mode{0};
+  int64_t ModTime{0}; // unix seconds
+  char Typeflag{0};
+  bool Sparse{false}; // the sparse map is read from the header at HeaderOffset
+};
+
+// Index entry table of an archive, kept in a sidecar file next to it and reused while the archive size, mtime and
+// leading bytes are unchanged
+class Index {
+public:
+  Index() = default;
+  Index(const Index &) = delete;
+  Index &operator=(const Index &) = delete;
+  // Open load the sidecar index of file, when build is set a missing or stale index is rebuilt by scanning the
+  // archive and saved, an unwritable sidecar is not an error
+  bool Open(std::wstring_view file, FileReader &fr, bool build, bela::error_code &ec);
+  // Build scan all entries of the decompressed stream r
+  bool Build(ExtractReader *r, bela::error_code &ec);
+  // Prepare start an index recorded by the Extractor (ExtractorOptions::record), Save it once the whole archive was
+  // extracted so the next selective extraction or listing does not scan the stream again
+  bool Prepare(FileReader &fr, bela::error_code &ec);
+  void Add(const Header &h, int64_t headerOffset, int64_t dataOffset);
+  bool Save(std::wstring_view file, bela::error_code &ec) const;
+  const std::vector<IndexEntry> &Entries() const { return entries; }
+
+private:
+  bool fingerprint(FileReader &fr, bela::error_code &ec);
+  bool load(std::wstring_view sidecar, bela::error_code &ec);
+  bool save(std::wstring_view sidecar, bela::error_code &ec) const;
+  std::vector<IndexEntry> entries;
+  int64_t archiveSize{0};
+  int64_t archiveModTime{0}; // FILETIME ticks
+  uint64_t prefixHash{0};
+};
+
+// RandomReader positional reads of the decompressed tar stream
+class RandomReader {
+public:
+  virtual ~RandomReader() = default;
+  virtual int64_t Size() const = 0;
+  // ReadAt read up to len bytes at pos, 0 at end of stream
+  virtual ssize_t ReadAt(void *buffer, size_t len, int64_t pos, bela::error_code &ec) = 0;
+  virtual bool WriteTo(const Writer &w, int64_t pos, int64_t size, bela::error_code &ec) = 0;
+};
+// MakeRandomReader reader for uncompressed tar and zstd archives whose frames have known sizes, nullptr when the
+// archive can only be streamed
+std::unique_ptr<RandomReader> MakeRandomReader(FileReader &fr);
+
+// Match archive path name against a pattern: '*' matches any run of characters including '/', '?' one character,
+// and a pattern matching a directory also selects everything below it
+bool Match(std::string_view pattern, std::string_view name);
+
+// OnEntry called before extracting an entry, path is the destination path
+using OnEntry = std::function<void(const Header &h, std::wstring_view path)>;
+// OnReuse called before writing a regular file, an existing file that may hold the same data (incremental upgrades
+// offer the installed copy). The entry data is compared with it while decoding, path is hard linked to it when they
+// are identical and written otherwise.
+using OnReuse = std::function<std::optional<std::wstring>(const Header &h, std::wstring_view path)>;
+// OnReused called after path was linked to the file offered by OnReuse
+using OnReused = std::function<void(const Header &h, std::wstring_view path)>;
+// OnSkip called for an entry that is not extracted because its path or its link target escapes destination
+using OnSkip = std::function<void(const Header &h, std::wstring_view reason)>;
+struct ExtractorOptions {
+  OnEntry onEntry;
+  OnReuse onReuse;
+  OnReused onReused;
+  OnSkip onSkip;
+  // pipelined extraction caps decompressed bytes in flight at memoryLimit, 0 extracts on the calling thread
+  uint64_t memoryLimit{0};
+  int writers{0}; // pipelined writer threads, 0: chosen by processor count
+  // patterns select entries by Match, empty extracts everything
+  std::vector<std::string> patterns;
+  // index of the archive, streaming extraction stops after the last selected entry
+  const Index *index{nullptr};
+  // record the entries read by a scan of the whole stream, nullptr when index is set
+  Index *record{nullptr};
+  bool overwrite{true};
+};
+
+namespace pipeline {
+class Source;
+class Writers;
+} // namespace pipeline
+
+// Extractor writes regular files, directories, symlinks and hardlinks under destination.
+// Device nodes and FIFOs are skipped, entries escaping destination by path or link target are skipped and reported
+// to onSkip.
+// Pipelined mode runs decompression, header parsing and file writes on separate threads.
+class Extractor {
+public:
+  Extractor(ExtractReader *r_, std::wstring_view destination_, const ExtractorOptions &opts_ = {})
+      : r(r_), destination(destination_), opts(opts_) {}
+  Extractor(const Extractor &) = delete;
+  Extractor &operator=(const Extractor &) = delete;
+  bool Extract(bela::error_code &ec);
+  // ExtractIndexed extract the selected entries of index through positional reads, other data is not touched
+  bool ExtractIndexed(const Index &index, RandomReader &rr, bela::error_code &ec);
+  size_t Extracted() const { return extracted; }
+  int64_t Decompressed() const { return decompressed; }
+  const DirCache &Dirs() const { return dirs; }
+
+private:
+  struct deferred {
+    std::wstring path;
+    std::wstring source;
+  };
+  ExtractReader *r{nullptr};
+  Reader *tr{nullptr};
+  RandomReader *rr{nullptr};
+  int64_t dataOffset{0}; // data of the entry extracted through rr
+  pipeline::Source *source{nullptr};
+  pipeline::Writers *writers{nullptr};
+  std::wstring destination;
+  ExtractorOptions opts;
+  std::vector<deferred> links; // hardlinks and copied symlinks whose source is not extracted yet
+  DirCache dirs;
+  bela::flat_hash_set<std::wstring> reused; // linked to OnReuse files, removed before another entry writes there
+  Buffer compare;                           // data read from an OnReuse file
+  size_t extracted{0};
+  int64_t decompressed{0};
+  bool selected(std::string_view name) const;
+  void skip(const Header &h, std::wstring_view reason) const;
+  std::optional<std::wstring> linkSource(const Header &h) const;
+  int64_t streamLimit() const;
+  bool extractEntry(const Header &h, std::wstring_view path, bela::error_code &ec);
+  bool extractEntries(bela::error_code &ec);
+  bool extractPipelined(bela::error_code &ec);
+  bool extractFile(const Header &h, std::wstring_view path, bela::error_code &ec);
+  bool extractSparse(const Header &h, std::wstring_view path, bela::error_code &ec);
+  bool submitFile(const Header &h, std::wstring_view path, bela::error_code &ec);
+  bool reuseFile(const Header &h, std::wstring_view path, std::wstring_view existing, bela::error_code &ec);
+  bool extractDir(std::wstring_view path, bela::error_code &ec);
+  bool extractSymlink(const Header &h, std::wstring_view path, std::wstring &&source, bela::error_code &ec);
+  bool extractHardlink(std::wstring_view path, std::wstring &&source);
+  bool resolveDeferred(bela::error_code &ec);
+};
+
+// Extract open file, detect the compression filter and extract all entries
+bool Extract(std::wstring_view file, std::wstring_view destination, const ExtractorOptions &opts,
+             bela::error_code &ec);
+
 std::wstring_view PathRemoveExtension(std::wstring_view p);
 } // namespace baulk::archive::tar
 
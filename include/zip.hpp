@@ -59,9 +59,11 @@ using bela::os::FileMode;
 // FileMode to string
 std::string String(FileMode m);
 
+// File fixed-size record of a central directory entry. name and comment view the mapping of a mapped Reader or its
+// name arena otherwise, they are valid while the Reader is open.
 struct File {
-  std::string name;
-  std::string comment;
+  std::string_view name;
+  std::string_view comment;
   uint64_t compressedSize{0};
   uint64_t uncompressedSize{0};
   uint64_t position{0}; // file position
@@ -85,8 +87,19 @@ struct File {
 };
 
 constexpr static auto size_max = (std::numeric_limits<std::size_t>::max)();
+constexpr size_t mappedInputSize = 64 * 1024 * 1024;
 
 using Writer = std::function<bool(const void *data, size_t len)>;
+// inflateOneShotLimit default of DecodeOptions::oneShotLimit
+constexpr uint64_t inflateOneShotLimit = 4 * 1024 * 1024;
+// DecodeOptions of a Reader, set before entries are decompressed. The defaults suit extraction, benchmarks turn them
+// off to measure what they gain.
+struct DecodeOptions {
+  bool decoderCache{true}; // reuse the decoder contexts and buffers of the calling thread between entries
+  // deflate entries up to this size are inflated in one call into a buffer of their exact size, 0 always streams
+  uint64_t oneShotLimit{inflateOneShotLimit};
+};
+class DecoderCache;
 class Reader {
 private:
   bool PositionAt(int64_t pos, bela::error_code &ec) const {
@@ -98,12 +111,26 @@ private:
     }
     return true;
   }
-  bool ReadFull(void *buffer, size_t len, bela::error_code &ec) const {
+  // ReadAt positional read: the offset is carried by OVERLAPPED, so concurrent calls never race on the shared file
+  // pointer. Decompress and the decompress* methods only use ReadAt, which makes them safe to run on worker threads.
+  bool ReadAt(void *buffer, size_t len, int64_t pos, bela::error_code &ec) const {
+    if (auto m = view.At(pos, len); m != nullptr) {
+      memcpy(buffer, m, len);
+      return true;
+    }
     auto p = reinterpret_cast<uint8_t *>(buffer);
     size_t total = 0;
     while (total < len) {
+      auto offset = static_cast<uint64_t>(pos) + total;
+      OVERLAPPED ov{};
+      ov.Offset = static_cast<DWORD>(offset);
+      ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
       DWORD dwSize = 0;
-      if (ReadFile(fd, p + total, static_cast<DWORD>(len - total), &dwSize, nullptr) != TRUE) {
+      if (ReadFile(fd, p + total, static_cast<DWORD>(len - total), &dwSize, &ov) != TRUE) {
+        if (GetLastError() == ERROR_HANDLE_EOF) {
+          ec = bela::make_error_code(ERROR_HANDLE_EOF, L"Reached the end of the file");
+          return false;
+        }
         ec = bela::make_system_error_code(L"ReadFile: ");
         return false;
       }
@@ -115,14 +142,21 @@ private:
     }
     return true;
   }
-  // ReadAt ReadFull
-  bool ReadAt(void *buffer, size_t len, int64_t pos, bela::error_code &ec) const {
-    if (!PositionAt(pos, ec)) {
-      return false;
+  // ReadIn decoder input at pos: a pointer into the mapping, otherwise len bytes read into in
+  const uint8_t *ReadIn(Buffer &in, size_t len, int64_t pos, bela::error_code &ec) const {
+    if (auto m = view.At(pos, len); m != nullptr) {
+      return m;
+    }
+    in.grow(len);
+    if (!ReadAt(in.data(), len, pos, ec)) {
+      return nullptr;
     }
-    return ReadFull(buffer, len, ec);
+    return in.data();
   }
+  // InputSize decoders consume a mapped entry in large slices instead of buffer sized reads
+  size_t InputSize(size_t buffered) const { return view.Mapped() ? mappedInputSize : buffered; }
   void Free() {
+    view.Unmap();
     if (needClosed && fd != INVALID_HANDLE_VALUE) {
       CloseHandle(fd);
       fd = INVALID_HANDLE_VALUE;
@@ -134,6 +168,7 @@ private:
     r.fd = INVALID_HANDLE_VALUE;
     needClosed = r.needClosed;
     r.needClosed = false;
+    view = std::move(r.view);
     size = r.size;
     r.size = 0;
     uncompressedSize = r.uncompressedSize;
@@ -142,6 +177,10 @@ private:
     r.compressedSize = 0;
     comment = std::move(r.comment);
     files = std::move(r.files);
+    names = std::move(r.names);
+    index = std::move(r.index);
+    codePage = r.codePage;
+    options = r.options;
   }
 
 public:
@@ -152,40 +191,72 @@ public:
     return *this;
   }
   ~Reader() { Free(); }
-  bool OpenReader(std::wstring_view file, bela::error_code &ec);
-  bool OpenReader(HANDLE nfd, int64_t sz, bela::error_code &ec);
+  // OpenReader mapped: parse the central directory and decode entries straight from a mapping of the file, falls
+  // back to positional reads when the file cannot be mapped
+  bool OpenReader(std::wstring_view file, bela::error_code &ec, bool mapped = false);
+  bool OpenReader(HANDLE nfd, int64_t sz, bela::error_code &ec, bool mapped = false);
+  bool Mapped() const { return view.Mapped(); }
+  void SetOptions(const DecodeOptions &opts) { options = opts; }
+  const DecodeOptions &Options() const { return options; }
   std::string_view Comment() const { return comment; }
   const auto &Files() const { return files; }
+  // BuildIndex hash the entry names so Find is O(1), a few lookups do without it
+  void BuildIndex();
+  // Find the entry named name, the last one of duplicates (the one extraction leaves on disk), nullptr when missing
+  const File *Find(std::string_view name) const;
+  // NameCodePage code page of the names not flagged UTF-8. Detected when the directory is read from all of them at
+  // once: short names alone fool the detector and one answer keeps the names of an archive consistent.
+  uint32_t NameCodePage() const { return codePage; }
   int64_t CompressedSize() const { return compressedSize; }
   int64_t UncompressedSize() const { return uncompressedSize; }
+  // Decompress is const and only issues positional reads, so different entries may be decompressed concurrently.
+  // Decoder contexts come from the DecoderCache of the calling thread.
   bool Decompress(const File &file, const Writer &w, bela::error_code &ec) const;
 
 private:
   std::string comment;
   std::vector<File> files;
+  Arena names; // names and comments of an unmapped directory
+  bela::flat_hash_map<std::string_view, uint32_t> index;
+  MappedFile view;
   HANDLE fd{INVALID_HANDLE_VALUE};
   int64_t size{bela::SizeUnInitialized};
   int64_t uncompressedSize{0};
   int64_t compressedSize{0};
+  uint32_t codePage{CP_ACP};
+  DecodeOptions options;
   bool needClosed{false};
-  bool Initialize(bela::error_code &ec);
+  bool Initialize(bool mapped, bela::error_code &ec);
+  bool readDirectory(const directoryEnd &d, bela::error_code &ec);
+  bool readMappedDirectory(const directoryEnd &d, bela::error_code &ec);
   bool readDirectoryEnd(directoryEnd &d, bela::error_code &ec);
   bool readDirectory64End(int64_t offset, directoryEnd &d, bela::error_code &ec);
   int64_t findDirectory64End(int64_t directoryEndOffset, bela::error_code &ec);
-  bool decompressDeflate(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressDeflate64(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressZstd(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressBz2(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressXz(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressLZMA(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressPpmd(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressBrotli(const File &file, const Writer &w, bela::error_code &ec) const;
+  bool decompressDeflate(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                         bela::error_code &ec) const;
+  bool decompressDeflateOneShot(const File &file, int64_t offset, DecoderCache &cache, const Writer &w, bool &oneshot,
+                                bela::error_code &ec) const;
+  bool decompressDeflate64(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                           bela::error_code &ec) const;
+  bool decompressZstd(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                      bela::error_code &ec) const;
+  bool decompressBz2(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                     bela::error_code &ec) const;
+  bool decompressXz(const File &file, int64_t offset, DecoderCache &cache, const Writer &w, bela::error_code &ec) const;
+  bool decompressXzParallel(const File &file, int64_t offset, const Writer &w, bool &parallel,
+                            bela::error_code &ec) const;
+  bool decompressLZMA(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                      bela::error_code &ec) const;
+  bool decompressPpmd(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                      bela::error_code &ec) const;
+  bool decompressBrotli(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                        bela::error_code &ec) const;
 };
 
 // NewReader
-inline std::optional<Reader> NewReader(HANDLE fd, int64_t size, bela::error_code &ec) {
+inline std::optional<Reader> NewReader(HANDLE fd, int64_t size, bela::error_code &ec, bool mapped = false) {
   Reader r;
-  if (!r.OpenReader(fd, size, ec)) {
+  if (!r.OpenReader(fd, size, ec, mapped)) {
     return std::nullopt;
   }
   return std::make_optional(std::move(r));
@@ -193,6 +264,8 @@ inline std::optional<Reader> NewReader(HANDLE fd, int64_t size, bela::error_code
 
 // root must be the cleaned path
 std::optional<std::wstring> PathCat(std::wstring_view root, const File &file, bool autocvt = true);
+// PathCat names not flagged UTF-8 are decoded with the code page detected for the archive of reader
+std::optional<std::wstring> PathCat(std::wstring_view root, const File &file, const Reader &reader);
 
 //
 } // namespace baulk::archive::zip
@@ -1,9 +1,11 @@
 ///
 #include <memory_resource>
 #include <filesystem>
+#include <algorithm>
 #include <archive.hpp>
 #include <bela/datetime.hpp>
 #include <bela/path.hpp>
+#include <winioctl.h>
 
 namespace baulk::archive {
 // https://en.cppreference.com/w/cpp/memory/unsynchronized_pool_resource
@@ -31,7 +33,7 @@ void Buffer::grow(size_t n) {
   }
   auto b = reinterpret_cast<uint8_t *>(archive_internal::pool.allocate(n));
   if (size_ != 0) {
-    memcpy(b, data_, n);
+    memcpy(b, data_, size_);
   }
   if (data_ != nullptr) {
     archive_internal::pool.deallocate(data_, capacity_);
@@ -40,6 +42,49 @@ void Buffer::grow(size_t n) {
   capacity_ = n;
 }
 
+// arena blocks hold the header blocks, PAX records and long names of a tar entry
+constexpr size_t arenaBlockSize = 16 * 1024;
+
+char *Arena::Allocate(size_t n) {
+  if (blocks.empty() || blocks.back().size - used < n) {
+    auto size = (std::max)(n, arenaBlockSize);
+    blocks.emplace_back(block{std::make_unique<char[]>(size), size});
+    used = 0;
+  }
+  auto p = blocks.back().data.get() + used;
+  used += n;
+  return p;
+}
+
+std::string_view Arena::Concat(std::string_view a, std::string_view b, std::string_view c) {
+  auto p = Allocate(a.size() + b.size() + c.size());
+  memcpy(p, a.data(), a.size());
+  memcpy(p + a.size(), b.data(), b.size());
+  memcpy(p + a.size() + b.size(), c.data(), c.size());
+  return std::string_view(p, a.size() + b.size() + c.size());
+}
+
+void Arena::Reserve(size_t n) {
+  if (n == 0 || (!blocks.empty() && blocks.back().size - used >= n)) {
+    return;
+  }
+  blocks.emplace_back(block{std::make_unique_for_overwrite<char[]>(n), n});
+  used = 0;
+}
+
+void Arena::Reset() {
+  used = 0;
+  if (blocks.size() < 2) {
+    return;
+  }
+  // the entry did not fit one block, keep the largest for the next ones
+  auto largest = std::max_element(blocks.begin(), blocks.end(),
+                                  [](const block &a, const block &b) { return a.size < b.size; });
+  auto keep = std::move(*largest);
+  blocks.clear();
+  blocks.emplace_back(std::move(keep));
+}
+
 // https://docs.microsoft.com/en-us/windows/desktop/api/fileapi/nf-fileapi-setfiletime
 bool FD::SetTime(bela::Time t, bela::error_code &ec) {
   auto ft = bela::ToFileTime(t);
@@ -95,6 +140,267 @@ bool FD::Write(const void *data, size_t bytes, bela::error_code &ec) {
   return true;
 }
 
+// https://docs.microsoft.com/en-us/windows/win32/fileio/sparse-files
+bool FD::SetSparse(bela::error_code &ec) {
+  DWORD dwSize = 0;
+  if (DeviceIoControl(fd, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &dwSize, nullptr) != TRUE) {
+    ec = bela::make_system_error_code(L"FSCTL_SET_SPARSE ");
+    return false;
+  }
+  return true;
+}
+
+bool FD::Seek(int64_t offset, bela::error_code &ec) {
+  LARGE_INTEGER li;
+  li.QuadPart = offset;
+  if (SetFilePointerEx(fd, li, nullptr, FILE_CURRENT) != TRUE) {
+    ec = bela::make_system_error_code(L"SetFilePointerEx ");
+    return false;
+  }
+  return true;
+}
+
+bool FD::Truncate(bela::error_code &ec) {
+  if (SetEndOfFile(fd) != TRUE) {
+    ec = bela::make_system_error_code(L"SetEndOfFile ");
+    return false;
+  }
+  return true;
+}
+
+// https://docs.microsoft.com/en-us/windows/win32/api/winbase/ns-winbase-file_allocation_info
+bool FD::Preallocate(int64_t size, bela::error_code &ec) {
+  FILE_ALLOCATION_INFO ai;
+  ai.AllocationSize.QuadPart = size;
+  if (SetFileInformationByHandle(fd, FileAllocationInfo, &ai, sizeof(ai)) != TRUE) {
+    ec = bela::make_system_error_code(L"FileAllocationInfo ");
+    return false;
+  }
+  return true;
+}
+
+WriteBehind::WriteBehind(size_t maxBlocks_) : maxBlocks((std::max)(maxBlocks_, static_cast<size_t>(1))) {
+  worker = std::thread([this] { run(); });
+}
+
+WriteBehind::~WriteBehind() {
+  bela::error_code ec;
+  Wait(ec);
+}
+
+Buffer WriteBehind::acquire() {
+  std::unique_lock lock(mtx);
+  cv.wait(lock, [&] { return failed || !free.empty() || allocated < maxBlocks; });
+  if (failed) {
+    return Buffer();
+  }
+  if (!free.empty()) {
+    auto b = std::move(free.back());
+    free.pop_back();
+    return b;
+  }
+  allocated++;
+  lock.unlock();
+  return Buffer(sinkBlockSize);
+}
+
+// release return a written block, or the one a discarded sink still holds, to the free list
+void WriteBehind::release(Buffer &&b) {
+  b.size() = 0;
+  {
+    std::scoped_lock lock(mtx);
+    free.emplace_back(std::move(b));
+  }
+  cv.notify_all();
+}
+
+void WriteBehind::submit(request &&r) {
+  {
+    // requests without a block (small files closed, discards) hold open handles, bound them too
+    std::unique_lock lock(mtx);
+    cv.wait(lock, [&] { return failed || closed || queue.size() < maxBlocks * 4; });
+    if (!closed) {
+      queue.emplace_back(std::move(r));
+      lock.unlock();
+      cv.notify_all();
+      return;
+    }
+  }
+  // after Wait: a sink unwinding with the extractor's error
+  process(r);
+}
+
+void WriteBehind::fail(bela::error_code &&ec) {
+  {
+    std::scoped_lock lock(mtx);
+    if (failed) {
+      return;
+    }
+    firstEc = std::move(ec);
+    failed = true;
+  }
+  cv.notify_all();
+}
+
+void WriteBehind::process(request &r) {
+  bela::error_code ec;
+  auto ok = true;
+  if (failed || r.op == Op::Discard) {
+    // canceled: files still queued are incomplete
+    r.file->fd.Discard();
+  } else if (r.op == Op::Write) {
+    ok = r.file->fd.Write(r.block.data(), r.block.size(), ec);
+  } else {
+    ok = r.file->fd.SetTime(r.mtime, ec);
+  }
+  if (!ok) {
+    r.file->fd.Discard();
+    fail(bela::make_error_code(ec.code, L"write '", r.file->path, L"' error: ", ec.message));
+  }
+}
+
+void WriteBehind::run() {
+  for (;;) {
+    request r;
+    {
+      std::unique_lock lock(mtx);
+      cv.wait(lock, [&] { return closed || !queue.empty(); });
+      if (queue.empty()) {
+        return;
+      }
+      r = std::move(queue.front());
+      queue.pop_front();
+    }
+    cv.notify_all();
+    process(r);
+    if (r.block.capacity() != 0) {
+      release(std::move(r.block));
+    }
+    // the last reference of a closed file closes the handle here
+  }
+}
+
+bool WriteBehind::Wait(bela::error_code &ec) {
+  {
+    std::scoped_lock lock(mtx);
+    closed = true;
+  }
+  cv.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+  if (failed) {
+    std::scoped_lock lock(mtx);
+    ec = firstEc;
+    return false;
+  }
+  return true;
+}
+
+FileSink::FileSink(FD &&fd, std::wstring_view path, int64_t size, WriteBehind *wb_)
+    : file(std::make_shared<archive_internal::SinkFile>()), wb(wb_) {
+  file->fd = std::move(fd);
+  file->path = path;
+  if (size >= preallocateMin) {
+    // FAT and network shares may refuse, the file then grows as it is written
+    bela::error_code ec;
+    file->fd.Preallocate(size, ec);
+  }
+  // a small file is written by a single block of its size
+  if (wb == nullptr && size < static_cast<int64_t>(sinkBlockSize)) {
+    blockSize = static_cast<size_t>((std::max)(size, static_cast<int64_t>(4096)));
+  }
+}
+
+bool FileSink::flush(bela::error_code &ec) {
+  if (block.size() == 0) {
+    return true;
+  }
+  if (wb != nullptr) {
+    // the moved block leaves an empty buffer, the next Write acquires another
+    wb->submit(WriteBehind::request{file, std::move(block), {}, WriteBehind::Op::Write});
+    return true;
+  }
+  auto ok = file->fd.Write(block.data(), block.size(), ec);
+  block.size() = 0;
+  return ok;
+}
+
+bool FileSink::Write(const void *data, size_t len, bela::error_code &ec) {
+  if (wb != nullptr && wb->Failed()) {
+    ec = bela::make_error_code(ErrCanceled, L"write behind canceled");
+    return false;
+  }
+  auto p = reinterpret_cast<const uint8_t *>(data);
+  while (len != 0) {
+    if (wb == nullptr && block.size() == 0 && len >= blockSize) {
+      // whole blocks are written without the copy
+      auto n = len - len % blockSize;
+      if (!file->fd.Write(p, n, ec)) {
+        return false;
+      }
+      p += n;
+      len -= n;
+      continue;
+    }
+    if (block.capacity() == 0) {
+      if (wb != nullptr) {
+        if (block = wb->acquire(); block.capacity() == 0) {
+          ec = bela::make_error_code(ErrCanceled, L"write behind canceled");
+          return false;
+        }
+      } else {
+        block.grow(blockSize);
+      }
+    }
+    auto n = (std::min)(len, block.capacity() - block.size());
+    memcpy(block.data() + block.size(), p, n);
+    block.size() += n;
+    p += n;
+    len -= n;
+    if (block.size() == block.capacity() && !flush(ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FileSink::Close(bela::Time mtime, bela::error_code &ec) {
+  if (done) {
+    return true;
+  }
+  if (!flush(ec)) {
+    Discard();
+    return false;
+  }
+  done = true;
+  if (wb != nullptr) {
+    wb->submit(WriteBehind::request{std::move(file), {}, mtime, WriteBehind::Op::Close});
+    return true;
+  }
+  if (!file->fd.SetTime(mtime, ec)) {
+    file->fd.Discard();
+    return false;
+  }
+  file.reset();
+  return true;
+}
+
+void FileSink::Discard() {
+  if (done) {
+    return;
+  }
+  done = true;
+  if (wb != nullptr) {
+    if (block.capacity() != 0) {
+      wb->release(std::move(block));
+    }
+    wb->submit(WriteBehind::request{std::move(file), {}, {}, WriteBehind::Op::Discard});
+    return;
+  }
+  file->fd.Discard();
+}
+
 std::optional<std::wstring> PathCat(std::wstring_view root, std::string_view child) {
   auto path = bela::PathCat(root, bela::ToWide(child));
   if (path == L"." || !path.starts_with(root)) {
@@ -106,26 +412,95 @@ std::optional<std::wstring> PathCat(std::wstring_view root, std::string_view chi
   return std::make_optional(std::move(path));
 }
 
-std::optional<FD> NewFD(std::wstring_view path, bela::error_code &ec, bool overwrite) {
-  std::filesystem::path p(path);
-  std::error_code sec;
-  if (std::filesystem::exists(p, sec)) {
-    if (!overwrite) {
-      ec = bela::make_error_code(ErrGeneral, L"file '", p.filename().wstring(), L"' exists");
+std::optional<FD> NewFD(std::wstring_view path, bela::error_code &ec, bool overwrite, DirCache *dirs) {
+  if (dirs != nullptr) {
+    // the cache knows the parent, CREATE_NEW reports an existing file without a stat
+    if (!dirs->MakeParent(path, ec)) {
       return std::nullopt;
     }
   } else {
-    std::filesystem::create_directories(p.parent_path(), sec);
+    std::filesystem::path p(path);
+    std::error_code sec;
+    if (std::filesystem::exists(p, sec)) {
+      if (!overwrite) {
+        ec = bela::make_error_code(ErrGeneral, L"file '", p.filename().wstring(), L"' exists");
+        return std::nullopt;
+      }
+    } else {
+      std::filesystem::create_directories(p.parent_path(), sec);
+    }
   }
-  auto fd = CreateFileW(path.data(), FILE_GENERIC_READ | FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
-                        FILE_ATTRIBUTE_NORMAL, nullptr);
+  auto fd = CreateFileW(path.data(), FILE_GENERIC_READ | FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                        overwrite ? CREATE_ALWAYS : CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
   if (fd == INVALID_HANDLE_VALUE) {
     ec = bela::make_system_error_code(L"CreateFileW ");
+    if (ec.code == ERROR_FILE_EXISTS) {
+      ec = bela::make_error_code(ErrGeneral, L"file '", bela::BaseName(path), L"' exists");
+    }
     return std::nullopt;
   }
   return std::make_optional<FD>(fd);
 }
 
+bool DirCache::MakeDir(std::wstring_view dir, bela::error_code &ec) {
+  while (dir.size() > 1 && bela::IsPathSeparator(dir.back())) {
+    dir.remove_suffix(1);
+  }
+  // lengths of the prefixes of dir not known to exist, deepest first
+  std::vector<size_t> missing;
+  {
+    std::scoped_lock lock(mtx);
+    for (auto n = dir.size(); n > 0;) {
+      if (known.contains(std::wstring(dir.substr(0, n)))) {
+        break;
+      }
+      missing.push_back(n);
+      auto pos = dir.substr(0, n).find_last_of(L"\\/");
+      if (pos == std::wstring_view::npos || pos == 0) {
+        break;
+      }
+      n = pos;
+    }
+  }
+  if (missing.empty()) {
+    cached++;
+    return true;
+  }
+  // the directories are created without the lock, extractors racing on a prefix see ERROR_ALREADY_EXISTS
+  std::vector<std::wstring> dirs;
+  dirs.reserve(missing.size());
+  for (auto it = missing.rbegin(); it != missing.rend(); it++) {
+    std::wstring d(dir.substr(0, *it));
+    if (CreateDirectoryW(d.data(), nullptr) == TRUE) {
+      created++;
+    } else if (auto e = GetLastError(); e == ERROR_ALREADY_EXISTS) {
+      // a file in the way must fail here, not as a confusing CreateFileW error below it
+      if (auto a = GetFileAttributesW(d.data()); a != INVALID_FILE_ATTRIBUTES && (a & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        ec = bela::make_error_code(ERROR_DIRECTORY, L"mkdir '", d, L"': a file exists at that path");
+        return false;
+      }
+    } else if (*it == dir.size()) {
+      // drive and UNC prefixes cannot be created, only dir itself must succeed
+      ec = bela::make_system_error_code(L"mkdir ");
+      return false;
+    }
+    dirs.emplace_back(std::move(d));
+  }
+  std::scoped_lock lock(mtx);
+  for (auto &d : dirs) {
+    known.emplace(std::move(d));
+  }
+  return true;
+}
+
+bool DirCache::MakeParent(std::wstring_view path, bela::error_code &ec) {
+  auto pos = path.find_last_of(L"\\/");
+  if (pos == std::wstring_view::npos || pos == 0) {
+    return true;
+  }
+  return MakeDir(path.substr(0, pos), ec);
+}
+
 #ifndef SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE
 #define SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE (0x2)
 #endif
@@ -133,6 +508,10 @@ std::optional<FD> NewFD(std::wstring_view path, bela::error_code &ec, bool overw
 #define SYMBOLIC_LINK_DIR (SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE | SYMBOLIC_LINK_FLAG_DIRECTORY)
 
 bool NewSymlink(std::wstring_view path, std::wstring_view linkname, bela::error_code &ec, bool overwrite) {
+  if (linkname.empty()) {
+    ec = bela::make_error_code(ErrGeneral, L"symlink '", path, L"' linkname is empty");
+    return false;
+  }
   std::filesystem::path p(path);
   std::error_code sec;
   if (std::filesystem::exists(p, sec)) {
@@ -144,8 +523,14 @@ bool NewSymlink(std::wstring_view path, std::wstring_view linkname, bela::error_
   } else {
     std::filesystem::create_directories(p.parent_path(), sec);
   }
-  DWORD flags = linkname.ends_with('/') ? SYMBOLIC_LINK_DIR : SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE;
-  if (CreateSymbolicLinkW(path.data(), linkname.data(), flags) != TRUE) {
+  // trailing separator marks directory link, relative targets must use backslash
+  DWORD flags = bela::IsPathSeparator(linkname.back()) ? SYMBOLIC_LINK_DIR : SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE;
+  std::wstring target(linkname);
+  std::replace(target.begin(), target.end(), L'/', L'\\');
+  while (target.size() > 1 && target.back() == L'\\') {
+    target.pop_back();
+  }
+  if (CreateSymbolicLinkW(path.data(), target.data(), flags) != TRUE) {
     ec = bela::make_system_error_code();
     return false;
   }
@@ -0,0 +1,287 @@
+//
+#include "bzipblocks.hpp"
+#include <bzlib.h>
+
+namespace baulk::archive::bzip {
+// https://github.com/dsnet/compress/blob/master/doc/bzip2-format.pdf
+constexpr uint64_t blockMagic = 0x314159265359ULL; // BCD pi
+constexpr uint64_t eosMagic = 0x177245385090ULL;   // BCD sqrt(pi)
+constexpr int magicBits = 48;
+constexpr int crcBits = 32;
+constexpr size_t scanSize = 1024 * 1024;
+constexpr size_t levelBlockSize = 100000;
+
+bool BlockScanner::fill(int64_t endBit, bela::error_code &ec) {
+  auto endByte = (endBit + 7) / 8;
+  while (base + static_cast<int64_t>(data.size()) < endByte) {
+    if (eof) {
+      return false;
+    }
+    auto size = data.size();
+    data.resize(size + scanSize);
+    auto n = read(data.data() + size, scanSize, ec);
+    if (n < 0) {
+      data.resize(size);
+      return false;
+    }
+    data.resize(size + static_cast<size_t>(n));
+    if (n == 0) {
+      eof = true;
+    }
+  }
+  return true;
+}
+
+// bits read n (<= 57) bits at bit position pos, bzip2 packs bits MSB first
+uint64_t BlockScanner::bits(int64_t pos, int n) const {
+  auto p = data.data() + (pos / 8 - base);
+  auto shift = static_cast<int>(pos % 8);
+  auto bytes = (shift + n + 7) / 8;
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; i++) {
+    v = (v << 8) | p[i];
+  }
+  return (v >> (bytes * 8 - shift - n)) & ((1ULL << n) - 1);
+}
+
+// validBlock reject block magics found inside compressed data: the randomised bit is never set by bzip2 0.9.5 and
+// later, origPtr must be inside the block
+bool BlockScanner::validBlock(int64_t pos, bela::error_code &ec) {
+  if (!fill(pos + magicBits + crcBits + 1 + 24, ec)) {
+    return false;
+  }
+  auto randomised = bits(pos + magicBits + crcBits, 1);
+  auto origPtr = bits(pos + magicBits + crcBits + 1, 24);
+  return randomised == 0 && origPtr < level * levelBlockSize;
+}
+
+// magicPairs: 16-bit values of the byte-aligned byte pairs inside both magics at all eight bit alignments. Every
+// magic holds five whole bytes, so one of its pairs starts at a multiple of four and find only probes those.
+const std::vector<uint64_t> &magicPairs() {
+  static const std::vector<uint64_t> pairs = [] {
+    std::vector<uint64_t> set(65536 / 64, 0);
+    for (auto m : {blockMagic, eosMagic}) {
+      for (int a = 0; a < 8; a++) {
+        auto v = m << (8 - a); // 56 bits, magic at bit a
+        uint8_t b[7];
+        for (int i = 0; i < 7; i++) {
+          b[i] = static_cast<uint8_t>(v >> (48 - i * 8));
+        }
+        for (int i = a == 0 ? 0 : 1; i < 5; i++) {
+          auto pair = (static_cast<uint32_t>(b[i]) << 8) | b[i + 1];
+          set[pair / 64] |= 1ULL << (pair % 64);
+        }
+      }
+    }
+    return set;
+  }();
+  return pairs;
+}
+
+// find the first block or end of stream magic at or after bit position from
+bool BlockScanner::find(int64_t from, int64_t &pos, bool &eos, bela::error_code &ec) {
+  const auto &pairs = magicPairs();
+  for (auto j = (from / 8 + 3) & ~static_cast<int64_t>(3);; j += 4) {
+    if (!fill((j + 2) * 8, ec)) {
+      return false;
+    }
+    auto pair = (static_cast<uint32_t>(data[static_cast<size_t>(j - base)]) << 8) | data[static_cast<size_t>(j + 1 - base)];
+    if ((pairs[pair / 64] & (1ULL << (pair % 64))) == 0) {
+      continue;
+    }
+    // the pair is one of the whole bytes k..k+4 of a magic, k in [j-3, j]
+    for (auto start = (std::max)((j - 4) * 8 + 1, from); start <= j * 8; start++) {
+      if (!fill(start + magicBits, ec)) {
+        if (ec) {
+          return false;
+        }
+        break;
+      }
+      auto v = bits(start, magicBits);
+      if (v == eosMagic) {
+        pos = start;
+        eos = true;
+        return true;
+      }
+      if (v == blockMagic && validBlock(start, ec)) {
+        pos = start;
+        eos = false;
+        return true;
+      }
+      if (ec) {
+        return false;
+      }
+    }
+  }
+}
+
+bool BlockScanner::readHeader(bela::error_code &ec) {
+  if (!fill((streamStart + 4) * 8, ec)) {
+    if (ec) {
+      return false;
+    }
+    if (streams != 0 && base + static_cast<int64_t>(data.size()) == streamStart) {
+      ec = bela::make_error_code(ErrEnded, L"bzip stream end");
+      return false;
+    }
+    ec = bela::make_error_code(ErrGeneral, L"bzip stream header truncated");
+    return false;
+  }
+  auto p = data.data() + (streamStart - base);
+  if (p[0] != 'B' || p[1] != 'Z' || p[2] != 'h' || p[3] < '1' || p[3] > '9') {
+    ec = bela::make_error_code(ErrGeneral, L"bzip stream header at ", streamStart, L" invalid");
+    return false;
+  }
+  level = p[3] - '0';
+  combined = 0;
+  cursor = (streamStart + 4) * 8;
+  inStream = true;
+  streams++;
+  return true;
+}
+
+// pack block [cursor, endBit) as a single-block stream, its combined CRC equals the block CRC
+void BlockScanner::pack(int64_t endBit, Buffer &in) const {
+  auto nbits = endBit - cursor;
+  in.grow(static_cast<size_t>(4 + (nbits + magicBits + crcBits + 7) / 8));
+  auto out = in.data();
+  out[0] = 'B';
+  out[1] = 'Z';
+  out[2] = 'h';
+  out[3] = static_cast<uint8_t>('0' + level);
+  size_t o = 4;
+  auto src = data.data() + (cursor / 8 - base);
+  auto shift = static_cast<int>(cursor % 8);
+  auto whole = static_cast<size_t>(nbits / 8);
+  if (shift == 0) {
+    memcpy(out + o, src, whole);
+  } else {
+    for (size_t i = 0; i < whole; i++) {
+      out[o + i] = static_cast<uint8_t>((src[i] << shift) | (src[i + 1] >> (8 - shift)));
+    }
+  }
+  o += whole;
+  uint32_t acc = 0;
+  int accBits = 0;
+  auto put = [&](uint64_t v, int n) {
+    for (int b = n - 1; b >= 0; b--) {
+      acc = (acc << 1) | static_cast<uint32_t>((v >> b) & 1);
+      if (++accBits == 8) {
+        out[o++] = static_cast<uint8_t>(acc);
+        acc = 0;
+        accBits = 0;
+      }
+    }
+  };
+  if (auto rest = static_cast<int>(nbits % 8); rest != 0) {
+    put(bits(cursor + static_cast<int64_t>(whole) * 8, rest), rest);
+  }
+  put(eosMagic, magicBits);
+  put(bits(cursor + magicBits, crcBits), crcBits);
+  if (accBits != 0) {
+    out[o++] = static_cast<uint8_t>(acc << (8 - accBits));
+  }
+  in.size() = o;
+  in.pos() = 0;
+}
+
+bool BlockScanner::Next(Chunk &chunk, Buffer &in, bela::error_code &ec) {
+  for (;;) {
+    if (!inStream && !readHeader(ec)) {
+      return false;
+    }
+    if (!fill(cursor + magicBits + crcBits, ec)) {
+      if (!ec) {
+        ec = bela::make_error_code(ErrGeneral, L"bzip stream truncated");
+      }
+      return false;
+    }
+    auto magic = bits(cursor, magicBits);
+    auto crc = static_cast<uint32_t>(bits(cursor + magicBits, crcBits));
+    if (magic == eosMagic) {
+      if (crc != combined) {
+        ec = bela::make_error_code(ErrGeneral, L"bzip combined crc want ", crc, L" got ", combined);
+        return false;
+      }
+      streamStart = (cursor + magicBits + crcBits + 7) / 8;
+      inStream = false;
+      continue;
+    }
+    if (magic != blockMagic) {
+      ec = bela::make_error_code(ErrGeneral, L"bzip block magic at bit ", cursor, L" invalid");
+      return false;
+    }
+    int64_t end = 0;
+    auto eos = false;
+    if (!find(cursor + magicBits, end, eos, ec)) {
+      if (!ec) {
+        ec = bela::make_error_code(ErrGeneral, L"bzip stream truncated");
+      }
+      return false;
+    }
+    combined = ((combined << 1) | (combined >> 31)) ^ crc;
+    pack(end, in);
+    chunk.offset = cursor / 8;
+    chunk.compressedSize = in.size();
+    chunk.decompressedSize = level * levelBlockSize;
+    cursor = end;
+    // blocks before the cursor are packed, drop their bytes
+    if (auto consumed = static_cast<size_t>(cursor / 8 - base); consumed != 0) {
+      data.erase(data.begin(), data.begin() + consumed);
+      base += static_cast<int64_t>(consumed);
+    }
+    return true;
+  }
+}
+
+bool DecodeBlock(const Buffer &in, Buffer &out, bela::error_code &ec) {
+  bz_stream bzs;
+  memset(&bzs, 0, sizeof(bzs));
+  if (auto ret = BZ2_bzDecompressInit(&bzs, 0, 0); ret != BZ_OK) {
+    ec = bela::make_error_code(ret, L"BZ2_bzDecompressInit error");
+    return false;
+  }
+  auto closer = bela::finally([&] { BZ2_bzDecompressEnd(&bzs); });
+  bzs.next_in = const_cast<char *>(reinterpret_cast<const char *>(in.data()));
+  bzs.avail_in = static_cast<unsigned int>(in.size());
+  out.size() = 0;
+  out.pos() = 0;
+  for (;;) {
+    // runs are expanded after the BWT, a block may decode to more than its level size
+    if (out.size() == out.capacity()) {
+      out.grow((std::max)(out.capacity() * 2, scanSize));
+    }
+    auto avail = out.capacity() - out.size();
+    bzs.next_out = reinterpret_cast<char *>(out.data() + out.size());
+    bzs.avail_out = static_cast<unsigned int>(avail);
+    auto ret = BZ2_bzDecompress(&bzs);
+    out.size() += avail - bzs.avail_out;
+    if (ret == BZ_STREAM_END) {
+      return true;
+    }
+    if (ret != BZ_OK) {
+      ec = bela::make_error_code(ret, L"bzlib error ", ret);
+      return false;
+    }
+    if (bzs.avail_in == 0 && bzs.avail_out != 0) {
+      ec = bela::make_error_code(ErrGeneral, L"bzip block truncated");
+      return false;
+    }
+  }
+}
+
+std::unique_ptr<ParallelDecoder> NewParallelDecoder(ReadSome &&read) {
+  auto threads = DecoderThreads();
+  if (threads < 2) {
+    return nullptr;
+  }
+  auto scanner = std::make_shared<BlockScanner>(std::move(read));
+  return std::make_unique<ParallelDecoder>(
+      [scanner](Chunk &chunk, Buffer &in, bela::error_code &ec) { return scanner->Next(chunk, in, ec); },
+      [](size_t, const Chunk &, const Buffer &in, Buffer &out, bela::error_code &ec) {
+        return DecodeBlock(in, out, ec);
+      },
+      threads, ChunkWindow(9 * levelBlockSize * 4, threads));
+}
+
+} // namespace baulk::archive::bzip
@@ -0,0 +1,48 @@
+//
+#ifndef BAULK_ARCHIVE_BZIPBLOCKS_HPP
+#define BAULK_ARCHIVE_BZIPBLOCKS_HPP
+#include "parallel.hpp"
+
+namespace baulk::archive::bzip {
+// ReadSome sequential read of the compressed data, 0 at end of file
+using ReadSome = std::function<bela::ssize_t(void *buffer, size_t len, bela::error_code &ec)>;
+
+// BlockScanner splits bzip2 streams at the bit-aligned block magics without decoding them. Every block is re-packed
+// as a standalone single-block stream which the vendored libbzip2 decodes and checks against the block CRC, the
+// combined CRC of each stream is verified from the block headers. Concatenated streams (pbzip2) are supported.
+class BlockScanner {
+public:
+  BlockScanner(ReadSome &&read_) : read(std::move(read_)) {}
+  BlockScanner(const BlockScanner &) = delete;
+  BlockScanner &operator=(const BlockScanner &) = delete;
+  // Next pack the next block into in, ErrEnded after the last stream
+  bool Next(Chunk &chunk, Buffer &in, bela::error_code &ec);
+
+private:
+  bool fill(int64_t endBit, bela::error_code &ec);
+  uint64_t bits(int64_t pos, int n) const;
+  bool validBlock(int64_t pos, bela::error_code &ec);
+  bool find(int64_t from, int64_t &pos, bool &eos, bela::error_code &ec);
+  bool readHeader(bela::error_code &ec);
+  void pack(int64_t endBit, Buffer &in) const;
+  ReadSome read;
+  std::vector<uint8_t> data; // bytes [base, base + data.size()) of the compressed data
+  int64_t base{0};
+  int64_t cursor{0}; // bit position of the current block magic
+  int64_t streamStart{0};
+  uint32_t combined{0};
+  int level{0};
+  int streams{0};
+  bool inStream{false};
+  bool eof{false};
+};
+
+// DecodeBlock decode a block packed by BlockScanner, out grows as needed
+bool DecodeBlock(const Buffer &in, Buffer &out, bela::error_code &ec);
+
+// NewParallelDecoder block decoder over the sequential reader, nullptr when there is a single hardware thread
+std::unique_ptr<ParallelDecoder> NewParallelDecoder(ReadSome &&read);
+
+} // namespace baulk::archive::bzip
+
+#endif
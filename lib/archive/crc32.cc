@@ -0,0 +1,191 @@
+///
+#include <archive.hpp>
+#include <zlib.h> // chromeconf.h symbol prefix
+#undef crc32 // chromeconf.h renames zlib crc32(), keep baulk::archive::crc32
+#include "zip/Crc32.h"
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BAULK_CRC32_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define BAULK_CRC32_ARM64 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <arm_acle.h>
+#endif
+#endif
+
+#if defined(BAULK_CRC32_X86)
+// chromium_zlib/crc32_simd.c, compiled with CRC32_SIMD_SSE42_PCLMUL on x86/x64
+extern "C" uint32_t crc32_sse42_simd_(const unsigned char *buf, z_size_t len, uint32_t crc);
+#endif
+
+namespace baulk::archive::crc32 {
+// crc32_sse42_simd_ buffer size constraints: see chromium_zlib/crc32_simd.h
+constexpr size_t pclmulMinimumLength = 64;
+constexpr size_t pclmulChunkMask = 15;
+
+uint32_t updateSlicingBy16(const void *data, size_t length, uint32_t previous) {
+  return crc32_fast(data, length, previous);
+}
+
+#if defined(BAULK_CRC32_X86)
+uint32_t updatePCLMUL(const void *data, size_t length, uint32_t previous) {
+  auto buf = reinterpret_cast<const unsigned char *>(data);
+  if (length >= pclmulMinimumLength) {
+    auto chunk = length & ~pclmulChunkMask;
+    previous = ~crc32_sse42_simd_(buf, static_cast<z_size_t>(chunk), ~previous);
+    buf += chunk;
+    length -= chunk;
+  }
+  if (length == 0) {
+    return previous;
+  }
+  return crc32_fast(buf, length, previous);
+}
+
+bool hasPCLMUL() {
+  int abcd[4] = {0};
+#ifdef _MSC_VER
+  __cpuid(abcd, 1);
+#else
+  __cpuid(1, abcd[0], abcd[1], abcd[2], abcd[3]);
+#endif
+  constexpr int sse2 = 0x4000000;   // edx
+  constexpr int sse42 = 0x100000;   // ecx
+  constexpr int pclmulqdq = 0x2;    // ecx
+  return (abcd[3] & sse2) != 0 && (abcd[2] & sse42) != 0 && (abcd[2] & pclmulqdq) != 0;
+}
+#endif
+
+#if defined(BAULK_CRC32_ARM64)
+#if !defined(_MSC_VER)
+__attribute__((target("crc")))
+#endif
+uint32_t updateARMv8(const void *data, size_t length, uint32_t previous) {
+  auto buf = reinterpret_cast<const uint8_t *>(data);
+  uint32_t c = ~previous;
+  while (length != 0 && (reinterpret_cast<uintptr_t>(buf) & 7) != 0) {
+    c = __crc32b(c, *buf++);
+    length--;
+  }
+  while (length >= 32) {
+    auto p = reinterpret_cast<const uint64_t *>(buf);
+    c = __crc32d(c, p[0]);
+    c = __crc32d(c, p[1]);
+    c = __crc32d(c, p[2]);
+    c = __crc32d(c, p[3]);
+    buf += 32;
+    length -= 32;
+  }
+  while (length >= 8) {
+    c = __crc32d(c, *reinterpret_cast<const uint64_t *>(buf));
+    buf += 8;
+    length -= 8;
+  }
+  while (length-- != 0) {
+    c = __crc32b(c, *buf++);
+  }
+  return ~c;
+}
+
+bool hasARMv8CRC32() {
+#if defined(_WIN32)
+  return IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE) == TRUE;
+#else
+  return false;
+#endif
+}
+#endif
+
+bool Supported(Kernel k) {
+  switch (k) {
+  case Kernel::SlicingBy16:
+    return true;
+#if defined(BAULK_CRC32_X86)
+  case Kernel::PCLMUL: {
+    static const bool pclmul = hasPCLMUL();
+    return pclmul;
+  }
+#endif
+#if defined(BAULK_CRC32_ARM64)
+  case Kernel::ARMv8: {
+    static const bool armv8 = hasARMv8CRC32();
+    return armv8;
+  }
+#endif
+  default:
+    break;
+  }
+  return false;
+}
+
+std::wstring_view KernelName(Kernel k) {
+  switch (k) {
+  case Kernel::SlicingBy16:
+    return L"slicing-by-16";
+  case Kernel::PCLMUL:
+    return L"sse4.2+pclmulqdq";
+  case Kernel::ARMv8:
+    return L"armv8-crc32";
+  default:
+    break;
+  }
+  return L"unknown";
+}
+
+using update_t = uint32_t (*)(const void *, size_t, uint32_t);
+
+update_t resolveUpdate(Kernel k) {
+  if (!Supported(k)) {
+    return updateSlicingBy16;
+  }
+  switch (k) {
+#if defined(BAULK_CRC32_X86)
+  case Kernel::PCLMUL:
+    return updatePCLMUL;
+#endif
+#if defined(BAULK_CRC32_ARM64)
+  case Kernel::ARMv8:
+    return updateARMv8;
+#endif
+  default:
+    break;
+  }
+  return updateSlicingBy16;
+}
+
+Kernel Detect() {
+  static const Kernel kernel = [] {
+    if (Supported(Kernel::PCLMUL)) {
+      return Kernel::PCLMUL;
+    }
+    if (Supported(Kernel::ARMv8)) {
+      return Kernel::ARMv8;
+    }
+    return Kernel::SlicingBy16;
+  }();
+  return kernel;
+}
+
+uint32_t Update(const void *data, size_t length, uint32_t previous) {
+  // resolved once, thread-safe static initialization
+  static const update_t update = resolveUpdate(Detect());
+  if (length == 0) {
+    return previous;
+  }
+  return update(data, length, previous);
+}
+
+uint32_t UpdateWith(Kernel k, const void *data, size_t length, uint32_t previous) {
+  if (length == 0) {
+    return previous;
+  }
+  return resolveUpdate(k)(data, length, previous);
+}
+
+} // namespace baulk::archive::crc32
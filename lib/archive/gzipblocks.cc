@@ -0,0 +1,700 @@
+//
+#include "gzipblocks.hpp"
+#include <bela/endian.hpp>
+#include <algorithm>
+#include "zlib.h"
+#undef crc32 // chromeconf.h renames zlib crc32(), keep baulk::archive::crc32
+
+namespace baulk::archive::gzip {
+// https://www.rfc-editor.org/rfc/rfc1951 https://www.rfc-editor.org/rfc/rfc1952
+constexpr int64_t chunkSlack = 1024 * 1024; // read past the chunk end to reach the next block boundary
+constexpr int64_t minChunks = 4;            // smaller files keep the serial decoder
+constexpr int findAttempts = 16;
+constexpr int64_t findSpan = 256 * 1024 * 8; // bits searched for a block boundary, fixed-only streams have none
+constexpr size_t windowSize = 32768;
+constexpr size_t minOutput = 64 * 1024;
+constexpr uint16_t markerBit = 0x8000; // symbol of the speculative inflater refers to the unknown window
+// speculative output per chunk is capped at speculateRatio * chunkSize: runs copied from the unknown window never get
+// clean, a chunk of zeros would otherwise expand to gigabytes of symbols. Larger chunks are inflated again by redo.
+constexpr int64_t speculateRatio = 8;
+
+constexpr uint16_t lengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                     31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                     2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t distanceBase[30] = {1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+                                       33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+                                       1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+constexpr uint8_t codeOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+enum class rangeStatus { error, boundary, final, incomplete, clean, overflow };
+
+// bitReader deflate bits are packed LSB first. Bits past the end read as zero, callers check overrun.
+class bitReader {
+public:
+  bitReader(const uint8_t *data_, size_t len_, int64_t pos_) : data(data_), len(len_), pos(pos_) {}
+  // peek n (<= 32) bits
+  uint32_t peek(int n) const {
+    auto byte = static_cast<size_t>(pos / 8);
+    uint64_t v = 0;
+    if (byte + 8 <= len) {
+      v = bela::cast_fromle<uint64_t>(data + byte);
+    } else {
+      for (size_t i = 0; i < 8 && byte + i < len; i++) {
+        v |= static_cast<uint64_t>(data[byte + i]) << (i * 8);
+      }
+    }
+    return static_cast<uint32_t>((v >> (pos % 8)) & ((1ULL << n) - 1));
+  }
+  uint32_t bits(int n) {
+    auto v = peek(n);
+    pos += n;
+    return v;
+  }
+  bool overrun() const { return pos > static_cast<int64_t>(len) * 8; }
+  const uint8_t *data{nullptr};
+  size_t len{0};
+  int64_t pos{0};
+};
+
+// huffman lookup table of a canonical prefix code, entries are symbol << 4 | length, 0 for unused codes
+class huffman {
+public:
+  bool build(const uint8_t *lens, int n, bool allowIncomplete);
+  int decode(bitReader &br) const {
+    auto e = table[br.peek(maxLen)];
+    if ((e & 15) == 0) {
+      return -1;
+    }
+    br.pos += e & 15;
+    return e >> 4;
+  }
+
+private:
+  std::vector<uint16_t> table;
+  int maxLen{0};
+};
+
+bool huffman::build(const uint8_t *lens, int n, bool allowIncomplete) {
+  int count[16] = {0};
+  for (int i = 0; i < n; i++) {
+    count[lens[i]]++;
+  }
+  count[0] = 0;
+  maxLen = 0;
+  int left = 1;
+  for (int l = 1; l < 16; l++) {
+    left = (left << 1) - count[l];
+    if (left < 0) {
+      return false; // over-subscribed
+    }
+    if (count[l] != 0) {
+      maxLen = l;
+    }
+  }
+  // like zlib: an incomplete literal/length or distance code is only a single code of length 1
+  if (left > 0 && (!allowIncomplete || maxLen > 1)) {
+    return false;
+  }
+  uint32_t next[16] = {0};
+  for (int l = 1, code = 0; l < 16; l++) {
+    code = (code + count[l - 1]) << 1;
+    next[l] = static_cast<uint32_t>(code);
+  }
+  table.assign(static_cast<size_t>(1) << maxLen, 0);
+  for (int sym = 0; sym < n; sym++) {
+    int l = lens[sym];
+    if (l == 0) {
+      continue;
+    }
+    uint32_t code = next[l]++;
+    uint32_t reversed = 0;
+    for (int i = 0; i < l; i++, code >>= 1) {
+      reversed = (reversed << 1) | (code & 1);
+    }
+    for (auto k = static_cast<size_t>(reversed); k < table.size(); k += static_cast<size_t>(1) << l) {
+      table[k] = static_cast<uint16_t>(sym << 4 | l);
+    }
+  }
+  return true;
+}
+
+// speculator finds block boundaries in the middle of a deflate stream and inflates from them without the window
+class speculator {
+public:
+  speculator(const uint8_t *data_, size_t len_);
+  // find the first candidate block at or after from and before limit: a dynamic block whose codes are complete or a
+  // stored block whose length checks. storedData is the offset of the stored data, -1 for dynamic blocks.
+  bool find(int64_t from, int64_t limit, int64_t &pos, int64_t &storedData);
+  // inflate from start until the last 32 KiB of out are free of window references (clean), the first block boundary
+  // at or after endBit or the end of the final block, overflow when out grows past limit symbols
+  rangeStatus inflate(int64_t start, int64_t endBit, size_t limit, std::vector<uint16_t> &out, int64_t &end);
+
+private:
+  bool readDynamic(bitReader &br);
+  bool copyStored(bitReader &br, std::vector<uint16_t> &out);
+  bool inflateBlock(bitReader &br, const huffman &litcode, const huffman &distcode, std::vector<uint16_t> &out);
+  const uint8_t *data{nullptr};
+  size_t len{0};
+  huffman codes;
+  huffman lit;
+  huffman dist;
+  huffman fixedLit;
+  huffman fixedDist;
+  int64_t lastMarker{-1};
+  size_t limit{0};
+  bool overflow{false};
+};
+
+speculator::speculator(const uint8_t *data_, size_t len_) : data(data_), len(len_) {
+  uint8_t lens[288];
+  memset(lens, 8, 144);
+  memset(lens + 144, 9, 112);
+  memset(lens + 256, 7, 24);
+  memset(lens + 280, 8, 8);
+  fixedLit.build(lens, 288, false);
+  memset(lens, 5, 32);
+  fixedDist.build(lens, 32, false);
+}
+
+bool speculator::readDynamic(bitReader &br) {
+  auto hlit = static_cast<int>(br.bits(5)) + 257;
+  auto hdist = static_cast<int>(br.bits(5)) + 1;
+  auto hclen = static_cast<int>(br.bits(4)) + 4;
+  if (hlit > 286 || hdist > 30) {
+    return false;
+  }
+  uint8_t lens[286 + 30] = {0};
+  for (int i = 0; i < hclen; i++) {
+    lens[codeOrder[i]] = static_cast<uint8_t>(br.bits(3));
+  }
+  if (!codes.build(lens, 19, false)) {
+    return false;
+  }
+  auto total = hlit + hdist;
+  for (int n = 0; n < total;) {
+    auto sym = codes.decode(br);
+    if (sym < 0) {
+      return false;
+    }
+    if (sym < 16) {
+      lens[n++] = static_cast<uint8_t>(sym);
+      continue;
+    }
+    uint8_t v = 0;
+    int repeat = 0;
+    if (sym == 16) {
+      if (n == 0) {
+        return false;
+      }
+      v = lens[n - 1];
+      repeat = 3 + static_cast<int>(br.bits(2));
+    } else if (sym == 17) {
+      repeat = 3 + static_cast<int>(br.bits(3));
+    } else {
+      repeat = 11 + static_cast<int>(br.bits(7));
+    }
+    if (n + repeat > total) {
+      return false;
+    }
+    memset(lens + n, v, repeat);
+    n += repeat;
+  }
+  if (br.overrun() || lens[256] == 0) {
+    return false;
+  }
+  return lit.build(lens, hlit, true) && dist.build(lens + hlit, hdist, true);
+}
+
+bool speculator::find(int64_t from, int64_t limit, int64_t &pos, int64_t &storedData) {
+  limit = (std::min)(limit, static_cast<int64_t>(len) * 8);
+  for (auto p = from; p < limit; p++) {
+    bitReader br(data, len, p);
+    auto header = br.bits(3);
+    if (header == 4) {
+      // BFINAL 0, BTYPE 10: HLIT and HDIST over 29 are invalid
+      if (auto v = br.peek(10); (v & 31) > 29 || (v >> 5) > 29) {
+        continue;
+      }
+      if (readDynamic(br)) {
+        pos = p;
+        storedData = -1;
+        return true;
+      }
+      continue;
+    }
+    if (header != 0) {
+      continue;
+    }
+    // BFINAL 0, BTYPE 00, zero padding up to LEN and NLEN. Scanning upwards finds the first zero bit of the padding,
+    // the true header may start at any of them.
+    auto k = (p + 3 + 7) / 8;
+    if (k + 4 > static_cast<int64_t>(len) || br.peek(static_cast<int>(k * 8 - br.pos)) != 0) {
+      continue;
+    }
+    auto length = bela::cast_fromle<uint16_t>(data + k);
+    auto nlength = bela::cast_fromle<uint16_t>(data + k + 2);
+    if (length != static_cast<uint16_t>(~nlength)) {
+      continue;
+    }
+    pos = p;
+    storedData = k;
+    return true;
+  }
+  return false;
+}
+
+bool speculator::copyStored(bitReader &br, std::vector<uint16_t> &out) {
+  br.pos = (br.pos + 7) / 8 * 8;
+  auto k = static_cast<size_t>(br.pos / 8);
+  if (k + 4 > len) {
+    br.pos = static_cast<int64_t>(len) * 8 + 1;
+    return false;
+  }
+  auto length = bela::cast_fromle<uint16_t>(data + k);
+  if (length != static_cast<uint16_t>(~bela::cast_fromle<uint16_t>(data + k + 2))) {
+    return false;
+  }
+  k += 4;
+  br.pos = static_cast<int64_t>(k + length) * 8;
+  if (k + length > len) {
+    return false;
+  }
+  out.insert(out.end(), data + k, data + k + length);
+  return true;
+}
+
+bool speculator::inflateBlock(bitReader &br, const huffman &litcode, const huffman &distcode,
+                              std::vector<uint16_t> &out) {
+  auto limit = static_cast<int64_t>(len) * 8;
+  for (;;) {
+    if (br.pos > limit) {
+      return false;
+    }
+    if (out.size() > limit) {
+      overflow = true;
+      return false;
+    }
+    auto sym = litcode.decode(br);
+    if (sym < 0) {
+      return false;
+    }
+    if (sym < 256) {
+      out.push_back(static_cast<uint16_t>(sym));
+      continue;
+    }
+    if (sym == 256) {
+      return true;
+    }
+    sym -= 257;
+    if (sym >= 29) {
+      return false;
+    }
+    auto length = lengthBase[sym] + br.bits(lengthExtra[sym]);
+    auto dsym = distcode.decode(br);
+    if (dsym < 0 || dsym >= 30) {
+      return false;
+    }
+    auto distance = distanceBase[dsym] + br.bits(distanceExtra[dsym]);
+    auto from = static_cast<int64_t>(out.size()) - static_cast<int64_t>(distance);
+    if (from < -static_cast<int64_t>(windowSize)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < length; i++, from++) {
+      auto v = from < 0 ? static_cast<uint16_t>(markerBit | (windowSize + from)) : out[static_cast<size_t>(from)];
+      if ((v & markerBit) != 0) {
+        lastMarker = static_cast<int64_t>(out.size());
+      }
+      out.push_back(v);
+    }
+  }
+}
+
+rangeStatus speculator::inflate(int64_t start, int64_t endBit, size_t limit_, std::vector<uint16_t> &out,
+                                int64_t &end) {
+  bitReader br(data, len, start);
+  lastMarker = -1;
+  limit = limit_;
+  overflow = false;
+  for (;;) {
+    auto final = br.bits(1);
+    auto ok = false;
+    switch (br.bits(2)) {
+    case 0:
+      ok = copyStored(br, out);
+      break;
+    case 1:
+      ok = inflateBlock(br, fixedLit, fixedDist, out);
+      break;
+    case 2:
+      ok = readDynamic(br) && inflateBlock(br, lit, dist, out);
+      break;
+    default:
+      break;
+    }
+    if (overflow || out.size() > limit) {
+      return rangeStatus::overflow;
+    }
+    if (br.overrun()) {
+      return rangeStatus::incomplete;
+    }
+    if (!ok) {
+      return rangeStatus::error;
+    }
+    end = br.pos;
+    if (final != 0) {
+      end = (br.pos + 7) / 8 * 8;
+      return rangeStatus::final;
+    }
+    if (end >= endBit) {
+      return rangeStatus::boundary;
+    }
+    if (out.size() >= windowSize && lastMarker < static_cast<int64_t>(out.size() - windowSize)) {
+      return rangeStatus::clean;
+    }
+  }
+}
+
+// inflateRange inflate raw deflate data with zlib from bit start until the first block boundary at or after endBit
+// or the end of the final block (end is then the trailer offset * 8), appending to out. overflow when out reaches
+// outLimit bytes first, 0 for no limit.
+rangeStatus inflateRange(const uint8_t *data, size_t len, int64_t start, int64_t endBit, const uint8_t *dict,
+                         size_t dictLen, size_t outLimit, Buffer &out, int64_t &end, bela::error_code &ec) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (auto zerr = inflateInit2(&zs, -MAX_WBITS); zerr != Z_OK) {
+    ec = bela::make_error_code(ErrGeneral, bela::ToWide(zError(zerr)));
+    return rangeStatus::error;
+  }
+  auto closer = bela::finally([&] { inflateEnd(&zs); });
+  if (dictLen != 0 && inflateSetDictionary(&zs, dict, static_cast<uInt>(dictLen)) != Z_OK) {
+    ec = bela::make_error_code(ErrGeneral, L"inflateSetDictionary error");
+    return rangeStatus::error;
+  }
+  auto byte = start / 8;
+  if (auto shift = static_cast<int>(start % 8); shift != 0) {
+    inflatePrime(&zs, 8 - shift, data[byte] >> shift);
+    byte++;
+  }
+  // stay before endBit without flushing, then stop at every block boundary to find the first one past it
+  auto limit = (std::clamp)(endBit / 8 - 1, byte, static_cast<int64_t>(len));
+  zs.next_in = const_cast<uint8_t *>(data + byte);
+  zs.avail_in = static_cast<uInt>(limit - byte);
+  auto flush = Z_NO_FLUSH;
+  for (;;) {
+    if (zs.avail_in == 0 && flush == Z_NO_FLUSH) {
+      flush = Z_BLOCK;
+      zs.avail_in = static_cast<uInt>(len - static_cast<size_t>(zs.next_in - data));
+    }
+    if (outLimit != 0 && out.size() >= outLimit) {
+      return rangeStatus::overflow;
+    }
+    if (out.capacity() - out.size() < minOutput) {
+      auto n = (std::max)(out.capacity() * 2, out.size() + minOutput);
+      out.grow(outLimit != 0 ? (std::min)(n, (std::max)(outLimit, out.size() + minOutput)) : n);
+    }
+    auto room = (std::min)(out.capacity() - out.size(), static_cast<size_t>(1) << 30);
+    zs.next_out = out.data() + out.size();
+    zs.avail_out = static_cast<uInt>(outLimit != 0 ? (std::min)(room, outLimit - out.size()) : room);
+    auto ret = ::inflate(&zs, flush);
+    out.size() = static_cast<size_t>(zs.next_out - out.data());
+    if (ret == Z_STREAM_END) {
+      end = static_cast<int64_t>(zs.next_in - data) * 8;
+      return rangeStatus::final;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+      ec = bela::make_error_code(ErrGeneral, L"inflate: ", bela::ToWide(zError(ret)));
+      return rangeStatus::error;
+    }
+    if (flush == Z_BLOCK && (zs.data_type & 128) != 0) {
+      auto pos = static_cast<int64_t>(zs.next_in - data) * 8 - (zs.data_type & 7);
+      if ((zs.data_type & 64) != 0) {
+        // Z_BLOCK stops behind the final block before inflate reports Z_STREAM_END
+        end = (pos + 7) / 8 * 8;
+        return rangeStatus::final;
+      }
+      if (pos >= endBit && pos > start) {
+        end = pos;
+        return rangeStatus::boundary;
+      }
+    }
+    if (ret == Z_BUF_ERROR && flush == Z_BLOCK && zs.avail_in == 0) {
+      return rangeStatus::incomplete;
+    }
+  }
+}
+
+ParallelInflater::ParallelInflater(ReadAt &&readAt_, int64_t size_, int64_t dataStart_, const InflaterOptions &opts)
+    : readAt(std::move(readAt_)), size(size_), chunkSize((std::max)(opts.chunkSize, int64_t{1})), dataStart(dataStart_),
+      prevEnd(dataStart_ * 8) {
+  results.resize(static_cast<size_t>((size - dataStart + chunkSize - 1) / chunkSize));
+  ChunkSource source = [this, next = size_t{0}](Chunk &chunk, Buffer &in, bela::error_code &ec) mutable -> bool {
+    if (next == results.size()) {
+      ec = bela::make_error_code(ErrEnded, L"gzip chunks end");
+      return false;
+    }
+    chunk.offset = dataStart + static_cast<int64_t>(next) * chunkSize;
+    chunk.compressedSize = static_cast<uint64_t>((std::min)(chunkEnd(next) + chunkSlack, size) - chunk.offset);
+    chunk.decompressedSize = chunkSize * 4;
+    in.grow(static_cast<size_t>(chunk.compressedSize));
+    if (!readAt(in.data(), static_cast<size_t>(chunk.compressedSize), chunk.offset, ec)) {
+      return false;
+    }
+    in.size() = static_cast<size_t>(chunk.compressedSize);
+    next++;
+    return true;
+  };
+  auto threads = opts.threads > 0 ? opts.threads : DecoderThreads();
+  auto chunks = opts.window != 0 ? opts.window : ChunkWindow(chunkSize * 6, threads);
+  mt = std::make_unique<ParallelDecoder>(
+      std::move(source),
+      [this](size_t index, const Chunk &chunk, const Buffer &in, Buffer &out, bela::error_code &) {
+        return decode(index, chunk, in, out);
+      },
+      threads, chunks);
+}
+
+int64_t ParallelInflater::chunkEnd(size_t index) const {
+  return (std::min)(dataStart + static_cast<int64_t>(index + 1) * chunkSize, size);
+}
+
+// decode runs on worker threads and only touches results[index], failures are left to redo
+bool ParallelInflater::decode(size_t index, const Chunk &chunk, const Buffer &in, Buffer &out) {
+  auto &res = results[index];
+  auto endBit = (chunkEnd(index) - chunk.offset) * 8;
+  auto limit = static_cast<size_t>(chunkSize * speculateRatio);
+  int64_t end = 0;
+  bela::error_code ec;
+  if (index == 0) {
+    // the first chunk starts right after the gzip header with an empty window
+    auto status = inflateRange(in.data(), in.size(), 0, endBit, nullptr, 0, limit, out, end, ec);
+    res.start = chunk.offset * 8;
+    res.end = chunk.offset * 8 + end;
+    res.final = status == rangeStatus::final;
+    res.ok = status == rangeStatus::boundary || res.final;
+    return true;
+  }
+  speculator sp(in.data(), in.size());
+  std::vector<uint16_t> symbols;
+  int64_t from = 0;
+  for (int attempt = 0; attempt < findAttempts; attempt++) {
+    int64_t pos = 0;
+    int64_t storedData = -1;
+    if (!sp.find(from, (std::min)(endBit, findSpan), pos, storedData)) {
+      break;
+    }
+    // every start before a stored length reaches the same block, go on behind it
+    from = storedData < 0 ? pos + 1 : storedData * 8 - 2;
+    symbols.clear();
+    auto status = sp.inflate(pos, endBit, limit, symbols, end);
+    if (status == rangeStatus::error) {
+      continue;
+    }
+    if (status == rangeStatus::incomplete || status == rangeStatus::overflow) {
+      break;
+    }
+    // bytes in front, runs of window references are resolved by the consumer
+    out.size() = 0;
+    out.grow(symbols.size() + minOutput);
+    res.refs.clear();
+    for (size_t i = 0; i < symbols.size(); i++) {
+      if ((symbols[i] & markerBit) == 0) {
+        out.data()[i] = static_cast<uint8_t>(symbols[i]);
+        continue;
+      }
+      out.data()[i] = 0;
+      auto w = static_cast<uint16_t>(symbols[i] & ~markerBit);
+      if (!res.refs.empty()) {
+        if (auto &r = res.refs.back(); r.offset + r.length == i && r.window + r.length == w) {
+          r.length++;
+          continue;
+        }
+      }
+      res.refs.emplace_back(windowRef{i, 1, w});
+    }
+    out.size() = symbols.size();
+    if (status == rangeStatus::clean) {
+      status = inflateRange(in.data(), in.size(), end, endBit, out.data() + out.size() - windowSize, windowSize, limit,
+                            out, end, ec);
+      if (status == rangeStatus::error) {
+        continue;
+      }
+      if (status == rangeStatus::incomplete || status == rangeStatus::overflow) {
+        break;
+      }
+    }
+    res.start = chunk.offset * 8 + pos;
+    res.storedData = storedData < 0 ? -1 : chunk.offset + storedData;
+    res.end = chunk.offset * 8 + end;
+    res.final = status == rangeStatus::final;
+    res.ok = true;
+    return true;
+  }
+  res.ok = false;
+  res.refs.clear();
+  out.size() = 0;
+  return true;
+}
+
+// accept a speculated chunk that starts where the previous one stopped and resolve its window references
+bool ParallelInflater::accept(chunkResult &res, Buffer &out) const {
+  if (!res.ok) {
+    return false;
+  }
+  if (res.start != prevEnd) {
+    // the zero bits in front of the length of a stored block are its header and padding, any start among them
+    // reaches the same block
+    if (res.storedData < 0 || prevEnd < res.start || (prevEnd + 3 + 7) / 8 != res.storedData) {
+      return false;
+    }
+  }
+  for (const auto &r : res.refs) {
+    // a run ends within the window, its first byte is the farthest back
+    auto distance = windowSize - r.window;
+    if (distance > window.size()) {
+      return false;
+    }
+    memcpy(out.data() + r.offset, window.data() + (window.size() - distance), r.length);
+  }
+  return true;
+}
+
+// redo inflate the chunk again from the true boundary with the known window
+bool ParallelInflater::redo(chunkResult &res, size_t index, Buffer &out, bela::error_code &ec) {
+  auto startByte = prevEnd / 8;
+  for (auto slack = chunkSlack;; slack *= 4) {
+    auto endByte = (std::min)((std::max)(chunkEnd(index), startByte) + slack, size);
+    auto len = static_cast<size_t>(endByte - startByte);
+    inb.grow(len);
+    if (!readAt(inb.data(), len, startByte, ec)) {
+      return false;
+    }
+    inb.size() = len;
+    out.size() = 0;
+    int64_t end = 0;
+    auto status = inflateRange(inb.data(), len, prevEnd - startByte * 8, (chunkEnd(index) - startByte) * 8,
+                               window.data(), window.size(), 0, out, end, ec);
+    if (status == rangeStatus::boundary || status == rangeStatus::final) {
+      res.end = startByte * 8 + end;
+      res.final = status == rangeStatus::final;
+      return true;
+    }
+    if (status != rangeStatus::incomplete) {
+      return false;
+    }
+    if (endByte == size) {
+      ec = bela::make_error_code(ErrGeneral, L"gzip stream truncated");
+      return false;
+    }
+  }
+}
+
+void ParallelInflater::remember(const Buffer &out) {
+  if (out.size() >= windowSize) {
+    window.assign(out.data() + out.size() - windowSize, out.data() + out.size());
+    return;
+  }
+  window.insert(window.end(), out.data(), out.data() + out.size());
+  if (window.size() > windowSize) {
+    window.erase(window.begin(), window.begin() + static_cast<ptrdiff_t>(window.size() - windowSize));
+  }
+}
+
+// finish check CRC32 and ISIZE in the member trailer
+bool ParallelInflater::finish(const chunkResult &res, bela::error_code &ec) {
+  uint8_t trailer[8];
+  auto offset = res.end / 8;
+  if (offset + 8 > size) {
+    ec = bela::make_error_code(ErrGeneral, L"gzip trailer truncated");
+    return false;
+  }
+  if (!readAt(trailer, sizeof(trailer), offset, ec)) {
+    return false;
+  }
+  if (bela::cast_fromle<uint32_t>(trailer) != crc) {
+    ec = bela::make_error_code(ErrGeneral, L"gzip crc32 mismatch");
+    return false;
+  }
+  if (bela::cast_fromle<uint32_t>(trailer + 4) != isize) {
+    ec = bela::make_error_code(ErrGeneral, L"gzip size mismatch");
+    return false;
+  }
+  memberEnd = offset + 8;
+  return true;
+}
+
+bool ParallelInflater::Next(Buffer &out, bela::error_code &ec) {
+  for (;;) {
+    if (done) {
+      ec = bela::make_error_code(ErrEnded, L"gzip member end");
+      return false;
+    }
+    if (!mt->Next(out, ec)) {
+      if (ec.code == ErrEnded) {
+        ec = bela::make_error_code(ErrGeneral, L"gzip stream truncated");
+      }
+      return false;
+    }
+    auto &res = results[current];
+    if (!accept(res, out) && !redo(res, current, out, ec)) {
+      return false;
+    }
+    current++;
+    res.refs = {};
+    prevEnd = res.end;
+    crc = crc32::Update(out.data(), out.size(), crc);
+    isize += static_cast<uint32_t>(out.size());
+    remember(out);
+    if (res.final) {
+      if (!finish(res, ec)) {
+        return false;
+      }
+      done = true;
+      mt.reset(); // chunks after the member are not needed
+    }
+    if (out.size() != 0) {
+      return true;
+    }
+  }
+}
+
+std::unique_ptr<ParallelInflater> NewParallelInflater(ReadAt &&readAt, int64_t size, const InflaterOptions &opts) {
+  if (!opts.force && (size < minChunks * opts.chunkSize || DecoderThreads() < 2)) {
+    return nullptr;
+  }
+  uint8_t header[4096];
+  auto headerSize = static_cast<size_t>((std::min)(size, static_cast<int64_t>(sizeof(header))));
+  bela::error_code ec;
+  if (headerSize < 18 || !readAt(header, headerSize, 0, ec)) {
+    return nullptr;
+  }
+  // ID1 ID2 CM FLG MTIME XFL OS
+  if (header[0] != 0x1F || header[1] != 0x8B || header[2] != 8 || (header[3] & 0xE0) != 0) {
+    return nullptr;
+  }
+  auto flags = header[3];
+  size_t pos = 10;
+  if ((flags & 0x04) != 0) { // FEXTRA
+    pos += 2 + bela::cast_fromle<uint16_t>(header + pos);
+  }
+  for (auto field : {0x08, 0x10}) { // FNAME FCOMMENT
+    if ((flags & field) == 0) {
+      continue;
+    }
+    while (pos < headerSize && header[pos] != 0) {
+      pos++;
+    }
+    pos++;
+  }
+  if ((flags & 0x02) != 0) { // FHCRC
+    pos += 2;
+  }
+  if (pos >= headerSize) {
+    return nullptr;
+  }
+  return std::make_unique<ParallelInflater>(std::move(readAt), size, static_cast<int64_t>(pos), opts);
+}
+
+} // namespace baulk::archive::gzip
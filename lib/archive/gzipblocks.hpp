@@ -0,0 +1,76 @@
+//
+#ifndef BAULK_ARCHIVE_GZIPBLOCKS_HPP
+#define BAULK_ARCHIVE_GZIPBLOCKS_HPP
+#include "parallel.hpp"
+
+namespace baulk::archive::gzip {
+// InflaterOptions the defaults suit archives on disk, tests shrink the chunks and force the threads
+struct InflaterOptions {
+  int64_t chunkSize{4 * 1024 * 1024}; // compressed bytes per chunk
+  int threads{0};                     // decoder threads, 0 for DecoderThreads()
+  size_t window{0};                   // chunks in flight, 0 for the memory budget
+  bool force{false};                  // split any file, also with a single hardware thread
+};
+
+// ParallelInflater inflates the first member of a gzip file on worker threads. The deflate data is cut into chunks of
+// fixed compressed size, every chunk but the first looks for a block boundary near its start and inflates from there
+// with an unknown window: back-references into it are kept as markers until the window is free of them, then the
+// vendored zlib takes over with the known window. Each chunk stops at the first block boundary past its end.
+// Speculated chunks are accepted in order when they start where the previous chunk stopped, their markers are resolved
+// from the data before them, otherwise they are inflated again from the true boundary. Speculation stops at a few
+// times the chunk size of output, such a chunk is inflated again too. CRC32 and ISIZE of the member are verified.
+class ParallelInflater {
+public:
+  ParallelInflater(ReadAt &&readAt_, int64_t size_, int64_t dataStart_, const InflaterOptions &opts = {});
+  ParallelInflater(const ParallelInflater &) = delete;
+  ParallelInflater &operator=(const ParallelInflater &) = delete;
+  // Next swap the next decoded part of the member into out, ErrEnded after its trailer has been verified
+  bool Next(Buffer &out, bela::error_code &ec);
+  // End offset of the next member (or trailing data), valid after Next returned ErrEnded
+  int64_t End() const { return memberEnd; }
+
+private:
+  // windowRef run of output bytes copied from consecutive bytes of the unknown window
+  struct windowRef {
+    size_t offset;   // output offset
+    uint32_t length; // bytes in the run
+    uint16_t window; // position of its first byte in the 32 KiB before the chunk
+  };
+  struct chunkResult {
+    std::vector<windowRef> refs; // output runs copied from the unknown window
+    int64_t start{0};            // bit position the chunk was inflated from
+    int64_t end{0};              // block boundary the chunk stopped at, trailer offset * 8 after the final block
+    int64_t storedData{-1};      // offset of the data of a stored block found at start
+    bool ok{false};
+    bool final{false};
+  };
+  int64_t chunkEnd(size_t index) const;
+  bool decode(size_t index, const Chunk &chunk, const Buffer &in, Buffer &out);
+  bool accept(chunkResult &res, Buffer &out) const;
+  bool redo(chunkResult &res, size_t index, Buffer &out, bela::error_code &ec);
+  bool finish(const chunkResult &res, bela::error_code &ec);
+  void remember(const Buffer &out);
+  ReadAt readAt;
+  int64_t size{0};
+  int64_t chunkSize{0};
+  int64_t dataStart{0};
+  std::vector<chunkResult> results;
+  std::unique_ptr<ParallelDecoder> mt;
+  // consumer state
+  size_t current{0};
+  int64_t prevEnd{0};
+  std::vector<uint8_t> window; // last 32 KiB returned
+  Buffer inb;
+  uint32_t crc{0};
+  uint32_t isize{0};
+  int64_t memberEnd{0};
+  bool done{false};
+};
+
+// NewParallelInflater inflater for the first member of a gzip file of size bytes, nullptr when the file is too small
+// to be split or there is a single hardware thread (unless opts.force)
+std::unique_ptr<ParallelInflater> NewParallelInflater(ReadAt &&readAt, int64_t size, const InflaterOptions &opts = {});
+
+} // namespace baulk::archive::gzip
+
+#endif
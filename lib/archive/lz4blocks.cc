@@ -0,0 +1,442 @@
+//
+#include "lz4blocks.hpp"
+#include <bela/endian.hpp>
+
+namespace baulk::archive::lz4 {
+constexpr uint32_t skippableMagic = 0x184D2A50; // & 0xFFFFFFF0
+constexpr size_t legacyBlockSize = 8 * 1024 * 1024;
+// LZ4_COMPRESSBOUND(legacyBlockSize), a larger legacy block size is the magic of the next frame
+constexpr uint32_t legacyBlockBound = legacyBlockSize + legacyBlockSize / 255 + 16;
+constexpr uint32_t prime1 = 0x9E3779B1U;
+constexpr uint32_t prime2 = 0x85EBCA77U;
+constexpr uint32_t prime3 = 0xC2B2AE3DU;
+constexpr uint32_t prime4 = 0x27D4EB2FU;
+constexpr uint32_t prime5 = 0x165667B1U;
+
+inline uint32_t rotl(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+inline uint32_t round32(uint32_t acc, uint32_t input) { return rotl(acc + input * prime2, 13) * prime1; }
+
+void Hash32::Reset(uint32_t seed_) {
+  seed = seed_;
+  v[0] = seed + prime1 + prime2;
+  v[1] = seed + prime2;
+  v[2] = seed;
+  v[3] = seed - prime1;
+  total = 0;
+  memsize = 0;
+}
+
+void Hash32::Update(const uint8_t *data, size_t len) {
+  if (len == 0) {
+    return;
+  }
+  total += len;
+  if (memsize + len < sizeof(mem)) {
+    memcpy(mem + memsize, data, len);
+    memsize += len;
+    return;
+  }
+  if (memsize != 0) {
+    auto n = sizeof(mem) - memsize;
+    memcpy(mem + memsize, data, n);
+    for (int i = 0; i < 4; i++) {
+      v[i] = round32(v[i], bela::cast_fromle<uint32_t>(mem + i * 4));
+    }
+    data += n;
+    len -= n;
+    memsize = 0;
+  }
+  auto end = data + (len & ~static_cast<size_t>(15));
+  for (; data < end; data += 16) {
+    v[0] = round32(v[0], bela::cast_fromle<uint32_t>(data));
+    v[1] = round32(v[1], bela::cast_fromle<uint32_t>(data + 4));
+    v[2] = round32(v[2], bela::cast_fromle<uint32_t>(data + 8));
+    v[3] = round32(v[3], bela::cast_fromle<uint32_t>(data + 12));
+  }
+  memsize = len & 15;
+  memcpy(mem, data, memsize);
+}
+
+uint32_t Hash32::Digest() const {
+  uint32_t h = total >= 16 ? rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18) : seed + prime5;
+  h += static_cast<uint32_t>(total);
+  size_t i = 0;
+  for (; i + 4 <= memsize; i += 4) {
+    h = rotl(h + bela::cast_fromle<uint32_t>(mem + i) * prime3, 17) * prime4;
+  }
+  for (; i < memsize; i++) {
+    h = rotl(h + mem[i] * prime5, 11) * prime1;
+  }
+  h ^= h >> 15;
+  h *= prime2;
+  h ^= h >> 13;
+  h *= prime3;
+  h ^= h >> 16;
+  return h;
+}
+
+uint32_t XXH32(const uint8_t *data, size_t len, uint32_t seed) {
+  Hash32 h(seed);
+  h.Update(data, len);
+  return h.Digest();
+}
+
+// decodeBlock LZ4 block format: sequences of a token, literals and a match, the last sequence has literals only.
+// Copies stay inside in and [dst, dst+capacity), matches may reach back to dst.
+inline bool decodeBlock(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t prefix, size_t capacity, size_t &n,
+                        bela::error_code &ec) {
+  auto ip = src;
+  auto iend = src + srcLen;
+  auto op = dst + prefix;
+  auto oend = dst + capacity;
+  auto corrupt = [&]() {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 block corrupt at ", ip - src);
+    return false;
+  };
+  // readLength 15 extends the length by bytes until one is not 255
+  auto readLength = [&](size_t &length) -> bool {
+    for (;;) {
+      if (ip >= iend) {
+        return false;
+      }
+      auto b = *ip++;
+      length += b;
+      if (b != 255) {
+        return true;
+      }
+    }
+  };
+  for (;;) {
+    if (ip >= iend) {
+      return corrupt();
+    }
+    auto token = *ip++;
+    size_t literals = token >> 4;
+    // short literal runs inside both buffers: one fixed size copy
+    if (literals < 15 && iend - ip >= 16 && oend - op >= 16) {
+      memcpy(op, ip, 16);
+    } else {
+      if (literals == 15 && !readLength(literals)) {
+        return corrupt();
+      }
+      if (static_cast<size_t>(iend - ip) < literals || static_cast<size_t>(oend - op) < literals) {
+        return corrupt();
+      }
+      memmove(op, ip, literals);
+    }
+    ip += literals;
+    op += literals;
+    if (ip == iend) {
+      break;
+    }
+    if (iend - ip < 2) {
+      return corrupt();
+    }
+    size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+      return corrupt();
+    }
+    size_t length = token & 15;
+    if (length == 15 && !readLength(length)) {
+      return corrupt();
+    }
+    length += 4;
+    if (static_cast<size_t>(oend - op) < length) {
+      return corrupt();
+    }
+    auto match = op - offset;
+    if (offset >= 16 && static_cast<size_t>(oend - op) >= length + 16) {
+      // 16 byte steps never read bytes of the same step
+      for (size_t i = 0; i < length; i += 16) {
+        memcpy(op + i, match + i, 16);
+      }
+    } else {
+      for (size_t i = 0; i < length; i++) {
+        op[i] = match[i];
+      }
+    }
+    op += length;
+  }
+  n = static_cast<size_t>(op - dst);
+  return true;
+}
+
+bool DecodeBlock(const Chunk &chunk, const Buffer &in, Buffer &out, size_t prefix, bela::error_code &ec) {
+  auto capacity = prefix + static_cast<size_t>(chunk.decompressedSize);
+  out.size() = prefix;
+  out.grow(capacity);
+  out.pos() = prefix;
+  if ((chunk.flags & blockStored) != 0) {
+    memcpy(out.data() + prefix, in.data(), in.size());
+    out.size() = prefix + in.size();
+    return true;
+  }
+  size_t n = 0;
+  if (!decodeBlock(in.data(), in.size(), out.data(), prefix, capacity, n, ec)) {
+    return false;
+  }
+  out.size() = n;
+  return true;
+}
+
+bool FrameScanner::readFull(void *buffer, size_t len, bool allowEnd, bela::error_code &ec) {
+  auto p = reinterpret_cast<uint8_t *>(buffer);
+  size_t rbytes = 0;
+  while (rbytes < len) {
+    auto n = read(p + rbytes, len - rbytes, ec);
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      if (allowEnd && rbytes == 0) {
+        ec = bela::make_error_code(ErrEnded, L"lz4 stream end");
+        return false;
+      }
+      ec = bela::make_error_code(ErrGeneral, L"lz4 stream truncated at ", offset + static_cast<int64_t>(rbytes));
+      return false;
+    }
+    rbytes += static_cast<size_t>(n);
+  }
+  offset += static_cast<int64_t>(len);
+  return true;
+}
+
+bool FrameScanner::readFrameHeader(uint32_t magic, bela::error_code &ec) {
+  frame = frameEnd{};
+  firstBlock = true;
+  if (magic == legacyMagic) {
+    legacy = true;
+    linked = false;
+    blockChecksum = false;
+    blockMax = legacyBlockSize;
+    inFrame = true;
+    return true;
+  }
+  legacy = false;
+  uint8_t desc[15];
+  if (!readFull(desc, 2, false, ec)) {
+    return false;
+  }
+  auto flg = desc[0];
+  auto bd = desc[1];
+  if ((flg >> 6) != 1 || (flg & 0x02) != 0 || (bd & 0x8F) != 0 || ((bd >> 4) & 7) < 4) {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 frame descriptor at ", offset - 2, L" invalid");
+    return false;
+  }
+  if ((flg & 0x01) != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 frames with a dictionary are not supported");
+    return false;
+  }
+  linked = (flg & 0x20) == 0;
+  blockChecksum = (flg & 0x10) != 0;
+  frame.hasSize = (flg & 0x08) != 0;
+  frame.hasChecksum = (flg & 0x04) != 0;
+  blockMax = static_cast<size_t>(1) << (8 + 2 * ((bd >> 4) & 7));
+  size_t size = 2;
+  if (frame.hasSize) {
+    if (!readFull(desc + size, 8, false, ec)) {
+      return false;
+    }
+    frame.contentSize = bela::cast_fromle<uint64_t>(desc + size);
+    size += 8;
+  }
+  uint8_t hc = 0;
+  if (!readFull(&hc, 1, false, ec)) {
+    return false;
+  }
+  if (static_cast<uint8_t>(XXH32(desc, size) >> 8) != hc) {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 frame descriptor checksum mismatch");
+    return false;
+  }
+  inFrame = true;
+  return true;
+}
+
+// endFrame frames without blocks are checked here, the others once their last block has been verified
+bool FrameScanner::endFrame(bela::error_code &ec) {
+  inFrame = false;
+  if (!firstBlock) {
+    frames.emplace_back(frame);
+    return true;
+  }
+  if ((frame.hasSize && frame.contentSize != 0) || (frame.hasChecksum && frame.checksum != XXH32(nullptr, 0))) {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 empty frame content mismatch");
+    return false;
+  }
+  return true;
+}
+
+bool FrameScanner::Next(Chunk &chunk, Buffer &in, bela::error_code &ec) {
+  for (;;) {
+    if (!inFrame) {
+      auto magic = pendingMagic;
+      pendingMagic = 0;
+      if (magic == 0) {
+        uint8_t b[4];
+        if (!readFull(b, 4, true, ec)) {
+          return false;
+        }
+        magic = bela::cast_fromle<uint32_t>(b);
+      }
+      if ((magic & 0xFFFFFFF0) == skippableMagic) {
+        uint8_t b[4];
+        if (!readFull(b, 4, false, ec)) {
+          return false;
+        }
+        // skipped by reading, the input is sequential
+        uint8_t skip[4096];
+        for (size_t len = bela::cast_fromle<uint32_t>(b); len > 0;) {
+          auto n = (std::min)(len, sizeof(skip));
+          if (!readFull(skip, n, false, ec)) {
+            return false;
+          }
+          len -= n;
+        }
+        continue;
+      }
+      if (magic != frameMagic && magic != legacyMagic) {
+        ec = bela::make_error_code(ErrGeneral, L"lz4 frame magic at ", offset - 4, L" invalid");
+        return false;
+      }
+      if (!readFrameHeader(magic, ec)) {
+        return false;
+      }
+    }
+    uint8_t b[4];
+    if (!readFull(b, 4, legacy, ec)) {
+      if (legacy && ec.code == ErrEnded) {
+        if (!endFrame(ec)) {
+          return false;
+        }
+        ec = bela::make_error_code(ErrEnded, L"lz4 stream end");
+      }
+      return false;
+    }
+    auto size = bela::cast_fromle<uint32_t>(b);
+    if (legacy && size > legacyBlockBound) {
+      pendingMagic = size;
+      if (!endFrame(ec)) {
+        return false;
+      }
+      continue;
+    }
+    if (!legacy && size == 0) {
+      if (frame.hasChecksum) {
+        if (!readFull(b, 4, false, ec)) {
+          return false;
+        }
+        frame.checksum = bela::cast_fromle<uint32_t>(b);
+      }
+      if (!endFrame(ec)) {
+        return false;
+      }
+      continue;
+    }
+    uint32_t flags = 0;
+    if (!legacy && (size & 0x80000000U) != 0) {
+      flags |= blockStored;
+      size &= 0x7FFFFFFFU;
+    }
+    if (size > (legacy ? legacyBlockBound : blockMax)) {
+      ec = bela::make_error_code(ErrGeneral, L"lz4 block size ", size, L" exceeds ", blockMax);
+      return false;
+    }
+    chunk.offset = offset;
+    in.grow(size);
+    if (!readFull(in.data(), size, false, ec)) {
+      return false;
+    }
+    in.size() = size;
+    in.pos() = 0;
+    if (blockChecksum) {
+      if (!readFull(b, 4, false, ec)) {
+        return false;
+      }
+      if (XXH32(in.data(), size) != bela::cast_fromle<uint32_t>(b)) {
+        ec = bela::make_error_code(ErrGeneral, L"lz4 block checksum mismatch at ", chunk.offset);
+        return false;
+      }
+    }
+    if (linked) {
+      flags |= blockLinked;
+    }
+    if (firstBlock) {
+      flags |= blockFirst;
+      firstBlock = false;
+    }
+    chunk.compressedSize = size;
+    chunk.decompressedSize = blockMax;
+    chunk.flags = flags;
+    blocks.emplace_back(flags);
+    return true;
+  }
+}
+
+bool FrameScanner::endVerify(bela::error_code &ec) {
+  verifying = false;
+  if (frames.empty()) {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 frame end missing");
+    return false;
+  }
+  auto f = frames.front();
+  frames.pop_front();
+  if (f.hasSize && f.contentSize != verified) {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 frame content size want ", f.contentSize, L" got ", verified);
+    return false;
+  }
+  if (f.hasChecksum && f.checksum != hash.Digest()) {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 frame content checksum mismatch");
+    return false;
+  }
+  return true;
+}
+
+bool FrameScanner::Verify(const uint8_t *data, size_t len, bela::error_code &ec) {
+  if (blocks.empty()) {
+    ec = bela::make_error_code(ErrGeneral, L"lz4 block not scanned");
+    return false;
+  }
+  auto flags = blocks.front();
+  blocks.pop_front();
+  if ((flags & blockFirst) != 0) {
+    // a new frame starts, so the scanner has read the end of the previous one
+    if (verifying && !endVerify(ec)) {
+      return false;
+    }
+    hash.Reset();
+    verified = 0;
+    verifying = true;
+  }
+  hash.Update(data, len);
+  verified += len;
+  return true;
+}
+
+bool FrameScanner::Finish(bela::error_code &ec) {
+  if (verifying) {
+    return endVerify(ec);
+  }
+  return true;
+}
+
+std::unique_ptr<ParallelDecoder> NewParallelDecoder(std::shared_ptr<FrameScanner> scanner) {
+  auto threads = DecoderThreads();
+  if (threads < 2) {
+    return nullptr;
+  }
+  // 4 MiB blocks of lz4 -B7 (the default), compressed and decoded
+  constexpr uint64_t maxChunk = 8ULL * 1024 * 1024;
+  return std::make_unique<ParallelDecoder>(
+      [scanner](Chunk &chunk, Buffer &in, bela::error_code &ec) { return scanner->Next(chunk, in, ec); },
+      [](size_t, const Chunk &chunk, const Buffer &in, Buffer &out, bela::error_code &ec) {
+        if ((chunk.flags & (blockLinked | blockFirst)) == blockLinked) {
+          ec = bela::make_error_code(ErrGeneral, L"lz4 linked block needs the previous block");
+          return false;
+        }
+        return DecodeBlock(chunk, in, out, 0, ec);
+      },
+      threads, ChunkWindow(maxChunk, threads));
+}
+
+} // namespace baulk::archive::lz4
@@ -0,0 +1,90 @@
+//
+#ifndef BAULK_ARCHIVE_LZ4BLOCKS_HPP
+#define BAULK_ARCHIVE_LZ4BLOCKS_HPP
+#include "parallel.hpp"
+
+namespace baulk::archive::lz4 {
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+constexpr uint32_t frameMagic = 0x184D2204;
+constexpr uint32_t legacyMagic = 0x184C2102;
+// Chunk::flags of lz4 blocks
+constexpr uint32_t blockStored = 1; // uncompressed block
+constexpr uint32_t blockLinked = 2; // matches may reach into the previous 64 KiB of the frame
+constexpr uint32_t blockFirst = 4;  // first block of a frame
+constexpr size_t historySize = 64 * 1024;
+
+// ReadSome sequential read of the compressed data, 0 at end of file
+using ReadSome = std::function<bela::ssize_t(void *buffer, size_t len, bela::error_code &ec)>;
+
+// Hash32 XXH32, the checksum of lz4 frame descriptors, blocks and contents
+class Hash32 {
+public:
+  Hash32(uint32_t seed_ = 0) { Reset(seed_); }
+  void Reset(uint32_t seed_ = 0);
+  void Update(const uint8_t *data, size_t len);
+  uint32_t Digest() const;
+
+private:
+  uint32_t v[4];
+  uint32_t seed{0};
+  uint64_t total{0};
+  uint8_t mem[16];
+  size_t memsize{0};
+};
+uint32_t XXH32(const uint8_t *data, size_t len, uint32_t seed = 0);
+
+// DecodeBlock decode the block in into out after its first prefix bytes, linked blocks take their matches from that
+// prefix. out grows to prefix + chunk.decompressedSize.
+bool DecodeBlock(const Chunk &chunk, const Buffer &in, Buffer &out, size_t prefix, bela::error_code &ec);
+
+// FrameScanner splits lz4 frames (and legacy frames) into blocks without decoding them. Header and block checksums
+// are checked while scanning, Verify checks content sizes and checksums as the decoded blocks are consumed in order.
+// Concatenated and skippable frames are supported, dictionary frames are not.
+class FrameScanner {
+public:
+  FrameScanner(ReadSome &&read_) : read(std::move(read_)) {}
+  FrameScanner(const FrameScanner &) = delete;
+  FrameScanner &operator=(const FrameScanner &) = delete;
+  // Next read the next block into in, ErrEnded after the last frame
+  bool Next(Chunk &chunk, Buffer &in, bela::error_code &ec);
+  // Verify consume the decoded data of the next block, Finish once all blocks have been consumed
+  bool Verify(const uint8_t *data, size_t len, bela::error_code &ec);
+  bool Finish(bela::error_code &ec);
+
+private:
+  struct frameEnd {
+    uint64_t contentSize{0};
+    uint32_t checksum{0};
+    bool hasSize{false};
+    bool hasChecksum{false};
+  };
+  bool readFull(void *buffer, size_t len, bool allowEnd, bela::error_code &ec);
+  bool readFrameHeader(uint32_t magic, bela::error_code &ec);
+  bool endFrame(bela::error_code &ec);
+  bool endVerify(bela::error_code &ec);
+  ReadSome read;
+  int64_t offset{0}; // compressed bytes read
+  // scanning state
+  frameEnd frame;
+  size_t blockMax{0};
+  uint32_t pendingMagic{0}; // legacy frames end at the magic of the next frame
+  bool inFrame{false};
+  bool legacy{false};
+  bool linked{false};
+  bool blockChecksum{false};
+  bool firstBlock{false};
+  std::deque<uint32_t> blocks; // flags of the scanned blocks not verified yet
+  std::deque<frameEnd> frames; // frames with blocks, in order
+  // verify state
+  Hash32 hash;
+  uint64_t verified{0};
+  bool verifying{false};
+};
+
+// NewParallelDecoder block decoder over scanner, nullptr when there is a single hardware thread
+std::unique_ptr<ParallelDecoder> NewParallelDecoder(std::shared_ptr<FrameScanner> scanner);
+
+} // namespace baulk::archive::lz4
+
+#endif
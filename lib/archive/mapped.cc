@@ -0,0 +1,40 @@
+///
+#include <limits>
+#include <archive.hpp>
+
+namespace baulk::archive {
+bool MappedFile::Map(HANDLE fd, int64_t size, bela::error_code &ec) {
+  Unmap();
+  if (size <= 0 || static_cast<uint64_t>(size) > (std::numeric_limits<size_t>::max)()) {
+    ec = bela::make_error_code(ErrGeneral, L"file size ", size, L" cannot be mapped");
+    return false;
+  }
+  mapping = CreateFileMappingW(fd, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    ec = bela::make_system_error_code(L"CreateFileMappingW: ");
+    return false;
+  }
+  auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(size));
+  if (view == nullptr) {
+    ec = bela::make_system_error_code(L"MapViewOfFile: ");
+    CloseHandle(mapping);
+    mapping = nullptr;
+    return false;
+  }
+  data_ = reinterpret_cast<const uint8_t *>(view);
+  size_ = static_cast<size_t>(size);
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+}
+} // namespace baulk::archive
@@ -1,6 +1,6 @@
 ///
-#ifndef BAULK_ZIP_HPP
-#define BAULK_ZIP_HPP
+#ifndef BAULK_OLDZIP_HPP
+#define BAULK_OLDZIP_HPP
 #include <cstdint>
 #include <bela/base.hpp>
 // https://www.winzip.com/win/en/comp_info.html
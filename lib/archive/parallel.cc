@@ -0,0 +1,139 @@
+//
+#include "parallel.hpp"
+#include <algorithm>
+
+namespace baulk::archive {
+// compressed and decoded chunks held by ParallelDecoder, xz -T0 -9 blocks are 192 MiB each
+constexpr uint64_t memoryBudget = 512ULL * 1024 * 1024;
+
+size_t ChunkWindow(uint64_t maxChunkMemory, int threads) {
+  return static_cast<size_t>((std::clamp)(memoryBudget / (std::max)(maxChunkMemory, static_cast<uint64_t>(1)),
+                                          static_cast<uint64_t>(1), static_cast<uint64_t>(threads) * 2));
+}
+
+int DecoderThreads() { return static_cast<int>((std::max)(std::thread::hardware_concurrency(), 1u)); }
+
+ParallelDecoder::ParallelDecoder(ChunkSource &&source_, DecodeChunk &&decode_, int threads, size_t window_)
+    : source(std::move(source_)), decode(std::move(decode_)), window((std::max)(window_, static_cast<size_t>(1))) {
+  threads = (std::max)(threads, 1);
+  workers.reserve(threads);
+  for (int i = 0; i < threads; i++) {
+    workers.emplace_back([this] { run(); });
+  }
+}
+
+ParallelDecoder::~ParallelDecoder() {
+  {
+    std::scoped_lock lock(mtx);
+    closed = true;
+  }
+  cv.notify_all();
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+void ParallelDecoder::run() {
+  for (;;) {
+    task *t = nullptr;
+    {
+      std::unique_lock lock(mtx);
+      cv.wait(lock, [&] { return closed || !queue.empty(); });
+      if (closed) {
+        return;
+      }
+      t = queue.front();
+      queue.pop_front();
+    }
+    t->out.grow(static_cast<size_t>(t->chunk.decompressedSize));
+    bela::error_code ec;
+    decode(t->index, t->chunk, t->in, t->out, ec);
+    {
+      std::scoped_lock lock(mtx);
+      t->ec = std::move(ec);
+      t->done = true;
+    }
+    cvDone.notify_all();
+  }
+}
+
+// schedule read chunks until the window is full
+bool ParallelDecoder::schedule(bela::error_code &ec) {
+  while (!eof && inflight.size() < window) {
+    auto t = std::make_unique<task>();
+    if (!source(t->chunk, t->in, ec)) {
+      if (ec.code != ErrEnded) {
+        return false;
+      }
+      ec.clear();
+      eof = true;
+      break;
+    }
+    t->index = next++;
+    {
+      std::scoped_lock lock(mtx);
+      queue.emplace_back(t.get());
+      inflight.emplace_back(std::move(t));
+    }
+    cv.notify_one();
+  }
+  return true;
+}
+
+bool ParallelDecoder::Next(Buffer &out, bela::error_code &ec) {
+  if (!schedule(ec)) {
+    return false;
+  }
+  std::unique_ptr<task> t;
+  {
+    std::unique_lock lock(mtx);
+    if (inflight.empty()) {
+      ec = bela::make_error_code(ErrEnded, L"parallel decoder end");
+      return false;
+    }
+    cvDone.wait(lock, [&] { return inflight.front()->done; });
+    t = std::move(inflight.front());
+    inflight.pop_front();
+  }
+  if (t->ec) {
+    ec = std::move(t->ec);
+    return false;
+  }
+  out = std::move(t->out);
+  out.pos() = 0; // Buffer move keeps the destination position
+  // keep decoders busy while the caller consumes this chunk
+  return schedule(ec);
+}
+
+std::unique_ptr<ParallelDecoder> MakeChunkDecoder(ReadAt &&readAt, std::vector<Chunk> &&chunks, DecodeChunk &&decode) {
+  if (chunks.size() < 2) {
+    return nullptr;
+  }
+  uint64_t maxMemory = 0;
+  for (const auto &c : chunks) {
+    maxMemory = (std::max)(maxMemory, c.compressedSize + c.decompressedSize);
+  }
+  auto threads = static_cast<int>((std::min)(static_cast<size_t>(DecoderThreads()), chunks.size()));
+  auto window = ChunkWindow(maxMemory, threads);
+  if (threads < 2 || window < 2) {
+    return nullptr;
+  }
+  ChunkSource source = [readAt = std::move(readAt), chunks = std::move(chunks), next = size_t{0}](
+                           Chunk &chunk, Buffer &in, bela::error_code &ec) mutable -> bool {
+    if (next == chunks.size()) {
+      ec = bela::make_error_code(ErrEnded, L"chunks end");
+      return false;
+    }
+    chunk = chunks[next];
+    in.grow(static_cast<size_t>(chunk.compressedSize));
+    if (!readAt(in.data(), static_cast<size_t>(chunk.compressedSize), chunk.offset, ec)) {
+      return false;
+    }
+    in.size() = static_cast<size_t>(chunk.compressedSize);
+    next++;
+    return true;
+  };
+  return std::make_unique<ParallelDecoder>(std::move(source), std::move(decode), threads, window);
+}
+
+} // namespace baulk::archive
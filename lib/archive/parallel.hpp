@@ -0,0 +1,76 @@
+//
+#ifndef BAULK_ARCHIVE_PARALLEL_HPP
+#define BAULK_ARCHIVE_PARALLEL_HPP
+#include <archive.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace baulk::archive {
+// ReadAt positional read of the whole range, pos is relative to the start of the compressed data
+using ReadAt = std::function<bool(void *buffer, size_t len, int64_t pos, bela::error_code &ec)>;
+
+// Chunk independently decodable part of a compressed stream (xz block, zstd frame, bzip2 block, lz4 block)
+struct Chunk {
+  int64_t offset{0};
+  uint64_t compressedSize{0};
+  uint64_t decompressedSize{0}; // exact size or an initial capacity, the decoder sets the output size
+  uint32_t flags{0};            // codec specific
+};
+
+// ChunkSource fill in with the next chunk, false with ErrEnded after the last chunk. Called on the consumer thread.
+using ChunkSource = std::function<bool(Chunk &chunk, Buffer &in, bela::error_code &ec)>;
+// DecodeChunk decode the index-th chunk from in into out, out has decompressedSize capacity
+using DecodeChunk =
+    std::function<bool(size_t index, const Chunk &chunk, const Buffer &in, Buffer &out, bela::error_code &ec)>;
+
+// DecoderThreads hardware threads available for chunk decoding
+int DecoderThreads();
+// ChunkWindow chunks in flight for threads decoders within the memory budget
+size_t ChunkWindow(uint64_t maxChunkMemory, int threads);
+
+// ParallelDecoder decodes chunks on worker threads and returns their output in stream order. Chunks are read on the
+// calling thread, so the source needs no synchronization. At most window chunks are held in memory.
+class ParallelDecoder {
+public:
+  ParallelDecoder(ChunkSource &&source_, DecodeChunk &&decode_, int threads, size_t window_);
+  ParallelDecoder(const ParallelDecoder &) = delete;
+  ParallelDecoder &operator=(const ParallelDecoder &) = delete;
+  ~ParallelDecoder();
+  // Next swap the next decoded chunk into out, ErrEnded after the last chunk
+  bool Next(Buffer &out, bela::error_code &ec);
+
+private:
+  struct task {
+    size_t index{0};
+    Chunk chunk;
+    Buffer in;
+    Buffer out;
+    bela::error_code ec;
+    bool done{false};
+  };
+  bool schedule(bela::error_code &ec);
+  void run();
+  ChunkSource source;
+  DecodeChunk decode;
+  size_t next{0};   // index of the next chunk
+  size_t window{1}; // scheduled chunks not yet returned
+  bool eof{false};
+  std::deque<std::unique_ptr<task>> inflight;
+  std::deque<task *> queue;
+  std::vector<std::thread> workers;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::condition_variable cvDone;
+  bool closed{false};
+};
+
+// MakeChunkDecoder decoder over a chunk list located in advance, nullptr when parallel decoding is not worthwhile
+std::unique_ptr<ParallelDecoder> MakeChunkDecoder(ReadAt &&readAt, std::vector<Chunk> &&chunks, DecodeChunk &&decode);
+
+} // namespace baulk::archive
+
+#endif
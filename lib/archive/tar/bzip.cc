@@ -9,6 +9,17 @@ Reader::~Reader() {
   }
 }
 bool Reader::Initialize(bela::error_code &ec) {
+  if (fr != nullptr) {
+    mt = baulk::archive::bzip::NewParallelDecoder(
+        [this](void *buffer, size_t len, bela::error_code &ec) { return fr->Read(buffer, len, ec); });
+    if (mt) {
+      return true;
+    }
+  }
+  return initializeSerial(ec);
+}
+
+bool Reader::initializeSerial(bela::error_code &ec) {
   bzs = baulk::archive::archive_internal::Allocate<bz_stream>(1);
   memset(bzs, 0, sizeof(bz_stream));
   if (auto bzerr = BZ2_bzDecompressInit(bzs, 0, 0); bzerr != BZ_OK) {
@@ -20,7 +31,29 @@ bool Reader::Initialize(bela::error_code &ec) {
   return true;
 }
 
+// recoverSerial: a block magic inside compressed data splits a block in two and neither part decodes. Rare enough to
+// restart with the serial decoder, which also reports the error of truly corrupt data.
+bool Reader::recoverSerial(bela::error_code &ec) {
+  mt.reset();
+  if (!fr->PositionAt(0, ec) || !initializeSerial(ec)) {
+    return false;
+  }
+  skipBytes = delivered;
+  return decompress(ec);
+}
+
 bool Reader::decompress(bela::error_code &ec) {
+  if (mt) {
+    // decoded blocks keep stream order, ErrEnded after the last one
+    if (mt->Next(out, ec)) {
+      delivered += static_cast<int64_t>(out.size());
+      return true;
+    }
+    if (ec.code == bela::ErrEnded) {
+      return false;
+    }
+    return recoverSerial(ec);
+  }
   if (ret == BZ_STREAM_END) {
     ec = bela::make_error_code(bela::ErrEnded, L"bzip stream end");
     return false;
@@ -47,10 +80,15 @@ bool Reader::decompress(bela::error_code &ec) {
     default:
       break;
     }
-    auto have = outsize - bzs->avail_out;
+    auto have = out.capacity() - bzs->avail_out;
     out.size() = have;
     out.pos() = 0;
-    if (have != 0) {
+    if (skipBytes != 0) {
+      auto skip = (std::min)(static_cast<size_t>(skipBytes), have);
+      out.pos() = skip;
+      skipBytes -= static_cast<int64_t>(skip);
+    }
+    if (out.pos() != out.size() || ret == BZ_STREAM_END) {
       break;
     }
   }
@@ -3,11 +3,14 @@
 #define BAULK_ARCHIVE_TAR_BZIP_HPP
 #include "tarinternal.hpp"
 #include <bzlib.h>
+#include "../bzipblocks.hpp"
 
 namespace baulk::archive::tar::bzip {
 class Reader : public ExtractReader {
 public:
   Reader(ExtractReader *lr) : r(lr) {} // source reader
+  // seekable input, blocks are decoded in parallel
+  Reader(FileReader *fr_) : r(fr_), fr(fr_) {}
   Reader(const Reader &) = delete;
   Reader &operator=(const Reader &) = delete;
   ~Reader();
@@ -18,7 +21,13 @@ public:
 
 private:
   bool decompress(bela::error_code &ec);
+  bool initializeSerial(bela::error_code &ec);
+  bool recoverSerial(bela::error_code &ec);
   ExtractReader *r{nullptr};
+  FileReader *fr{nullptr};
+  std::unique_ptr<baulk::archive::ParallelDecoder> mt;
+  int64_t delivered{0}; // bytes returned by the parallel decoder
+  int64_t skipBytes{0}; // already returned bytes the serial decoder drops after recovery
   bz_stream *bzs{nullptr};
   Buffer in;
   Buffer out;
@@ -6,6 +6,7 @@
 #include "brotli.hpp"
 #include "gzip.hpp"
 #include "xz.hpp"
+#include "lz4.hpp"
 
 namespace baulk::archive::tar {
 // https://github.com/file/file/blob/6fc66d12c0ca172f4681adb63c6f662ac33cbc7c/magic/Magdir/compress
@@ -54,6 +55,13 @@ std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, bela::error_code &ec)
     }
     return nullptr;
   }
+  // LZ4 frame or legacy frame
+  if (zstdmagic == baulk::archive::lz4::frameMagic || zstdmagic == baulk::archive::lz4::legacyMagic) {
+    if (auto r = std::make_shared<lz4::Reader>(&fd); r->Initialize(ec)) {
+      return r;
+    }
+    return nullptr;
+  }
   // vaild is good tar file. must >=512 bytes
   if (n == 512) {
     if (auto uh = reinterpret_cast<const ustar_header *>(magic); getFormat(*uh) != FormatUnknown) {
@@ -0,0 +1,461 @@
+//
+#include "tarinternal.hpp"
+#include "pipeline.hpp"
+#include <bela/path.hpp>
+#include <filesystem>
+#include <algorithm>
+
+namespace baulk::archive::tar {
+
+inline std::string_view archiveDirName(std::string_view name) {
+  while (!name.empty() && name.back() == '/') {
+    name.remove_suffix(1);
+  }
+  if (auto pos = name.rfind('/'); pos != std::string_view::npos) {
+    return name.substr(0, pos);
+  }
+  return "";
+}
+
+// copyFile symlink fallback when the process is not allowed to create symlinks
+inline bool copyFile(std::wstring_view path, std::wstring_view source, bela::error_code &ec) {
+  if (CopyFileW(source.data(), path.data(), FALSE) != TRUE) {
+    ec = bela::make_system_error_code(L"CopyFileW ");
+    return false;
+  }
+  return true;
+}
+
+bool Extractor::extractDir(std::wstring_view path, bela::error_code &ec) { return dirs.MakeDir(path, ec); }
+
+bool Extractor::extractFile(const Header &h, std::wstring_view path, bela::error_code &ec) {
+  auto fd = baulk::archive::NewFD(path, ec, opts.overwrite, &dirs);
+  if (!fd) {
+    return false;
+  }
+  baulk::archive::FileSink sink(std::move(*fd), path, h.Size);
+  // zero-size files only need the handle created
+  if (h.Size != 0) {
+    auto w = [&](const void *data, size_t len, bela::error_code &ec) -> bool {
+      decompressed += static_cast<int64_t>(len);
+      return sink.Write(data, len, ec);
+    };
+    if (!(rr != nullptr ? rr->WriteTo(w, dataOffset, h.Size, ec) : tr->WriteTo(w, h.Size, ec))) {
+      return false;
+    }
+  }
+  return sink.Close(h.ModTime, ec);
+}
+
+// extractSparse only the data fragments are written, holes are skipped and stay unallocated
+bool Extractor::extractSparse(const Header &h, std::wstring_view path, bela::error_code &ec) {
+  auto fd = baulk::archive::NewFD(path, ec, opts.overwrite, &dirs);
+  if (!fd) {
+    return false;
+  }
+  // FAT and exFAT have no sparse files, the holes are then written as zeros by the file system
+  bela::error_code se;
+  fd->SetSparse(se);
+  auto w = [&](const void *data, size_t len, bela::error_code &ec) -> bool {
+    decompressed += static_cast<int64_t>(len);
+    return fd->Write(data, len, ec);
+  };
+  auto hole = [&](int64_t len, bela::error_code &ec) -> bool { return fd->Seek(len, ec); };
+  // a trailing hole moves the file pointer past the data, the file size is set there. The time is set last like
+  // FileSink does, no later write touches it
+  if (!tr->WriteTo(w, hole, h.Size, ec) || !fd->Truncate(ec) || !fd->SetTime(h.ModTime, ec)) {
+    fd->Discard();
+    return false;
+  }
+  return true;
+}
+
+// linkSource destination path of a link target, symlinks are relative to the entry's directory and hardlinks to the
+// archive root, std::nullopt when the target escapes destination. Drive letters (C:/x, C:x), rooted and UNC paths
+// (\x, \\server\share) are never joined: Windows resolves them on their own and a symlink keeps the raw target.
+std::optional<std::wstring> Extractor::linkSource(const Header &h) const {
+  if (h.LinkName.starts_with('\\') || h.LinkName.find(':') != std::string_view::npos) {
+    return std::nullopt;
+  }
+  if (h.Typeflag == TypeLink) {
+    return baulk::archive::PathCat(destination, h.LinkName);
+  }
+  if (h.LinkName.starts_with('/')) {
+    return std::nullopt;
+  }
+  return baulk::archive::PathCat(destination, bela::StringCat(archiveDirName(h.Name), "/", h.LinkName));
+}
+
+bool Extractor::extractSymlink(const Header &h, std::wstring_view path, std::wstring &&source,
+                               bela::error_code &ec) {
+  if (h.LinkName.empty()) {
+    ec = bela::make_error_code(ErrGeneral, L"symlink '", path, L"' linkname is empty");
+    return false;
+  }
+  auto linkname = bela::ToWide(h.LinkName);
+  if (bela::PathExists(source, bela::FileAttribute::Dir) && !bela::IsPathSeparator(linkname.back())) {
+    linkname.push_back('/');
+  }
+  if (baulk::archive::NewSymlink(path, linkname, ec, opts.overwrite)) {
+    return true;
+  }
+  if (ec.code != ERROR_PRIVILEGE_NOT_HELD) {
+    return false;
+  }
+  // Developer Mode disabled and not elevated: copy the target
+  if (bela::PathExists(source, bela::FileAttribute::Dir)) {
+    ec = bela::make_error_code(ERROR_PRIVILEGE_NOT_HELD, L"unable create directory symlink '", path, L"'");
+    return false;
+  }
+  links.emplace_back(deferred{std::wstring(path), std::move(source)});
+  ec.clear();
+  return true;
+}
+
+bool Extractor::extractHardlink(std::wstring_view path, std::wstring &&source) {
+  links.emplace_back(deferred{std::wstring(path), std::move(source)});
+  return true;
+}
+
+// resolveDeferred: link sources may appear after the link itself in the archive, so links are created once the
+// stream has been fully read. Hardlinks fall back to copies on file systems without hardlink support.
+bool Extractor::resolveDeferred(bela::error_code &ec) {
+  for (const auto &l : links) {
+    std::error_code e;
+    std::filesystem::remove(l.path, e);
+    if (CreateHardLinkW(l.path.data(), l.source.data(), nullptr) == TRUE) {
+      continue;
+    }
+    if (!copyFile(l.path, l.source, ec)) {
+      ec = bela::make_error_code(ec.code, L"link '", l.path, L"' to '", l.source, L"' error: ", ec.message);
+      return false;
+    }
+  }
+  links.clear();
+  return true;
+}
+
+// submitFile pipelined file extraction: data stays in the source blocks, writer threads write the slices
+bool Extractor::submitFile(const Header &h, std::wstring_view path, bela::error_code &ec) {
+  auto job = writers->Submit(path, h.ModTime, h.Size);
+  auto closer = bela::finally([&] { writers->Seal(job); });
+  if (h.Size == 0) {
+    return true;
+  }
+  return tr->WriteTo(
+      [&](const void *data, size_t len, bela::error_code &) -> bool {
+        decompressed += static_cast<int64_t>(len);
+        writers->Push(job, pipeline::Slice{source->Current(), reinterpret_cast<const uint8_t *>(data), len});
+        return !writers->Failed();
+      },
+      h.Size, ec);
+}
+
+// reuseFile compare the entry data with existing while decoding it, identical data links path to existing. At the first
+// difference the equal prefix is copied from existing and the rest of the entry written on the calling thread.
+bool Extractor::reuseFile(const Header &h, std::wstring_view path, std::wstring_view existing, bela::error_code &ec) {
+  bela::error_code oec;
+  auto fr = OpenFile(existing, oec);
+  if (!fr) {
+    return writers != nullptr ? submitFile(h, path, ec) : extractFile(h, path, ec);
+  }
+  std::optional<baulk::archive::FileSink> sink;
+  int64_t same = 0;
+  auto diverge = [&](bela::error_code &ec) -> bool {
+    auto fd = baulk::archive::NewFD(path, ec, opts.overwrite, &dirs);
+    if (!fd) {
+      return false;
+    }
+    sink.emplace(std::move(*fd), path, h.Size);
+    for (int64_t pos = 0; pos < same;) {
+      auto n = static_cast<size_t>((std::min)(same - pos, static_cast<int64_t>(compare.capacity())));
+      if (!fr->ReadFullAt(compare.data(), n, pos, ec) || !sink->Write(compare.data(), n, ec)) {
+        return false;
+      }
+      pos += static_cast<int64_t>(n);
+    }
+    return true;
+  };
+  auto w = [&](const void *data, size_t len, bela::error_code &ec) -> bool {
+    decompressed += static_cast<int64_t>(len);
+    if (!sink) {
+      compare.grow(len);
+      bela::error_code rec;
+      if (fr->ReadFullAt(compare.data(), len, same, rec) && memcmp(compare.data(), data, len) == 0) {
+        same += static_cast<int64_t>(len);
+        return true;
+      }
+      if (!diverge(ec)) {
+        return false;
+      }
+    }
+    return sink->Write(data, len, ec);
+  };
+  if (!(rr != nullptr ? rr->WriteTo(w, dataOffset, h.Size, ec) : tr->WriteTo(w, h.Size, ec))) {
+    return false;
+  }
+  if (sink) {
+    return sink->Close(h.ModTime, ec);
+  }
+  if (dirs.MakeParent(path, ec) && CreateHardLinkW(path.data(), existing.data(), nullptr) == TRUE) {
+    reused.emplace(pipeline::pathKey(path));
+    if (opts.onReused) {
+      opts.onReused(h, path);
+    }
+    return true;
+  }
+  // path exists, another volume or no hard links: copy the identical file
+  ec.clear();
+  return diverge(ec) && sink->Close(h.ModTime, ec);
+}
+
+bool Extractor::selected(std::string_view name) const {
+  if (opts.patterns.empty()) {
+    return true;
+  }
+  return std::any_of(opts.patterns.begin(), opts.patterns.end(),
+                     [&](const std::string &p) { return Match(p, name); });
+}
+
+// streamLimit header offset of the last selected entry, -1 when nothing is selected, INT64_MAX without an index
+int64_t Extractor::streamLimit() const {
+  if (opts.index == nullptr || opts.patterns.empty()) {
+    return INT64_MAX;
+  }
+  int64_t limit = -1;
+  for (const auto &e : opts.index->Entries()) {
+    if (selected(e.Name)) {
+      limit = (std::max)(limit, e.HeaderOffset);
+    }
+  }
+  return limit;
+}
+
+void Extractor::skip(const Header &h, std::wstring_view reason) const {
+  if (opts.onSkip) {
+    opts.onSkip(h, reason);
+  }
+}
+
+bool Extractor::extractEntry(const Header &h, std::wstring_view path, bela::error_code &ec) {
+  std::optional<std::wstring> source;
+  if (h.Typeflag == TypeSymlink || h.Typeflag == TypeLink) {
+    // links escaping destination are skipped like escaping paths, the rest of the archive is still extracted
+    if (source = linkSource(h); !source) {
+      skip(h, L"link target outside destination");
+      return true;
+    }
+  }
+  if (opts.onEntry) {
+    opts.onEntry(h, path);
+  }
+  if (writers != nullptr) {
+    // a writer may still be writing an earlier entry at path, tar entries replace it in archive order
+    writers->WaitPath(path);
+  }
+  if (!reused.empty()) {
+    // an earlier entry linked path to an existing file, writing through the link would change that file
+    if (auto it = reused.find(pipeline::pathKey(path)); it != reused.end()) {
+      DeleteFileW(path.data());
+      reused.erase(it);
+    }
+  }
+  auto ret = true;
+  switch (h.Typeflag) {
+  case TypeDir:
+    ret = extractDir(path, ec);
+    break;
+  case TypeSymlink:
+    ret = extractSymlink(h, path, std::move(*source), ec);
+    break;
+  case TypeLink:
+    ret = extractHardlink(path, std::move(*source));
+    break;
+  case TypeReg:
+  case TypeCont:
+  case TypeGNUSparse:
+    // sparse files are written on the calling thread, their data is small next to the holes
+    if (!h.Sparse.empty()) {
+      ret = extractSparse(h, path, ec);
+      break;
+    }
+    if (opts.onReuse && h.Size != 0) {
+      if (auto candidate = opts.onReuse(h, path); candidate) {
+        ret = reuseFile(h, path, *candidate, ec);
+        break;
+      }
+    }
+    ret = writers != nullptr ? submitFile(h, path, ec) : extractFile(h, path, ec);
+    break;
+  default:
+    // char/block devices and FIFOs have no meaning on Windows
+    return true;
+  }
+  if (!ret) {
+    ec = bela::make_error_code(ec.code, L"extract '", path, L"' error: ", ec.message);
+    return false;
+  }
+  extracted++;
+  return true;
+}
+
+bool Extractor::extractEntries(bela::error_code &ec) {
+  auto limit = streamLimit();
+  if (limit < 0) {
+    return true;
+  }
+  for (;;) {
+    auto fh = tr->Next(ec);
+    if (!fh) {
+      if (ec.code == bela::ErrEnded) {
+        ec.clear();
+        return true;
+      }
+      return false;
+    }
+    if (opts.record != nullptr) {
+      opts.record->Add(*fh, tr->HeaderOffset(), tr->DataOffset());
+    }
+    if (fh->Typeflag != TypeXGlobalHeader && selected(fh->Name)) {
+      // dangerous path or archive root are skipped
+      auto path = baulk::archive::PathCat(destination, fh->Name);
+      if (!path) {
+        skip(*fh, L"path outside destination");
+      } else if (!extractEntry(*fh, *path, ec)) {
+        return false;
+      }
+    }
+    // the rest of the stream holds no selected entry
+    if (tr->HeaderOffset() >= limit) {
+      return true;
+    }
+  }
+}
+
+// extractPipelined: a decompressor thread fills a bounded ring of blocks, entries are parsed on the calling thread
+// and file data is handed to writer threads as slices of those blocks. Directories and symlinks are created on the
+// calling thread so later entries can rely on them, links to files are resolved after all writers finished.
+bool Extractor::extractPipelined(bela::error_code &ec) {
+  auto blockSize = static_cast<size_t>(
+      (std::clamp)(opts.memoryLimit / 8, static_cast<uint64_t>(pipeline::minBlockSize),
+                   static_cast<uint64_t>(pipeline::maxBlockSize)));
+  auto maxBlocks = (std::max)(static_cast<size_t>(opts.memoryLimit / blockSize), pipeline::minBlocks);
+  auto n = opts.writers;
+  if (n <= 0) {
+    n = static_cast<int>((std::clamp)(std::thread::hardware_concurrency() / 2, 1u, 8u));
+  }
+  pipeline::Source src(r, blockSize, maxBlocks);
+  pipeline::Writers ws(n, opts.overwrite, &dirs, [&] { src.Cancel(); });
+  src.Start();
+  Reader reader(&src);
+  tr = &reader;
+  source = &src;
+  writers = &ws;
+  auto closer = bela::finally([&] {
+    tr = nullptr;
+    source = nullptr;
+    writers = nullptr;
+  });
+  if (!extractEntries(ec)) {
+    // report the write error rather than the cancellation it caused
+    if (ws.Failed()) {
+      ws.Wait(ec);
+    }
+    return false;
+  }
+  if (!ws.Wait(ec)) {
+    return false;
+  }
+  return resolveDeferred(ec);
+}
+
+bool Extractor::Extract(bela::error_code &ec) {
+  if (r == nullptr) {
+    ec = bela::make_error_code(ErrGeneral, L"tar reader is null");
+    return false;
+  }
+  if (opts.memoryLimit != 0) {
+    return extractPipelined(ec);
+  }
+  Reader reader(r);
+  tr = &reader;
+  auto closer = bela::finally([&] { tr = nullptr; });
+  if (!extractEntries(ec)) {
+    return false;
+  }
+  return resolveDeferred(ec);
+}
+
+// ExtractIndexed: a hardlink needs its source on disk, so the sources of selected hardlinks are extracted too
+bool Extractor::ExtractIndexed(const Index &index, RandomReader &rr_, bela::error_code &ec) {
+  const auto &entries = index.Entries();
+  std::vector<bool> want(entries.size(), false);
+  bela::flat_hash_map<std::string_view, size_t> byName;
+  for (size_t i = 0; i < entries.size(); i++) {
+    byName[entries[i].Name] = i;
+    want[i] = selected(entries[i].Name);
+  }
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (want[i] && entries[i].Typeflag == TypeLink) {
+      if (auto it = byName.find(entries[i].LinkName); it != byName.end()) {
+        want[it->second] = true;
+      }
+    }
+  }
+  rr = &rr_;
+  auto closer = bela::finally([&] { rr = nullptr; });
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (!want[i]) {
+      continue;
+    }
+    const auto &e = entries[i];
+    Header h{.Name = e.Name,
+             .LinkName = e.LinkName,
+             .Size = e.Size,
+             .Mode = e.Mode,
+             .ModTime = bela::FromUnix(e.ModTime, 0),
+             .Typeflag = e.Typeflag};
+    auto path = baulk::archive::PathCat(destination, e.Name);
+    if (!path) {
+      skip(h, L"path outside destination");
+      continue;
+    }
+    if (e.Sparse) {
+      // the sparse map is not indexed, read the entry's headers again
+      randomStream rs(rr_, e.HeaderOffset);
+      Reader reader(&rs);
+      auto fh = reader.Next(ec);
+      if (!fh) {
+        return false;
+      }
+      tr = &reader;
+      auto ret = extractEntry(*fh, *path, ec);
+      tr = nullptr;
+      if (!ret) {
+        return false;
+      }
+      continue;
+    }
+    dataOffset = e.DataOffset;
+    if (!extractEntry(h, *path, ec)) {
+      return false;
+    }
+  }
+  return resolveDeferred(ec);
+}
+
+bool Extract(std::wstring_view file, std::wstring_view destination, const ExtractorOptions &opts,
+             bela::error_code &ec) {
+  auto fr = OpenFile(file, ec);
+  if (fr == nullptr) {
+    return false;
+  }
+  auto wr = MakeReader(*fr, ec);
+  if (wr == nullptr && ec.code != ErrNoFilter) {
+    return false;
+  }
+  Extractor extractor(wr != nullptr ? wr.get() : static_cast<ExtractReader *>(fr.get()), destination, opts);
+  return extractor.Extract(ec);
+}
+
+} // namespace baulk::archive::tar
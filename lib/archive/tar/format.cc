@@ -1,30 +1,102 @@
 ///
 #include <charconv>
+#include <bit>
 #include "tarinternal.hpp"
+#include <bela/str_join_narrow.hpp>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BAULK_TAR_SSE2 1
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define BAULK_TAR_NEON 1
+#include <arm_neon.h>
+#endif
 
 namespace baulk::archive::tar {
-inline bool IsChecksumEqual(const ustar_header &hdr) {
+constexpr size_t checksumOffset = 148;
+constexpr size_t checksumSize = 8;
+
+// blockSums sum of the bytes of a 512 byte block and the number of bytes with the high bit set
+inline void blockSums(const uint8_t *p, uint32_t &sum, uint32_t &high) {
+#if defined(BAULK_TAR_SSE2)
+  auto zero = _mm_setzero_si128();
+  auto acc = _mm_setzero_si128();
+  uint32_t h = 0;
+  for (size_t i = 0; i < blockSize; i += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+    h += static_cast<uint32_t>(std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(v))));
+  }
+  sum = static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+  high = h;
+#elif defined(BAULK_TAR_NEON)
+  uint32_t s = 0;
+  uint32_t h = 0;
+  for (size_t i = 0; i < blockSize; i += 16) {
+    auto v = vld1q_u8(p + i);
+    s += vaddlvq_u8(v);
+    h += vaddvq_u8(vshrq_n_u8(v, 7));
+  }
+  sum = s;
+  high = h;
+#else
+  uint32_t s = 0;
+  uint32_t h = 0;
+  for (size_t i = 0; i < blockSize; i++) {
+    s += p[i];
+    h += p[i] >> 7;
+  }
+  sum = s;
+  high = h;
+#endif
+}
+
+bool isZeroBlock(const ustar_header &hdr) {
   auto p = reinterpret_cast<const uint8_t *>(&hdr);
-  auto value = parseNumeric(hdr.chksum);
-  int64_t check = 0;
-  int64_t scheck = 0;
-  int i;
-  for (i = 0; i < 148; i++) {
-    check += p[i];
-    scheck = static_cast<int8_t>(p[i]);
+  // headers start with a name, the first chunk usually decides
+#if defined(BAULK_TAR_SSE2)
+  auto zero = _mm_setzero_si128();
+  for (size_t i = 0; i < blockSize; i += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xFFFF) {
+      return false;
+    }
   }
-  check += 256;
-  scheck += 256;
-  i = 156;
-  for (; i < 512; i++) {
-    check += p[i];
-    scheck = static_cast<int8_t>(p[i]);
+#elif defined(BAULK_TAR_NEON)
+  for (size_t i = 0; i < blockSize; i += 16) {
+    if (vmaxvq_u8(vld1q_u8(p + i)) != 0) {
+      return false;
+    }
+  }
+#else
+  for (size_t i = 0; i < blockSize; i += sizeof(uint64_t)) {
+    uint64_t v;
+    memcpy(&v, p + i, sizeof(v));
+    if (v != 0) {
+      return false;
+    }
+  }
+#endif
+  return true;
+}
+
+// validChecksum the checksum field counts as eight spaces, historic tars summed signed chars
+inline bool validChecksum(const ustar_header &hdr) {
+  auto p = reinterpret_cast<const uint8_t *>(&hdr);
+  uint32_t sum = 0;
+  uint32_t high = 0;
+  blockSums(p, sum, high);
+  for (size_t i = checksumOffset; i < checksumOffset + checksumSize; i++) {
+    sum -= p[i];
+    high -= p[i] >> 7;
   }
-  return (check == value || scheck == value);
+  auto usum = static_cast<int64_t>(sum) + static_cast<int64_t>(checksumSize) * ' ';
+  auto ssum = usum - 256 * static_cast<int64_t>(high);
+  auto value = parseNumeric(hdr.chksum);
+  return value == usum || value == ssum;
 }
 
 tar_format_t getFormat(const ustar_header &hdr) {
-  if (!IsChecksumEqual(hdr)) {
+  if (!validChecksum(hdr)) {
     return FormatUnknown;
   }
   auto star = reinterpret_cast<const star_header *>(&hdr);
@@ -99,97 +171,137 @@ bool parsePAXTime(std::string_view p, bela::Time &t, bela::error_code &ec) {
   }
   int64_t sec = 0;
   auto res = std::from_chars(ss.data(), ss.data() + ss.size(), sec);
-  if (res.ec != std::errc{}) {
+  if (res.ec != std::errc{} || res.ptr != ss.data() + ss.size()) {
     ec = bela::make_error_code(bela::ErrGeneral, L"unable parse number '", bela::ToWide(ss), L"'");
     return false;
   }
-  if (sn.empty()) {
-    t = bela::FromUnix(sec, 0);
-    return true;
-  }
-  /* Calculate nanoseconds. */
+  // nanoseconds: the first nine fraction digits
   int64_t nsec{0};
-  std::from_chars(ss.data(), ss.data() + ss.size(), sec);
+  for (size_t i = 0; i < 9; i++) {
+    nsec *= 10;
+    if (i >= sn.size()) {
+      continue;
+    }
+    if (sn[i] < '0' || sn[i] > '9') {
+      ec = bela::make_error_code(bela::ErrGeneral, L"unable parse time '", bela::ToWide(p), L"'");
+      return false;
+    }
+    nsec += sn[i] - '0';
+  }
+  if (ss.starts_with('-')) {
+    nsec = -nsec;
+  }
   t = bela::FromUnix(sec, nsec);
   return true;
 }
 
-bool mergePAX(Header &h, pax_records_t &paxHdrs, bela::error_code &ec) {
-  for (const auto &[k, v] : paxHdrs) {
-    if (v.empty()) {
-      continue;
-    }
-    if (k == paxPath) {
-      h.Name = v;
-      continue;
-    }
-    if (k == paxLinkpath) {
-      h.LinkName = v;
-      continue;
-    }
-    if (k == paxUname) {
-      h.Uname = v;
-      continue;
-    }
-    if (k == paxGname) {
-      h.Gname = v;
-      continue;
-    }
-    if (k == paxUid) {
-      int64_t id{0};
-      auto res = std::from_chars(v.data(), v.data() + v.size(), id);
-      if (res.ec != std::errc{}) {
-        ec = bela::make_error_code(bela::ErrGeneral, L"unable parse uid number '", bela::ToWide(v), L"'");
-        return false;
-      }
-      h.UID = static_cast<int>(id);
-      continue;
-    }
-    if (k == paxGid) {
-      int64_t id{0};
-      auto res = std::from_chars(v.data(), v.data() + v.size(), id);
-      if (res.ec != std::errc{}) {
-        ec = bela::make_error_code(bela::ErrGeneral, L"unable parse gid number '", bela::ToWide(v), L"'");
-        return false;
-      }
-      h.GID = static_cast<int>(id);
-      continue;
-    }
-    if (k == paxAtime) {
-      if (parsePAXTime(v, h.AccessTime, ec)) {
-        return false;
-      }
-      continue;
-    }
-    if (k == paxMtime) {
-      if (parsePAXTime(v, h.ModTime, ec)) {
-        return false;
-      }
-      continue;
-    }
-    if (k == paxCtime) {
-      if (parsePAXTime(v, h.ChangeTime, ec)) {
-        return false;
-      }
-      continue;
-    }
-    if (k == paxSize) {
-      int64_t size{0};
-      auto res = std::from_chars(v.data(), v.data() + v.size(), size);
-      if (res.ec != std::errc{}) {
-        ec = bela::make_error_code(bela::ErrGeneral, L"unable parse size number '", bela::ToWide(v), L"'");
-        return false;
-      }
-      h.Size = size;
-      continue;
-    }
-    if (k.starts_with(paxSchilyXattr)) {
-      h.Xattrs.emplace(k.substr(paxSchilyXattr.size()), v);
-    }
+inline bool parsePAXNumber(std::string_view k, std::string_view v, int64_t &n, bela::error_code &ec) {
+  auto res = std::from_chars(v.data(), v.data() + v.size(), n);
+  if (res.ec != std::errc{}) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"unable parse ", bela::ToWide(k), L" number '", bela::ToWide(v),
+                               L"'");
+    return false;
   }
-  h.PAXRecords = std::move(paxHdrs);
   return true;
 }
+
+// mergePAX apply the records of pax to h, names are views of pax
+bool mergePAX(Header &h, std::string_view pax, bela::error_code &ec) {
+  h.PAX = pax;
+  return forEachPAXRecord(
+      pax,
+      [&](std::string_view k, std::string_view v) -> bool {
+        if (v.empty()) {
+          return true;
+        }
+        int64_t n{0};
+        if (k == paxPath) {
+          h.Name = v;
+        } else if (k == paxLinkpath) {
+          h.LinkName = v;
+        } else if (k == paxUname) {
+          h.Uname = v;
+        } else if (k == paxGname) {
+          h.Gname = v;
+        } else if (k == paxUid) {
+          if (!parsePAXNumber(k, v, n, ec)) {
+            return false;
+          }
+          h.UID = static_cast<int>(n);
+        } else if (k == paxGid) {
+          if (!parsePAXNumber(k, v, n, ec)) {
+            return false;
+          }
+          h.GID = static_cast<int>(n);
+        } else if (k == paxAtime) {
+          return parsePAXTime(v, h.AccessTime, ec);
+        } else if (k == paxMtime) {
+          return parsePAXTime(v, h.ModTime, ec);
+        } else if (k == paxCtime) {
+          return parsePAXTime(v, h.ChangeTime, ec);
+        } else if (k == paxSize) {
+          if (!parsePAXNumber(k, v, n, ec)) {
+            return false;
+          }
+          h.Size = n;
+        }
+        return true;
+      },
+      ec);
+}
+
+std::optional<std::string_view> Header::PAXRecord(std::string_view key) const {
+  std::optional<std::string_view> value;
+  bela::error_code ec;
+  forEachPAXRecord(
+      PAX,
+      [&](std::string_view k, std::string_view v) {
+        if (k == key) {
+          value = v;
+        }
+        return true;
+      },
+      ec);
+  return value;
+}
+
+// PAXRecords GNU sparse 0.0 offset and numbytes pairs are joined into GNU.sparse.map
+pax_records_t Header::PAXRecords() const {
+  pax_records_t records;
+  std::vector<std::string_view> sparseMap;
+  bela::error_code ec;
+  forEachPAXRecord(
+      PAX,
+      [&](std::string_view k, std::string_view v) {
+        if (k == paxGNUSparseOffset || k == paxGNUSparseNumBytes) {
+          sparseMap.emplace_back(v);
+          return true;
+        }
+        records.insert_or_assign(std::string(k), std::string(v));
+        return true;
+      },
+      ec);
+  if (!sparseMap.empty()) {
+    records.insert_or_assign(std::string(paxGNUSparseMap), bela::narrow::StrJoin(sparseMap, ","));
+  }
+  return records;
+}
+
+pax_records_t Header::Xattrs() const {
+  pax_records_t xattrs;
+  bela::error_code ec;
+  forEachPAXRecord(
+      PAX,
+      [&](std::string_view k, std::string_view v) {
+        if (k.starts_with(paxSchilyXattr)) {
+          xattrs.insert_or_assign(std::string(k.substr(paxSchilyXattr.size())), std::string(v));
+        }
+        return true;
+      },
+      ec);
+  return xattrs;
+}
+
 bool validPAXRecord(std::string_view k, std::string_view v) {
   if (k.empty() || k.find('=') != std::string_view::npos) {
     return false;
@@ -207,8 +319,9 @@ bool parsePAXRecord(std::string_view *sv, std::string_view *k, std::string_view
     ec = bela::make_error_code(L"invalid tar header");
     return false;
   }
-  int n = 0;
-  if (auto res = std::from_chars(sv->data(), sv->data() + pos, n); res.ec != std::errc{} || n > sv->size()) {
+  size_t n = 0;
+  if (auto res = std::from_chars(sv->data(), sv->data() + pos, n);
+      res.ec != std::errc{} || n > sv->size() || n <= pos + 1) {
     ec = bela::make_error_code(bela::ErrGeneral, L"invalid number '", bela::ToWide(sv->substr(0, pos)), L"'");
     return false;
   }
@@ -223,12 +336,12 @@ bool parsePAXRecord(std::string_view *sv, std::string_view *k, std::string_view
     ec = bela::make_error_code(L"invalid tar header");
     return false;
   }
+  *k = rec.substr(0, pos);
+  *v = rec.substr(pos + 1);
   if (!validPAXRecord(*k, *v)) {
     ec = bela::make_error_code(L"invalid tar header");
     return false;
   }
-  *k = rec.substr(0, pos);
-  *v = rec.substr(pos + 1);
   sv->remove_prefix(n);
   return true;
 }
@@ -9,6 +9,23 @@ Reader::~Reader() {
   }
 }
 bool Reader::Initialize(bela::error_code &ec) {
+  if (fr != nullptr) {
+    mt = baulk::archive::gzip::NewParallelInflater(
+        [this](void *buffer, size_t len, int64_t pos, bela::error_code &ec) {
+          return fr->ReadFullAt(buffer, len, pos, ec);
+        },
+        fr->Size());
+    if (mt) {
+      return true;
+    }
+    if (!fr->PositionAt(0, ec)) {
+      return false;
+    }
+  }
+  return initializeSerial(ec);
+}
+
+bool Reader::initializeSerial(bela::error_code &ec) {
   zs = baulk::archive::archive_internal::Allocate<z_stream>(1);
   memset(zs, 0, sizeof(z_stream));
   if (auto zerr = inflateInit2(zs, MAX_WBITS + 16); zerr != Z_OK) {
@@ -21,17 +38,48 @@ bool Reader::Initialize(bela::error_code &ec) {
 }
 
 bool Reader::decompress(bela::error_code &ec) {
+  if (mt) {
+    if (mt->Next(out, ec)) {
+      return true;
+    }
+    if (ec.code != ErrEnded) {
+      return false;
+    }
+    // members after the first one are inflated serially
+    auto end = mt->End();
+    mt.reset();
+    if (end >= fr->Size() || !fr->PositionAt(end, ec) || !initializeSerial(ec)) {
+      return false;
+    }
+    memberEnd = true;
+  }
   for (;;) {
-    if (zs->avail_out != 0 || pickBytes == 0) {
+    if (zs->avail_in == 0) {
       auto n = r->Read(in.data(), in.capacity(), ec);
-      if (n <= 0) {
-        return n;
+      if (n < 0) {
+        return false;
+      }
+      if (n == 0) {
+        if (memberEnd) {
+          ec = bela::make_error_code(ErrEnded, L"gzip stream end");
+        } else {
+          ec = bela::make_error_code(ErrGeneral, L"gzip stream truncated");
+        }
+        return false;
       }
-      pickBytes += static_cast<int64_t>(n);
       zs->next_in = in.data();
       zs->avail_in = static_cast<uint32_t>(n);
     }
-    zs->avail_out = static_cast<int>(outsize);
+    if (memberEnd) {
+      // concatenated members (pigz -i, gzip -c a b), anything else is trailing garbage that gzip ignores too
+      if (zs->next_in[0] != 0x1F) {
+        ec = bela::make_error_code(ErrEnded, L"gzip stream end");
+        return false;
+      }
+      inflateReset(zs);
+      memberEnd = false;
+    }
+    zs->avail_out = static_cast<uint32_t>(out.capacity());
     zs->next_out = out.data();
     auto ret = ::inflate(zs, Z_NO_FLUSH);
     switch (ret) {
@@ -43,10 +91,13 @@ bool Reader::decompress(bela::error_code &ec) {
     case Z_MEM_ERROR:
       ec = bela::make_error_code(ret, bela::ToWide(zError(ret)));
       return false;
+    case Z_STREAM_END:
+      memberEnd = true;
+      break;
     default:
       break;
     }
-    auto have = outsize - zs->avail_out;
+    auto have = out.capacity() - zs->avail_out;
     out.pos() = 0;
     out.size() = have;
     if (have != 0) {
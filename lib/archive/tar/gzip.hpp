@@ -3,26 +3,32 @@
 #define BAULK_ARCHIVE_TAR_GZIP_HPP
 #include "tarinternal.hpp"
 #include "zlib.h"
+#include "../gzipblocks.hpp"
 
 namespace baulk::archive::tar::gzip {
 class Reader : public ExtractReader {
 public:
   Reader(ExtractReader *lr) : r(lr) {}
+  // seekable input, large single member files are inflated in parallel
+  Reader(FileReader *fr_) : r(fr_), fr(fr_) {}
   Reader(const Reader &) = delete;
   Reader &operator=(const Reader &) = delete;
   ~Reader();
   bool Initialize(bela::error_code &ec);
   ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
   bool Discard(int64_t len, bela::error_code &ec);
-  bool WriteTo(const Writer &w, int64_t filesize,int64_t &extracted,  bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
 
 private:
   bool decompress(bela::error_code &ec);
+  bool initializeSerial(bela::error_code &ec);
   ExtractReader *r{nullptr};
+  FileReader *fr{nullptr};
+  std::unique_ptr<baulk::archive::gzip::ParallelInflater> mt;
   z_stream *zs{nullptr};
   Buffer out;
   Buffer in;
-  int64_t pickBytes{0};
+  bool memberEnd{false};
 };
 } // namespace baulk::archive::tar::gzip
 
@@ -0,0 +1,394 @@
+// tar random access index
+#include "tarinternal.hpp"
+#include <bela/endian.hpp>
+#include <bela/fnmatch.hpp>
+#include <bela/mapview.hpp>
+#include <bela/io.hpp>
+#include <algorithm>
+#include "../zstdframes.hpp"
+
+namespace baulk::archive::tar {
+constexpr uint8_t indexMagic[8] = {'B', 'K', 'T', 'A', 'R', 'I', 'D', 'X'};
+// bump when the layout or the offsets recorded by Reader change, old indexes are rebuilt
+constexpr uint32_t indexVersion = 2;
+constexpr std::wstring_view indexSuffix = L".baulkidx";
+constexpr size_t prefixHashSize = 64 * 1024;
+// larger frames are not worth decoding for a single member, such archives are streamed
+constexpr uint64_t maxRandomFrameSize = 256ULL * 1024 * 1024;
+
+struct indexHeader {
+  uint8_t magic[8];
+  uint32_t version;
+  uint32_t count;
+  int64_t archiveSize;
+  int64_t archiveModTime;
+  uint64_t prefixHash;
+  uint64_t poolsize;
+};
+struct indexRecord {
+  int64_t headerOffset;
+  int64_t dataOffset;
+  int64_t size;
+  int64_t mode;
+  int64_t modTime;
+  uint64_t name; // offset in pool
+  uint64_t linkName;
+  uint32_t nameLength;
+  uint32_t linkNameLength;
+  char typeflag;
+  uint8_t sparse;
+  char padding[6];
+};
+static_assert(sizeof(indexHeader) == 48, "indexHeader layout");
+static_assert(sizeof(indexRecord) == 72, "indexRecord layout");
+
+// FNV-1a, only detects archives replaced in place with the same size and mtime
+inline uint64_t hashPrefix(const uint8_t *data, size_t len) {
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ data[i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+inline std::string_view trimPath(std::string_view p) {
+  while (p.starts_with("./")) {
+    p.remove_prefix(2);
+  }
+  while (!p.empty() && p.back() == '/') {
+    p.remove_suffix(1);
+  }
+  return p;
+}
+
+bool Match(std::string_view pattern, std::string_view name) {
+  auto wp = bela::ToWide(trimPath(pattern));
+  if (wp.empty() || wp == L".") {
+    return true;
+  }
+  auto wn = bela::ToWide(trimPath(name));
+  // no FNM_PATHNAME: like tar, '*' also matches '/'
+  if (bela::FnMatch(wp, wn)) {
+    return true;
+  }
+  for (auto pos = wn.find('/'); pos != std::wstring::npos; pos = wn.find('/', pos + 1)) {
+    if (bela::FnMatch(wp, std::wstring_view{wn}.substr(0, pos))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// fileReader uncompressed tar, offsets in the stream are file offsets
+class fileReader : public RandomReader {
+public:
+  fileReader(FileReader &fr_) : fr(fr_) {}
+  int64_t Size() const { return fr.Size(); }
+  ssize_t ReadAt(void *buffer, size_t len, int64_t pos, bela::error_code &ec) {
+    if (pos >= fr.Size()) {
+      return 0;
+    }
+    len = static_cast<size_t>((std::min)(static_cast<int64_t>(len), fr.Size() - pos));
+    if (!fr.ReadFullAt(buffer, len, pos, ec)) {
+      return -1;
+    }
+    return static_cast<ssize_t>(len);
+  }
+  bool WriteTo(const Writer &w, int64_t pos, int64_t size, bela::error_code &ec) {
+    if (!fr.PositionAt(pos, ec)) {
+      return false;
+    }
+    int64_t extracted = 0;
+    return fr.WriteTo(w, size, extracted, ec);
+  }
+
+private:
+  FileReader &fr;
+};
+
+// zstdReader zstd frames with known decompressed sizes, the frame holding the position is decoded and kept
+class zstdReader : public RandomReader {
+public:
+  zstdReader(FileReader &fr_, std::vector<baulk::archive::Chunk> &&frames_) : fr(fr_), frames(std::move(frames_)) {
+    starts.reserve(frames.size());
+    for (const auto &f : frames) {
+      starts.emplace_back(size);
+      size += static_cast<int64_t>(f.decompressedSize);
+    }
+  }
+  int64_t Size() const { return size; }
+  ssize_t ReadAt(void *buffer, size_t len, int64_t pos, bela::error_code &ec) {
+    auto p = reinterpret_cast<uint8_t *>(buffer);
+    size_t n = 0;
+    auto ret = forEach(pos, static_cast<int64_t>(len), ec, [&](const uint8_t *data, size_t dlen, bela::error_code &) {
+      memcpy(p + n, data, dlen);
+      n += dlen;
+      return true;
+    });
+    return ret ? static_cast<ssize_t>(n) : -1;
+  }
+  bool WriteTo(const Writer &w, int64_t pos, int64_t len, bela::error_code &ec) {
+    if (pos + len > size) {
+      ec = bela::make_error_code(ErrGeneral, L"tar entry beyond end of stream");
+      return false;
+    }
+    return forEach(pos, len, ec, [&](const uint8_t *data, size_t dlen, bela::error_code &ec) {
+      return w(data, dlen, ec);
+    });
+  }
+
+private:
+  bool decode(size_t index, bela::error_code &ec) {
+    if (index == current) {
+      return true;
+    }
+    const auto &f = frames[index];
+    in.grow(static_cast<size_t>(f.compressedSize));
+    if (!fr.ReadFullAt(in.data(), static_cast<size_t>(f.compressedSize), f.offset, ec)) {
+      return false;
+    }
+    in.size() = static_cast<size_t>(f.compressedSize);
+    out.grow(static_cast<size_t>(f.decompressedSize));
+    current = frames.size();
+    if (!baulk::archive::zstd::DecodeFrame(f, in, out, ec)) {
+      return false;
+    }
+    if (out.size() != f.decompressedSize) {
+      ec = bela::make_error_code(ErrGeneral, L"zstd frame at ", f.offset, L" content size mismatch");
+      return false;
+    }
+    current = index;
+    return true;
+  }
+  template <typename F> bool forEach(int64_t pos, int64_t len, bela::error_code &ec, F &&fn) {
+    len = (std::min)(len, size - pos);
+    while (len > 0) {
+      auto index = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), pos) - starts.begin() - 1);
+      if (!decode(index, ec)) {
+        return false;
+      }
+      auto off = static_cast<size_t>(pos - starts[index]);
+      auto n = (std::min)(static_cast<size_t>(len), out.size() - off);
+      if (!fn(out.data() + off, n, ec)) {
+        return false;
+      }
+      pos += static_cast<int64_t>(n);
+      len -= static_cast<int64_t>(n);
+    }
+    return true;
+  }
+  FileReader &fr;
+  std::vector<baulk::archive::Chunk> frames;
+  std::vector<int64_t> starts; // decompressed offset of each frame
+  int64_t size{0};
+  size_t current{SIZE_MAX};
+  Buffer in;
+  Buffer out;
+};
+
+std::unique_ptr<RandomReader> MakeRandomReader(FileReader &fr) {
+  uint8_t magic[blockSize];
+  bela::error_code ec;
+  auto n = fr.ReadAt(magic, sizeof(magic), 0, ec);
+  if (n < 4) {
+    return nullptr;
+  }
+  if (n == static_cast<ssize_t>(blockSize) &&
+      getFormat(*reinterpret_cast<const ustar_header *>(magic)) != FormatUnknown) {
+    return std::make_unique<fileReader>(fr);
+  }
+  auto zstdmagic = bela::cast_fromle<uint32_t>(magic);
+  if (zstdmagic != 0xFD2FB528U && (zstdmagic & 0xFFFFFFF0) != 0x184D2A50) {
+    return nullptr;
+  }
+  std::vector<baulk::archive::Chunk> frames;
+  auto readAt = [&](void *buffer, size_t len, int64_t pos, bela::error_code &ec) -> bool {
+    return fr.ReadFullAt(buffer, len, pos, ec);
+  };
+  if (!baulk::archive::zstd::LookupSeekableFrames(readAt, fr.Size(), frames, ec) || frames.empty()) {
+    return nullptr;
+  }
+  for (const auto &f : frames) {
+    if (f.decompressedSize > maxRandomFrameSize) {
+      return nullptr;
+    }
+  }
+  return std::make_unique<zstdReader>(fr, std::move(frames));
+}
+
+bool Index::Build(ExtractReader *r, bela::error_code &ec) {
+  Reader tr(r);
+  entries.clear();
+  for (;;) {
+    auto h = tr.Next(ec);
+    if (!h) {
+      if (ec.code == bela::ErrEnded) {
+        ec.clear();
+        return true;
+      }
+      return false;
+    }
+    Add(*h, tr.HeaderOffset(), tr.DataOffset());
+  }
+}
+
+void Index::Add(const Header &h, int64_t headerOffset, int64_t dataOffset) {
+  if (h.Typeflag == TypeXGlobalHeader) {
+    return;
+  }
+  entries.emplace_back(IndexEntry{.Name = std::string(h.Name),
+                                  .LinkName = std::string(h.LinkName),
+                                  .HeaderOffset = headerOffset,
+                                  .DataOffset = dataOffset,
+                                  .Size = h.Size,
+                                  .Mode = h.Mode,
+                                  .ModTime = bela::ToUnixSeconds(h.ModTime),
+                                  .Typeflag = h.Typeflag,
+                                  .Sparse = !h.Sparse.empty()});
+}
+
+bool Index::Prepare(FileReader &fr, bela::error_code &ec) {
+  entries.clear();
+  return fingerprint(fr, ec);
+}
+
+bool Index::Save(std::wstring_view file, bela::error_code &ec) const {
+  return save(bela::StringCat(file, indexSuffix), ec);
+}
+
+bool Index::fingerprint(FileReader &fr, bela::error_code &ec) {
+  FILETIME ft;
+  if (GetFileTime(fr.FD(), nullptr, nullptr, &ft) != TRUE) {
+    ec = bela::make_system_error_code(L"GetFileTime: ");
+    return false;
+  }
+  archiveSize = fr.Size();
+  archiveModTime = static_cast<int64_t>((static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime);
+  Buffer head(prefixHashSize);
+  auto len = static_cast<size_t>((std::min)(static_cast<int64_t>(prefixHashSize), archiveSize));
+  if (!fr.ReadFullAt(head.data(), len, 0, ec)) {
+    return false;
+  }
+  prefixHash = hashPrefix(head.data(), len);
+  return fr.PositionAt(0, ec);
+}
+
+bool Index::load(std::wstring_view sidecar, bela::error_code &ec) {
+  bela::MapView mv;
+  if (!mv.MappingView(sidecar, ec, sizeof(indexHeader))) {
+    return false;
+  }
+  auto v = mv.subview();
+  auto hdr = reinterpret_cast<const indexHeader *>(v.data());
+  if (!v.StartsWith(indexMagic) || hdr->version != indexVersion) {
+    ec = bela::make_error_code(ErrGeneral, sidecar, L" is not a tar index");
+    return false;
+  }
+  if (hdr->archiveSize != archiveSize || hdr->archiveModTime != archiveModTime || hdr->prefixHash != prefixHash) {
+    ec = bela::make_error_code(ErrGeneral, sidecar, L" is stale");
+    return false;
+  }
+  // poolsize comes from the file, compare each part with what is left so a hostile value cannot wrap the sum
+  auto avail = static_cast<uint64_t>(v.size() - sizeof(indexHeader));
+  auto recordsSize = static_cast<uint64_t>(hdr->count) * sizeof(indexRecord);
+  if (recordsSize > avail || hdr->poolsize > avail - recordsSize) {
+    ec = bela::make_error_code(ErrGeneral, sidecar, L" truncated");
+    return false;
+  }
+  auto records = reinterpret_cast<const indexRecord *>(v.data() + sizeof(indexHeader));
+  auto pool = reinterpret_cast<const char *>(v.data() + sizeof(indexHeader) + hdr->count * sizeof(indexRecord));
+  auto str = [&](uint64_t offset, uint32_t length) -> std::string_view {
+    if (offset > hdr->poolsize || length > hdr->poolsize - offset) {
+      return "";
+    }
+    return std::string_view{pool + offset, length};
+  };
+  entries.clear();
+  entries.reserve(hdr->count);
+  for (uint32_t i = 0; i < hdr->count; i++) {
+    const auto &e = records[i];
+    entries.emplace_back(IndexEntry{.Name = std::string(str(e.name, e.nameLength)),
+                                    .LinkName = std::string(str(e.linkName, e.linkNameLength)),
+                                    .HeaderOffset = e.headerOffset,
+                                    .DataOffset = e.dataOffset,
+                                    .Size = e.size,
+                                    .Mode = e.mode,
+                                    .ModTime = e.modTime,
+                                    .Typeflag = e.typeflag,
+                                    .Sparse = e.sparse != 0});
+  }
+  return true;
+}
+
+bool Index::save(std::wstring_view sidecar, bela::error_code &ec) const {
+  indexHeader hdr;
+  memcpy(hdr.magic, indexMagic, sizeof(indexMagic));
+  hdr.version = indexVersion;
+  hdr.count = static_cast<uint32_t>(entries.size());
+  hdr.archiveSize = archiveSize;
+  hdr.archiveModTime = archiveModTime;
+  hdr.prefixHash = prefixHash;
+  std::string pool;
+  std::vector<indexRecord> records;
+  records.reserve(entries.size());
+  for (const auto &e : entries) {
+    indexRecord r{0};
+    r.headerOffset = e.HeaderOffset;
+    r.dataOffset = e.DataOffset;
+    r.size = e.Size;
+    r.mode = e.Mode;
+    r.modTime = e.ModTime;
+    r.name = pool.size();
+    r.nameLength = static_cast<uint32_t>(e.Name.size());
+    pool.append(e.Name);
+    r.linkName = pool.size();
+    r.linkNameLength = static_cast<uint32_t>(e.LinkName.size());
+    pool.append(e.LinkName);
+    r.typeflag = e.Typeflag;
+    r.sparse = e.Sparse ? 1 : 0;
+    records.emplace_back(r);
+  }
+  hdr.poolsize = pool.size();
+  std::string buffer;
+  buffer.reserve(sizeof(hdr) + records.size() * sizeof(indexRecord) + pool.size());
+  buffer.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+  buffer.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(indexRecord));
+  buffer.append(pool);
+  return bela::io::WriteTextAtomic(buffer, sidecar, ec);
+}
+
+// Open: uncompressed tar and seekable zstd are scanned through positional reads, only the headers are read.
+// Other archives are decompressed once.
+bool Index::Open(std::wstring_view file, FileReader &fr, bool build, bela::error_code &ec) {
+  if (!fingerprint(fr, ec)) {
+    return false;
+  }
+  auto sidecar = bela::StringCat(file, indexSuffix);
+  if (bela::error_code le; load(sidecar, le)) {
+    return true;
+  }
+  if (!build) {
+    ec = bela::make_error_code(ErrGeneral, sidecar, L" unavailable");
+    return false;
+  }
+  if (auto rr = MakeRandomReader(fr); rr) {
+    randomStream rs(*rr);
+    if (!Build(&rs, ec)) {
+      return false;
+    }
+  } else {
+    auto wr = MakeReader(fr, ec);
+    if (wr == nullptr && ec.code != ErrNoFilter) {
+      return false;
+    }
+    if (!Build(wr != nullptr ? wr.get() : static_cast<ExtractReader *>(&fr), ec)) {
+      return false;
+    }
+  }
+  // an unwritable archive directory only costs the next run another scan
+  bela::error_code se;
+  save(sidecar, se);
+  return fr.PositionAt(0, ec);
+}
+
+} // namespace baulk::archive::tar
@@ -0,0 +1,162 @@
+//
+#include "lz4.hpp"
+
+namespace baulk::archive::tar::lz4 {
+using baulk::archive::lz4::blockFirst;
+using baulk::archive::lz4::blockLinked;
+using baulk::archive::lz4::historySize;
+
+// independentBlocks: lz4 writes independent blocks unless -BD is given, linked blocks must be decoded in order
+inline bool independentBlocks(const uint8_t *header, size_t len) {
+  if (len < 4) {
+    return false;
+  }
+  auto magic = bela::cast_fromle<uint32_t>(header);
+  if (magic == baulk::archive::lz4::legacyMagic) {
+    return true;
+  }
+  return magic == baulk::archive::lz4::frameMagic && len > 4 && (header[4] & 0x20) != 0;
+}
+
+bool Reader::Initialize(bela::error_code &ec) {
+  if (fr != nullptr) {
+    uint8_t header[5];
+    auto n = fr->ReadAt(header, sizeof(header), 0, ec);
+    if (n < 0 || !fr->PositionAt(0, ec)) {
+      return false;
+    }
+    if (independentBlocks(header, static_cast<size_t>(n))) {
+      scanner = std::make_shared<baulk::archive::lz4::FrameScanner>(
+          [this](void *buffer, size_t len, bela::error_code &ec) { return fr->Read(buffer, len, ec); });
+      if (mt = baulk::archive::lz4::NewParallelDecoder(scanner); mt) {
+        return true;
+      }
+    }
+  }
+  initializeSerial();
+  return true;
+}
+
+void Reader::initializeSerial() {
+  scanner = std::make_shared<baulk::archive::lz4::FrameScanner>(
+      [this](void *buffer, size_t len, bela::error_code &ec) { return r->Read(buffer, len, ec); });
+  outb.size() = 0;
+  outb.pos() = 0;
+}
+
+// recoverSerial: a linked block after the first frame cannot be decoded on its own, restart with the serial decoder,
+// which also reports the error of truly corrupt data.
+bool Reader::recoverSerial(bela::error_code &ec) {
+  mt.reset();
+  if (!fr->PositionAt(0, ec)) {
+    return false;
+  }
+  initializeSerial();
+  skipBytes = delivered;
+  return decompress(ec);
+}
+
+// finish: after the last block, check the content size and checksum of the last frame. Always false, ec stays
+// ErrEnded unless the check fails.
+bool Reader::finish(bela::error_code &ec) {
+  bela::error_code fec;
+  if (!scanner->Finish(fec)) {
+    ec = std::move(fec);
+  }
+  return false;
+}
+
+bool Reader::decompress(bela::error_code &ec) {
+  if (mt) {
+    // decoded blocks keep stream order, ErrEnded after the last one
+    if (mt->Next(outb, ec)) {
+      if (!scanner->Verify(outb.data(), outb.size(), ec)) {
+        return false;
+      }
+      delivered += static_cast<int64_t>(outb.size());
+      return true;
+    }
+    if (ec.code == bela::ErrEnded) {
+      return finish(ec);
+    }
+    return recoverSerial(ec);
+  }
+  for (;;) {
+    if (!scanner->Next(chunk, inb, ec)) {
+      if (ec.code == bela::ErrEnded) {
+        return finish(ec);
+      }
+      return false;
+    }
+    size_t prefix = 0;
+    if ((chunk.flags & (blockLinked | blockFirst)) == blockLinked) {
+      // keep the window of the previous blocks in front of the block
+      prefix = (std::min)(outb.size(), historySize);
+      memmove(outb.data(), outb.data() + outb.size() - prefix, prefix);
+    }
+    if (!baulk::archive::lz4::DecodeBlock(chunk, inb, outb, prefix, ec)) {
+      return false;
+    }
+    if (!scanner->Verify(outb.data() + prefix, outb.size() - prefix, ec)) {
+      return false;
+    }
+    if (skipBytes != 0) {
+      auto skip = (std::min)(static_cast<size_t>(skipBytes), outb.size() - outb.pos());
+      outb.pos() += skip;
+      skipBytes -= static_cast<int64_t>(skip);
+    }
+    if (outb.pos() != outb.size()) {
+      break;
+    }
+  }
+  return true;
+}
+
+ssize_t Reader::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (outb.pos() == outb.size()) {
+    if (!decompress(ec)) {
+      return -1;
+    }
+  }
+  auto minsize = (std::min)(len, outb.size() - outb.pos());
+  memcpy(buffer, outb.data() + outb.pos(), minsize);
+  outb.pos() += minsize;
+  return minsize;
+}
+
+bool Reader::Discard(int64_t len, bela::error_code &ec) {
+  while (len > 0) {
+    if (outb.pos() == outb.size()) {
+      if (!decompress(ec)) {
+        return false;
+      }
+    }
+    // seek position
+    auto minsize = (std::min)(static_cast<size_t>(len), outb.size() - outb.pos());
+    outb.pos() += minsize;
+    len -= minsize;
+  }
+  return true;
+}
+
+// Avoid multiple memory copies
+bool Reader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  while (filesize > 0) {
+    if (outb.pos() == outb.size()) {
+      if (!decompress(ec)) {
+        return false;
+      }
+    }
+    auto minsize = (std::min)(static_cast<size_t>(filesize), outb.size() - outb.pos());
+    auto p = outb.data() + outb.pos();
+    outb.pos() += minsize;
+    filesize -= minsize;
+    extracted += minsize;
+    if (!w(p, minsize, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace baulk::archive::tar::lz4
@@ -0,0 +1,37 @@
+///
+#ifndef BAULK_ARCHIVE_TAR_LZ4_HPP
+#define BAULK_ARCHIVE_TAR_LZ4_HPP
+#include "tarinternal.hpp"
+#include "../lz4blocks.hpp"
+
+namespace baulk::archive::tar::lz4 {
+class Reader : public ExtractReader {
+public:
+  Reader(ExtractReader *lr) : r(lr) {} // source reader
+  // seekable input, independent blocks are decoded in parallel
+  Reader(FileReader *fr_) : r(fr_), fr(fr_) {}
+  Reader(const Reader &) = delete;
+  Reader &operator=(const Reader &) = delete;
+  bool Initialize(bela::error_code &ec);
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  bool Discard(int64_t len, bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+
+private:
+  bool decompress(bela::error_code &ec);
+  bool finish(bela::error_code &ec);
+  void initializeSerial();
+  bool recoverSerial(bela::error_code &ec);
+  ExtractReader *r{nullptr};
+  FileReader *fr{nullptr};
+  std::shared_ptr<baulk::archive::lz4::FrameScanner> scanner;
+  std::unique_ptr<baulk::archive::ParallelDecoder> mt;
+  int64_t delivered{0}; // bytes returned by the parallel decoder
+  int64_t skipBytes{0}; // already returned bytes the serial decoder drops after recovery
+  Chunk chunk;
+  Buffer inb;
+  Buffer outb;
+};
+} // namespace baulk::archive::tar::lz4
+
+#endif
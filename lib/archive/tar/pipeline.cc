@@ -0,0 +1,335 @@
+//
+#include "pipeline.hpp"
+
+namespace baulk::archive::tar::pipeline {
+
+BlockPool::~BlockPool() {
+  for (auto b : blocks) {
+    delete b;
+  }
+}
+
+BlockPtr BlockPool::Acquire() {
+  Buffer *b = nullptr;
+  {
+    std::unique_lock lock(mtx);
+    cv.wait(lock, [&] { return canceled || !blocks.empty() || allocated < maxBlocks; });
+    if (canceled) {
+      return nullptr;
+    }
+    if (!blocks.empty()) {
+      b = blocks.back();
+      blocks.pop_back();
+    } else {
+      allocated++;
+    }
+  }
+  if (b == nullptr) {
+    b = new Buffer(blockSize);
+  }
+  b->size() = 0;
+  b->pos() = 0;
+  return BlockPtr(b, [this](Buffer *b) { release(b); });
+}
+
+void BlockPool::release(Buffer *b) {
+  {
+    std::scoped_lock lock(mtx);
+    blocks.emplace_back(b);
+  }
+  cv.notify_one();
+}
+
+void BlockPool::Cancel() {
+  {
+    std::scoped_lock lock(mtx);
+    canceled = true;
+  }
+  cv.notify_all();
+}
+
+Source::~Source() {
+  Cancel();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+void Source::Start() {
+  worker = std::thread([this] { decompress(); });
+}
+
+void Source::Cancel() { pool.Cancel(); }
+
+void Source::finish(bela::error_code &&ec) {
+  {
+    std::scoped_lock lock(mtx);
+    ended = true;
+    endEc = std::move(ec);
+  }
+  cv.notify_all();
+}
+
+void Source::decompress() {
+  for (;;) {
+    auto b = pool.Acquire();
+    if (!b) {
+      finish(bela::make_error_code(ErrCanceled, L"tar extraction canceled"));
+      return;
+    }
+    bela::error_code ec;
+    auto eof = false;
+    while (b->size() < b->capacity()) {
+      auto n = r->Read(b->data() + b->size(), b->capacity() - b->size(), ec);
+      if (n < 0) {
+        if (ec.code != ErrEnded) {
+          finish(std::move(ec));
+          return;
+        }
+        eof = true;
+        break;
+      }
+      if (n == 0) {
+        eof = true;
+        break;
+      }
+      b->size() += static_cast<size_t>(n);
+    }
+    if (b->size() != 0) {
+      {
+        std::scoped_lock lock(mtx);
+        filled.emplace_back(std::move(b));
+      }
+      cv.notify_one();
+    }
+    if (eof) {
+      finish(bela::make_error_code(ErrEnded, L"tar stream end"));
+      return;
+    }
+  }
+}
+
+bool Source::next(bela::error_code &ec) {
+  // return the consumed block to the pool before waiting on the decompressor
+  current.reset();
+  std::unique_lock lock(mtx);
+  cv.wait(lock, [&] { return !filled.empty() || ended; });
+  if (!filled.empty()) {
+    current = std::move(filled.front());
+    filled.pop_front();
+    return true;
+  }
+  ec = endEc;
+  return false;
+}
+
+ssize_t Source::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (!current || current->pos() == current->size()) {
+    if (!next(ec)) {
+      if (ec.code == ErrEnded) {
+        ec.clear();
+        return 0;
+      }
+      return -1;
+    }
+  }
+  auto minsize = (std::min)(len, current->size() - current->pos());
+  memcpy(buffer, current->data() + current->pos(), minsize);
+  current->pos() += minsize;
+  return static_cast<ssize_t>(minsize);
+}
+
+bool Source::Discard(int64_t len, bela::error_code &ec) {
+  while (len > 0) {
+    if (!current || current->pos() == current->size()) {
+      if (!next(ec)) {
+        return false;
+      }
+    }
+    auto minsize = (std::min)(static_cast<size_t>(len), current->size() - current->pos());
+    current->pos() += minsize;
+    len -= minsize;
+  }
+  return true;
+}
+
+bool Source::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  while (filesize > 0) {
+    if (!current || current->pos() == current->size()) {
+      if (!next(ec)) {
+        return false;
+      }
+    }
+    auto minsize = (std::min)(static_cast<size_t>(filesize), current->size() - current->pos());
+    auto p = current->data() + current->pos();
+    current->pos() += minsize;
+    filesize -= minsize;
+    extracted += minsize;
+    if (!w(p, minsize, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Writers::Writers(int n, bool overwrite_, DirCache *dirs_, std::function<void()> &&onFailure_)
+    : onFailure(std::move(onFailure_)), dirs(dirs_), overwrite(overwrite_) {
+  threads.reserve(n);
+  for (int i = 0; i < n; i++) {
+    threads.emplace_back([this] { run(); });
+  }
+}
+
+Writers::~Writers() {
+  Cancel();
+  for (auto &t : threads) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+}
+
+FileJob *Writers::Submit(std::wstring_view path, bela::Time mtime, int64_t size) {
+  auto job = std::make_unique<FileJob>();
+  job->path = path;
+  job->key = pathKey(path);
+  job->mtime = mtime;
+  job->size = size;
+  auto p = job.get();
+  {
+    // the earlier job is sealed and ahead in submission order, writers finish it without the parser
+    std::unique_lock lock(mtx);
+    cv.wait(lock, [&] { return canceled || !inflight.contains(p->key); });
+    inflight.emplace(p->key);
+    pending.emplace_back(std::move(job));
+  }
+  cv.notify_all();
+  return p;
+}
+
+void Writers::WaitPath(std::wstring_view path) {
+  auto key = pathKey(path);
+  std::unique_lock lock(mtx);
+  cv.wait(lock, [&] { return canceled || !inflight.contains(key); });
+}
+
+void Writers::finish(const FileJob &job) {
+  {
+    std::scoped_lock lock(mtx);
+    inflight.erase(job.key);
+  }
+  cv.notify_all();
+}
+
+void Writers::Push(FileJob *job, Slice &&slice) {
+  {
+    std::scoped_lock lock(mtx);
+    job->slices.emplace_back(std::move(slice));
+  }
+  cv.notify_all();
+}
+
+void Writers::Seal(FileJob *job) {
+  {
+    std::scoped_lock lock(mtx);
+    job->sealed = true;
+  }
+  cv.notify_all();
+}
+
+void Writers::fail(bela::error_code &&ec) {
+  {
+    std::scoped_lock lock(mtx);
+    if (!failed) {
+      firstEc = std::move(ec);
+      failed = true;
+    }
+    canceled = true;
+  }
+  cv.notify_all();
+  if (onFailure) {
+    onFailure();
+  }
+}
+
+void Writers::run() {
+  for (;;) {
+    std::unique_ptr<FileJob> job;
+    {
+      std::unique_lock lock(mtx);
+      cv.wait(lock, [&] { return canceled || closed || !pending.empty(); });
+      if (canceled || pending.empty()) {
+        return;
+      }
+      job = std::move(pending.front());
+      pending.pop_front();
+    }
+    bela::error_code ec;
+    auto fd = baulk::archive::NewFD(job->path, ec, overwrite, dirs);
+    // slices end where the source blocks end, the sink writes them in whole blocks
+    std::optional<FileSink> sink;
+    if (fd) {
+      sink.emplace(std::move(*fd), job->path, job->size);
+    }
+    auto ok = sink.has_value();
+    auto aborted = false;
+    for (;;) {
+      Slice slice;
+      {
+        std::unique_lock lock(mtx);
+        cv.wait(lock, [&] { return canceled || job->sealed || !job->slices.empty(); });
+        if (canceled) {
+          aborted = true;
+          break;
+        }
+        if (job->slices.empty()) {
+          break;
+        }
+        slice = std::move(job->slices.front());
+        job->slices.pop_front();
+      }
+      if (ok && !sink->Write(slice.data, slice.size, ec)) {
+        ok = false;
+      }
+    }
+    if (aborted) {
+      // the sink discards the file
+      return;
+    }
+    if (!ok || !sink->Close(job->mtime, ec)) {
+      fail(bela::make_error_code(ec.code, L"extract '", job->path, L"' error: ", ec.message));
+      return;
+    }
+    sink.reset();
+    finish(*job);
+  }
+}
+
+bool Writers::Wait(bela::error_code &ec) {
+  {
+    std::scoped_lock lock(mtx);
+    closed = true;
+  }
+  cv.notify_all();
+  for (auto &t : threads) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+  if (failed) {
+    std::scoped_lock lock(mtx);
+    ec = firstEc;
+    return false;
+  }
+  return true;
+}
+
+void Writers::Cancel() {
+  {
+    std::scoped_lock lock(mtx);
+    canceled = true;
+  }
+  cv.notify_all();
+}
+
+} // namespace baulk::archive::tar::pipeline
@@ -0,0 +1,132 @@
+//
+#ifndef BAULK_ARCHIVE_TAR_PIPELINE_HPP
+#define BAULK_ARCHIVE_TAR_PIPELINE_HPP
+#include "tarinternal.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+namespace baulk::archive::tar::pipeline {
+constexpr size_t minBlockSize = 64 * 1024;
+constexpr size_t maxBlockSize = 4 * 1024 * 1024;
+constexpr size_t minBlocks = 3; // decompressor, parser and at least one writer each hold a block
+
+using BlockPtr = std::shared_ptr<Buffer>;
+
+// pathKey NTFS names are case-insensitive, "README" and "readme" are one file
+inline std::wstring pathKey(std::wstring_view path) {
+  std::wstring key(path);
+  CharLowerBuffW(key.data(), static_cast<DWORD>(key.size()));
+  return key;
+}
+
+// BlockPool bounded set of equally sized blocks, released blocks are recycled
+class BlockPool {
+public:
+  BlockPool(size_t blockSize_, size_t maxBlocks_) : blockSize(blockSize_), maxBlocks(maxBlocks_) {}
+  BlockPool(const BlockPool &) = delete;
+  BlockPool &operator=(const BlockPool &) = delete;
+  ~BlockPool();
+  // Acquire waits for a free block, nullptr after Cancel
+  BlockPtr Acquire();
+  void Cancel();
+
+private:
+  void release(Buffer *b);
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::vector<Buffer *> blocks;
+  size_t blockSize{0};
+  size_t maxBlocks{0};
+  size_t allocated{0};
+  bool canceled{false};
+};
+
+// Source drains the filter on a decompressor thread into a ring of blocks, the tar Reader on the calling thread
+// consumes them. WriteTo hands out pointers into the current block, Current keeps it alive past the callback.
+class Source : public ExtractReader {
+public:
+  Source(ExtractReader *r_, size_t blockSize, size_t maxBlocks) : r(r_), pool(blockSize, maxBlocks) {}
+  Source(const Source &) = delete;
+  Source &operator=(const Source &) = delete;
+  ~Source();
+  void Start();
+  void Cancel();
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  bool Discard(int64_t len, bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  const BlockPtr &Current() const { return current; }
+
+private:
+  void decompress();
+  void finish(bela::error_code &&ec);
+  bool next(bela::error_code &ec);
+  ExtractReader *r{nullptr};
+  BlockPool pool;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<BlockPtr> filled;
+  bela::error_code endEc; // ErrEnded on clean end of stream
+  bool ended{false};
+  BlockPtr current;
+  std::thread worker;
+};
+
+struct Slice {
+  BlockPtr block;
+  const uint8_t *data{nullptr};
+  size_t size{0};
+};
+
+struct FileJob {
+  std::wstring path;
+  std::wstring key; // case-folded path, one job per key is in flight
+  bela::Time mtime;
+  int64_t size{0};
+  std::deque<Slice> slices;
+  bool sealed{false};
+};
+
+// Writers creates and fills files on worker threads. Jobs are taken in submission order, so only the newest job
+// can still be waiting for slices and every older job drains and releases its blocks.
+class Writers {
+public:
+  Writers(int n, bool overwrite_, DirCache *dirs_, std::function<void()> &&onFailure_);
+  Writers(const Writers &) = delete;
+  Writers &operator=(const Writers &) = delete;
+  ~Writers();
+  // Submit waits for the job of an earlier entry at the same path, the last entry of a tar wins
+  FileJob *Submit(std::wstring_view path, bela::Time mtime, int64_t size);
+  // WaitPath wait until no job writes path, the parser then creates a directory or a link over it
+  void WaitPath(std::wstring_view path);
+  void Push(FileJob *job, Slice &&slice);
+  // Seal no more slices, job must not be touched afterwards
+  void Seal(FileJob *job);
+  // Wait finish submitted jobs and stop workers, returns the first write error
+  bool Wait(bela::error_code &ec);
+  void Cancel();
+  bool Failed() const { return failed; }
+
+private:
+  void run();
+  void finish(const FileJob &job);
+  void fail(bela::error_code &&ec);
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<std::unique_ptr<FileJob>> pending;
+  bela::flat_hash_set<std::wstring> inflight; // keys of submitted jobs not finished yet
+  std::vector<std::thread> threads;
+  std::function<void()> onFailure;
+  DirCache *dirs{nullptr};
+  bela::error_code firstEc;
+  std::atomic_bool failed{false};
+  bool overwrite{true};
+  bool canceled{false};
+  bool closed{false};
+};
+
+} // namespace baulk::archive::tar::pipeline
+
+#endif
@@ -1,9 +1,9 @@
 //
 #include "tarinternal.hpp"
 #include <bela/str_cat_narrow.hpp>
-#include <bela/str_join_narrow.hpp>
 #include <bela/str_split_narrow.hpp>
 #include <charconv>
+#include <algorithm>
 
 namespace baulk::archive::tar {
 // tar code
@@ -27,6 +27,26 @@ ssize_t FileReader::ReadAt(void *buffer, size_t len, int64_t pos, bela::error_co
   }
   return Read(buffer, len, ec);
 }
+// ReadFullAt read exactly len bytes at pos, a short file is an error
+bool FileReader::ReadFullAt(void *buffer, size_t len, int64_t pos, bela::error_code &ec) {
+  if (!PositionAt(pos, ec)) {
+    return false;
+  }
+  auto p = reinterpret_cast<uint8_t *>(buffer);
+  while (len > 0) {
+    auto n = Read(p, len, ec);
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      ec = bela::make_error_code(ErrGeneral, L"unexpected end of file");
+      return false;
+    }
+    p += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
 bool FileReader::PositionAt(int64_t pos, bela::error_code &ec) {
   auto li = *reinterpret_cast<LARGE_INTEGER *>(&pos);
   LARGE_INTEGER oli{0};
@@ -57,6 +77,10 @@ bool FileReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted,
       ec = bela::make_system_error_code(L"ReadFile: ");
       return false;
     }
+    if (drSize == 0) {
+      ec = bela::make_error_code(ErrGeneral, L"unexpected end of file");
+      return false;
+    }
     filesize -= drSize;
     extracted += drSize;
     if (!w(buffer, drSize, ec)) {
@@ -81,11 +105,6 @@ std::shared_ptr<FileReader> OpenFile(std::wstring_view file, bela::error_code &e
   return std::make_shared<FileReader>(fd, li.QuadPart, true);
 }
 
-inline bool isZeroBlock(const ustar_header &th) {
-  static ustar_header zeroth = {0};
-  return memcmp(&th, &zeroth, sizeof(ustar_header)) == 0;
-}
-
 // blockPadding computes the number of bytes needed to pad offset up to the
 // nearest block edge where 0 <= n < blockSize.
 inline constexpr int64_t blockPadding(int64_t offset) { return -offset & (blockSize - 1); }
@@ -113,7 +132,11 @@ bela::ssize_t Reader::readInternal(void *buffer, size_t size, bela::error_code &
     ec = bela::make_error_code(L"underlying reader is null");
     return -1;
   }
-  return r->Read(buffer, size, ec);
+  auto n = r->Read(buffer, size, ec);
+  if (n > 0) {
+    offset += n;
+  }
+  return n;
 }
 
 bool Reader::discard(int64_t bytes, bela::error_code &ec) {
@@ -121,10 +144,41 @@ bool Reader::discard(int64_t bytes, bela::error_code &ec) {
     ec = bela::make_error_code(L"underlying reader is null");
     return false;
   }
-  return r->Discard(bytes, ec);
+  if (!r->Discard(bytes, ec)) {
+    return false;
+  }
+  offset += bytes;
+  return true;
+}
+
+// readSparse holes are filled with zeros, data is read from the fragment at sparsePos
+bela::ssize_t Reader::readSparse(void *buffer, size_t size, bela::error_code &ec) {
+  while (sparseNext < sparse.size() && sparse[sparseNext].endOffset() <= sparsePos) {
+    sparseNext++;
+  }
+  if (sparseNext == sparse.size() || size == 0) {
+    return 0;
+  }
+  const auto &f = sparse[sparseNext];
+  if (sparsePos < f.Offset) {
+    auto n = static_cast<size_t>((std::min)(static_cast<int64_t>(size), f.Offset - sparsePos));
+    memset(buffer, 0, n);
+    sparsePos += n;
+    return static_cast<bela::ssize_t>(n);
+  }
+  auto n = readInternal(buffer, static_cast<size_t>((std::min)(static_cast<int64_t>(size), f.endOffset() - sparsePos)),
+                        ec);
+  if (n > 0) {
+    sparsePos += n;
+    remainingSize -= n;
+  }
+  return n;
 }
 
 bela::ssize_t Reader::Read(void *buffer, size_t size, bela::error_code &ec) {
+  if (!sparse.empty()) {
+    return readSparse(buffer, size, ec);
+  }
   auto n = readInternal(buffer, size, ec);
   if (n > 0 && remainingSize > 0) {
     remainingSize -= n;
@@ -150,78 +204,88 @@ bool Reader::ReadFull(void *buffer, size_t size, bela::error_code &ec) {
   return true;
 }
 
-bool Reader::parsePAX(int64_t paxSize, pax_records_t &paxHdrs, bela::error_code &ec) {
-  Buffer buf(paxSize);
-  if (!ReadFull(buf.data(), paxSize, ec)) {
+// readBody read the data of a PAX or GNU long name header into the arena
+bool Reader::readBody(int64_t size, std::string_view &body, bela::error_code &ec) {
+  if (size < 0 || size > maxSpecialFileSize) {
+    ec = bela::make_error_code(ErrGeneral, L"tar: extended header size ", size, L" invalid");
     return false;
   }
-  std::string_view sv{reinterpret_cast<const char *>(buf.data()), static_cast<size_t>(paxSize)};
-  std::vector<std::string_view> sparseMap;
-  while (!sv.empty()) {
-    std::string_view k;
-    std::string_view v;
-    if (!parsePAXRecord(&sv, &k, &v, ec)) {
-      return false;
-    }
-    if (k == paxGNUSparseOffset || k == paxGNUSparseNumBytes) {
-      if ((sparseMap.size() % 2 == 0 && k != paxGNUSparseOffset) ||
-          (sparseMap.size() % 2 == 1 && k != paxGNUSparseNumBytes) || v.find('.') != std::string_view::npos) {
-        ec = bela::make_error_code(L"invalid tar header");
-        return false;
-      }
-      sparseMap.emplace_back(v);
-      continue;
-    }
-    paxHdrs.emplace(k, v);
-  }
-  if (!sparseMap.empty()) {
-    paxHdrs.emplace(paxGNUSparseMap, bela::narrow::StrJoin(sparseMap, ","));
+  auto p = arena.Allocate(static_cast<size_t>(size));
+  if (!ReadFull(p, static_cast<size_t>(size), ec)) {
+    return false;
   }
+  body = std::string_view(p, static_cast<size_t>(size));
   return true;
 }
 
-bool Reader::readHeader(Header &h, bela::error_code &ec) {
-  ustar_header hdr{0};
-  if (!ReadFull(&hdr, sizeof(hdr), ec)) {
+// parsePAX read and validate the records, the sparse 0.0 offset and numbytes keys must alternate
+bool Reader::parsePAX(int64_t paxSize, std::string_view &pax, bela::error_code &ec) {
+  if (!readBody(paxSize, pax, ec)) {
     return false;
   }
-  if (isZeroBlock(hdr)) {
-    if (!ReadFull(&hdr, sizeof(hdr), ec)) {
+  size_t sparseKeys = 0;
+  return forEachPAXRecord(
+      pax,
+      [&](std::string_view k, std::string_view v) -> bool {
+        if (k != paxGNUSparseOffset && k != paxGNUSparseNumBytes) {
+          return true;
+        }
+        if ((sparseKeys % 2 == 0 && k != paxGNUSparseOffset) || (sparseKeys % 2 == 1 && k != paxGNUSparseNumBytes) ||
+            v.find('.') != std::string_view::npos) {
+          ec = bela::make_error_code(L"invalid tar header");
+          return false;
+        }
+        sparseKeys++;
+        return true;
+      },
+      ec);
+}
+
+bool Reader::readHeader(Header &h, const ustar_header *&hdr, bela::error_code &ec) {
+  // names and link names are views of this block
+  auto block = reinterpret_cast<ustar_header *>(arena.Allocate(sizeof(ustar_header)));
+  hdr = block;
+  if (!ReadFull(block, sizeof(ustar_header), ec)) {
+    return false;
+  }
+  if (isZeroBlock(*hdr)) {
+    if (!ReadFull(block, sizeof(ustar_header), ec)) {
       return false;
     }
-    if (isZeroBlock(hdr)) {
+    if (isZeroBlock(*hdr)) {
       ec = bela::make_error_code(bela::ErrEnded, L"tar stream end");
       return false;
     }
     ec = bela::make_error_code(L"invalid tar header");
     return false;
   }
-  if (h.Format = getFormat(hdr); h.Format == FormatUnknown) {
+  if (h.Format = getFormat(*hdr); h.Format == FormatUnknown) {
     ec = bela::make_error_code(L"invalid tar header");
     return false;
   }
-  h.Typeflag = hdr.typeflag;
-  h.Name = parseString(hdr.name);
-  h.LinkName = parseString(hdr.linkname);
-  h.Size = parseNumeric(hdr.size);
-  h.UID = static_cast<int>(parseNumeric(hdr.uid));
-  h.GID = static_cast<int>(parseNumeric(hdr.gid));
-  h.ModTime = bela::FromUnix(parseNumeric(hdr.mtime), 0);
+  h.Typeflag = hdr->typeflag;
+  h.Name = parseString(hdr->name);
+  h.LinkName = parseString(hdr->linkname);
+  h.Size = parseNumeric(hdr->size);
+  h.Mode = parseNumeric(hdr->mode);
+  h.UID = static_cast<int>(parseNumeric(hdr->uid));
+  h.GID = static_cast<int>(parseNumeric(hdr->gid));
+  h.ModTime = bela::FromUnix(parseNumeric(hdr->mtime), 0);
   if (h.Format > FormatV7) {
-    h.Uname = parseString(hdr.uname);
-    h.Gname = parseString(hdr.gname);
-    h.Devmajor = parseNumeric(hdr.devmajor);
-    h.Devminor = parseNumeric(hdr.devminor);
-    std::string prefix;
+    h.Uname = parseString(hdr->uname);
+    h.Gname = parseString(hdr->gname);
+    h.Devmajor = parseNumeric(hdr->devmajor);
+    h.Devminor = parseNumeric(hdr->devminor);
+    std::string_view prefix;
     if ((h.Format & (FormatUSTAR | FormatPAX)) != 0) {
-      prefix = parseString(hdr.prefix);
+      prefix = parseString(hdr->prefix);
     } else if ((h.Format & FormatSTAR) != 0) {
-      auto star = reinterpret_cast<const star_header *>(&hdr);
+      auto star = reinterpret_cast<const star_header *>(hdr);
       prefix = parseString(star->prefix);
       h.AccessTime = bela::FromUnix(parseNumeric(star->atime), 0);
       h.ChangeTime = bela::FromUnix(parseNumeric(star->ctime), 0);
     } else if ((h.Format & FormatGNU) != 0) {
-      auto gnu = reinterpret_cast<const gnutar_header *>(&hdr);
+      auto gnu = reinterpret_cast<const gnutar_header *>(hdr);
       if (gnu->atime[0] != 0) {
         h.AccessTime = bela::FromUnix(parseNumeric(gnu->atime), 0);
       }
@@ -230,18 +294,42 @@ bool Reader::readHeader(Header &h, bela::error_code &ec) {
       }
     }
     if (!prefix.empty()) {
-      h.Name = bela::narrow::StringCat(prefix, "/", h.Name);
+      h.Name = arena.Concat(prefix, "/", h.Name);
     }
   }
   return true;
 }
 
-bool Reader::readOldGNUSparseMap(Header &h, sparseDatas &spd, const gnutar_header *th, bela::error_code &ec) {
-  ec = bela::make_error_code(L"tar: GNU old sparse file extraction is not implemented");
-  return false;
+// readOldGNUSparseMap the map starts in the header, extension blocks follow it before the data
+bool Reader::readOldGNUSparseMap(Header &h, const gnutar_header *th, bela::error_code &ec) {
+  h.Size = parseNumeric(th->realsize);
+  const gnu_sparse *entries = th->sparse;
+  size_t count = std::size(th->sparse);
+  auto extended = th->isextended[0] != 0;
+  gnutar_sparse_header ext;
+  for (;;) {
+    for (size_t i = 0; i < count; i++) {
+      if (entries[i].offset[0] == 0) {
+        break;
+      }
+      sparse.emplace_back(sparseEntry{parseNumeric(entries[i].offset), parseNumeric(entries[i].numbytes)});
+    }
+    if (!extended) {
+      return true;
+    }
+    if (!ReadFull(&ext, sizeof(ext), ec)) {
+      return false;
+    }
+    entries = ext.sparse;
+    count = std::size(ext.sparse);
+    extended = ext.isextended[0] != 0;
+  }
 }
 
-bool readGNUSparseMap0x1(pax_records_t &paxrs, sparseDatas &spd, bela::error_code &ec) {
+// readGNUSparseMap0x1 GNU.sparse.map holds offset,length pairs, the 0.0 offset and numbytes records are folded into
+// it by PAXRecords
+bool readGNUSparseMap0x1(const Header &h, sparseDatas &spd, bela::error_code &ec) {
+  auto paxrs = h.PAXRecords();
   auto it = paxrs.find(paxGNUSparseNumBlocks);
   if (it == paxrs.end()) {
     ec = bela::make_error_code(L"tar: pax sparse missing num blocks");
@@ -278,16 +366,22 @@ bool readGNUSparseMap0x1(pax_records_t &paxrs, sparseDatas &spd, bela::error_cod
   return true;
 }
 
-bool Reader::readGNUSparseMap1x0(sparseDatas &spd, bela::error_code &ec) {
+// readGNUSparseMap1x0 the map is a newline separated list at the start of the data, padded to a block
+bool Reader::readGNUSparseMap1x0(bela::error_code &ec) {
   int64_t cntNewline{0};
-  char block[512];
+  char block[blockSize];
   std::string buf;
-  std::string::size_type offset{0};
-  auto feedTokens = [&](int64_t n, bela::error_code &e) -> bool {
+  std::string::size_type pos{0};
+  auto feedTokens = [&](int64_t n) -> bool {
     while (cntNewline < n) {
+      if (remainingSize < static_cast<int64_t>(sizeof(block))) {
+        ec = bela::make_error_code(L"tar: pax sparse map truncated");
+        return false;
+      }
       if (!ReadFull(block, sizeof(block), ec)) {
         return false;
       }
+      remainingSize -= sizeof(block);
       buf.append(block, sizeof(block));
       for (auto c : block) {
         if (c == '\n') {
@@ -299,30 +393,29 @@ bool Reader::readGNUSparseMap1x0(sparseDatas &spd, bela::error_code &ec) {
   };
   auto nextToken = [&]() -> std::string_view {
     cntNewline--;
-    auto pos = buf.find('\n', offset);
-    if (pos != std::string::npos) {
-      std::string_view sv{buf.data() + offset, pos};
-      offset = pos + 1;
-      return sv;
+    auto end = buf.find('\n', pos);
+    if (end == std::string::npos) {
+      end = buf.size();
     }
-    return std::string_view{buf.data() + offset, buf.size() - offset};
+    std::string_view sv{buf.data() + pos, end - pos};
+    pos = end + 1;
+    return sv;
   };
-  if (!feedTokens(1, ec)) {
+  if (!feedTokens(1)) {
     return false;
   }
-  auto nextTokenStr = nextToken();
   int64_t numEntries{0};
-  if (!bela::SimpleAtoi(nextTokenStr, &numEntries) || numEntries < 0 ||
+  if (!bela::SimpleAtoi(nextToken(), &numEntries) || numEntries < 0 ||
       static_cast<int>(numEntries * 2) < static_cast<int>(numEntries)) {
     ec = bela::make_error_code(L"tar: pax sparse invalid num blocks");
     return false;
   }
-  if (!feedTokens(2 * numEntries, ec)) {
+  if (!feedTokens(2 * numEntries)) {
     return false;
   }
-  spd.resize(numEntries);
+  sparse.resize(numEntries);
   for (int64_t i = 0; i < numEntries; i++) {
-    if (!bela::SimpleAtoi(nextToken(), &spd[i].Offset) || !bela::SimpleAtoi(nextToken(), &spd[i].Length)) {
+    if (!bela::SimpleAtoi(nextToken(), &sparse[i].Offset) || !bela::SimpleAtoi(nextToken(), &sparse[i].Length)) {
       ec = bela::make_error_code(L"tar: pax sparse  invalid sparse offset or length");
       return false;
     }
@@ -330,70 +423,97 @@ bool Reader::readGNUSparseMap1x0(sparseDatas &spd, bela::error_code &ec) {
   return true;
 }
 
-bool Reader::readGNUSparsePAXHeaders(Header &h, sparseDatas &spd, bela::error_code &ec) {
+// readGNUSparsePAXHeaders found is set for the GNU PAX sparse formats 0.0, 0.1 and 1.0
+bool Reader::readGNUSparsePAXHeaders(Header &h, bool &found, bela::error_code &ec) {
+  auto major = h.PAXRecord(paxGNUSparseMajor).value_or("");
+  auto minor = h.PAXRecord(paxGNUSparseMinor).value_or("");
   bool is1x0 = false;
-  auto mit = h.PAXRecords.find(paxGNUSparseMajor);
-  if (mit == h.PAXRecords.end()) {
-    return true;
-  }
-  std::string_view major = mit->second;
-  auto it = h.PAXRecords.find(paxGNUSparseMinor);
-  if (it == h.PAXRecords.end()) {
-    return false;
-  }
-  std::string_view minor = it->second;
   if (major == "0" && (minor == "0" || minor == "1")) {
     is1x0 = false;
   } else if (major == "1" && minor == "0") {
     is1x0 = true;
-  } else if (major.empty() || minor.empty()) {
+  } else if (!major.empty() || !minor.empty()) {
+    // unknown version, the data is extracted as stored
     return true;
-  } else if (auto kit = h.PAXRecords.find(paxGNUSparseMap); kit != h.PAXRecords.end() && !kit->second.empty()) {
+  } else if (!h.PAXRecord(paxGNUSparseMap).value_or("").empty() ||
+             !h.PAXRecord(paxGNUSparseOffset).value_or("").empty()) {
+    // 0.0 and 0.1 have no version records
     is1x0 = false;
   } else {
     return true;
   }
+  found = true;
   h.Format = FormatPAX;
-  if (auto it = h.PAXRecords.find(paxGNUSparseName); it != h.PAXRecords.end() && !it->second.empty()) {
-    h.Name = it->second;
+  if (auto name = h.PAXRecord(paxGNUSparseName); name && !name->empty()) {
+    h.Name = *name;
+  }
+  auto size = h.PAXRecord(paxGNUSparseSize).value_or("");
+  if (size.empty()) {
+    size = h.PAXRecord(paxGNUSparseRealSize).value_or("");
   }
-  if (auto it = h.PAXRecords.find(paxGNUSparseSize); it != h.PAXRecords.end() && !it->second.empty()) {
+  if (!size.empty()) {
     int64_t n = 0;
-    if (auto res = std::from_chars(it->second.data(), it->second.data() + it->second.size(), n);
-        res.ec == std::errc{}) {
-      h.SparseSize = n;
+    if (auto res = std::from_chars(size.data(), size.data() + size.size(), n);
+        res.ec != std::errc{} || res.ptr != size.data() + size.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"tar: pax sparse invalid size '", bela::ToWide(size), L"'");
       return false;
     }
+    h.SparseSize = n;
+    h.Size = n;
   }
   if (is1x0) {
-    return readGNUSparseMap1x0(spd, ec);
+    return readGNUSparseMap1x0(ec);
   }
-  return readGNUSparseMap0x1(h.PAXRecords, spd, ec);
+  return readGNUSparseMap0x1(h, sparse, ec);
 }
 
 // handleSparseFile tar support sparse file
 // https://www.gnu.org/software/tar/manual/html_node/sparse.html
+// on success h.Size is the logical size and remainingSize the stored data, which must be the sum of the fragments
 bool Reader::handleSparseFile(Header &h, const gnutar_header *gh, bela::error_code &ec) {
-  std::vector<sparseEntry> spd;
-  bool ret = false;
+  auto found = false;
   if (h.Typeflag == TypeGNUSparse) {
-    ret = readOldGNUSparseMap(h, spd, gh, ec);
-  } else {
-    ret = readGNUSparsePAXHeaders(h, spd, ec);
-  }
-  if (ret && !spd.empty()) {
-    if (isHeaderOnlyType(h.Typeflag) || !validateSparseEntries(spd, h.Size)) {
-      ec = bela::make_error_code(L"invalid tar header");
+    if (!readOldGNUSparseMap(h, gh, ec)) {
       return false;
     }
+    found = true;
+  } else if (!readGNUSparsePAXHeaders(h, found, ec)) {
+    return false;
   }
+  if (!found) {
+    return true;
+  }
+  if (isHeaderOnlyType(h.Typeflag) || !validateSparseEntries(sparse, h.Size)) {
+    ec = bela::make_error_code(L"invalid tar header");
+    return false;
+  }
+  int64_t stored = 0;
+  for (const auto &e : sparse) {
+    stored += e.Length;
+  }
+  if (stored != remainingSize) {
+    ec = bela::make_error_code(ErrGeneral, L"tar: sparse map of '", bela::ToWide(h.Name), L"' describes ", stored,
+                               L" bytes, ", remainingSize, L" stored");
+    return false;
+  }
+  // a trailing hole or an empty map: the last fragment marks the end of the file
+  if (sparse.empty() || sparse.back().endOffset() < h.Size) {
+    sparse.emplace_back(sparseEntry{h.Size, 0});
+  }
+  h.Sparse = sparse;
   return true;
 }
 
+// Next: the strings of the returned header live in the arena until the following call
 std::optional<Header> Reader::Next(bela::error_code &ec) {
-  pax_records_t paxHdrs;
-  std::string gnuLongName;
-  std::string gnuLongLink;
+  arena.Reset();
+  sparse.clear();
+  sparseNext = 0;
+  sparsePos = 0;
+  std::string_view pax;
+  std::string_view gnuLongName;
+  std::string_view gnuLongLink;
+  auto first = true;
   // read next entry
   for (;;) {
     if (!discard(remainingSize, ec)) {
@@ -402,20 +522,28 @@ std::optional<Header> Reader::Next(bela::error_code &ec) {
     if (!discard(paddingSize, ec)) {
       return std::nullopt;
     }
+    if (first) {
+      headerOffset = offset;
+      first = false;
+    }
     Header h;
-    if (!readHeader(h, ec)) {
+    const ustar_header *hdr = nullptr;
+    if (!readHeader(h, hdr, ec)) {
       return std::nullopt;
     }
     if (!handleRegularFile(h, paddingSize, ec)) {
       return std::nullopt;
     }
+    remainingSize = 0;
     if (h.Typeflag == TypeXHeader || h.Typeflag == TypeXGlobalHeader) {
       h.Format &= FormatPAX;
-      if (!parsePAX(h.Size, paxHdrs, ec)) {
+      if (!parsePAX(h.Size, pax, ec)) {
         return std::nullopt;
       }
       if (h.Typeflag == TypeXGlobalHeader) {
-        mergePAX(h, paxHdrs, ec);
+        if (!mergePAX(h, pax, ec)) {
+          return std::nullopt;
+        }
         // C++20 designated initializers
         // https://mariusbancila.ro/blog/2020/02/27/c20-designated-initializers/
         // a designator must refer to a non-static direct data member
@@ -425,35 +553,31 @@ std::optional<Header> Reader::Next(bela::error_code &ec) {
         // it is not possible to mix designated and non-designated initialization
         // desginators of the same data member cannot appear multiple times
         // designators cannot be nested
-        return std::make_optional(Header{.Name = h.Name,
-                                         .Xattrs = h.Xattrs,
-                                         .PAXRecords = h.PAXRecords,
-                                         .Format = h.Format,
-                                         .Typeflag = h.Typeflag});
+        return std::make_optional(Header{.Name = h.Name, .PAX = h.PAX, .Format = h.Format, .Typeflag = h.Typeflag});
       }
       continue;
     }
     if (h.Typeflag == TypeGNULongName || h.Typeflag == TypeGNULongLink) {
       h.Format = FormatGNU;
-      Buffer realname(h.Size);
-      if (!ReadFull(realname.data(), h.Size, ec)) {
+      std::string_view body;
+      if (!readBody(h.Size, body, ec)) {
         return std::nullopt;
       }
       if (h.Typeflag == TypeGNULongName) {
-        gnuLongName = parseString(realname.data(), h.Size);
+        gnuLongName = parseString(body.data(), body.size());
         continue;
       }
-      gnuLongLink = parseString(realname.data(), h.Size);
+      gnuLongLink = parseString(body.data(), body.size());
       continue;
     }
-    if (!mergePAX(h, paxHdrs, ec)) {
+    if (!mergePAX(h, pax, ec)) {
       return std::nullopt;
     }
     if (!gnuLongName.empty()) {
-      h.Name = std::move(gnuLongName);
+      h.Name = gnuLongName;
     }
     if (!gnuLongLink.empty()) {
-      h.LinkName = std::move(gnuLongLink);
+      h.LinkName = gnuLongLink;
     }
     if (h.Typeflag == TypeRegA) {
       h.Typeflag = h.Name.ends_with('/') ? TypeDir : TypeReg;
@@ -461,20 +585,82 @@ std::optional<Header> Reader::Next(bela::error_code &ec) {
     if (!handleRegularFile(h, paddingSize, ec)) {
       return std::nullopt;
     }
-    // TODO support tar sparse feature
+    remainingSize = h.Size;
     if ((h.Format & (FormatUSTAR | FormatPAX)) != 0) {
       h.Format = FormatUSTAR;
     }
-    remainingSize = h.Size;
-    return std::make_optional(std::move(h));
+    if (!handleSparseFile(h, reinterpret_cast<const gnutar_header *>(hdr), ec)) {
+      return std::nullopt;
+    }
+    dataOffset = offset;
+    return std::make_optional(h);
   }
   return std::nullopt;
 }
 
+// writeSparse write the logical range [sparsePos, sparsePos+size) of a sparse entry
+bool Reader::writeSparse(const Writer &w, const Hole &hole, int64_t size, bela::error_code &ec) {
+  auto end = (std::min)(sparsePos + size, sparse.back().endOffset());
+  while (sparsePos < end) {
+    while (sparse[sparseNext].endOffset() <= sparsePos) {
+      sparseNext++;
+    }
+    const auto &f = sparse[sparseNext];
+    if (sparsePos < f.Offset) {
+      auto n = (std::min)(f.Offset, end) - sparsePos;
+      if (!hole(n, ec)) {
+        return false;
+      }
+      sparsePos += n;
+      continue;
+    }
+    auto n = (std::min)(f.endOffset(), end) - sparsePos;
+    int64_t extracted{0};
+    auto ret = r->WriteTo(w, n, extracted, ec);
+    offset += extracted;
+    remainingSize -= extracted;
+    sparsePos += extracted;
+    if (!ret) {
+      return false;
+    }
+    if (extracted != n) {
+      ec = bela::make_error_code(bela::ErrEnded, L"tar: sparse data truncated");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Reader::WriteTo(const Writer &w, const Hole &hole, int64_t filesize, bela::error_code &ec) {
+  if (sparse.empty()) {
+    return WriteTo(w, filesize, ec);
+  }
+  ec.clear();
+  return writeSparse(w, hole, filesize, ec);
+}
+
 bool Reader::WriteTo(const Writer &w, int64_t filesize, bela::error_code &ec) {
+  if (!sparse.empty()) {
+    ec.clear();
+    return writeSparse(
+        w,
+        [&](int64_t len, bela::error_code &ec) -> bool {
+          static const uint8_t zeros[blockSize * 16] = {0};
+          while (len > 0) {
+            auto n = (std::min)(len, static_cast<int64_t>(sizeof(zeros)));
+            if (!w(zeros, static_cast<size_t>(n), ec)) {
+              return false;
+            }
+            len -= n;
+          }
+          return true;
+        },
+        filesize, ec);
+  }
   ec.clear();
   int64_t extracted{0};
   auto ret = r->WriteTo(w, filesize, extracted, ec);
+  offset += extracted;
   if (remainingSize > 0) {
     remainingSize -= extracted;
   }
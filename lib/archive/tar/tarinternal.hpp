@@ -16,6 +16,8 @@ constexpr size_t nameSize = 100;   // Max length of the name field in USTAR form
 constexpr size_t prefixSize = 155; // Max length of the prefix field in USTAR format
 constexpr size_t outsize = 64 * 1024;
 constexpr size_t insize = 32 * 1024;
+// maxSpecialFileSize limit of PAX and GNU long name headers
+constexpr int64_t maxSpecialFileSize = 1 << 20;
 
 struct tar_v7_header {
   char name[100];
@@ -78,21 +80,36 @@ constexpr std::string_view paxGNUSparseMinor = "GNU.sparse.minor";
 constexpr std::string_view paxGNUSparseSize = "GNU.sparse.size";
 constexpr std::string_view paxGNUSparseRealSize = "GNU.sparse.realsize";
 bool parsePAXTime(std::string_view p, bela::Time &t, bela::error_code &ec);
-bool mergePAX(Header &h, pax_records_t &paxHdrs, bela::error_code &ec);
+bool mergePAX(Header &h, std::string_view pax, bela::error_code &ec);
 bool parsePAXRecord(std::string_view *sv, std::string_view *k, std::string_view *v, bela::error_code &ec);
+// forEachPAXRecord call fn(k, v) for the records of pax in order, false on a malformed record
+template <typename F> bool forEachPAXRecord(std::string_view pax, F &&fn, bela::error_code &ec) {
+  while (!pax.empty()) {
+    std::string_view k;
+    std::string_view v;
+    if (!parsePAXRecord(&pax, &k, &v, ec)) {
+      return false;
+    }
+    if (!fn(k, v)) {
+      return false;
+    }
+  }
+  return true;
+}
 bool validateSparseEntries(sparseDatas &spd, int64_t size);
+// isZeroBlock and getFormat examine a whole 512 byte block with SSE2/NEON where available
+bool isZeroBlock(const ustar_header &hdr);
 tar_format_t getFormat(const ustar_header &hdr);
-inline std::string parseString(const void *data, size_t N) {
+// parseString view of a NUL padded field
+inline std::string_view parseString(const void *data, size_t N) {
   auto p = reinterpret_cast<const char *>(data);
-  auto pos = memchr(p, 0, N);
-  if (pos == nullptr) {
-    return std::string(p, N);
+  if (auto pos = memchr(p, 0, N); pos != nullptr) {
+    N = reinterpret_cast<const char *>(pos) - p;
   }
-  N = reinterpret_cast<const char *>(pos) - p;
-  return std::string(p, N);
+  return std::string_view(p, N);
 }
 
-template <size_t N> std::string parseString(const char (&aArr)[N]) { return parseString(aArr, N); }
+template <size_t N> std::string_view parseString(const char (&aArr)[N]) { return parseString(aArr, N); }
 
 inline int64_t parseNumeric8(const char *p, size_t char_cnt) {
   int64_t val = 0;
@@ -148,6 +165,35 @@ inline int64_t parseNumeric(const char *p, size_t char_cnt) {
 
 template <size_t N> int64_t parseNumeric(const char (&aArr)[N]) { return parseNumeric(aArr, N); }
 
+// randomStream sequential view of a RandomReader, Discard skips without reading
+class randomStream : public ExtractReader {
+public:
+  randomStream(RandomReader &rr_, int64_t pos_ = 0) : rr(rr_), pos(pos_) {}
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) {
+    auto n = rr.ReadAt(buffer, len, pos, ec);
+    if (n > 0) {
+      pos += n;
+    }
+    return n;
+  }
+  bool Discard(int64_t len, bela::error_code &ec) {
+    pos += len;
+    return true;
+  }
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+    if (!rr.WriteTo(w, pos, filesize, ec)) {
+      return false;
+    }
+    pos += filesize;
+    extracted += filesize;
+    return true;
+  }
+
+private:
+  RandomReader &rr;
+  int64_t pos{0};
+};
+
 } // namespace baulk::archive::tar
 
 #endif
\ No newline at end of file
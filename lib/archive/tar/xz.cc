@@ -9,7 +9,26 @@ Reader::~Reader() {
     baulk::archive::archive_internal::Deallocate(xzs, 1);
   }
 }
+// initializeParallel: multi-block streams (xz -T) carry an index of independent blocks, decode them on worker
+// threads. Returns false to fall back to the streaming decoder.
+bool Reader::initializeParallel() {
+  if (fr == nullptr || fr->Size() <= 0) {
+    return false;
+  }
+  auto readAt = [this](void *buffer, size_t len, int64_t pos, bela::error_code &ec) -> bool {
+    return fr->ReadFullAt(buffer, len, pos, ec);
+  };
+  mt = baulk::archive::xz::NewParallelDecoder(std::move(readAt), fr->Size());
+  return mt != nullptr;
+}
+
 bool Reader::Initialize(bela::error_code &ec) {
+  if (initializeParallel()) {
+    return true;
+  }
+  if (fr != nullptr && !fr->PositionAt(0, ec)) {
+    return false;
+  }
   xzs = baulk::archive::archive_internal::Allocate<lzma_stream>(1);
   memset(xzs, 0, sizeof(lzma_stream));
   auto ret = lzma_stream_decoder(xzs, UINT64_MAX, LZMA_CONCATENATED);
@@ -60,6 +79,10 @@ inline bela::error_code XzErrorCode(lzma_ret ret) {
 }
 
 bool Reader::decompress(bela::error_code &ec) {
+  if (mt) {
+    // decoded blocks keep stream order, ErrEnded after the last one
+    return mt->Next(out, ec);
+  }
   if (ret == LZMA_STREAM_END) {
     ec = bela::make_error_code(bela::ErrEnded, L"xz stream end");
     return false;
@@ -3,11 +3,14 @@
 #define BAULK_ARCHIVE_TAR_XZ_HPP
 #include "tarinternal.hpp"
 #include <lzma.h>
+#include "../xzblocks.hpp"
 
 namespace baulk::archive::tar::xz {
 class Reader : public ExtractReader {
 public:
   Reader(ExtractReader *lr) : r(lr) {}
+  // seekable input, multi-block streams are decoded in parallel
+  Reader(FileReader *fr_) : r(fr_), fr(fr_) {}
   Reader(const Reader &) = delete;
   Reader &operator=(const Reader &) = delete;
   ~Reader();
@@ -18,8 +21,11 @@ public:
 
 private:
   bool decompress(bela::error_code &ec);
+  bool initializeParallel();
   bela::ssize_t ReadAtLeast(void *buffer, size_t size, bela::error_code &ec);
   ExtractReader *r{nullptr};
+  FileReader *fr{nullptr};
+  std::unique_ptr<baulk::archive::ParallelDecoder> mt;
   lzma_stream *xzs{nullptr};
   Buffer in;
   Buffer out;
@@ -7,7 +7,26 @@ Reader::~Reader() {
     ZSTD_freeDCtx(zds);
   }
 }
+// initializeParallel: pzstd and seekable archives hold many independent frames, decode them on worker threads.
+// Returns false to fall back to the streaming decoder.
+bool Reader::initializeParallel() {
+  if (fr == nullptr || fr->Size() <= 0) {
+    return false;
+  }
+  auto readAt = [this](void *buffer, size_t len, int64_t pos, bela::error_code &ec) -> bool {
+    return fr->ReadFullAt(buffer, len, pos, ec);
+  };
+  mt = baulk::archive::zstd::NewParallelDecoder(std::move(readAt), fr->Size());
+  return mt != nullptr;
+}
+
 bool Reader::Initialize(bela::error_code &ec) {
+  if (initializeParallel()) {
+    return true;
+  }
+  if (fr != nullptr && !fr->PositionAt(0, ec)) {
+    return false;
+  }
   zds = ZSTD_createDCtx();
   if (zds == nullptr) {
     ec = bela::make_error_code(L"ZSTD_createDStream() out of memory");
@@ -22,6 +41,10 @@ bool Reader::Initialize(bela::error_code &ec) {
 }
 
 bool Reader::decompress(bela::error_code &ec) {
+  if (mt) {
+    // decoded frames keep stream order, ErrEnded after the last one
+    return mt->Next(outb, ec);
+  }
   for (;;) {
     if (in.pos == in.size) {
       auto n = r->Read(inb.data(), inb.capacity(), ec);
@@ -3,11 +3,14 @@
 #define BAULK_ARCHIVE_TAR_ZSTD_HPP
 #include "tarinternal.hpp"
 #include <zstd.h>
+#include "../zstdframes.hpp"
 
 namespace baulk::archive::tar::zstd {
 class Reader : public ExtractReader {
 public:
   Reader(ExtractReader *lr) : r(lr) {}
+  // seekable input, multi-frame streams are decoded in parallel
+  Reader(FileReader *fr_) : r(fr_), fr(fr_) {}
   Reader(const Reader &) = delete;
   Reader &operator=(const Reader &) = delete;
   ~Reader();
@@ -18,7 +21,10 @@ public:
 
 private:
   bool decompress(bela::error_code &ec);
+  bool initializeParallel();
   ExtractReader *r{nullptr};
+  FileReader *fr{nullptr};
+  std::unique_ptr<baulk::archive::ParallelDecoder> mt;
   ZSTD_DCtx *zds{nullptr};
   Buffer outb;
   Buffer inb;
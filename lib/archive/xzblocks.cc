@@ -0,0 +1,167 @@
+//
+#include "xzblocks.hpp"
+
+namespace baulk::archive::xz {
+constexpr size_t streamHeaderSize = LZMA_STREAM_HEADER_SIZE;
+constexpr uint64_t maxIndexSize = 64ULL * 1024 * 1024;
+
+inline bela::error_code xzErrorCode(lzma_ret ret, std::wstring_view prefix) {
+  switch (ret) {
+  case LZMA_MEM_ERROR:
+    return bela::make_error_code(ErrGeneral, prefix, L"memory error");
+  case LZMA_FORMAT_ERROR:
+    return bela::make_error_code(ErrGeneral, prefix, L"File format not recognized");
+  case LZMA_OPTIONS_ERROR:
+    return bela::make_error_code(ErrGeneral, prefix, L"Unsupported compression options");
+  case LZMA_DATA_ERROR:
+    return bela::make_error_code(ErrGeneral, prefix, L"File is corrupt");
+  case LZMA_BUF_ERROR:
+    return bela::make_error_code(ErrGeneral, prefix, L"Unexpected end of input");
+  default:
+    break;
+  }
+  return bela::make_error_code(ErrGeneral, prefix, L"Internal error (bug) ret=", static_cast<int>(ret));
+}
+
+// lookupStream parse the stream ending at end, returns stream start
+bool lookupStream(const ReadAt &readAt, int64_t end, std::vector<BlockInfo> &blocks, int64_t &start,
+                  bela::error_code &ec) {
+  uint8_t buf[streamHeaderSize];
+  if (end < static_cast<int64_t>(streamHeaderSize * 2) || !readAt(buf, streamHeaderSize, end - streamHeaderSize, ec)) {
+    ec = bela::make_error_code(ErrGeneral, L"xz stream footer truncated");
+    return false;
+  }
+  lzma_stream_flags footer;
+  if (auto ret = lzma_stream_footer_decode(&footer, buf); ret != LZMA_OK) {
+    ec = xzErrorCode(ret, L"xz stream footer: ");
+    return false;
+  }
+  auto indexSize = static_cast<int64_t>(footer.backward_size);
+  if (footer.backward_size > maxIndexSize ||
+      end < static_cast<int64_t>(streamHeaderSize * 2) + indexSize) {
+    ec = bela::make_error_code(ErrGeneral, L"xz index size ", footer.backward_size, L" invalid");
+    return false;
+  }
+  Buffer ib(static_cast<size_t>(indexSize));
+  if (!readAt(ib.data(), static_cast<size_t>(indexSize), end - streamHeaderSize - indexSize, ec)) {
+    return false;
+  }
+  lzma_index *index = nullptr;
+  uint64_t memlimit = UINT64_MAX;
+  size_t inpos = 0;
+  if (auto ret = lzma_index_buffer_decode(&index, &memlimit, nullptr, ib.data(), &inpos, static_cast<size_t>(indexSize));
+      ret != LZMA_OK) {
+    ec = xzErrorCode(ret, L"xz index: ");
+    return false;
+  }
+  auto closer = bela::finally([&] { lzma_index_end(index, nullptr); });
+  auto streamSize = static_cast<int64_t>(lzma_index_stream_size(index));
+  if (streamSize > end) {
+    ec = bela::make_error_code(ErrGeneral, L"xz stream size ", streamSize, L" exceeds data");
+    return false;
+  }
+  start = end - streamSize;
+  if (!readAt(buf, streamHeaderSize, start, ec)) {
+    return false;
+  }
+  lzma_stream_flags header;
+  if (auto ret = lzma_stream_header_decode(&header, buf); ret != LZMA_OK) {
+    ec = xzErrorCode(ret, L"xz stream header: ");
+    return false;
+  }
+  if (auto ret = lzma_stream_flags_compare(&header, &footer); ret != LZMA_OK) {
+    ec = bela::make_error_code(ErrGeneral, L"xz stream header and footer mismatch");
+    return false;
+  }
+  std::vector<BlockInfo> sb;
+  lzma_index_iter iter;
+  lzma_index_iter_init(&iter, index);
+  while (!lzma_index_iter_next(&iter, LZMA_INDEX_ITER_BLOCK)) {
+    sb.emplace_back(BlockInfo{start + static_cast<int64_t>(iter.block.compressed_stream_offset),
+                              iter.block.total_size, iter.block.uncompressed_size, header.check});
+  }
+  blocks.insert(blocks.begin(), sb.begin(), sb.end());
+  return true;
+}
+
+bool LookupBlocks(const ReadAt &readAt, int64_t size, std::vector<BlockInfo> &blocks, bela::error_code &ec) {
+  blocks.clear();
+  auto end = size;
+  while (end > 0) {
+    // stream padding is a multiple of four null bytes
+    uint8_t padding[4];
+    if (end < 4 || !readAt(padding, 4, end - 4, ec)) {
+      ec = bela::make_error_code(ErrGeneral, L"xz stream truncated");
+      return false;
+    }
+    if (padding[0] == 0 && padding[1] == 0 && padding[2] == 0 && padding[3] == 0) {
+      end -= 4;
+      continue;
+    }
+    int64_t start = 0;
+    if (!lookupStream(readAt, end, blocks, start, ec)) {
+      return false;
+    }
+    end = start;
+  }
+  return true;
+}
+
+bool decodeBlock(const BlockInfo &bi, const Buffer &in, Buffer &out, bela::error_code &ec) {
+  lzma_filter filters[LZMA_FILTERS_MAX + 1];
+  lzma_block block;
+  memset(&block, 0, sizeof(block));
+  block.version = 1;
+  block.check = bi.check;
+  block.filters = filters;
+  block.header_size = lzma_block_header_size_decode(in.data()[0]);
+  if (block.header_size > in.size()) {
+    ec = bela::make_error_code(ErrGeneral, L"xz block header truncated");
+    return false;
+  }
+  if (auto ret = lzma_block_header_decode(&block, nullptr, in.data()); ret != LZMA_OK) {
+    ec = xzErrorCode(ret, L"xz block header: ");
+    return false;
+  }
+  // options are allocated by lzma_block_header_decode with the default allocator
+  auto closer = bela::finally([&] {
+    for (size_t i = 0; filters[i].id != LZMA_VLI_UNKNOWN; i++) {
+      free(filters[i].options);
+    }
+  });
+  size_t inpos = block.header_size;
+  size_t outpos = 0;
+  if (auto ret = lzma_block_buffer_decode(&block, nullptr, in.data(), &inpos, in.size(), out.data(), &outpos,
+                                          static_cast<size_t>(bi.uncompressedSize));
+      ret != LZMA_OK) {
+    ec = xzErrorCode(ret, L"xz block: ");
+    return false;
+  }
+  if (outpos != bi.uncompressedSize) {
+    ec = bela::make_error_code(ErrGeneral, L"xz block size ", outpos, L" index ", bi.uncompressedSize);
+    return false;
+  }
+  out.size() = outpos;
+  out.pos() = 0;
+  return true;
+}
+
+std::unique_ptr<ParallelDecoder> NewParallelDecoder(ReadAt &&readAt, int64_t size) {
+  std::vector<BlockInfo> blocks;
+  bela::error_code ec;
+  if (!LookupBlocks(readAt, size, blocks, ec)) {
+    return nullptr;
+  }
+  std::vector<Chunk> chunks;
+  chunks.reserve(blocks.size());
+  for (const auto &b : blocks) {
+    chunks.emplace_back(Chunk{b.offset, b.totalSize, b.uncompressedSize});
+  }
+  return MakeChunkDecoder(
+      std::move(readAt), std::move(chunks),
+      [blocks = std::move(blocks)](size_t index, const Chunk &, const Buffer &in, Buffer &out, bela::error_code &ec) {
+        return decodeBlock(blocks[index], in, out, ec);
+      });
+}
+
+} // namespace baulk::archive::xz
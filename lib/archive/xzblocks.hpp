@@ -0,0 +1,26 @@
+//
+#ifndef BAULK_ARCHIVE_XZBLOCKS_HPP
+#define BAULK_ARCHIVE_XZBLOCKS_HPP
+#include "parallel.hpp"
+#include <lzma.h>
+
+namespace baulk::archive::xz {
+
+struct BlockInfo {
+  int64_t offset{0};         // block header position
+  uint64_t totalSize{0};     // block header + compressed data + padding + check
+  uint64_t uncompressedSize{0};
+  lzma_check check{LZMA_CHECK_NONE};
+};
+
+// LookupBlocks walks stream footers and indexes backwards from the end of the data, concatenated streams and
+// stream padding are supported. Returns false when the data is not a complete .xz file.
+bool LookupBlocks(const ReadAt &readAt, int64_t size, std::vector<BlockInfo> &blocks, bela::error_code &ec);
+
+// NewParallelDecoder block decoder over [0, size) of readAt, nullptr when the data is a single block or its index
+// is unreadable and the streaming decoder should be used
+std::unique_ptr<ParallelDecoder> NewParallelDecoder(ReadAt &&readAt, int64_t size);
+
+} // namespace baulk::archive::xz
+
+#endif
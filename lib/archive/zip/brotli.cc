@@ -1,12 +1,13 @@
 ///
-#include "zipinternal.hpp"
+#include "decodercache.hpp"
 #include <brotli/decode.h>
 
 namespace baulk::archive::zip {
 
 // https://github.com/google/brotli/blob/master/c/tools/brotli.c#L884
 // Brotli
-bool Reader::decompressBrotli(const File &file, const Writer &w, bela::error_code &ec) const {
+bool Reader::decompressBrotli(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                              bela::error_code &ec) const {
   auto state = BrotliDecoderCreateInstance(0, 0, 0);
   if (state == nullptr) {
     ec = bela::make_error_code(L"BrotliDecoderCreateInstance failed");
@@ -14,26 +15,30 @@ bool Reader::decompressBrotli(const File &file, const Writer &w, bela::error_cod
   }
   auto closer = bela::finally([&] { BrotliDecoderDestroyInstance(state); });
   BrotliDecoderSetParameter(state, BROTLI_DECODER_PARAM_LARGE_WINDOW, 1u);
-  Buffer out(outsize);
-  Buffer in(insize);
+  auto &out = cache.Output(outputSize(file.uncompressedSize, outsize));
+  const auto outlen = (std::min)(out.capacity(), outsize);
+  auto &in = cache.Input();
+  const auto chunksize = InputSize(insize);
   auto csize = file.compressedSize;
   BrotliDecoderResult result{};
   size_t totalout = 0;
   uint32_t crc32val = 0;
   while (csize != 0) {
-    auto minsize = (std::min)(csize, static_cast<uint64_t>(insize));
-    if (!ReadFull(in.data(), static_cast<size_t>(minsize), ec)) {
+    auto minsize = (std::min)(csize, static_cast<uint64_t>(chunksize));
+    auto input = ReadIn(in, static_cast<size_t>(minsize), offset, ec);
+    if (input == nullptr) {
       return false;
     }
+    offset += minsize;
     size_t avail_in = static_cast<size_t>(minsize);
-    const unsigned char *inptr = in.data();
+    const unsigned char *inptr = input;
     for (;;) {
       auto outptr = out.data();
-      auto avail_out = outsize;
+      auto avail_out = outlen;
       result = BrotliDecoderDecompressStream(state, &avail_in, &inptr, &avail_out, &outptr, &totalout);
       if (outptr != out.data()) {
         auto have = outptr - out.data();
-        crc32val = crc32_fast(out.data(), have, crc32val);
+        crc32val = crc32::Update(out.data(), have, crc32val);
         if (!w(out.data(), have)) {
           ec = bela::make_error_code(ErrCanceled, L"canceled");
           return false;
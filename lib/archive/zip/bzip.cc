@@ -1,32 +1,37 @@
 ///
-#include "zipinternal.hpp"
+#include "decodercache.hpp"
 #include <bzlib.h>
 
 namespace baulk::archive::zip {
 
 // bzip2
-bool Reader::decompressBz2(const File &file, const Writer &w, bela::error_code &ec) const {
+bool Reader::decompressBz2(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                           bela::error_code &ec) const {
   bz_stream bzs{};
   if (auto ret = BZ2_bzDecompressInit(&bzs, 0, 0); ret != BZ_OK) {
     ec = bela::make_error_code(ret, L"BZ2_bzDecompressInit error");
     return false;
   }
   auto closer = bela::finally([&] { BZ2_bzDecompressEnd(&bzs); });
-  Buffer out(outsize);
-  Buffer in(insize);
+  auto &out = cache.Output(outputSize(file.uncompressedSize, outsize));
+  const auto outlen = (std::min)(out.capacity(), outsize);
+  auto &in = cache.Input();
+  const auto chunksize = InputSize(insize);
   int64_t uncsize = 0;
   auto csize = file.compressedSize;
   int ret = BZ_OK;
   uint32_t crc32val = 0;
   while (csize != 0) {
-    auto minsize = (std::min)(csize, static_cast<uint64_t>(insize));
-    if (!ReadFull(in.data(), static_cast<size_t>(minsize), ec)) {
+    auto minsize = (std::min)(csize, static_cast<uint64_t>(chunksize));
+    auto input = ReadIn(in, static_cast<size_t>(minsize), offset, ec);
+    if (input == nullptr) {
       return false;
     }
+    offset += minsize;
     bzs.avail_in = static_cast<unsigned int>(minsize);
-    bzs.next_in = reinterpret_cast<char *>(in.data());
+    bzs.next_in = reinterpret_cast<char *>(const_cast<uint8_t *>(input));
     do {
-      bzs.avail_out = static_cast<int>(outsize);
+      bzs.avail_out = static_cast<unsigned int>(outlen);
       bzs.next_out = reinterpret_cast<char *>(out.data());
       ret = BZ2_bzDecompress(&bzs);
       switch (ret) {
@@ -38,8 +43,8 @@ bool Reader::decompressBz2(const File &file, const Writer &w, bela::error_code &
       default:
         break;
       }
-      auto have = outsize - bzs.avail_out;
-      crc32val = crc32_fast(out.data(), have, crc32val);
+      auto have = outlen - bzs.avail_out;
+      crc32val = crc32::Update(out.data(), have, crc32val);
       if (!w(out.data(), have)) {
         ec = bela::make_error_code(ErrCanceled, L"canceled");
         return false;
@@ -0,0 +1,65 @@
+///
+#include "decodercache.hpp"
+
+namespace baulk::archive::zip {
+DecoderCache &DecoderCache::Local() {
+  thread_local DecoderCache cache;
+  return cache;
+}
+
+DecoderCache::~DecoderCache() {
+  if (inflaterReady) {
+    inflateEnd(&zs);
+  }
+  if (zds != nullptr) {
+    ZSTD_freeDCtx(zds);
+  }
+  lzma_end(&xz);
+  ReleasePpmd();
+}
+
+z_stream *DecoderCache::Inflater(bela::error_code &ec) {
+  if (inflaterReady) {
+    if (auto zerr = inflateReset(&zs); zerr != Z_OK) {
+      ec = bela::make_error_code(ErrGeneral, bela::ToWide(zError(zerr)));
+      return nullptr;
+    }
+    return &zs;
+  }
+  memset(&zs, 0, sizeof(zs));
+  if (auto zerr = inflateInit2(&zs, -MAX_WBITS); zerr != Z_OK) {
+    ec = bela::make_error_code(ErrGeneral, bela::ToWide(zError(zerr)));
+    return nullptr;
+  }
+  inflaterReady = true;
+  return &zs;
+}
+
+ZSTD_DCtx *DecoderCache::Zstd(bela::error_code &ec) {
+  if (zds != nullptr) {
+    ZSTD_DCtx_reset(zds, ZSTD_reset_session_only);
+    return zds;
+  }
+  if (zds = ZSTD_createDCtx(); zds == nullptr) {
+    ec = bela::make_error_code(L"ZSTD_createDStream() out of memory");
+    return nullptr;
+  }
+  return zds;
+}
+
+CPpmd8 *DecoderCache::Ppmd() {
+  if (!ppmdReady) {
+    memset(&ppmd, 0, sizeof(ppmd));
+    Ppmd8_Construct(&ppmd);
+    ppmdReady = true;
+  }
+  return &ppmd;
+}
+
+void DecoderCache::ReleasePpmd() {
+  if (ppmdReady) {
+    ppmdFree(&ppmd);
+  }
+}
+
+} // namespace baulk::archive::zip
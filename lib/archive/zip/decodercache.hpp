@@ -0,0 +1,62 @@
+//
+#ifndef BAULK_ZIP_DECODERCACHE_HPP
+#define BAULK_ZIP_DECODERCACHE_HPP
+#include "zipinternal.hpp"
+#include <zlib.h>
+#undef crc32 // chromeconf.h renames zlib crc32(), keep baulk::archive::crc32
+#include <zstd.h>
+#include <lzma.h>
+#include "../ppmd/Ppmd8.h"
+
+namespace baulk::archive::zip {
+// cached PPMd models up to this size, larger ones are released after the entry
+constexpr uint32_t ppmdCacheLimit = 64 << 20;
+
+// DecoderCache decoder contexts and buffers reused across entries. Reader::Decompress takes the cache of the calling
+// thread: inflate and zstd contexts are reset, liblzma reinitializes a stream in place and keeps its dictionary, PPMd
+// keeps its model memory. bzip2 and brotli have no reset, only the buffers are reused for them. The cache is not
+// reentrant, a Writer must not decompress on the same thread.
+class DecoderCache {
+public:
+  DecoderCache() = default;
+  DecoderCache(const DecoderCache &) = delete;
+  DecoderCache &operator=(const DecoderCache &) = delete;
+  ~DecoderCache();
+  static DecoderCache &Local();
+  // Inflater raw deflate stream, ready for a new entry
+  z_stream *Inflater(bela::error_code &ec);
+  ZSTD_DCtx *Zstd(bela::error_code &ec);
+  // Lzma stream for lzma_stream_decoder or lzma_alone_decoder, which reuse the memory of the previous decoder
+  lzma_stream *Lzma() { return &xz; }
+  // Ppmd constructed model, Ppmd8_Alloc keeps its memory when the entry uses the same size
+  CPpmd8 *Ppmd();
+  void ReleasePpmd();
+  // Output buffer of at least n bytes, entries smaller than the decoder buffer get a buffer of their size
+  Buffer &Output(size_t n) {
+    out.grow(n);
+    return out;
+  }
+  Buffer &Input() { return in; }
+
+private:
+  z_stream zs;
+  ZSTD_DCtx *zds{nullptr};
+  lzma_stream xz = LZMA_STREAM_INIT;
+  CPpmd8 ppmd;
+  Buffer out;
+  Buffer in;
+  bool inflaterReady{false};
+  bool ppmdReady{false};
+};
+
+// outputSize decoder buffer for an entry of size bytes, at most limit
+inline size_t outputSize(uint64_t size, size_t limit) {
+  constexpr uint64_t minOutputSize = 4096;
+  return static_cast<size_t>((std::clamp)(size, minOutputSize, static_cast<uint64_t>(limit)));
+}
+
+// ppmdFree release the model memory of a PPMd decoder (ppmd.cc owns its allocator)
+void ppmdFree(CPpmd8 *p);
+} // namespace baulk::archive::zip
+
+#endif
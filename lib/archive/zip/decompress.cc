@@ -1,8 +1,11 @@
 ///
 #include <bela/endian.hpp>
-#include "zipinternal.hpp"
+#include <optional>
+#include "decodercache.hpp"
 
 namespace baulk::archive::zip {
+// mapped stored entries are checked and written in slices, the write finds the slice still in cache
+constexpr size_t mappedStoredSize = 256 * 1024;
 
 bool Reader::Decompress(const File &file, const Writer &w, bela::error_code &ec) const {
   uint8_t buf[fileHeaderLen];
@@ -17,43 +20,69 @@ bool Reader::Decompress(const File &file, const Writer &w, bela::error_code &ec)
   b.Discard(22);
   auto filenameLen = static_cast<int>(b.Read<uint16_t>());
   auto extraLen = static_cast<int>(b.Read<uint16_t>());
-  auto position = file.position + fileHeaderLen + filenameLen + extraLen;
-  if (!PositionAt(position, ec)) {
-    return false;
+  auto position = static_cast<int64_t>(file.position + fileHeaderLen + filenameLen + extraLen);
+  std::optional<DecoderCache> fresh;
+  if (file.method != ZIP_STORE && !options.decoderCache) {
+    fresh.emplace();
   }
+  auto &cache = fresh ? *fresh : DecoderCache::Local();
   switch (file.method) {
   case ZIP_STORE: {
-    uint8_t buffer[4096];
     auto csize = file.compressedSize;
+    uint32_t crc32val = 0;
+    if (auto data = view.At(position, csize); data != nullptr) {
+      // zero-copy: the writer gets slices of the mapping
+      while (csize != 0) {
+        auto minsize = static_cast<size_t>((std::min)(csize, static_cast<uint64_t>(mappedStoredSize)));
+        crc32val = crc32::Update(data, minsize, crc32val);
+        if (!w(data, minsize)) {
+          return false;
+        }
+        data += minsize;
+        csize -= minsize;
+      }
+      if (crc32val != file.crc32sum) {
+        ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32sum, L" got ", crc32val, L" not match");
+        return false;
+      }
+      break;
+    }
+    uint8_t buffer[4096];
     while (csize != 0) {
       auto minsize = (std::min)(csize, static_cast<uint64_t>(sizeof(buffer)));
-      if (!ReadFull(buffer, static_cast<size_t>(minsize), ec)) {
+      if (!ReadAt(buffer, static_cast<size_t>(minsize), position, ec)) {
         return false;
       }
+      position += minsize;
+      crc32val = crc32::Update(buffer, static_cast<size_t>(minsize), crc32val);
       if (!w(buffer, static_cast<size_t>(minsize))) {
         return false;
       }
       csize -= minsize;
     }
+    if (crc32val != file.crc32sum) {
+      ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32sum, L" got ", crc32val, L" not match");
+      return false;
+    }
   } break;
   case ZIP_DEFLATE:
-    return decompressDeflate(file, w, ec);
+    return decompressDeflate(file, position, cache, w, ec);
   case ZIP_DEFLATE64:
-    return decompressDeflate64(file, w, ec);
+    return decompressDeflate64(file, position, cache, w, ec);
   case 20:
     [[fallthrough]];
   case ZIP_ZSTD:
-    return decompressZstd(file, w, ec);
+    return decompressZstd(file, position, cache, w, ec);
   case ZIP_LZMA:
-    return decompressLZMA(file, w, ec);
+    return decompressLZMA(file, position, cache, w, ec);
   case ZIP_XZ:
-    return decompressXz(file, w, ec);
+    return decompressXz(file, position, cache, w, ec);
   case ZIP_BZIP2:
-    return decompressBz2(file, w, ec);
+    return decompressBz2(file, position, cache, w, ec);
   case ZIP_PPMD:
-    return decompressPpmd(file, w, ec);
+    return decompressPpmd(file, position, cache, w, ec);
   case ZIP_BROTLI:
-    return decompressBrotli(file, w, ec);
+    return decompressBrotli(file, position, cache, w, ec);
   default:
     ec = bela::make_error_code(ErrGeneral, L"unsupport zip method ", file.method);
     return false;
@@ -1,38 +1,87 @@
 ///
-#include "zipinternal.hpp"
-#include <zlib.h>
+#include "decodercache.hpp"
 
 namespace baulk::archive::zip {
+// decompressDeflateOneShot: the central directory gives the exact sizes, so small entries are inflated with Z_FINISH
+// from the whole compressed input into a buffer of their uncompressed size. zlib skips its window copies when the
+// stream ends in one call, the crc runs while the output is still in cache and the Writer is called once. oneshot
+// stays false when the entry is too large or the stream does not match its sizes, the caller then streams it.
+bool Reader::decompressDeflateOneShot(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                                      bool &oneshot, bela::error_code &ec) const {
+  oneshot = false;
+  const auto limit = (std::min)(options.oneShotLimit, static_cast<uint64_t>((std::numeric_limits<uInt>::max)()));
+  if (file.uncompressedSize == 0 || file.uncompressedSize > limit || file.compressedSize > limit) {
+    return false;
+  }
+  oneshot = true;
+  auto zs = cache.Inflater(ec);
+  if (zs == nullptr) {
+    return false;
+  }
+  auto &in = cache.Input();
+  auto input = ReadIn(in, static_cast<size_t>(file.compressedSize), offset, ec);
+  if (input == nullptr) {
+    return false;
+  }
+  const auto size = static_cast<size_t>(file.uncompressedSize);
+  auto &out = cache.Output(size);
+  zs->next_in = const_cast<uint8_t *>(input);
+  zs->avail_in = static_cast<uInt>(file.compressedSize);
+  zs->next_out = out.data();
+  zs->avail_out = static_cast<uInt>(size);
+  if (::inflate(zs, Z_FINISH) != Z_STREAM_END || zs->total_out != size) {
+    // wrong sizes or corrupt data, nothing written yet: the streaming decoder reports it
+    oneshot = false;
+    return false;
+  }
+  auto crc32val = crc32::Update(out.data(), size);
+  if (!w(out.data(), size)) {
+    ec = bela::make_error_code(ErrCanceled, L"canceled");
+    return false;
+  }
+  if (crc32val != file.crc32sum) {
+    ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32sum, L" got ", crc32val, L" not match");
+    return false;
+  }
+  return true;
+}
+
 // DEFLATE
 // https://github.com/madler/zlib/blob/master/examples/zpipe.c#L92
-bool Reader::decompressDeflate(const File &file, const Writer &w, bela::error_code &ec) const {
-  z_stream zs;
-  memset(&zs, 0, sizeof(zs));
-  if (auto zerr = inflateInit2(&zs, -MAX_WBITS); zerr != Z_OK) {
-    ec = bela::make_error_code(ErrGeneral, bela::ToWide(zError(zerr)));
+bool Reader::decompressDeflate(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                               bela::error_code &ec) const {
+  auto oneshot = false;
+  if (auto result = decompressDeflateOneShot(file, offset, cache, w, oneshot, ec); oneshot) {
+    return result;
+  }
+  auto zs = cache.Inflater(ec);
+  if (zs == nullptr) {
     return false;
   }
-  auto closer = bela::finally([&] { inflateEnd(&zs); });
-  Buffer out(outsize);
-  Buffer in(insize);
+  auto &out = cache.Output(outputSize(file.uncompressedSize, outsize));
+  const auto outlen = (std::min)(out.capacity(), outsize);
+  auto &in = cache.Input();
+  const auto chunksize = InputSize(insize);
   int64_t uncsize = 0;
   auto csize = file.compressedSize;
   int ret = Z_OK;
   uint32_t crc32val = 0;
   while (csize != 0) {
-    auto minsize = (std::min)(csize, static_cast<uint64_t>(insize));
-    if (!ReadFull(in.data(), static_cast<size_t>(minsize), ec)) {
+    auto minsize = (std::min)(csize, static_cast<uint64_t>(chunksize));
+    auto input = ReadIn(in, static_cast<size_t>(minsize), offset, ec);
+    if (input == nullptr) {
       return false;
     }
-    zs.avail_in = static_cast<int>(minsize);
-    if (zs.avail_in == 0) {
+    offset += minsize;
+    zs->avail_in = static_cast<int>(minsize);
+    if (zs->avail_in == 0) {
       break;
     }
-    zs.next_in = in.data();
+    zs->next_in = const_cast<uint8_t *>(input);
     do {
-      zs.avail_out = static_cast<int>(outsize);
-      zs.next_out = out.data();
-      ret = ::inflate(&zs, Z_NO_FLUSH);
+      zs->avail_out = static_cast<uInt>(outlen);
+      zs->next_out = out.data();
+      ret = ::inflate(zs, Z_NO_FLUSH);
       switch (ret) {
       case Z_NEED_DICT:
         ret = Z_DATA_ERROR;
@@ -45,13 +94,13 @@ bool Reader::decompressDeflate(const File &file, const Writer &w, bela::error_co
       default:
         break;
       }
-      auto have = outsize - zs.avail_out;
-      crc32val = crc32_fast(out.data(), have, crc32val);
+      auto have = outlen - zs->avail_out;
+      crc32val = crc32::Update(out.data(), have, crc32val);
       if (!w(out.data(), have)) {
         ec = bela::make_error_code(ErrCanceled, L"canceled");
         return false;
       }
-    } while (zs.avail_out == 0);
+    } while (zs->avail_out == 0);
     csize -= minsize;
     if (ret == Z_STREAM_END) {
       break;
@@ -1,7 +1,6 @@
 ///
 // https://github.com/madler/sunzip/blob/master/sunzip.c
-#include "zipinternal.hpp"
-#include <zlib.h>
+#include "decodercache.hpp"
 // deflate64
 #include "../deflate64/infback9.h"
 
@@ -15,7 +14,7 @@ struct inflate64Writer {
 };
 int put(void *out_desc, unsigned char *buf, unsigned len) {
   auto w = reinterpret_cast<inflate64Writer *>(out_desc);
-  w->crc32val = crc32_fast(buf, len, w->crc32val);
+  w->crc32val = crc32::Update(buf, len, w->crc32val);
   w->count += len;
   if (!w->w(buf, len)) {
     w->canceled = true;
@@ -30,10 +29,21 @@ struct inflate64Reader {
   int64_t count{0};
   int64_t offset{0};
   int64_t size{0};
+  int64_t position{0};            // file position of compressed data
+  const uint8_t *mapped{nullptr}; // compressed data in the file mapping
 };
 
 unsigned get(void *in_desc, unsigned char **buf) {
   auto r = reinterpret_cast<inflate64Reader *>(in_desc);
+  if (r->mapped != nullptr) {
+    auto len = static_cast<unsigned>((std::min)(static_cast<int64_t>(mappedInputSize), r->size - r->offset));
+    if (buf != nullptr) {
+      *buf = const_cast<uint8_t *>(r->mapped + r->offset);
+    }
+    r->count += len;
+    r->offset += len;
+    return len;
+  }
   auto next = r->buf;
   if (buf != nullptr) {
     *buf = next;
@@ -44,7 +54,12 @@ unsigned get(void *in_desc, unsigned char **buf) {
   }
   DWORD got = 0;
   for (;;) {
-    if (::ReadFile(r->fd, next, want, &got, nullptr) != TRUE) {
+    // positional read, don't touch shared file pointer
+    auto pos = static_cast<uint64_t>(r->position + r->offset) + (next - r->buf);
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(pos);
+    ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+    if (::ReadFile(r->fd, next, want, &got, &ov) != TRUE) {
       return 0;
     }
     next += got;
@@ -60,9 +75,14 @@ unsigned get(void *in_desc, unsigned char **buf) {
 }
 
 // DEFLATE64
-bool Reader::decompressDeflate64(const File &file, const Writer &w, bela::error_code &ec) const {
-  baulk::archive::Buffer window(65536);
-  baulk::archive::Buffer chunk(CHUNK);
+bool Reader::decompressDeflate64(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                                 bela::error_code &ec) const {
+  auto &window = cache.Output(65536);
+  auto mapped = view.At(offset, file.compressedSize);
+  auto &chunk = cache.Input();
+  if (mapped == nullptr) {
+    chunk.grow(CHUNK);
+  }
   z_stream zs;
   memset(&zs, 0, sizeof(zs));
   auto ret = inflateBack9Init(&zs, window.data());
@@ -72,7 +92,7 @@ bool Reader::decompressDeflate64(const File &file, const Writer &w, bela::error_
   }
   auto closer = bela::finally([&] { inflateBack9End(&zs); });
   inflate64Writer iw{w, 0, 0, false};
-  inflate64Reader r{fd, chunk.data(), 0, 0, static_cast<int64_t>(file.compressedSize)};
+  inflate64Reader r{fd, chunk.data(), 0, 0, static_cast<int64_t>(file.compressedSize), offset, mapped};
   ret = inflateBack9(&zs, get, &r, put, &iw);
   if (iw.canceled) {
     ec = bela::make_error_code(ErrCanceled, L"canceled");
@@ -63,6 +63,109 @@ inline std::wstring fromcodePage(std::string_view name, int codePage = CP_ACP) {
   return output;
 }
 
+// names detected together are capped, 64 KiB of text is well past what CED needs to be reliable
+constexpr size_t nameSampleLimit = 64 * 1024;
+
+// isASCII eight bytes at a time, most names of most archives are ASCII
+inline bool isASCII(std::string_view s) {
+  size_t i = 0;
+  for (; i + 8 <= s.size(); i += 8) {
+    uint64_t v;
+    memcpy(&v, s.data() + i, sizeof(v));
+    if ((v & 0x8080808080808080ULL) != 0) {
+      return false;
+    }
+  }
+  for (; i < s.size(); i++) {
+    if (static_cast<uint8_t>(s[i]) >= 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// validUTF8 well-formed UTF-8: no overlong forms, surrogates or code points past U+10FFFF
+inline bool validUTF8(std::string_view s) {
+  auto p = reinterpret_cast<const uint8_t *>(s.data());
+  auto end = p + s.size();
+  while (p < end) {
+    auto c = *p;
+    if (c < 0x80) {
+      p++;
+      continue;
+    }
+    size_t n = 0;
+    uint8_t lo = 0x80;
+    uint8_t hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+      n = 1;
+    } else if (c == 0xE0) {
+      n = 2;
+      lo = 0xA0;
+    } else if (c == 0xED) {
+      n = 2;
+      hi = 0x9F;
+    } else if (c >= 0xE1 && c <= 0xEF) {
+      n = 2;
+    } else if (c == 0xF0) {
+      n = 3;
+      lo = 0x90;
+    } else if (c == 0xF4) {
+      n = 3;
+      hi = 0x8F;
+    } else if (c >= 0xF1 && c <= 0xF3) {
+      n = 3;
+    } else {
+      return false;
+    }
+    if (static_cast<size_t>(end - p) <= n || p[1] < lo || p[1] > hi) {
+      return false;
+    }
+    for (size_t i = 2; i <= n; i++) {
+      if (p[i] < 0x80 || p[i] > 0xBF) {
+        return false;
+      }
+    }
+    p += n + 1;
+  }
+  return true;
+}
+
+uint32_t DetectNameCodePage(const std::vector<File> &files) {
+  std::string sample;
+  auto utf8 = true;
+  for (const auto &file : files) {
+    if (file.IsFileNameUTF8() || isASCII(file.name)) {
+      continue;
+    }
+    if (utf8 && !validUTF8(file.name)) {
+      utf8 = false;
+    }
+    if (sample.size() < nameSampleLimit) {
+      sample.append(file.name);
+      sample.push_back('\n');
+      continue;
+    }
+    if (!utf8) {
+      break;
+    }
+  }
+  // ASCII names read the same in every code page
+  if (sample.empty()) {
+    return CP_ACP;
+  }
+  // UTF-8 without the flag: macOS Archive Utility, Java and many scripts
+  if (utf8) {
+    return CP_UTF8;
+  }
+  bool is_reliable = false;
+  int bytes_consumed = 0;
+  auto e = CompactEncDet::DetectEncoding(sample.data(), static_cast<int>(sample.size()), nullptr, nullptr, nullptr,
+                                         UNKNOWN_ENCODING, UNKNOWN_LANGUAGE, CompactEncDet::WEB_CORPUS, false,
+                                         &bytes_consumed, &is_reliable);
+  return codePageSearch(e);
+}
+
 inline std::wstring PathConvert(const File &file, bool autocvt) {
   if (file.IsFileNameUTF8()) {
     return bela::ToWide(file.name);
@@ -88,8 +191,7 @@ constexpr bool IsDangerousPath(std::wstring_view p) {
   return false;
 }
 
-std::optional<std::wstring> PathCat(std::wstring_view root, const File &file, bool autocvt) {
-  auto filename = PathConvert(file, autocvt);
+inline std::optional<std::wstring> pathCat(std::wstring_view root, std::wstring_view filename) {
   auto path = bela::PathCat(root, filename);
   // not allowed path
   if (IsDangerousPath(path)) {
@@ -103,4 +205,15 @@ std::optional<std::wstring> PathCat(std::wstring_view root, const File &file, bo
   }
   return std::make_optional(std::move(path));
 }
+
+std::optional<std::wstring> PathCat(std::wstring_view root, const File &file, bool autocvt) {
+  return pathCat(root, PathConvert(file, autocvt));
+}
+
+std::optional<std::wstring> PathCat(std::wstring_view root, const File &file, const Reader &reader) {
+  if (file.IsFileNameUTF8()) {
+    return pathCat(root, bela::ToWide(file.name));
+  }
+  return pathCat(root, fromcodePage(file.name, static_cast<int>(reader.NameCodePage())));
+}
 } // namespace baulk::archive::zip
\ No newline at end of file
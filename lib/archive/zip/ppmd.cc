@@ -1,15 +1,19 @@
 ///
 #include <bela/types.hpp>
 #include <bela/endian.hpp>
-#include "zipinternal.hpp"
-#include "../ppmd/Ppmd8.h"
+#include "decodercache.hpp"
 
 namespace baulk::archive::zip {
 using bela::ssize_t;
 constexpr auto BufferSize = static_cast<size_t>(1) << 20;
 class SectionReader {
 public:
-  SectionReader(HANDLE fd_, int64_t len) : fd(fd_), size(len) { cacheb.grow(32 * 1024); }
+  SectionReader(HANDLE fd_, int64_t pos, int64_t len, const uint8_t *mapped_)
+      : fd(fd_), position(pos), size(len), mapped(mapped_) {
+    if (mapped == nullptr) {
+      cacheb.grow(32 * 1024);
+    }
+  }
   SectionReader(const SectionReader &) = delete;
   SectionReader &operator=(const SectionReader &) = delete;
   ssize_t Buffered() const { return w - r; }
@@ -19,6 +23,17 @@ public:
       ec = bela::make_error_code(L"short read");
       return -1;
     }
+    if (mapped != nullptr) {
+      // the mapping is the buffer
+      auto n = static_cast<ssize_t>((std::min)(static_cast<int64_t>(len), size - offset));
+      if (n == 0) {
+        ec = bela::make_error_code(ERROR_HANDLE_EOF, L"unexpected EOF");
+        return -1;
+      }
+      memcpy(buffer, mapped + offset, static_cast<size_t>(n));
+      offset += n;
+      return n;
+    }
     if (r == w) {
       if (static_cast<size_t>(len) > cacheb.capacity()) {
         // Large read, empty buffer.
@@ -72,14 +87,20 @@ private:
   // reference please don't close it
   Buffer cacheb;
   HANDLE fd{INVALID_HANDLE_VALUE};
+  int64_t position{0}; // section start
   int64_t size{0};
   int64_t offset{0};
+  const uint8_t *mapped{nullptr}; // section in the file mapping
   ssize_t w{0};
   ssize_t r{0};
   bela::error_code ec;
   bool fsread(void *b, ssize_t len, ssize_t &rlen, bela::error_code &ec) {
     DWORD dwSize = {0};
-    if (ReadFile(fd, b, static_cast<DWORD>(len), &dwSize, nullptr) != TRUE) {
+    auto pos = static_cast<uint64_t>(position + offset);
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(pos);
+    ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+    if (ReadFile(fd, b, static_cast<DWORD>(len), &dwSize, &ov) != TRUE) {
       ec = bela::make_system_error_code(L"ReadFile: ");
       return false;
     }
@@ -121,13 +142,14 @@ static void SzBigFree(ISzAllocPtr p, void *address) {
 
 const ISzAlloc g_BigAlloc = {SzBigAlloc, SzBigFree};
 
-bool Reader::decompressPpmd(const File &file, const Writer &w, bela::error_code &ec) const {
-  SectionReader sr(fd, file.compressedSize);
+void ppmdFree(CPpmd8 *p) { Ppmd8_Free(p, &g_BigAlloc); }
+
+bool Reader::decompressPpmd(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                            bela::error_code &ec) const {
+  SectionReader sr(fd, offset, file.compressedSize, view.At(offset, file.compressedSize));
   IByteIn bi{&sr, ppmd_read};
-  CPpmd8 _ppmd = {0};
+  auto &_ppmd = *cache.Ppmd();
   _ppmd.Stream.In = &bi;
-  Ppmd8_Construct(&_ppmd);
-  auto closer = bela::finally([&] { Ppmd8_Free(&_ppmd, &g_BigAlloc); });
   uint8_t buf[8];
   if (sr.ReadFull(buf, 2) != 2) {
     ec = sr.ErrorCode();
@@ -141,20 +163,26 @@ bool Reader::decompressPpmd(const File &file, const Writer &w, bela::error_code
     ec = bela::make_error_code(L"PPMd compressed data corrupted");
     return false;
   }
+  // Ppmd8_Alloc keeps the model memory of the previous entry when the size matches
   if (!Ppmd8_Alloc(&_ppmd, mem << 20, &g_BigAlloc)) {
     ec = bela::make_error_code(L"Allocate Memory Failed");
     return false;
   }
+  auto release = bela::finally([&] {
+    if ((mem << 20) > ppmdCacheLimit) {
+      cache.ReleasePpmd();
+    }
+  });
   if (!Ppmd8_RangeDec_Init(&_ppmd)) {
     ec = bela::make_error_code(L"Ppmd8_RangeDec_Init");
     return false;
   }
   Ppmd8_Init(&_ppmd, order, restor);
-  Buffer out(BufferSize);
+  auto &out = cache.Output(outputSize(file.uncompressedSize, BufferSize));
+  const auto size = (std::min)(out.capacity(), BufferSize);
   uint32_t crc32val = 0;
   for (;;) {
     auto ob = out.data();
-    auto size = BufferSize;
     size_t i = 0;
     do {
       auto sym = Ppmd8_DecodeSymbol(&_ppmd);
@@ -167,7 +195,7 @@ bool Reader::decompressPpmd(const File &file, const Writer &w, bela::error_code
     if (i == 0) {
       break;
     }
-    crc32val = crc32_fast(ob, i, crc32val);
+    crc32val = crc32::Update(ob, i, crc32val);
     if (!w(ob, i)) {
       ec = bela::make_error_code(ErrCanceled, L"canceled");
       return false;
@@ -1,34 +1,79 @@
 ///
-#include "zipinternal.hpp"
-#include <lzma.h>
+#include "decodercache.hpp"
+#include "../xzblocks.hpp"
 
 namespace baulk::archive::zip {
 constexpr size_t xzoutsize = 256 * 1024;
 constexpr size_t xzinsize = 128 * 1024;
+// decompressXzParallel: multi-block xz entries are decoded on worker threads. parallel stays false when the entry is
+// a single block or its index is unreadable, the caller then uses the streaming decoder.
+bool Reader::decompressXzParallel(const File &file, int64_t offset, const Writer &w, bool &parallel,
+                                  bela::error_code &ec) const {
+  parallel = false;
+  auto readAt = [this, offset](void *buffer, size_t len, int64_t pos, bela::error_code &ec) -> bool {
+    return ReadAt(buffer, len, offset + pos, ec);
+  };
+  auto decoder = baulk::archive::xz::NewParallelDecoder(std::move(readAt), static_cast<int64_t>(file.compressedSize));
+  if (!decoder) {
+    return false;
+  }
+  parallel = true;
+  Buffer out;
+  uint32_t crc32val = 0;
+  for (;;) {
+    if (!decoder->Next(out, ec)) {
+      if (ec.code != ErrEnded) {
+        return false;
+      }
+      ec.clear();
+      break;
+    }
+    crc32val = crc32::Update(out.data(), out.size(), crc32val);
+    if (!w(out.data(), out.size())) {
+      ec = bela::make_error_code(ErrCanceled, L"canceled");
+      return false;
+    }
+  }
+  if (crc32val != file.crc32sum) {
+    ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32sum, L" got ", crc32val, L" not match");
+    return false;
+  }
+  return true;
+}
+
 // XZ
-bool Reader::decompressXz(const File &file, const Writer &w, bela::error_code &ec) const {
-  lzma_stream zs = LZMA_STREAM_INIT;
+bool Reader::decompressXz(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                          bela::error_code &ec) const {
+  auto parallel = false;
+  if (auto result = decompressXzParallel(file, offset, w, parallel, ec); parallel) {
+    return result;
+  }
+  auto &zs = *cache.Lzma();
   auto ret = lzma_stream_decoder(&zs, UINT64_MAX, LZMA_CONCATENATED);
   if (ret != LZMA_OK) {
     ec = bela::make_error_code(ret, L"lzma_stream_decoder error ", ret);
     return false;
   }
-  Buffer out(xzoutsize);
-  Buffer in(xzinsize);
+  auto &out = cache.Output(outputSize(file.uncompressedSize, xzoutsize));
+  const auto outlen = (std::min)(out.capacity(), xzoutsize);
+  auto &in = cache.Input();
+  const auto chunksize = InputSize(xzinsize);
   auto csize = file.compressedSize;
   lzma_action action = LZMA_RUN; // no C26812
   zs.next_in = nullptr;
   zs.avail_in = 0;
   zs.next_out = out.data();
-  zs.avail_out = xzoutsize;
+  zs.avail_out = outlen;
   uint32_t crc32val = 0;
   for (;;) {
     if (zs.avail_in == 0 && csize != 0) {
-      auto minsize = (std::min)(csize, static_cast<uint64_t>(xzinsize));
-      if (!ReadFull(in.data(), static_cast<size_t>(minsize), ec)) {
+      auto minsize = (std::min)(csize, static_cast<uint64_t>(chunksize));
+      auto input = ReadIn(in, static_cast<size_t>(minsize), offset, ec);
+      if (input == nullptr) {
         return false;
       }
-      zs.next_in = in.data();
+      offset += minsize;
+      zs.next_in = input;
       zs.avail_in = minsize;
       csize -= minsize;
       if (csize == 0) {
@@ -37,14 +82,14 @@ bool Reader::decompressXz(const File &file, const Writer &w, bela::error_code &e
     }
     ret = lzma_code(&zs, action);
     if (zs.avail_out == 0 || ret == LZMA_STREAM_END) {
-      auto have = xzoutsize - zs.avail_out;
-      crc32val = crc32_fast(out.data(), have, crc32val);
+      auto have = outlen - zs.avail_out;
+      crc32val = crc32::Update(out.data(), have, crc32val);
       if (!w(out.data(), have)) {
         ec = bela::make_error_code(ErrCanceled, L"canceled");
         return false;
       }
       zs.next_out = out.data();
-      zs.avail_out = xzoutsize;
+      zs.avail_out = outlen;
     }
     if (ret == LZMA_STREAM_END) {
       break;
@@ -88,21 +133,21 @@ struct alone_header {
 #pragma pack(pop)
 
 // LZMA
-bool Reader::decompressLZMA(const File &file, const Writer &w, bela::error_code &ec) const {
-  lzma_stream zs;
-  memset(&zs, 0, sizeof(zs));
+bool Reader::decompressLZMA(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                            bela::error_code &ec) const {
+  auto &zs = *cache.Lzma();
   if (auto ret = lzma_alone_decoder(&zs, UINT64_MAX); ret != LZMA_OK) {
     ec = bela::make_error_code(ret, L"lzma_stream_decoder error ", ret);
     return false;
   }
-  auto closer = bela::finally([&] { lzma_end(&zs); });
   // cat /bin/ls | lzma | xxd | head -n 1
   // $ cat stream_inside_zipx | xxd | head -n 1
   // 00000000: 0914 0500 5d00 8000 0000 2814 .... ....
   uint8_t d[16] = {0};
-  if (!ReadFull(d, 9, ec)) {
+  if (!ReadAt(d, 9, offset, ec)) {
     return false;
   }
+  offset += 9;
   if (d[2] != 0x05 || d[3] != 0x00) {
     ec = bela::make_error_code(ErrGeneral, L"Invalid LZMA data");
     return false;
@@ -110,13 +155,15 @@ bool Reader::decompressLZMA(const File &file, const Writer &w, bela::error_code
   alone_header ah{0};
   memcpy(ah.bytes, d + 4, 5);
   ah.uncompressed_size = UINT64_MAX;
-  Buffer out(xzoutsize);
-  Buffer in(xzinsize);
+  auto &out = cache.Output(outputSize(file.uncompressedSize, xzoutsize));
+  const auto outlen = (std::min)(out.capacity(), xzoutsize);
+  auto &in = cache.Input();
+  const auto chunksize = InputSize(xzinsize);
   zs.next_in = reinterpret_cast<const uint8_t *>(&ah);
   zs.avail_in = sizeof(ah);
   zs.total_in = 0;
   zs.next_out = out.data();
-  zs.avail_out = xzoutsize;
+  zs.avail_out = outlen;
   zs.total_out = 0;
   int ret = LZMA_OK;
   if (ret = lzma_code(&zs, LZMA_RUN); ret != LZMA_OK) {
@@ -128,11 +175,13 @@ bool Reader::decompressLZMA(const File &file, const Writer &w, bela::error_code
   lzma_action action = LZMA_RUN;
   for (;;) {
     if (zs.avail_in == 0 && csize > 0) {
-      auto minsize = (std::min)(csize, static_cast<uint64_t>(xzinsize));
-      if (!ReadFull(in.data(), static_cast<size_t>(minsize), ec)) {
+      auto minsize = (std::min)(csize, static_cast<uint64_t>(chunksize));
+      auto input = ReadIn(in, static_cast<size_t>(minsize), offset, ec);
+      if (input == nullptr) {
         return false;
       }
-      zs.next_in = in.data();
+      offset += minsize;
+      zs.next_in = input;
       zs.avail_in = minsize;
       csize -= minsize;
       if (csize == 0) {
@@ -141,14 +190,14 @@ bool Reader::decompressLZMA(const File &file, const Writer &w, bela::error_code
     }
     ret = lzma_code(&zs, action);
     if (zs.avail_out == 0 || ret == LZMA_STREAM_END) {
-      auto have = xzoutsize - zs.avail_out;
-      crc32val = crc32_fast(out.data(), have, crc32val);
+      auto have = outlen - zs.avail_out;
+      crc32val = crc32::Update(out.data(), have, crc32val);
       if (!w(out.data(), have)) {
         ec = bela::make_error_code(ErrCanceled, L"canceled");
         return false;
       }
       zs.next_out = out.data();
-      zs.avail_out = xzoutsize;
+      zs.avail_out = outlen;
     }
     if (ret == LZMA_STREAM_END) {
       break;
@@ -18,6 +18,19 @@ inline std::string stringCleaned(const void *data, size_t N) {
   N = reinterpret_cast<const char *>(pos) - p;
   return std::string(p, N);
 }
+// nameCleaned view of a name or comment up to its first 'NUL', copied into arena unless it views the mapping
+inline std::string_view nameCleaned(const void *data, size_t N, Arena *arena) {
+  auto p = reinterpret_cast<const char *>(data);
+  if (auto pos = memchr(data, 0, N); pos != nullptr) {
+    N = reinterpret_cast<const char *>(pos) - p;
+  }
+  if (arena == nullptr || N == 0) {
+    return std::string_view(p, N);
+  }
+  auto name = arena->Allocate(N);
+  memcpy(name, p, N);
+  return std::string_view(name, N);
+}
 int findSignatureInBlock(const bela::Buffer &b) {
   for (auto i = static_cast<int>(b.size()) - directoryEndLen; i >= 0; i--) {
     if (b[i] == 'P' && b[i + 1] == 'K' && b[i + 2] == 0x05 && b[i + 3] == 0x06) {
@@ -164,12 +177,17 @@ constexpr uint64_t OffsetMin = 0xFFFFFFFFull;
 
 */
 
-bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, bela::error_code &ec) {
-  uint8_t buf[directoryHeaderLen];
-  if (br.ReadFull(buf, sizeof(buf), ec) != sizeof(buf)) {
-    return false;
-  }
-  bela::endian::LittenEndian b(buf, sizeof(buf));
+// directoryHeaderTail length of the file name, extra field and file comment after a directory header
+inline size_t directoryHeaderTail(const uint8_t *header) {
+  return static_cast<size_t>(bela::cast_fromle<uint16_t>(header + 28)) + bela::cast_fromle<uint16_t>(header + 30) +
+         bela::cast_fromle<uint16_t>(header + 32);
+}
+
+// decodeDirectoryHeader decode the fixed part at header and its name, extra field and comment at tail. Names are
+// copied into arena, a nullptr arena keeps views of tail.
+bool decodeDirectoryHeader(const uint8_t *header, const uint8_t *tail, File &file, Arena *arena,
+                           bela::error_code &ec) {
+  bela::endian::LittenEndian b(header, directoryHeaderLen);
   if (auto n = static_cast<int>(b.Read<uint32_t>()); n != directoryHeaderSignature) {
     ec = bela::make_error_code(L"zip: not a valid zip file");
     return false;
@@ -193,21 +211,16 @@ bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, bela::erro
   b.Discard(4);
   auto externalAttrs = b.Read<uint32_t>();
   file.position = b.Read<uint32_t>();
-  auto totallen = filenameLen + extraLen + commentLen;
-  buffer.grow(totallen);
-  if (br.ReadFull(buffer.data(), totallen, ec) != totallen) {
-    return false;
-  }
-  file.name = stringCleaned(buffer.data(), filenameLen);
   if (commentLen != 0) {
-    file.comment = stringCleaned(buffer.data() + filenameLen + extraLen, commentLen);
+    file.comment = nameCleaned(tail + filenameLen + extraLen, commentLen, arena);
   }
   file.mode = resolveFileMode(file, externalAttrs);
   auto needUSize = file.uncompressedSize == SizeMin;
   auto needSize = file.compressedSize == SizeMin;
   auto needOffset = file.position == OffsetMin;
   bela::Time modified;
-  bela::endian::LittenEndian extra(buffer.data() + filenameLen, static_cast<size_t>(extraLen));
+  auto unicodePath = false; // the name comes from the Info-ZIP Unicode Path field
+  bela::endian::LittenEndian extra(tail + filenameLen, static_cast<size_t>(extraLen));
   for (; extra.Size() >= 4;) {
     auto fieldTag = extra.Read<uint16_t>();
     auto fieldSize = static_cast<int>(extra.Read<uint16_t>());
@@ -303,7 +316,8 @@ bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, bela::erro
       auto ver = fb.Pick();
       auto crc32val = fb.Read<uint32_t>();
       file.flags |= 0x800;
-      file.name = stringCleaned(fb.Data<char>(), fb.Size());
+      file.name = nameCleaned(fb.Data<char>(), fb.Size(), arena);
+      unicodePath = true;
       continue;
     }
     // https://www.winzip.com/win/en/aes_info.html
@@ -319,6 +333,9 @@ bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, bela::erro
     }
     ///
   }
+  if (!unicodePath) {
+    file.name = nameCleaned(tail, filenameLen, arena);
+  }
   file.time = bela::FromDosDateTime(dosDate, dosTime);
   if (bela::ToUnixSeconds(modified) != 0) {
     file.time = modified;
@@ -330,13 +347,79 @@ bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, bela::erro
   return true;
 }
 
-bool Reader::Initialize(bela::error_code &ec) {
+bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, Arena *arena, bela::error_code &ec) {
+  uint8_t buf[directoryHeaderLen];
+  if (br.ReadFull(buf, sizeof(buf), ec) != sizeof(buf)) {
+    return false;
+  }
+  auto totallen = directoryHeaderTail(buf);
+  buffer.grow(totallen);
+  if (br.ReadFull(buffer.data(), totallen, ec) != static_cast<bela::ssize_t>(totallen)) {
+    return false;
+  }
+  return decodeDirectoryHeader(buf, buffer.data(), file, arena, ec);
+}
+
+bool Reader::readDirectory(const directoryEnd &d, bela::error_code &ec) {
+  if (!PositionAt(d.directoryOffset, ec)) {
+    return false;
+  }
+  // names and comments are part of the directory, one block holds them unless its size is wrong
+  names.Reserve(static_cast<size_t>((std::min)(d.directorySize, static_cast<uint64_t>(size))));
+  // 64K avoid group
+  Buffer buffer(64 * 1024);
+  bufioReader br(fd);
+  for (uint64_t i = 0; i < d.directoryRecords; i++) {
+    File file;
+    if (!readDirectoryHeader(br, buffer, file, &names, ec)) {
+      return false;
+    }
+    uncompressedSize += file.uncompressedSize;
+    compressedSize += file.compressedSize;
+    files.emplace_back(std::move(file));
+  }
+  return true;
+}
+
+// readMappedDirectory decode directory headers in place, names and comments view the mapping
+bool Reader::readMappedDirectory(const directoryEnd &d, bela::error_code &ec) {
+  auto offset = static_cast<int64_t>(d.directoryOffset);
+  for (uint64_t i = 0; i < d.directoryRecords; i++) {
+    auto header = view.At(offset, directoryHeaderLen);
+    if (header == nullptr) {
+      ec = bela::make_error_code(ERROR_HANDLE_EOF, L"Reached the end of the file");
+      return false;
+    }
+    auto totallen = directoryHeaderTail(header);
+    auto tail = view.At(offset + directoryHeaderLen, totallen);
+    if (tail == nullptr) {
+      ec = bela::make_error_code(ERROR_HANDLE_EOF, L"Reached the end of the file");
+      return false;
+    }
+    File file;
+    if (!decodeDirectoryHeader(header, tail, file, nullptr, ec)) {
+      return false;
+    }
+    offset += directoryHeaderLen + static_cast<int64_t>(totallen);
+    uncompressedSize += file.uncompressedSize;
+    compressedSize += file.compressedSize;
+    files.emplace_back(std::move(file));
+  }
+  return true;
+}
+
+bool Reader::Initialize(bool mapped, bela::error_code &ec) {
   LARGE_INTEGER li;
   if (GetFileSizeEx(fd, &li) != TRUE) {
     ec = bela::make_system_error_code(L"GetFileSizeEx: ");
     return false;
   }
   size = li.QuadPart;
+  if (mapped) {
+    // an unmappable file (too large for the address space) keeps positional reads
+    bela::error_code mec;
+    view.Map(fd, size, mec);
+  }
   directoryEnd d;
   if (!readDirectoryEnd(d, ec)) {
     return false;
@@ -347,25 +430,37 @@ bool Reader::Initialize(bela::error_code &ec) {
     return false;
   }
   files.reserve(d.directoryRecords);
-  if (!PositionAt(d.directoryOffset, ec)) {
+  if (!(view.Mapped() ? readMappedDirectory(d, ec) : readDirectory(d, ec))) {
     return false;
   }
-  // 64K avoid group
-  Buffer buffer(64 * 1024);
-  bufioReader br(fd);
-  for (uint64_t i = 0; i < d.directoryRecords; i++) {
-    File file;
-    if (!readDirectoryHeader(br, buffer, file, ec)) {
-      return false;
+  codePage = DetectNameCodePage(files);
+  return true;
+}
+
+void Reader::BuildIndex() {
+  index.clear();
+  index.reserve(files.size());
+  for (size_t i = 0; i < files.size(); i++) {
+    index.insert_or_assign(files[i].name, static_cast<uint32_t>(i));
+  }
+}
+
+const File *Reader::Find(std::string_view name) const {
+  if (!index.empty() || files.empty()) {
+    if (auto it = index.find(name); it != index.end()) {
+      return &files[it->second];
     }
-    uncompressedSize += file.uncompressedSize;
-    compressedSize += file.compressedSize;
-    files.emplace_back(std::move(file));
+    return nullptr;
   }
-  return true;
+  for (auto it = files.rbegin(); it != files.rend(); ++it) {
+    if (it->name == name) {
+      return &*it;
+    }
+  }
+  return nullptr;
 }
 
-bool Reader::OpenReader(std::wstring_view file, bela::error_code &ec) {
+bool Reader::OpenReader(std::wstring_view file, bela::error_code &ec, bool mapped) {
   if (fd != INVALID_HANDLE_VALUE) {
     ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
     return false;
@@ -377,16 +472,16 @@ bool Reader::OpenReader(std::wstring_view file, bela::error_code &ec) {
     return false;
   }
   needClosed = true;
-  return Initialize(ec);
+  return Initialize(mapped, ec);
 }
 
-bool Reader::OpenReader(HANDLE nfd, int64_t sz, bela::error_code &ec) {
+bool Reader::OpenReader(HANDLE nfd, int64_t sz, bela::error_code &ec, bool mapped) {
   if (fd != INVALID_HANDLE_VALUE) {
     ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
     return false;
   }
   fd = nfd;
   size = sz;
-  return Initialize(ec);
+  return Initialize(mapped, ec);
 }
 } // namespace baulk::archive::zip
\ No newline at end of file
@@ -3,7 +3,6 @@
 #define BAULK_ZIP_INTERNAL_HPP
 #include <bela/path.hpp>
 #include <zip.hpp>
-#include "Crc32.h"
 
 namespace baulk::archive::zip {
 // https://pkware.cachefly.net/webdocs/casestudies/APPNOTE.TXT
@@ -81,6 +80,8 @@ inline bool IsSuperficialPath(std::string_view sv) {
 constexpr size_t outsize = 64 * 1024;
 constexpr size_t insize = 16 * 1024;
 FileMode resolveFileMode(const File &file, uint32_t externalAttrs);
+// DetectNameCodePage code page of the names not flagged UTF-8, detected once per archive
+uint32_t DetectNameCodePage(const std::vector<File> &files);
 } // namespace baulk::archive::zip
 
 #endif
\ No newline at end of file
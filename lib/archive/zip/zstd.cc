@@ -1,29 +1,29 @@
 ///
-#include "zipinternal.hpp"
-#include <zstd.h>
+#include "decodercache.hpp"
 
 namespace baulk::archive::zip {
 // zstd
 // https://github.com/facebook/zstd/blob/dev/examples/streaming_decompression.c
-bool Reader::decompressZstd(const File &file, const Writer &w, bela::error_code &ec) const {
-  const auto boutsize = ZSTD_DStreamOutSize();
-  const auto binsize = ZSTD_DStreamInSize();
-  Buffer outbuf(boutsize);
-  Buffer inbuf(binsize);
-  auto zds = ZSTD_createDCtx();
+bool Reader::decompressZstd(const File &file, int64_t offset, DecoderCache &cache, const Writer &w,
+                            bela::error_code &ec) const {
+  auto zds = cache.Zstd(ec);
   if (zds == nullptr) {
-    ec = bela::make_error_code(L"ZSTD_createDStream() out of memory");
     return false;
   }
-  auto closer = bela::finally([&] { ZSTD_freeDCtx(zds); });
+  auto &outbuf = cache.Output(outputSize(file.uncompressedSize, ZSTD_DStreamOutSize()));
+  const auto boutsize = (std::min)(outbuf.capacity(), ZSTD_DStreamOutSize());
+  auto &inbuf = cache.Input();
+  const auto chunksize = InputSize(ZSTD_DStreamInSize());
   auto csize = file.compressedSize;
   uint32_t crc32val = 0;
   while (csize != 0) {
-    auto minsize = (std::min)(csize, static_cast<uint64_t>(binsize));
-    if (!ReadFull(inbuf.data(), static_cast<size_t>(minsize), ec)) {
+    auto minsize = (std::min)(csize, static_cast<uint64_t>(chunksize));
+    auto input = ReadIn(inbuf, static_cast<size_t>(minsize), offset, ec);
+    if (input == nullptr) {
       return false;
     }
-    ZSTD_inBuffer in{inbuf.data(), minsize, 0};
+    offset += minsize;
+    ZSTD_inBuffer in{input, static_cast<size_t>(minsize), 0};
     while (in.pos < in.size) {
       ZSTD_outBuffer out{outbuf.data(), boutsize, 0};
       auto result = ZSTD_decompressStream(zds, &out, &in);
@@ -31,7 +31,7 @@ bool Reader::decompressZstd(const File &file, const Writer &w, bela::error_code
         ec = bela::make_error_code(ErrGeneral, L"ZSTD_decompressStream: ", bela::ToWide(ZSTD_getErrorName(result)));
         return false;
       }
-      crc32val = crc32_fast(out.dst, out.pos, crc32val);
+      crc32val = crc32::Update(out.dst, out.pos, crc32val);
       if (!w(out.dst, out.pos)) {
         ec = bela::make_error_code(ErrCanceled, L"canceled");
         return false;
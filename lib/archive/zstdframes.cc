@@ -0,0 +1,200 @@
+//
+#define ZSTD_STATIC_LINKING_ONLY
+#include "zstdframes.hpp"
+#include <bela/endian.hpp>
+#include <zstd.h>
+
+namespace baulk::archive::zstd {
+// https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+constexpr uint32_t seekableMagic = 0x8F92EAB1;
+constexpr uint32_t seekTableMagic = 0x184D2A5E;
+constexpr size_t seekTableFooterSize = 9;
+constexpr size_t skippableHeaderSize = 8;
+constexpr size_t blockHeaderSize = 3;
+constexpr size_t checksumSize = 4;
+
+// lookupSeekTable frames from the jump table of a seekable archive, false when there is none
+bool lookupSeekTable(const ReadAt &readAt, int64_t size, std::vector<Chunk> &frames) {
+  uint8_t footer[seekTableFooterSize];
+  bela::error_code ec;
+  if (size < static_cast<int64_t>(skippableHeaderSize + seekTableFooterSize) ||
+      !readAt(footer, sizeof(footer), size - seekTableFooterSize, ec)) {
+    return false;
+  }
+  if (bela::cast_fromle<uint32_t>(footer + 5) != seekableMagic || (footer[4] & 0x7C) != 0) {
+    return false;
+  }
+  auto numFrames = static_cast<int64_t>(bela::cast_fromle<uint32_t>(footer));
+  auto entrySize = (footer[4] & 0x80) != 0 ? 12 : 8;
+  auto tableSize = numFrames * entrySize;
+  auto frameSize = static_cast<int64_t>(skippableHeaderSize) + tableSize + static_cast<int64_t>(seekTableFooterSize);
+  if (frameSize > size) {
+    return false;
+  }
+  Buffer table(static_cast<size_t>(skippableHeaderSize + tableSize));
+  if (!readAt(table.data(), table.capacity(), size - frameSize, ec)) {
+    return false;
+  }
+  if (bela::cast_fromle<uint32_t>(table.data()) != seekTableMagic ||
+      bela::cast_fromle<uint32_t>(table.data() + 4) != static_cast<uint32_t>(frameSize - skippableHeaderSize)) {
+    return false;
+  }
+  int64_t offset = 0;
+  frames.clear();
+  for (int64_t i = 0; i < numFrames; i++) {
+    auto entry = table.data() + skippableHeaderSize + i * entrySize;
+    auto compressedSize = bela::cast_fromle<uint32_t>(entry);
+    auto decompressedSize = bela::cast_fromle<uint32_t>(entry + 4);
+    frames.emplace_back(Chunk{offset, compressedSize, decompressedSize});
+    offset += compressedSize;
+  }
+  // frames must cover the data up to the jump table
+  return offset == size - frameSize;
+}
+
+// lookupFrame walk the block headers of the frame at offset, decompressedSize is an upper bound when the frame
+// header has no content size, exact reports which one it is
+bool lookupFrame(const ReadAt &readAt, int64_t size, int64_t offset, Chunk &frame, bool &exact, bela::error_code &ec) {
+  uint8_t header[ZSTD_FRAMEHEADERSIZE_MAX];
+  auto hsize = static_cast<size_t>((std::min)(size - offset, static_cast<int64_t>(sizeof(header))));
+  if (!readAt(header, hsize, offset, ec)) {
+    return false;
+  }
+  ZSTD_frameHeader fh;
+  if (auto result = ZSTD_getFrameHeader(&fh, header, hsize); result != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"zstd frame header at ", offset, L" invalid");
+    return false;
+  }
+  auto pos = offset + static_cast<int64_t>(fh.headerSize);
+  uint64_t bound = 0;
+  for (;;) {
+    uint8_t bh[blockHeaderSize];
+    if (pos + static_cast<int64_t>(blockHeaderSize) > size || !readAt(bh, sizeof(bh), pos, ec)) {
+      ec = bela::make_error_code(ErrGeneral, L"zstd frame at ", offset, L" truncated");
+      return false;
+    }
+    auto bv = static_cast<uint32_t>(bh[0]) | (static_cast<uint32_t>(bh[1]) << 8) | (static_cast<uint32_t>(bh[2]) << 16);
+    auto last = (bv & 1) != 0;
+    auto blockSize = static_cast<int64_t>(bv >> 3);
+    pos += blockHeaderSize;
+    switch ((bv >> 1) & 3) {
+    case 0: // raw
+      pos += blockSize;
+      bound += blockSize;
+      break;
+    case 1: // RLE, one byte repeated blockSize times
+      pos += 1;
+      bound += blockSize;
+      break;
+    case 2: // compressed
+      pos += blockSize;
+      bound += fh.blockSizeMax;
+      break;
+    default:
+      ec = bela::make_error_code(ErrGeneral, L"zstd reserved block type at ", pos);
+      return false;
+    }
+    if (last) {
+      break;
+    }
+  }
+  if (fh.checksumFlag != 0) {
+    pos += checksumSize;
+  }
+  if (pos > size) {
+    ec = bela::make_error_code(ErrGeneral, L"zstd frame at ", offset, L" truncated");
+    return false;
+  }
+  frame.offset = offset;
+  frame.compressedSize = static_cast<uint64_t>(pos - offset);
+  exact = fh.frameContentSize != ZSTD_CONTENTSIZE_UNKNOWN;
+  frame.decompressedSize = exact ? fh.frameContentSize : bound;
+  return true;
+}
+
+bool lookupFrames(const ReadAt &readAt, int64_t size, std::vector<Chunk> &frames, bool &exact, bela::error_code &ec) {
+  exact = true;
+  if (lookupSeekTable(readAt, size, frames)) {
+    return true;
+  }
+  frames.clear();
+  int64_t offset = 0;
+  while (offset < size) {
+    uint8_t magic[skippableHeaderSize];
+    if (offset + 4 > size || !readAt(magic, 4, offset, ec)) {
+      ec = bela::make_error_code(ErrGeneral, L"zstd frame at ", offset, L" truncated");
+      return false;
+    }
+    auto m = bela::cast_fromle<uint32_t>(magic);
+    if ((m & ZSTD_MAGIC_SKIPPABLE_MASK) == ZSTD_MAGIC_SKIPPABLE_START) {
+      if (offset + static_cast<int64_t>(skippableHeaderSize) > size || !readAt(magic, skippableHeaderSize, offset, ec)) {
+        ec = bela::make_error_code(ErrGeneral, L"zstd skippable frame at ", offset, L" truncated");
+        return false;
+      }
+      offset += skippableHeaderSize + bela::cast_fromle<uint32_t>(magic + 4);
+      continue;
+    }
+    if (m != ZSTD_MAGICNUMBER) {
+      // legacy or unknown frame, left to the streaming decoder
+      ec = bela::make_error_code(ErrGeneral, L"zstd frame at ", offset, L" unsupported magic");
+      return false;
+    }
+    Chunk frame;
+    auto frameExact = false;
+    if (!lookupFrame(readAt, size, offset, frame, frameExact, ec)) {
+      return false;
+    }
+    exact = exact && frameExact;
+    offset += static_cast<int64_t>(frame.compressedSize);
+    frames.emplace_back(frame);
+  }
+  return true;
+}
+
+bool LookupFrames(const ReadAt &readAt, int64_t size, std::vector<Chunk> &frames, bela::error_code &ec) {
+  auto exact = false;
+  return lookupFrames(readAt, size, frames, exact, ec);
+}
+
+bool LookupSeekableFrames(const ReadAt &readAt, int64_t size, std::vector<Chunk> &frames, bela::error_code &ec) {
+  auto exact = false;
+  if (!lookupFrames(readAt, size, frames, exact, ec)) {
+    return false;
+  }
+  if (!exact) {
+    ec = bela::make_error_code(ErrGeneral, L"zstd frames without content size");
+    return false;
+  }
+  return true;
+}
+
+bool DecodeFrame(const Chunk &frame, const Buffer &in, Buffer &out, bela::error_code &ec) {
+  auto dctx = ZSTD_createDCtx();
+  if (dctx == nullptr) {
+    ec = bela::make_error_code(ErrGeneral, L"ZSTD_createDCtx() out of memory");
+    return false;
+  }
+  auto closer = bela::finally([&] { ZSTD_freeDCtx(dctx); });
+  auto result = ZSTD_decompressDCtx(dctx, out.data(), static_cast<size_t>(frame.decompressedSize), in.data(), in.size());
+  if (ZSTD_isError(result) != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"ZSTD_decompressDCtx: ", bela::ToWide(ZSTD_getErrorName(result)));
+    return false;
+  }
+  out.size() = result;
+  out.pos() = 0;
+  return true;
+}
+
+std::unique_ptr<ParallelDecoder> NewParallelDecoder(ReadAt &&readAt, int64_t size) {
+  std::vector<Chunk> frames;
+  bela::error_code ec;
+  if (!LookupFrames(readAt, size, frames, ec)) {
+    return nullptr;
+  }
+  return MakeChunkDecoder(std::move(readAt), std::move(frames),
+                          [](size_t, const Chunk &frame, const Buffer &in, Buffer &out, bela::error_code &ec) {
+                            return DecodeFrame(frame, in, out, ec);
+                          });
+}
+
+} // namespace baulk::archive::zstd
@@ -0,0 +1,25 @@
+//
+#ifndef BAULK_ARCHIVE_ZSTDFRAMES_HPP
+#define BAULK_ARCHIVE_ZSTDFRAMES_HPP
+#include "parallel.hpp"
+
+namespace baulk::archive::zstd {
+// LookupFrames locates the zstd frames of [0, size), skippable frames produce no output and are left out. The
+// seekable format jump table is used when present, otherwise frame and block headers are walked without decoding.
+// Returns false for legacy frames or malformed data.
+bool LookupFrames(const ReadAt &readAt, int64_t size, std::vector<Chunk> &frames, bela::error_code &ec);
+
+// LookupSeekableFrames LookupFrames when every frame has an exact decompressed size (seekable format, pzstd and
+// zstd --content-size output), so decompressed offsets map to frames without decoding
+bool LookupSeekableFrames(const ReadAt &readAt, int64_t size, std::vector<Chunk> &frames, bela::error_code &ec);
+
+// DecodeFrame decode a whole frame, out must have frame.decompressedSize capacity
+bool DecodeFrame(const Chunk &frame, const Buffer &in, Buffer &out, bela::error_code &ec);
+
+// NewParallelDecoder frame decoder over [0, size) of readAt, nullptr when the data is a single frame (zstd -T
+// output included) and the streaming decoder should be used
+std::unique_ptr<ParallelDecoder> NewParallelDecoder(ReadAt &&readAt, int64_t size);
+
+} // namespace baulk::archive::zstd
+
+#endif
@@ -0,0 +1,46 @@
+///
+#include <bela/hash.hpp>
+#include <bela/terminal.hpp>
+#include <random>
+#include <vector>
+#include "../tools/baulk/hash.hpp"
+
+// Blake3Update must produce the same digest as the 32K streaming path used by Sumizer
+std::wstring streaming(const uint8_t *data, size_t len) {
+  bela::hash::blake3::Hasher hasher;
+  hasher.Initialize();
+  constexpr size_t bufsize = 32768;
+  for (size_t offset = 0; offset < len; offset += bufsize) {
+    hasher.Update(data + offset, (std::min)(bufsize, len - offset));
+  }
+  return hasher.Finalize();
+}
+
+std::wstring parallel(const uint8_t *data, size_t len, int jobs) {
+  bela::hash::blake3::Hasher hasher;
+  hasher.Initialize();
+  baulk::hash::Blake3Update(hasher, data, len, jobs);
+  return hasher.Finalize();
+}
+
+int wmain() {
+  constexpr size_t sizes[] = {0,        1,        1024,     1025,           4 << 20,         (4 << 20) + 1,
+                              17 << 20, 33 << 20, 64 << 20, (64 << 20) + 7, (100 << 20) + 12345};
+  std::vector<uint8_t> data((100 << 20) + 12345);
+  std::mt19937 gen(3);
+  for (auto &c : data) {
+    c = static_cast<uint8_t>(gen());
+  }
+  int failed = 0;
+  for (auto size : sizes) {
+    auto want = streaming(data.data(), size);
+    for (int jobs : {1, 2, 3, 8, 0}) {
+      if (auto got = parallel(data.data(), size, jobs); got != want) {
+        bela::FPrintF(stderr, L"\x1b[31msize %d jobs %d: %s want %s\x1b[0m\n", size, jobs, got, want);
+        failed++;
+      }
+    }
+  }
+  bela::FPrintF(stderr, L"blake3 parallel: %d failed\n", failed);
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+///
+#include <archive.hpp>
+#include <bela/terminal.hpp>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using baulk::archive::crc32::Kernel;
+
+struct benchcase {
+  size_t size;
+  size_t rounds;
+};
+
+int wmain(int argc, wchar_t **argv) {
+  constexpr benchcase cases[] = {{64, 1 << 20}, {4096, 1 << 16}, {64 * 1024, 1 << 12}, {16 * 1024 * 1024, 16}};
+  constexpr Kernel kernels[] = {Kernel::SlicingBy16, Kernel::PCLMUL, Kernel::ARMv8};
+  std::vector<uint8_t> data(16 * 1024 * 1024 + 7);
+  std::mt19937 gen(20201018);
+  for (auto &c : data) {
+    c = static_cast<uint8_t>(gen());
+  }
+  bela::FPrintF(stderr, L"detected kernel: %s\n", baulk::archive::crc32::KernelName(baulk::archive::crc32::Detect()));
+  for (const auto &c : cases) {
+    // unaligned start and odd tail exercise the remainder paths
+    const auto p = data.data() + 1;
+    const auto want = baulk::archive::crc32::UpdateWith(Kernel::SlicingBy16, p, c.size);
+    for (auto k : kernels) {
+      if (!baulk::archive::crc32::Supported(k)) {
+        continue;
+      }
+      if (auto got = baulk::archive::crc32::UpdateWith(k, p, c.size); got != want) {
+        bela::FPrintF(stderr, L"\x1b[31m%s size %d crc32 %08x want %08x\x1b[0m\n", baulk::archive::crc32::KernelName(k),
+                      c.size, got, want);
+        return 1;
+      }
+      uint32_t crc = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < c.rounds; i++) {
+        crc = baulk::archive::crc32::UpdateWith(k, p, c.size, crc);
+      }
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      auto mbps = static_cast<double>(c.size) * static_cast<double>(c.rounds) / elapsed / (1024 * 1024);
+      bela::FPrintF(stderr, L"%-18s size %8d: %10.2f MB/s (%08x)\n", baulk::archive::crc32::KernelName(k), c.size,
+                    mbps, crc);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,48 @@
+///
+#include <tar.hpp>
+#include <baulkmisc.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <chrono>
+#include <limits>
+
+// decompressbench archive...: filter throughput of MakeReader, compare tar.lz4 with tar.zst, tar.gz of the same tar
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s archive...\n", argv[0]);
+    return 1;
+  }
+  for (int i = 1; i < argc; i++) {
+    auto file = bela::PathAbsolute(argv[i]);
+    bela::error_code ec;
+    auto fr = baulk::archive::tar::OpenFile(file, ec);
+    if (fr == nullptr) {
+      bela::FPrintF(stderr, L"unable open file %s error %s\n", file, ec.message);
+      return 1;
+    }
+    auto wr = baulk::archive::tar::MakeReader(*fr, ec);
+    if (wr == nullptr) {
+      bela::FPrintF(stderr, L"unable open compressed file %s error %s\n", file, ec.message);
+      return 1;
+    }
+    int64_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    // decoded data is only counted, WriteTo hands out the decoder buffers without copies
+    if (!wr->WriteTo([](const void *, size_t, bela::error_code &) { return true; },
+                     (std::numeric_limits<int64_t>::max)(), bytes, ec) &&
+        ec.code != bela::ErrEnded) {
+      bela::FPrintF(stderr, L"decompress %s error %s\n", file, ec.message);
+      return 1;
+    }
+    auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    wchar_t total[64];
+    wchar_t rate[64];
+    baulk::misc::EncodeRate(total, static_cast<uint64_t>(bytes));
+    baulk::misc::EncodeRate(rate, elapsed > 0 ? static_cast<uint64_t>(bytes) * 1000 / static_cast<uint64_t>(elapsed)
+                                              : static_cast<uint64_t>(bytes));
+    bela::FPrintF(stderr, L"%s: %s in %d.%03ds, %s/s\n", bela::BaseName(file), total, elapsed / 1000, elapsed % 1000,
+                  rate);
+  }
+  return 0;
+}
@@ -0,0 +1,280 @@
+///
+#include <tar.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <random>
+#include "gzipblocks.hpp"
+#include "zlib.h"
+#undef crc32 // chromeconf.h renames zlib crc32(), keep baulk::archive::crc32
+
+// gzipparallel_test [file.gz...]: inflate generated gzip files (and the given ones) with ParallelInflater forced onto
+// small chunks, one or more threads and narrow windows, then compare every member and its end offset with serial
+// zlib. Covers dynamic, fixed and stored blocks, flush points, long zero runs, concatenated members and trailing
+// garbage.
+using baulk::archive::gzip::InflaterOptions;
+
+struct member {
+  std::vector<uint8_t> data;
+  int64_t end{0};
+};
+
+struct segment {
+  int level;
+  int strategy;
+  int flush;
+};
+
+std::vector<uint8_t> makeText(size_t size, uint32_t seed) {
+  constexpr std::string_view words[] = {"baulk ",   "archive ", "inflate ", "the ",  "window ", "\n",
+                                        "chunk ",   "member ",  "deflate ", "of ",   "block ",  "speculate ",
+                                        "marker ",  "zlib ",    "gzip ",    "tar\n", "stored ", "boundary "};
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> text;
+  text.reserve(size + 16);
+  while (text.size() < size) {
+    auto w = words[rng() % std::size(words)];
+    text.insert(text.end(), w.begin(), w.end());
+  }
+  text.resize(size);
+  return text;
+}
+
+std::vector<uint8_t> makeRandom(size_t size, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> data(size);
+  for (auto &b : data) {
+    b = static_cast<uint8_t>(rng());
+  }
+  return data;
+}
+
+// compress data into a gzip member, segments are cycled every step bytes
+bool compress(const std::vector<uint8_t> &data, const std::vector<segment> &segments, size_t step,
+              std::vector<uint8_t> &out) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (deflateInit2(&zs, segments[0].level, Z_DEFLATED, MAX_WBITS + 16, 8, segments[0].strategy) != Z_OK) {
+    return false;
+  }
+  auto closer = bela::finally([&] { deflateEnd(&zs); });
+  std::vector<uint8_t> buffer(64 * 1024);
+  size_t pos = 0;
+  for (size_t i = 0;; i++) {
+    const auto &seg = segments[i % segments.size()];
+    if (i != 0) {
+      // deflateParams flushes the pending block into next_out
+      zs.next_out = buffer.data();
+      zs.avail_out = static_cast<uInt>(buffer.size());
+      if (deflateParams(&zs, seg.level, seg.strategy) != Z_OK) {
+        return false;
+      }
+      out.insert(out.end(), buffer.data(), buffer.data() + (buffer.size() - zs.avail_out));
+    }
+    auto n = (std::min)(step, data.size() - pos);
+    auto flush = pos + n == data.size() ? Z_FINISH : seg.flush;
+    zs.next_in = const_cast<uint8_t *>(data.data() + pos);
+    zs.avail_in = static_cast<uInt>(n);
+    int ret = Z_OK;
+    do {
+      zs.next_out = buffer.data();
+      zs.avail_out = static_cast<uInt>(buffer.size());
+      ret = deflate(&zs, flush);
+      if (ret == Z_STREAM_ERROR) {
+        return false;
+      }
+      out.insert(out.end(), buffer.data(), buffer.data() + (buffer.size() - zs.avail_out));
+    } while (zs.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+    pos += n;
+    if (flush == Z_FINISH) {
+      return true;
+    }
+  }
+}
+
+// serial zlib, members until the end of the data or anything that is not a gzip header
+bool inflateSerial(const std::vector<uint8_t> &gz, std::vector<member> &members) {
+  int64_t offset = 0;
+  while (offset + 2 <= static_cast<int64_t>(gz.size()) && gz[offset] == 0x1F && gz[offset + 1] == 0x8B) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, MAX_WBITS + 16) != Z_OK) {
+      return false;
+    }
+    auto closer = bela::finally([&] { inflateEnd(&zs); });
+    zs.next_in = const_cast<uint8_t *>(gz.data() + offset);
+    zs.avail_in = static_cast<uInt>(gz.size() - offset);
+    member m;
+    std::vector<uint8_t> buffer(256 * 1024);
+    for (;;) {
+      zs.next_out = buffer.data();
+      zs.avail_out = static_cast<uInt>(buffer.size());
+      auto ret = inflate(&zs, Z_NO_FLUSH);
+      m.data.insert(m.data.end(), buffer.data(), buffer.data() + (buffer.size() - zs.avail_out));
+      if (ret == Z_STREAM_END) {
+        break;
+      }
+      if (ret != Z_OK) {
+        return false;
+      }
+    }
+    offset = static_cast<int64_t>(zs.next_in - gz.data());
+    m.end = offset;
+    members.emplace_back(std::move(m));
+  }
+  return !members.empty();
+}
+
+bool inflateParallel(const std::vector<uint8_t> &gz, int64_t offset, const InflaterOptions &opts, member &m,
+                     bela::error_code &ec) {
+  auto size = static_cast<int64_t>(gz.size()) - offset;
+  auto mt = baulk::archive::gzip::NewParallelInflater(
+      [&](void *buffer, size_t len, int64_t pos, bela::error_code &ec) {
+        if (pos < 0 || pos > size || static_cast<int64_t>(len) > size - pos) {
+          ec = bela::make_error_code(bela::ErrGeneral, L"read out of range");
+          return false;
+        }
+        memcpy(buffer, gz.data() + offset + pos, len);
+        return true;
+      },
+      size, opts);
+  if (!mt) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"no parallel inflater");
+    return false;
+  }
+  baulk::archive::Buffer out;
+  for (;;) {
+    if (!mt->Next(out, ec)) {
+      if (ec.code != bela::ErrEnded) {
+        return false;
+      }
+      break;
+    }
+    m.data.insert(m.data.end(), out.data(), out.data() + out.size());
+  }
+  m.end = offset + mt->End();
+  ec.clear();
+  return true;
+}
+
+bool check(std::wstring_view name, const std::vector<uint8_t> &gz) {
+  std::vector<member> expected;
+  if (!inflateSerial(gz, expected)) {
+    bela::FPrintF(stderr, L"%s: zlib rejects the input\n", name);
+    return false;
+  }
+  constexpr InflaterOptions variants[] = {
+      {16 * 1024, 1, 1, true},   {16 * 1024, 4, 2, true}, {64 * 1024, 1, 4, true},
+      {64 * 1024, 4, 0, true},   {256 * 1024, 2, 3, true}, {1024 * 1024, 3, 0, true},
+  };
+  auto passed = true;
+  for (const auto &opts : variants) {
+    int64_t offset = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+      member m;
+      bela::error_code ec;
+      if (!inflateParallel(gz, offset, opts, m, ec)) {
+        bela::FPrintF(stderr, L"%s [chunk %d threads %d window %d] member %d: %s\n", name, opts.chunkSize,
+                      opts.threads, opts.window, i, ec.message);
+        passed = false;
+        break;
+      }
+      if (m.data != expected[i].data || m.end != expected[i].end) {
+        auto mismatch = std::mismatch(m.data.begin(), m.data.end(), expected[i].data.begin(), expected[i].data.end());
+        bela::FPrintF(stderr,
+                      L"%s [chunk %d threads %d window %d] member %d: %d bytes ending at %d, zlib %d bytes ending at "
+                      L"%d, first difference at %d\n",
+                      name, opts.chunkSize, opts.threads, opts.window, i, m.data.size(), m.end,
+                      expected[i].data.size(), expected[i].end, mismatch.first - m.data.begin());
+        passed = false;
+        break;
+      }
+      offset = m.end;
+    }
+  }
+  bela::FPrintF(stderr, L"%s: %d bytes, %d members, %d bytes after them: %s\n", name, gz.size(), expected.size(),
+                static_cast<int64_t>(gz.size()) - expected.back().end, passed ? L"ok" : L"FAILED");
+  return passed;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  constexpr size_t size = 4 * 1024 * 1024;
+  auto text = makeText(size, 1);
+  auto random = makeRandom(size / 2, 2);
+  std::vector<uint8_t> mixed(text.begin(), text.begin() + size / 2);
+  mixed.insert(mixed.end(), random.begin(), random.end());
+  const std::vector<segment> dynamic = {{6, Z_DEFAULT_STRATEGY, Z_NO_FLUSH}};
+  const std::vector<segment> fast = {{1, Z_DEFAULT_STRATEGY, Z_NO_FLUSH}};
+  const std::vector<segment> stored = {{0, Z_DEFAULT_STRATEGY, Z_NO_FLUSH}};
+  const std::vector<segment> fixed = {{9, Z_FIXED, Z_NO_FLUSH}};
+  const std::vector<segment> cycled = {{6, Z_DEFAULT_STRATEGY, Z_NO_FLUSH}, {0, Z_DEFAULT_STRATEGY, Z_NO_FLUSH},
+                                       {9, Z_HUFFMAN_ONLY, Z_NO_FLUSH},     {1, Z_RLE, Z_NO_FLUSH},
+                                       {6, Z_FIXED, Z_NO_FLUSH},            {0, Z_DEFAULT_STRATEGY, Z_NO_FLUSH}};
+  const std::vector<segment> flushed = {{6, Z_DEFAULT_STRATEGY, Z_SYNC_FLUSH}, {6, Z_DEFAULT_STRATEGY, Z_FULL_FLUSH}};
+  struct generated {
+    std::wstring_view name;
+    const std::vector<uint8_t> &data;
+    const std::vector<segment> &segments;
+    size_t step;
+  };
+  const generated cases[] = {
+      {L"text-6", text, dynamic, size},       {L"text-1", text, fast, size},
+      {L"mixed-6", mixed, dynamic, size},     {L"text-stored", text, stored, size},
+      {L"text-fixed", text, fixed, size},     {L"text-cycled", text, cycled, 300 * 1000},
+      {L"mixed-cycled", mixed, cycled, 70001}, {L"text-flushed", text, flushed, 100 * 1000},
+  };
+  std::vector<std::vector<uint8_t>> members;
+  auto passed = true;
+  for (const auto &c : cases) {
+    std::vector<uint8_t> gz;
+    if (!compress(c.data, c.segments, c.step, gz)) {
+      bela::FPrintF(stderr, L"%s: deflate error\n", c.name);
+      return 1;
+    }
+    passed = check(c.name, gz) && passed;
+    members.emplace_back(std::move(gz));
+  }
+  // concatenated members (gzip -c a b, pigz -i), the last one is short
+  std::vector<uint8_t> concat;
+  for (size_t i : {0, 3, 6}) {
+    concat.insert(concat.end(), members[i].begin(), members[i].end());
+  }
+  std::vector<uint8_t> tail;
+  if (!compress(std::vector<uint8_t>(text.begin(), text.begin() + 5000), dynamic, size, tail)) {
+    return 1;
+  }
+  concat.insert(concat.end(), tail.begin(), tail.end());
+  passed = check(L"concatenated", concat) && passed;
+  // trailing garbage: zero padding of tape blocks and random bytes, gzip ignores both
+  auto padded = members[0];
+  padded.resize(padded.size() + 10240, 0);
+  passed = check(L"zero-padded", padded) && passed;
+  auto garbage = members[2];
+  auto noise = makeRandom(100000, 3);
+  noise[0] = 0x42;
+  garbage.insert(garbage.end(), noise.begin(), noise.end());
+  passed = check(L"trailing-garbage", garbage) && passed;
+  // a long zero run expands about 1000:1, speculation inside it only copies window markers and must give up
+  std::vector<uint8_t> zeros(text.begin(), text.begin() + 100000);
+  zeros.resize(zeros.size() + 64 * 1024 * 1024, 0);
+  zeros.insert(zeros.end(), text.begin(), text.begin() + 100000);
+  std::vector<uint8_t> zgz;
+  if (!compress(zeros, dynamic, zeros.size(), zgz)) {
+    return 1;
+  }
+  passed = check(L"zero-run", zgz) && passed;
+  for (int i = 1; i < argc; i++) {
+    auto file = bela::PathAbsolute(argv[i]);
+    bela::error_code ec;
+    auto fr = baulk::archive::tar::OpenFile(file, ec);
+    std::vector<uint8_t> gz;
+    if (fr) {
+      gz.resize(static_cast<size_t>(fr->Size()));
+    }
+    if (!fr || !fr->ReadFullAt(gz.data(), gz.size(), 0, ec)) {
+      bela::FPrintF(stderr, L"unable read %s error %s\n", file, ec.message);
+      return 1;
+    }
+    passed = check(file, gz) && passed;
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+//
+#include <bela/terminal.hpp>
+#include <linkmeta.hpp>
+
+int wmain() {
+  std::vector<std::wstring> aliases;
+  for (int i = 0; i < 500; i++) {
+    aliases.emplace_back(bela::StringCat(L"tool", i, L".exe"));
+  }
+  std::vector<baulk::linkmeta::Link> links;
+  for (size_t i = 0; i < aliases.size(); i++) {
+    links.emplace_back(baulk::linkmeta::Link{aliases[i], L"tools", aliases[i], i % 3 != 0});
+  }
+  links.emplace_back(baulk::linkmeta::Link{L"7z.exe", L"7z", L"7z.exe", true});
+  links.emplace_back(baulk::linkmeta::Link{L"7zFM.exe", L"7z", L"7zFM.exe", false});
+  auto buffer = baulk::linkmeta::Encode(links);
+  if (buffer.empty()) {
+    bela::FPrintF(stderr, L"encode link table failed\n");
+    return 1;
+  }
+  baulk::linkmeta::Table table;
+  bela::error_code ec;
+  if (!table.Open(bela::MemView(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size()), ec)) {
+    bela::FPrintF(stderr, L"open link table: %s\n", ec.message);
+    return 1;
+  }
+  int failed = 0;
+  for (const auto &l : links) {
+    auto link = table.Lookup(l.alias);
+    if (!link || link->pkg != l.pkg || link->path != l.path || link->console != l.console) {
+      bela::FPrintF(stderr, L"lookup %s mismatch\n", l.alias);
+      failed++;
+    }
+  }
+  if (auto link = table.Lookup(L"7zfm.EXE"); !link || link->alias != L"7zFM.exe" || link->console) {
+    bela::FPrintF(stderr, L"case insensitive lookup failed\n");
+    failed++;
+  }
+  for (auto miss : {L"7zz.exe", L"tool500.exe", L"", L"git.exe"}) {
+    if (table.Lookup(miss)) {
+      bela::FPrintF(stderr, L"lookup '%s' should miss\n", miss);
+      failed++;
+    }
+  }
+  bela::FPrintF(stderr, L"links: %d slots: %d table: %d bytes failed: %d\n", links.size(), table.size(), buffer.size(),
+                failed);
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+///
+#include <archive.hpp>
+#include <baulkmisc.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <bela/numbers.hpp>
+#include <bela/fs.hpp>
+#include <chrono>
+
+// sinkbench [-files N] [-size BYTES] dir...: write N files in 64 KB chunks like the decoders do, plain FD writes vs
+// FileSink vs FileSink with a WriteBehind thread. Pass a RAM disk (ImDisk, tmpfs under WSL) and a real disk to tell
+// the system call cost from the device cost. Files go to dir\sinkbench and are removed after every run.
+enum class Mode : int { Plain, Sink, WriteBehind };
+constexpr std::wstring_view modeNames[] = {L"plain", L"sink", L"write-behind"};
+constexpr size_t chunkSize = 64 * 1024;
+
+bool writeFile(Mode mode, std::wstring_view path, const std::vector<uint8_t> &data, bela::Time mtime,
+               baulk::archive::WriteBehind *wb, bela::error_code &ec) {
+  auto fd = baulk::archive::NewFD(path, ec, true);
+  if (!fd) {
+    return false;
+  }
+  if (mode == Mode::Plain) {
+    if (!fd->SetTime(mtime, ec)) {
+      return false;
+    }
+    for (size_t pos = 0; pos < data.size(); pos += chunkSize) {
+      if (!fd->Write(data.data() + pos, (std::min)(chunkSize, data.size() - pos), ec)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  baulk::archive::FileSink sink(std::move(*fd), path, static_cast<int64_t>(data.size()), wb);
+  for (size_t pos = 0; pos < data.size(); pos += chunkSize) {
+    if (!sink.Write(data.data() + pos, (std::min)(chunkSize, data.size() - pos), ec)) {
+      return false;
+    }
+  }
+  return sink.Close(mtime, ec);
+}
+
+bool benchSink(Mode mode, std::wstring_view dir, int files, const std::vector<uint8_t> &data) {
+  using clock = std::chrono::steady_clock;
+  auto root = bela::StringCat(dir, L"\\sinkbench");
+  bela::error_code ec;
+  auto closer = bela::finally([&] {
+    bela::error_code rec;
+    bela::fs::RemoveAll(root, rec);
+  });
+  auto mtime = bela::Now();
+  auto start = clock::now();
+  std::optional<baulk::archive::WriteBehind> wb;
+  if (mode == Mode::WriteBehind) {
+    wb.emplace();
+  }
+  for (int i = 0; i < files; i++) {
+    auto path = bela::StringCat(root, L"\\", i / 1000, L"\\file", i, L".bin");
+    if (!writeFile(mode, path, data, mtime, wb ? &*wb : nullptr, ec)) {
+      if (wb) {
+        wb->Wait(ec);
+      }
+      bela::FPrintF(stderr, L"write %s error %s\n", path, ec.message);
+      return false;
+    }
+  }
+  if (wb && !wb->Wait(ec)) {
+    bela::FPrintF(stderr, L"write behind error %s\n", ec.message);
+    return false;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+  auto bytes = static_cast<uint64_t>(data.size()) * static_cast<uint64_t>(files);
+  wchar_t total[64];
+  wchar_t rate[64];
+  baulk::misc::EncodeRate(total, bytes);
+  baulk::misc::EncodeRate(rate, elapsed > 0 ? bytes * 1000000 / static_cast<uint64_t>(elapsed) : bytes);
+  bela::FPrintF(stderr, L"%s [%s]: %d files, %s in %d us, %s/s, %d files/s\n", dir, modeNames[static_cast<int>(mode)],
+                files, total, elapsed, rate, elapsed > 0 ? static_cast<int64_t>(files) * 1000000 / elapsed : files);
+  return true;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  int files = 1000;
+  int64_t size = 256 * 1024;
+  int i = 1;
+  for (; i + 1 < argc; i += 2) {
+    if (wcscmp(argv[i], L"-files") == 0) {
+      if (!bela::SimpleAtoi(argv[i + 1], &files) || files <= 0) {
+        bela::FPrintF(stderr, L"invalid files %s\n", argv[i + 1]);
+        return 1;
+      }
+      continue;
+    }
+    if (wcscmp(argv[i], L"-size") == 0) {
+      if (!bela::SimpleAtoi(argv[i + 1], &size) || size < 0) {
+        bela::FPrintF(stderr, L"invalid size %s\n", argv[i + 1]);
+        return 1;
+      }
+      continue;
+    }
+    break;
+  }
+  if (i >= argc) {
+    bela::FPrintF(stderr, L"usage: %s [-files N] [-size BYTES] dir...\n", argv[0]);
+    return 1;
+  }
+  std::vector<uint8_t> data(static_cast<size_t>(size));
+  for (size_t j = 0; j < data.size(); j++) {
+    data[j] = static_cast<uint8_t>(j * 31 + 7);
+  }
+  for (; i < argc; i++) {
+    auto dir = bela::PathAbsolute(argv[i]);
+    if (!benchSink(Mode::Plain, dir, files, data) || !benchSink(Mode::Sink, dir, files, data) ||
+        !benchSink(Mode::WriteBehind, dir, files, data)) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,136 @@
+///
+#include <bela/terminal.hpp>
+#include <bela/io.hpp>
+#include "../tools/baulk/stub.hpp"
+#include "../tools/baulk/rcwriter.hpp"
+
+// minimal PE32+ image: .bkslot section with the slot and .rsrc section with RT_VERSION/1/0x409
+constexpr uint32_t slotRVA = 0x1000;
+constexpr uint32_t slotRaw = 0x400;
+constexpr uint32_t slotSize = 0x2200;
+constexpr uint32_t rsrcRVA = 0x4000;
+constexpr uint32_t rsrcRaw = slotRaw + slotSize;
+constexpr uint32_t versionReserved = 3072;
+constexpr uint32_t rsrcSize = 0x60 + versionReserved;
+
+template <typename T> void put(std::string &image, size_t offset, const T &t) {
+  memcpy(image.data() + offset, &t, sizeof(T));
+}
+
+std::string MakeTemplate() {
+  std::string image(rsrcRaw + rsrcSize, '\0');
+  bela::pe::DosHeader dh{};
+  dh.e_magic = 0x5A4D;
+  dh.e_lfanew = 64;
+  put(image, 0, dh);
+  put(image, 64, static_cast<uint32_t>(0x00004550));
+  bela::pe::FileHeader fh{};
+  fh.Machine = static_cast<uint16_t>(bela::pe::Machine::AMD64);
+  fh.NumberOfSections = 2;
+  fh.SizeOfOptionalHeader = sizeof(bela::pe::OptionalHeader64);
+  put(image, 68, fh);
+  bela::pe::OptionalHeader64 oh{};
+  oh.Magic = 0x20b;
+  oh.Subsystem = static_cast<uint16_t>(bela::pe::Subsystem::CUI);
+  oh.NumberOfRvaAndSizes = 16;
+  oh.DataDirectory[2] = {rsrcRVA, rsrcSize};
+  put(image, 68 + sizeof(fh), oh);
+  auto shoffset = 68 + sizeof(fh) + sizeof(oh);
+  bela::pe::SectionHeader32 slotsh{};
+  memcpy(slotsh.Name, baulk::stub::SlotSection, 8);
+  slotsh.VirtualAddress = slotRVA;
+  slotsh.VirtualSize = sizeof(baulk::stub::Slot);
+  slotsh.SizeOfRawData = slotSize;
+  slotsh.PointerToRawData = slotRaw;
+  put(image, shoffset, slotsh);
+  bela::pe::SectionHeader32 rsrcsh{};
+  memcpy(rsrcsh.Name, ".rsrc", 5);
+  rsrcsh.VirtualAddress = rsrcRVA;
+  rsrcsh.VirtualSize = rsrcSize;
+  rsrcsh.SizeOfRawData = rsrcSize;
+  rsrcsh.PointerToRawData = rsrcRaw;
+  put(image, shoffset + sizeof(slotsh), rsrcsh);
+  baulk::stub::Slot slot{};
+  memcpy(slot.magic, baulk::stub::SlotMagic, sizeof(slot.magic));
+  slot.capacity = baulk::stub::TargetCapacity;
+  put(image, slotRaw, slot);
+  // resource tree: directory(16) + entry(8) per level, data entry at 0x48, data at 0x60
+  auto dir = [&](uint32_t offset, uint32_t name, uint32_t data) {
+    put(image, rsrcRaw + offset + 14, static_cast<uint16_t>(1)); // NumberOfIdEntries
+    put(image, rsrcRaw + offset + 16, name);
+    put(image, rsrcRaw + offset + 20, data);
+  };
+  dir(0x00, 16, 0x80000018);
+  dir(0x18, 1, 0x80000030);
+  dir(0x30, 0x409, 0x48);
+  put(image, rsrcRaw + 0x48, rsrcRVA + 0x60);
+  put(image, rsrcRaw + 0x4C, versionReserved);
+  return image;
+}
+
+int check(bool ok, std::wstring_view what) {
+  bela::FPrintF(stderr, L"%s %s\n", ok ? L"\x1b[32mPASS\x1b[0m" : L"\x1b[31mFAIL\x1b[0m", what);
+  return ok ? 0 : 1;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  int fail = 0;
+  auto image = MakeTemplate();
+  baulk::stub::StubPatcher patcher(image);
+  bela::error_code ec;
+  fail += check(patcher.Parse(ec), L"parse template");
+  fail += check(patcher.Subsystem() == bela::pe::Subsystem::CUI, L"subsystem");
+  std::wstring_view target = L"C:\\Baulk\\bin\\pkgs\\7z\\7zFM.exe";
+  fail += check(patcher.PatchTarget(target, ec), L"patch target");
+  baulk::stub::Slot slot;
+  memcpy(&slot, image.data() + slotRaw, sizeof(slot));
+  fail += check(slot.length == target.size() && std::wstring_view(slot.target) == target, L"slot content");
+  std::wstring longtarget(baulk::stub::TargetCapacity, L'a');
+  fail += check(!patcher.PatchTarget(longtarget, ec), L"reject target beyond capacity");
+
+  bela::pe::Version vi;
+  vi.CompanyName = L"Igor Pavlov";
+  vi.FileDescription = L"7-Zip File Manager";
+  vi.FileVersion = L"19.00";
+  vi.ProductVersion = L"19.00";
+  vi.ProductName = L"7-Zip";
+  vi.OriginalFileName = L"7zFM.exe";
+  vi.InternalName = L"7zfm";
+  baulk::rc::VersionEncoder encoder;
+  auto block = encoder.Encode(vi);
+  fail += check(patcher.PatchVersion(block, ec), L"patch version");
+  uint32_t size = 0;
+  memcpy(&size, image.data() + rsrcRaw + 0x4C, sizeof(size));
+  fail += check(size == block.size() && memcmp(image.data() + rsrcRaw + 0x60, block.data(), block.size()) == 0,
+                L"version resource content");
+  uint16_t wLength = 0;
+  memcpy(&wLength, block.data(), sizeof(wLength));
+  fail += check(wLength == block.size(), L"VS_VERSIONINFO length");
+  vi.FileDescription.assign(versionReserved, L'x');
+  fail += check(!patcher.PatchVersion(encoder.Encode(vi), ec), L"reject version beyond reserved size");
+  vi.FileDescription = L"7-Zip File Manager";
+
+  // baulk-stub-console.exe from the build tree: stubpatch_test path/to/stub out.exe target
+  if (argc >= 4) {
+    std::string stub;
+    FILE *fd = nullptr;
+    if (_wfopen_s(&fd, argv[1], L"rb") != 0) {
+      bela::FPrintF(stderr, L"unable open %s\n", argv[1]);
+      return 1;
+    }
+    char buffer[4096];
+    size_t n = 0;
+    while ((n = fread(buffer, 1, sizeof(buffer), fd)) != 0) {
+      stub.append(buffer, n);
+    }
+    fclose(fd);
+    baulk::stub::StubPatcher sp(stub);
+    if (!sp.Parse(ec) || !sp.PatchTarget(argv[3], ec) || !sp.PatchVersion(encoder.Encode(vi), ec) ||
+        !bela::io::WriteText(stub, argv[2], ec)) {
+      bela::FPrintF(stderr, L"patch %s error: %s\n", argv[1], ec.message);
+      return 1;
+    }
+    bela::FPrintF(stderr, L"%s -> %s\n", argv[2], argv[3]);
+  }
+  return fail == 0 ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+///
+#include <tar.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <bela/numbers.hpp>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+// counting allocator: header decoding should not allocate once the reader arena has grown
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto p = malloc(size == 0 ? 1 : size); p != nullptr) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// memoryReader serves an uncompressed tar from memory so only header decoding is measured
+class memoryReader : public baulk::archive::tar::ExtractReader {
+public:
+  memoryReader(const std::vector<uint8_t> &data_) : data(data_) {}
+  bela::ssize_t Read(void *buffer, size_t len, bela::error_code &ec) {
+    auto n = (std::min)(len, data.size() - pos);
+    memcpy(buffer, data.data() + pos, n);
+    pos += n;
+    return static_cast<bela::ssize_t>(n);
+  }
+  bool Discard(int64_t len, bela::error_code &ec) {
+    if (static_cast<uint64_t>(len) > data.size() - pos) {
+      ec = bela::make_error_code(bela::ErrEnded, L"End of file");
+      return false;
+    }
+    pos += static_cast<size_t>(len);
+    return true;
+  }
+  bool WriteTo(const baulk::archive::tar::Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+    return Discard(filesize, ec);
+  }
+  void Rewind() { pos = 0; }
+
+private:
+  const std::vector<uint8_t> &data;
+  size_t pos{0};
+};
+
+// tarheaderbench archive.tar [rounds]: allocations and time per header of Reader::Next
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s archive.tar [rounds]\n", argv[0]);
+    return 1;
+  }
+  auto file = bela::PathAbsolute(argv[1]);
+  int rounds = 10;
+  if (argc > 2 && (!bela::SimpleAtoi(argv[2], &rounds) || rounds <= 0)) {
+    rounds = 10;
+  }
+  bela::error_code ec;
+  auto fr = baulk::archive::tar::OpenFile(file, ec);
+  if (fr == nullptr) {
+    bela::FPrintF(stderr, L"unable open file %s error %s\n", file, ec.message);
+    return 1;
+  }
+  std::vector<uint8_t> data(static_cast<size_t>(fr->Size()));
+  if (!fr->ReadFullAt(data.data(), data.size(), 0, ec)) {
+    bela::FPrintF(stderr, L"unable read file %s error %s\n", file, ec.message);
+    return 1;
+  }
+  memoryReader mr(data);
+  uint64_t entries = 0;
+  uint64_t allocated = 0;
+  std::chrono::nanoseconds elapsed{0};
+  for (int i = 0; i < rounds; i++) {
+    mr.Rewind();
+    baulk::archive::tar::Reader tr(&mr);
+    auto before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (;;) {
+      auto fh = tr.Next(ec);
+      if (!fh) {
+        break;
+      }
+      entries++;
+    }
+    elapsed += std::chrono::steady_clock::now() - start;
+    allocated += allocations.load() - before;
+    if (ec.code != bela::ErrEnded) {
+      bela::FPrintF(stderr, L"read tar header error %s\n", ec.message);
+      return 1;
+    }
+    ec.clear();
+  }
+  if (entries == 0) {
+    bela::FPrintF(stderr, L"%s has no entries\n", file);
+    return 1;
+  }
+  bela::FPrintF(stderr, L"%d headers, %d allocations (%d.%02d per header), %d ns per header\n", entries, allocated,
+                allocated / entries, allocated * 100 / entries % 100, elapsed.count() / entries);
+  return 0;
+}
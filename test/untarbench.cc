@@ -0,0 +1,50 @@
+///
+#include <tar.hpp>
+#include <baulkmisc.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <bela/numbers.hpp>
+#include <chrono>
+
+// untarbench archive dest [MiB]: in-process extraction throughput, the engine used by baulk install
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 3) {
+    bela::FPrintF(stderr, L"usage: %s archive dest [MiB]\n", argv[0]);
+    return 1;
+  }
+  auto file = bela::PathAbsolute(argv[1]);
+  auto dest = bela::PathAbsolute(argv[2]);
+  bela::error_code ec;
+  auto fr = baulk::archive::tar::OpenFile(file, ec);
+  if (fr == nullptr) {
+    bela::FPrintF(stderr, L"unable open file %s error %s\n", file, ec.message);
+    return 1;
+  }
+  auto wr = baulk::archive::tar::MakeReader(*fr, ec);
+  if (wr == nullptr && ec.code != baulk::archive::tar::ErrNoFilter) {
+    bela::FPrintF(stderr, L"unable open tar file %s error %s\n", file, ec.message);
+    return 1;
+  }
+  baulk::archive::tar::ExtractorOptions opts;
+  // optional MiB in flight: pipelined extraction, compare with the serial run
+  if (int mb = 0; argc > 3 && bela::SimpleAtoi(argv[3], &mb) && mb > 0) {
+    opts.memoryLimit = static_cast<uint64_t>(mb) * 1024 * 1024;
+  }
+  baulk::archive::tar::Extractor extractor(
+      wr != nullptr ? wr.get() : static_cast<baulk::archive::tar::ExtractReader *>(fr.get()), dest, opts);
+  auto start = std::chrono::steady_clock::now();
+  if (!extractor.Extract(ec)) {
+    bela::FPrintF(stderr, L"untar error %s\n", ec.message);
+    return 1;
+  }
+  auto elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  auto bytes = static_cast<uint64_t>(extractor.Decompressed());
+  wchar_t total[64];
+  wchar_t rate[64];
+  baulk::misc::EncodeRate(total, bytes);
+  baulk::misc::EncodeRate(rate, elapsed > 0 ? bytes * 1000 / static_cast<uint64_t>(elapsed) : bytes);
+  bela::FPrintF(stderr, L"extracted %d entries, %s in %d.%03ds, %s/s (%s)\n", extractor.Extracted(), total,
+                elapsed / 1000, elapsed % 1000, rate, opts.memoryLimit != 0 ? L"pipelined" : L"serial");
+  return 0;
+}
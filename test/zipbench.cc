@@ -0,0 +1,127 @@
+///
+#include <zip.hpp>
+#include <baulkmisc.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <bela/numbers.hpp>
+#include <chrono>
+
+// zipbench [-rounds N] [-deflate] file.zip...: open the archive, look up every name through the index and decompress
+// every entry N times, once per reader variant: positional reads or a mapping, fresh decoders per entry or the
+// per-thread DecoderCache, streaming or one-shot inflate. Archives of many small files (node_modules, python
+// site-packages) show the decoder setup cost, -deflate leaves out the other methods. A first unreported run warms the
+// page cache and the decoder cache.
+using baulk::archive::zip::DecodeOptions;
+using baulk::archive::zip::inflateOneShotLimit;
+
+struct variant {
+  std::wstring_view name;
+  bool mapped;
+  DecodeOptions options;
+};
+
+constexpr variant variants[] = {
+    {L"reads", false, {true, inflateOneShotLimit}},
+    {L"mapped", true, {true, inflateOneShotLimit}},
+    {L"fresh decoders", false, {false, inflateOneShotLimit}},
+    {L"streaming inflate", false, {true, 0}},
+};
+
+struct benchOptions {
+  int rounds{5};
+  bool deflateOnly{false};
+};
+
+bool benchReader(std::wstring_view file, const variant &v, const benchOptions &bo, bool report) {
+  using clock = std::chrono::steady_clock;
+  auto us = [](clock::time_point a, clock::time_point b) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(b - a).count();
+  };
+  auto start = clock::now();
+  baulk::archive::zip::Reader reader;
+  bela::error_code ec;
+  if (!reader.OpenReader(file, ec, v.mapped)) {
+    bela::FPrintF(stderr, L"unable open zip file %s error %s\n", file, ec.message);
+    return false;
+  }
+  reader.SetOptions(v.options);
+  auto opened = clock::now();
+  reader.BuildIndex();
+  for (const auto &f : reader.Files()) {
+    if (auto found = reader.Find(f.name); found == nullptr || found->name != f.name) {
+      bela::FPrintF(stderr, L"index lookup %s failed\n", f.name);
+      return false;
+    }
+  }
+  auto indexed = clock::now();
+  uint64_t bytes = 0;
+  int64_t entries = 0;
+  for (int i = 0; i < bo.rounds; i++) {
+    for (const auto &f : reader.Files()) {
+      if (f.IsDir() || (bo.deflateOnly && f.method != baulk::archive::zip::ZIP_DEFLATE)) {
+        continue;
+      }
+      auto ret = reader.Decompress(
+          f,
+          [&](const void *, size_t len) {
+            bytes += len;
+            return true;
+          },
+          ec);
+      if (!ret) {
+        bela::FPrintF(stderr, L"decompress %s error %s\n", f.name, ec.message);
+        return false;
+      }
+      entries++;
+    }
+  }
+  if (!report) {
+    return true;
+  }
+  auto elapsed = us(indexed, clock::now());
+  wchar_t total[64];
+  wchar_t rate[64];
+  baulk::misc::EncodeRate(total, bytes);
+  baulk::misc::EncodeRate(rate, elapsed > 0 ? bytes * 1000000 / static_cast<uint64_t>(elapsed) : bytes);
+  bela::FPrintF(stderr,
+                L"%s [%s]: directory %d us, index and lookups %d us, %d entries, %s in %d us, %d.%02d us/entry, "
+                L"%s/s\n",
+                bela::BaseName(file), v.name, us(start, opened), us(opened, indexed), entries, total, elapsed,
+                entries > 0 ? elapsed / entries : 0, entries > 0 ? (elapsed * 100 / entries) % 100 : 0, rate);
+  return true;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  benchOptions bo;
+  int i = 1;
+  for (; i < argc; i++) {
+    if (wcscmp(argv[i], L"-rounds") == 0 && i + 1 < argc) {
+      if (!bela::SimpleAtoi(argv[++i], &bo.rounds) || bo.rounds <= 0) {
+        bela::FPrintF(stderr, L"invalid rounds %s\n", argv[i]);
+        return 1;
+      }
+      continue;
+    }
+    if (wcscmp(argv[i], L"-deflate") == 0) {
+      bo.deflateOnly = true;
+      continue;
+    }
+    break;
+  }
+  if (i >= argc) {
+    bela::FPrintF(stderr, L"usage: %s [-rounds N] [-deflate] file.zip...\n", argv[0]);
+    return 1;
+  }
+  for (; i < argc; i++) {
+    auto file = bela::PathAbsolute(argv[i]);
+    if (!benchReader(file, variants[0], {1, bo.deflateOnly}, false)) {
+      return 1;
+    }
+    for (const auto &v : variants) {
+      if (!benchReader(file, v, bo, true)) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
@@ -7,6 +7,7 @@
 #include <bela/str_split.hpp>
 #include <bela/env.hpp>
 #include <baulkrev.hpp>
+#include <linkmeta.hpp>
 #include <filesystem>
 #include <json.hpp>
 #include <cstdio>
@@ -49,7 +50,30 @@ bool IsSubsytemConsole(std::wstring_view exe) {
   return bela::pe::IsSubsystemConsole(*realexe);
 }
 
-std::optional<std::wstring> ResolveTarget(std::wstring_view arg0, bela::error_code &ec) {
+struct Target {
+  std::wstring path;
+  bool console{true};
+};
+
+// ResolveTableTarget lookup the compiled link table, one mapping and no json parsing
+std::optional<Target> ResolveTableTarget(std::wstring_view parent, std::wstring_view launcher) {
+  auto file = bela::StringCat(parent, L"\\", baulk::linkmeta::LinkMetaTableName);
+  baulk::linkmeta::Table table;
+  bela::error_code ec;
+  if (!table.Open(file, ec)) {
+    DbgPrint(L"open link table: %s", ec.message);
+    return std::nullopt;
+  }
+  auto link = table.Lookup(launcher);
+  if (!link) {
+    DbgPrint(L"link table missing '%s'", launcher);
+    return std::nullopt;
+  }
+  auto baulkroot = bela::DirName(parent);
+  return std::make_optional(Target{bela::StringCat(baulkroot, L"\\pkgs\\", link->pkg, L"\\", link->path), link->console});
+}
+
+std::optional<Target> ResolveTarget(std::wstring_view arg0, bela::error_code &ec) {
   // avoid commandline forged
   constexpr std::wstring_view baulklinkmeta = L"\\baulk.linkmeta.json";
   auto exe = bela::Executable(ec); // GetModuleFileName
@@ -58,6 +82,9 @@ std::optional<std::wstring> ResolveTarget(std::wstring_view arg0, bela::error_co
   }
   auto launcher = bela::BaseName(*exe);
   auto parent = bela::DirName(*exe);
+  if (auto target = ResolveTableTarget(parent, launcher); target) {
+    return target;
+  }
   auto linkmeta = bela::StringCat(parent, baulklinkmeta);
   try {
     /* code */
@@ -77,7 +104,8 @@ std::optional<std::wstring> ResolveTarget(std::wstring_view arg0, bela::error_co
     }
     auto baulkroot = bela::DirName(parent);
     auto target = bela::StringCat(baulkroot, L"\\pkgs\\", tv[0], L"\\", tv[1]);
-    return std::make_optional(std::move(target));
+    auto console = IsSubsytemConsole(target);
+    return std::make_optional(Target{std::move(target), console});
   } catch (const std::exception &e) {
     ec = bela::make_error_code(bela::ErrGeneral, L"baulk.links.json exception: ", bela::ToWide(e.what()));
   }
@@ -96,15 +124,15 @@ int wmain(int argc, wchar_t **argv) {
     bela::FPrintF(stderr, L"unable detect launcher target: %s\n", ec.message);
     return 1;
   }
-  DbgPrint(L"resolve target: %s\n", *target);
-  auto isconsole = IsSubsytemConsole(*target);
+  DbgPrint(L"resolve target: %s\n", target->path);
+  auto isconsole = target->console;
   std::wstring newcmd(GetCommandLineW());
   STARTUPINFOW si;
   PROCESS_INFORMATION pi;
   SecureZeroMemory(&si, sizeof(si));
   SecureZeroMemory(&pi, sizeof(pi));
   si.cb = sizeof(si);
-  if (CreateProcessW(target->data(), newcmd.data(), nullptr, nullptr, FALSE, CREATE_UNICODE_ENVIRONMENT, nullptr,
+  if (CreateProcessW(target->path.data(), newcmd.data(), nullptr, nullptr, FALSE, CREATE_UNICODE_ENVIRONMENT, nullptr,
                      nullptr, &si, &pi) != TRUE) {
     auto ec = bela::make_system_error_code();
     bela::FPrintF(stderr, L"unable detect launcher target: %s\n", ec.message);
@@ -0,0 +1,88 @@
+// baulk-stub: launcher template, baulk copies it and patches the target slot and version resource.
+// Built without the CRT, same as the launchers baulk used to compile with cl/link.
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <baulkstub.hpp>
+
+#pragma section(BAULK_STUB_SECTION, read)
+extern "C" __declspec(allocate(BAULK_STUB_SECTION)) const baulk::stub::Slot baulkStubSlot = {
+    {L'B', L'K', L'S', L'T', L'U', L'B', L'1', 0}, baulk::stub::TargetCapacity, 0, {0}};
+
+inline constexpr size_t StringLength(const wchar_t *s) {
+  const wchar_t *a = s;
+  for (; *a != 0; a++) {
+    ;
+  }
+  return a - s;
+}
+inline void *StringCopy(wchar_t *dest, const wchar_t *src, size_t n) {
+  auto d = dest;
+  for (; n; n--) {
+    *d++ = *src++;
+  }
+  return dest;
+}
+inline wchar_t *StringAllocate(size_t count) {
+  return reinterpret_cast<wchar_t *>(HeapAlloc(GetProcessHeap(), 0, sizeof(wchar_t) * count));
+}
+inline wchar_t *StringDup(const wchar_t *s) {
+  auto l = StringLength(s);
+  auto ds = StringAllocate(l + 1);
+  StringCopy(ds, s, l);
+  ds[l] = 0;
+  return ds;
+}
+inline void StringFree(wchar_t *p) { HeapFree(GetProcessHeap(), 0, p); }
+
+// the slot is patched after link, volatile reads keep the optimizer from folding the zeroed template
+wchar_t *SlotTarget() {
+  auto slot = reinterpret_cast<const volatile baulk::stub::Slot *>(&baulkStubSlot);
+  auto len = slot->length;
+  if (len == 0 || len >= baulk::stub::TargetCapacity) {
+    return nullptr;
+  }
+  auto target = StringAllocate(len + 1);
+  for (uint32_t i = 0; i < len; i++) {
+    target[i] = slot->target[i];
+  }
+  target[len] = 0;
+  return target;
+}
+
+#ifdef BAULK_STUB_WINDOWS
+int WINAPI wWinMain(HINSTANCE, HINSTANCE, LPWSTR, int) {
+#else
+int wmain() {
+#endif
+  auto target = SlotTarget();
+  if (target == nullptr) {
+    return -1;
+  }
+  STARTUPINFOW si;
+  PROCESS_INFORMATION pi;
+  SecureZeroMemory(&si, sizeof(si));
+  SecureZeroMemory(&pi, sizeof(pi));
+  si.cb = sizeof(si);
+  auto cmdline = StringDup(GetCommandLineW());
+  if (!CreateProcessW(target, cmdline, nullptr, nullptr, FALSE, CREATE_UNICODE_ENVIRONMENT, nullptr, nullptr, &si,
+                      &pi)) {
+    StringFree(cmdline);
+    StringFree(target);
+    return -1;
+  }
+  StringFree(cmdline);
+  StringFree(target);
+  CloseHandle(pi.hThread);
+#ifdef BAULK_STUB_WINDOWS
+  CloseHandle(pi.hProcess);
+  return 0;
+#else
+  SetConsoleCtrlHandler(nullptr, TRUE);
+  WaitForSingleObject(pi.hProcess, INFINITE);
+  SetConsoleCtrlHandler(nullptr, FALSE);
+  DWORD exitCode;
+  GetExitCodeProcess(pi.hProcess, &exitCode);
+  CloseHandle(pi.hProcess);
+  return exitCode;
+#endif
+}
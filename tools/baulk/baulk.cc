@@ -1,5 +1,6 @@
 #include <bela/subsitute.hpp>
 #include <bela/path.hpp>
+#include <bela/numbers.hpp>
 #include <baulkrev.hpp>
 #include "baulk.hpp"
 #include "baulkargv.hpp"
@@ -12,6 +13,9 @@ bool IsForceDelete = false;
 bool IsQuietMode = false;
 bool IsTraceMode = false;
 bool IsInsecureMode = false;
+bool IsListMode = false;
+bool IsMappedMode = false;
+int ParallelJobs = 0;
 wchar_t UserAgent[UerAgentMaximumLength] = L"Wget/5.0 (Baulk)";
 int cmd_uninitialized(const baulk::commands::argv_t &argv) {
   bela::FPrintF(stderr, L"baulk uninitialized command\n");
@@ -42,8 +46,11 @@ Usage: baulk [option] command pkg ...
   -A|--user-agent  Send User-Agent <name> to server
   -k|--insecure    Allow insecure server connections when using SSL
   -T|--trace       Turn on trace mode. track baulk execution details.
+  -j|--jobs        Number of worker threads extracting zip and tar archives. default: number of processors
   --https-proxy    Use this proxy. Equivalent to setting the environment variable 'HTTPS_PROXY'
   --force-delete   When uninstalling the package, forcefully delete the related directories
+  --list           List archive entries instead of extracting them (untar)
+  --mmap           Read zip archives through a file mapping, an I/O error on it terminates baulk
 
 
 Command:
@@ -59,7 +66,8 @@ Command:
   sha256sum        Calculate the SHA256 checksum of a file
   cleancache       Cleanup download cache
   bucket           Add, delete or list buckets
-  untar            Extract files in a tar archive. support: tar.xz tar.bz2 tar.gz tar.zstd (experimental)
+  untar            Extract files in a tar archive, optionally only entries matching patterns. support: tar.xz tar.bz2
+                   tar.gz tar.zstd tar.lz4 (experimental)
   unzip            Extract compressed files in a ZIP archive (experimental)
 
 Alias:
@@ -97,7 +105,10 @@ bool ParseArgv(int argc, wchar_t **argv, baulkcommand_t &cmd) {
       .Add(L"user-agent", baulk::cli::required_argument, 'A')
       .Add(L"https-proxy", baulk::cli::required_argument, 1001) // option
       .Add(L"force-delete", baulk::cli::no_argument, 1002)
+      .Add(L"list", baulk::cli::no_argument, 1003)
+      .Add(L"mmap", baulk::cli::no_argument, 1004)
       .Add(L"trace", baulk::cli::no_argument, 'T')
+      .Add(L"jobs", baulk::cli::required_argument, 'j')
       .Add(L"exec"); // subcommand
   bela::error_code ec;
   auto result = ba.Execute(
@@ -126,6 +137,13 @@ bool ParseArgv(int argc, wchar_t **argv, baulkcommand_t &cmd) {
         case 'k':
           baulk::IsInsecureMode = true;
           break;
+        case 'j':
+          if (int jobs = 0; bela::SimpleAtoi(oa, &jobs) && jobs >= 0) {
+            baulk::ParallelJobs = jobs;
+            break;
+          }
+          bela::FPrintF(stderr, L"baulk: invalid jobs '%s'\n", oa);
+          return false;
         case 'A':
           if (auto len = wcslen(oa); len < 256) {
             wmemcmp(baulk::UserAgent, oa, len);
@@ -138,6 +156,12 @@ bool ParseArgv(int argc, wchar_t **argv, baulkcommand_t &cmd) {
         case 1002:
           baulk::IsForceDelete = true;
           break;
+        case 1003:
+          baulk::IsListMode = true;
+          break;
+        case 1004:
+          baulk::IsMappedMode = true;
+          break;
         default:
           return false;
         }
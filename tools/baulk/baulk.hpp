@@ -13,6 +13,13 @@ extern bool IsForceDelete;
 extern bool IsQuietMode;
 extern bool IsTraceMode;
 extern bool IsInsecureMode;
+// IsListMode untar lists entries instead of extracting them
+extern bool IsListMode;
+// IsMappedMode zip archives are read through a file mapping. A failed page-in (network share, file truncated while
+// open) raises EXCEPTION_IN_PAGE_ERROR instead of an error code, so positional reads stay the default.
+extern bool IsMappedMode;
+// ParallelJobs number of worker threads, 0: use hardware concurrency
+extern int ParallelJobs;
 constexpr size_t UerAgentMaximumLength = 64;
 extern wchar_t UserAgent[UerAgentMaximumLength];
 // DbgPrint added newline
@@ -92,6 +99,8 @@ std::wstring_view BaulkLocale();
 Buckets &BaulkBuckets();
 int BaulkBucketWeights(std::wstring_view bucket);
 std::wstring_view BaulkGit();
+// BaulkExtractMemory decompressed bytes held in flight by pipelined tar extraction
+uint64_t BaulkExtractMemory();
 baulk::compiler::Executor &BaulkExecutor();
 bool BaulkInitializeExecutor(bela::error_code &ec);
 // package base
@@ -12,6 +12,8 @@
 namespace baulk {
 // https://github.com/baulk/bucket/commits/master.atom
 constexpr std::wstring_view DefaultBucket = L"https://github.com/baulk/bucket";
+constexpr uint64_t DefaultExtractMemory = 64ULL * 1024 * 1024;
+constexpr int64_t MaxExtractMemoryMiB = 64 * 1024;
 class BaulkEnv {
 public:
   BaulkEnv(const BaulkEnv &) = delete;
@@ -49,6 +51,7 @@ public:
   }
   std::wstring_view Profile() const { return profile; }
   std::wstring_view Locale() const { return locale; }
+  uint64_t ExtractMemory() const { return extractMemory; }
 
 private:
   BaulkEnv() = default;
@@ -59,6 +62,7 @@ private:
   Buckets buckets;
   std::vector<std::wstring> freezepkgs;
   baulk::compiler::Executor executor;
+  uint64_t extractMemory{DefaultExtractMemory};
 };
 
 bool InitializeGitPath(std::wstring &git) {
@@ -148,6 +152,15 @@ bool BaulkEnv::Initialize(int argc, wchar_t *const *argv, std::wstring_view prof
       DbgPrint(L"Add bucket: %s '%s@%s'", url, name, desc);
       buckets.emplace_back(std::move(desc), std::move(name), std::move(url), weights);
     }
+    // MiB, limits decompressed data in flight when extracting tar packages
+    if (auto it = json.find("extract_memory"); it != json.end() && it.value().is_number_integer()) {
+      if (auto mb = it.value().get<int64_t>(); mb >= 1 && mb <= MaxExtractMemoryMiB) {
+        extractMemory = static_cast<uint64_t>(mb) * 1024 * 1024;
+      } else {
+        DbgPrint(L"extract_memory %d MiB out of range [1, %d], keep %d MiB", mb, MaxExtractMemoryMiB,
+                 extractMemory / (1024 * 1024));
+      }
+    }
     if (auto it = json.find("freeze"); it != json.end()) {
       for (const auto &freeze : it.value()) {
         freezepkgs.emplace_back(bela::ToWide(freeze.get<std::string_view>()));
@@ -192,6 +205,8 @@ std::wstring_view BaulkLocale() {
   return BaulkEnv::Instance().Locale();
 }
 
+uint64_t BaulkExtractMemory() { return BaulkEnv::Instance().ExtractMemory(); }
+
 baulk::compiler::Executor &BaulkExecutor() { return BaulkEnv::Instance().BaulkExecutor(); }
 
 int BaulkBucketWeights(std::wstring_view bucket) { return BaulkEnv::Instance().BaulkBucketWeights(bucket); }
@@ -180,65 +180,80 @@ std::optional<baulk::Package> PackageLocalMeta(std::wstring_view pkgname, bela::
   return std::make_optional(std::move(pkg));
 }
 
-bool PackageUpdatableMeta(const baulk::Package &opkg, baulk::Package &pkg) {
-  // initialize version from installed version
-  baulk::version::version pkgversion(opkg.version);
-  auto weights = opkg.weights;
-  bool updated{false};
-  auto bucketsdir = bela::StringCat(baulk::BaulkRoot(), L"\\", baulk::BucketsDirName);
+std::optional<baulk::Package> PackageMetaFromBucket(std::wstring_view pkgname, const baulk::Bucket &bucket,
+                                                    bela::error_code &ec) {
+  auto pkgmeta = bela::StringCat(baulk::BaulkRoot(), L"\\", baulk::BucketsDirName, L"\\", bucket.name, L"\\bucket\\",
+                                 pkgname, L".json");
+  auto pkg = PackageMeta(pkgmeta, pkgname, bucket.name, ec);
+  if (!pkg) {
+    if (ec) {
+      bela::FPrintF(stderr, L"Parse %s error: %s\n", pkgmeta, ec.message);
+    }
+    return std::nullopt;
+  }
+  pkg->bucket = bucket.name;
+  pkg->weights = bucket.weights;
+  return pkg;
+}
 
+// PackageNewest selects the newest package among buckets, indexed buckets only compare versions,
+// the manifest of the selected bucket is parsed once
+bool PackageNewest(std::wstring_view pkgname, baulk::version::version pkgversion, int weights, baulk::Package &pkg,
+                   size_t &found) {
+  const baulk::Bucket *newest = nullptr;
+  std::optional<baulk::Package> newestPkg;
   for (const auto &bk : baulk::BaulkBuckets()) {
-    auto pkgmeta = bela::StringCat(bucketsdir, L"\\", bk.name, L"\\bucket\\", opkg.name, L".json");
-    bela::error_code ec;
-    auto pkgN = PackageMeta(pkgmeta, opkg.name, bk.name, ec);
-    if (!pkgN) {
-      if (ec) {
-        bela::FPrintF(stderr, L"Parse %s error: %s\n", pkgmeta, ec.message);
+    std::optional<baulk::Package> pkgN;
+    std::wstring_view version;
+    if (auto index = BucketIndexLookup(bk.name); index != nullptr) {
+      auto sm = index->Find(pkgname);
+      if (!sm) {
+        continue;
       }
-      continue;
+      version = sm->version;
+    } else {
+      bela::error_code ec;
+      if (pkgN = PackageMetaFromBucket(pkgname, bk, ec); !pkgN) {
+        continue;
+      }
+      version = pkgN->version;
     }
-    pkgN->bucket = bk.name;
-    pkgN->weights = bk.weights;
-    baulk::version::version newversion(pkgN->version);
+    found++;
+    baulk::version::version newversion(version);
     // compare version newversion is > oldversion
     // newversion == oldversion and strversion not equail compare weights
-    if (newversion > pkgversion || (newversion == pkgversion && weights < pkgN->weights)) {
-      pkg = std::move(*pkgN);
+    if (newversion > pkgversion || (newversion == pkgversion && weights < bk.weights)) {
+      newest = &bk;
+      newestPkg = std::move(pkgN);
       pkgversion = newversion;
-      weights = pkgN->weights;
-      updated = true;
+      weights = bk.weights;
     }
   }
-  return updated;
+  if (newest == nullptr) {
+    return false;
+  }
+  if (!newestPkg) {
+    bela::error_code ec;
+    if (newestPkg = PackageMetaFromBucket(pkgname, *newest, ec); !newestPkg) {
+      return false;
+    }
+  }
+  pkg = std::move(*newestPkg);
+  return true;
 }
+
+bool PackageUpdatableMeta(const baulk::Package &opkg, baulk::Package &pkg) {
+  // initialize version from installed version
+  size_t found = 0;
+  return PackageNewest(opkg.name, baulk::version::version(opkg.version), opkg.weights, pkg, found);
+}
+
 // package metadata
 std::optional<baulk::Package> PackageMetaEx(std::wstring_view pkgname, bela::error_code &ec) {
-  baulk::version::version pkgversion; // 0.0.0.0
   baulk::Package pkg;
-  auto bucketsdir = bela::StringCat(baulk::BaulkRoot(), L"\\", baulk::BucketsDirName);
   size_t pkgsame = 0;
-  for (const auto &bk : baulk::BaulkBuckets()) {
-    auto pkgmeta = bela::StringCat(bucketsdir, L"\\", bk.name, L"\\bucket\\", pkgname, L".json");
-    bela::error_code ec;
-    auto pkgN = PackageMeta(pkgmeta, pkgname, bk.name, ec);
-    if (!pkgN) {
-      if (ec) {
-        bela::FPrintF(stderr, L"Parse %s error: %s\n", pkgmeta, ec.message);
-      }
-      continue;
-    }
-    pkgsame++;
-    pkgN->bucket = bk.name;
-    pkgN->weights = bk.weights;
-    baulk::version::version newversion(pkgN->version);
-    // compare version newversion is > oldversion
-    // newversion == oldversion and strversion not equail compare weights
-    if (newversion > pkgversion || (newversion == pkgversion && pkg.weights < pkgN->weights)) {
-      pkg = std::move(*pkgN);
-      pkgversion = newversion;
-    }
-  }
-  if (pkgsame == 0) {
+  // 0.0.0.0
+  if (!PackageNewest(pkgname, baulk::version::version(), 0, pkg, pkgsame) || pkgsame == 0) {
     ec = bela::make_error_code(bela::ErrGeneral, L"'", pkgname, L"' not yet ported.");
     return std::nullopt;
   }
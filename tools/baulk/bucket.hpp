@@ -4,6 +4,7 @@
 #include <string>
 #include <optional>
 #include <bela/base.hpp>
+#include <bela/mapview.hpp>
 #include "baulk.hpp"
 
 namespace baulk::bucket {
@@ -19,6 +20,47 @@ std::optional<baulk::Package> PackageLocalMeta(std::wstring_view pkgname, bela::
 bool PackageUpdatableMeta(const baulk::Package &opkg, baulk::Package &pkg);
 
 bool PackageIsUpdatable(std::wstring_view pkgname, baulk::Package &pkg);
+
+// Binary bucket index: buckets/<bucket>/bucket.index, rebuilt by 'baulk update'.
+// header | entries sorted by lowercase package name | UTF-16 string pool
+[[maybe_unused]] constexpr std::wstring_view BucketIndexName = L"bucket.index";
+struct PackageSummary {
+  std::wstring_view name;
+  std::wstring_view version;
+  std::wstring_view description;
+  std::wstring_view category;
+  std::wstring_view urls; // separated by '\n'
+  std::wstring_view checksum;
+  int weights{0};
+};
+struct IndexEntry;
+class BucketIndex {
+public:
+  BucketIndex() = default;
+  BucketIndex(const BucketIndex &) = delete;
+  BucketIndex &operator=(const BucketIndex &) = delete;
+  bool Open(std::wstring_view file, bela::error_code &ec);
+  size_t size() const { return count; }
+  int Weights() const { return weights; }
+  PackageSummary At(size_t i) const;
+  std::optional<PackageSummary> Find(std::wstring_view pkgname) const;
+
+private:
+  bela::MapView mv;
+  const IndexEntry *entries{nullptr};
+  const wchar_t *pool{nullptr};
+  size_t poolsize{0};
+  size_t count{0};
+  int weights{0};
+  std::wstring_view str(uint32_t offset, uint32_t length) const;
+};
+// BucketIndexBuild parse every manifest in the bucket once and write the binary index
+bool BucketIndexBuild(const baulk::Bucket &bucket, bela::error_code &ec);
+// BucketIndexLookup opened index of the bucket, nullptr when missing or outdated (fallback to manifests)
+const BucketIndex *BucketIndexLookup(std::wstring_view bucket);
+// PackageMetaFromBucket parse manifest buckets/<bucket>/bucket/<pkgname>.json
+std::optional<baulk::Package> PackageMetaFromBucket(std::wstring_view pkgname, const baulk::Bucket &bucket,
+                                                    bela::error_code &ec);
 } // namespace baulk::bucket
 
 #endif
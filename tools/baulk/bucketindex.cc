@@ -0,0 +1,237 @@
+// binary bucket index
+#include <bela/path.hpp>
+#include <bela/io.hpp>
+#include <bela/ascii.hpp>
+#include <bela/str_join.hpp>
+#include <algorithm>
+#include "baulk.hpp"
+#include "bucket.hpp"
+#include "fs.hpp"
+#include "net.hpp"
+
+namespace baulk::bucket {
+constexpr uint8_t indexMagic[8] = {'B', 'K', 'I', 'N', 'D', 'E', 'X', 0};
+// bump when layout or manifest interpretation changes, old indexes are ignored
+constexpr uint32_t indexVersion = 1;
+
+struct IndexHeader {
+  uint8_t magic[8];
+  uint32_t version;
+  uint32_t count;
+  int32_t weights;
+  uint32_t poolsize; // wchar_t count
+};
+struct IndexString {
+  uint32_t offset; // wchar_t offset in pool
+  uint32_t length;
+};
+struct IndexEntry {
+  IndexString name;
+  IndexString version;
+  IndexString description;
+  IndexString category;
+  IndexString urls;
+  IndexString checksum;
+};
+static_assert(sizeof(IndexHeader) == 24, "IndexHeader layout");
+static_assert(sizeof(IndexEntry) == 48, "IndexEntry layout");
+
+inline wchar_t foldASCII(wchar_t c) { return (c >= 'A' && c <= 'Z') ? static_cast<wchar_t>(c + ('a' - 'A')) : c; }
+
+// package names are case insensitive (NTFS file names)
+inline int compareFold(std::wstring_view a, std::wstring_view b) {
+  auto n = (std::min)(a.size(), b.size());
+  for (size_t i = 0; i < n; i++) {
+    auto ca = foldASCII(a[i]);
+    auto cb = foldASCII(b[i]);
+    if (ca != cb) {
+      return ca < cb ? -1 : 1;
+    }
+  }
+  if (a.size() == b.size()) {
+    return 0;
+  }
+  return a.size() < b.size() ? -1 : 1;
+}
+
+inline std::wstring BucketIndexPath(std::wstring_view bucket) {
+  return bela::StringCat(baulk::BaulkRoot(), L"\\", baulk::BucketsDirName, L"\\", bucket, L"\\", BucketIndexName);
+}
+
+bool BucketIndex::Open(std::wstring_view file, bela::error_code &ec) {
+  if (!mv.MappingView(file, ec, sizeof(IndexHeader))) {
+    return false;
+  }
+  auto v = mv.subview();
+  auto hdr = reinterpret_cast<const IndexHeader *>(v.data());
+  if (!v.StartsWith(indexMagic)) {
+    ec = bela::make_error_code(bela::ErrGeneral, file, L" is not a bucket index");
+    return false;
+  }
+  if (hdr->version != indexVersion) {
+    ec = bela::make_error_code(bela::ErrGeneral, file, L" index version ", hdr->version, L" unsupported");
+    return false;
+  }
+  auto required = sizeof(IndexHeader) + static_cast<uint64_t>(hdr->count) * sizeof(IndexEntry) +
+                  static_cast<uint64_t>(hdr->poolsize) * sizeof(wchar_t);
+  if (required > v.size()) {
+    ec = bela::make_error_code(bela::ErrGeneral, file, L" index truncated");
+    return false;
+  }
+  count = hdr->count;
+  weights = hdr->weights;
+  entries = reinterpret_cast<const IndexEntry *>(v.data() + sizeof(IndexHeader));
+  pool = reinterpret_cast<const wchar_t *>(v.data() + sizeof(IndexHeader) + count * sizeof(IndexEntry));
+  poolsize = hdr->poolsize;
+  return true;
+}
+
+std::wstring_view BucketIndex::str(uint32_t offset, uint32_t length) const {
+  if (static_cast<size_t>(offset) + length > poolsize) {
+    return L"";
+  }
+  return std::wstring_view{pool + offset, length};
+}
+
+PackageSummary BucketIndex::At(size_t i) const {
+  const auto &e = entries[i];
+  PackageSummary sm;
+  sm.name = str(e.name.offset, e.name.length);
+  sm.version = str(e.version.offset, e.version.length);
+  sm.description = str(e.description.offset, e.description.length);
+  sm.category = str(e.category.offset, e.category.length);
+  sm.urls = str(e.urls.offset, e.urls.length);
+  sm.checksum = str(e.checksum.offset, e.checksum.length);
+  sm.weights = weights;
+  return sm;
+}
+
+std::optional<PackageSummary> BucketIndex::Find(std::wstring_view pkgname) const {
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    auto mid = lo + (hi - lo) / 2;
+    auto name = str(entries[mid].name.offset, entries[mid].name.length);
+    auto c = compareFold(name, pkgname);
+    if (c == 0) {
+      return std::make_optional(At(mid));
+    }
+    if (c < 0) {
+      lo = mid + 1;
+      continue;
+    }
+    hi = mid;
+  }
+  return std::nullopt;
+}
+
+// opened indexes live until exit, list/upgrade look up every installed package
+class BucketIndexCache {
+public:
+  static BucketIndexCache &Instance() {
+    static BucketIndexCache cache;
+    return cache;
+  }
+  const BucketIndex *Lookup(std::wstring_view bucket) {
+    if (auto it = indexes.find(bucket); it != indexes.end()) {
+      return it->second.get();
+    }
+    auto index = std::make_unique<BucketIndex>();
+    bela::error_code ec;
+    if (!index->Open(BucketIndexPath(bucket), ec)) {
+      baulk::DbgPrint(L"bucket '%s' index unavailable: %s", bucket, ec.message);
+      index.reset();
+    }
+    auto p = index.get();
+    indexes.emplace(bucket, std::move(index));
+    return p;
+  }
+  // unmap before the index file is replaced
+  void Drop(std::wstring_view bucket) {
+    if (auto it = indexes.find(bucket); it != indexes.end()) {
+      indexes.erase(it);
+    }
+  }
+
+private:
+  bela::flat_hash_map<std::wstring, std::unique_ptr<BucketIndex>, baulk::net::StringCaseInsensitiveHash,
+                      baulk::net::StringCaseInsensitiveEq>
+      indexes;
+};
+
+const BucketIndex *BucketIndexLookup(std::wstring_view bucket) { return BucketIndexCache::Instance().Lookup(bucket); }
+
+class IndexEncoder {
+public:
+  IndexString Add(std::wstring_view sv) {
+    IndexString s{static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(sv.size())};
+    pool.append(sv);
+    return s;
+  }
+  void Add(const baulk::Package &pkg) {
+    IndexEntry e;
+    e.name = Add(pkg.name);
+    e.version = Add(pkg.version);
+    e.description = Add(pkg.description);
+    e.category = Add(pkg.venv.category);
+    e.urls = Add(bela::StrJoin(pkg.urls, L"\n"));
+    e.checksum = Add(pkg.checksum);
+    entries.emplace_back(e);
+  }
+  std::string Encode(int weights) const {
+    IndexHeader hdr;
+    memcpy(hdr.magic, indexMagic, sizeof(indexMagic));
+    hdr.version = indexVersion;
+    hdr.count = static_cast<uint32_t>(entries.size());
+    hdr.weights = weights;
+    hdr.poolsize = static_cast<uint32_t>(pool.size());
+    std::string buffer;
+    buffer.reserve(sizeof(hdr) + entries.size() * sizeof(IndexEntry) + pool.size() * sizeof(wchar_t));
+    buffer.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    buffer.append(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(IndexEntry));
+    buffer.append(reinterpret_cast<const char *>(pool.data()), pool.size() * sizeof(wchar_t));
+    return buffer;
+  }
+
+private:
+  std::vector<IndexEntry> entries;
+  std::wstring pool;
+};
+
+bool BucketIndexBuild(const baulk::Bucket &bucket, bela::error_code &ec) {
+  auto bucketdir = bela::StringCat(baulk::BaulkRoot(), L"\\", baulk::BucketsDirName, L"\\", bucket.name, L"\\bucket");
+  std::vector<baulk::Package> pkgs;
+  bela::fs::Finder finder;
+  if (!finder.First(bucketdir, L"*.json", ec)) {
+    return false;
+  }
+  do {
+    if (finder.Ignore() || finder.IsDir()) {
+      continue;
+    }
+    auto pkgname = finder.Name();
+    auto pkgmeta = bela::StringCat(bucketdir, L"\\", pkgname);
+    pkgname.remove_suffix(5);
+    bela::error_code ec_;
+    auto pkg = PackageMeta(pkgmeta, pkgname, bucket.name, ec_);
+    if (!pkg) {
+      baulk::DbgPrint(L"bucket '%s' index skip %s: %s", bucket.name, pkgmeta, ec_.message);
+      continue;
+    }
+    pkgs.emplace_back(std::move(*pkg));
+  } while (finder.Next());
+  std::sort(pkgs.begin(), pkgs.end(),
+            [](const baulk::Package &a, const baulk::Package &b) { return compareFold(a.name, b.name) < 0; });
+  IndexEncoder encoder;
+  for (const auto &pkg : pkgs) {
+    encoder.Add(pkg);
+  }
+  BucketIndexCache::Instance().Drop(bucket.name);
+  if (!bela::io::WriteTextAtomic(encoder.Encode(bucket.weights), BucketIndexPath(bucket.name), ec)) {
+    return false;
+  }
+  baulk::DbgPrint(L"bucket '%s' index %d packages", bucket.name, pkgs.size());
+  return true;
+}
+
+} // namespace baulk::bucket
@@ -12,7 +12,7 @@ namespace baulk::commands {
 
 // package
 
-inline std::wstring StringCategory(baulk::Package &pkg) {
+inline std::wstring StringCategory(const baulk::Package &pkg) {
   if (pkg.venv.category.empty()) {
     return L"";
   }
@@ -34,7 +34,40 @@ public:
     }
     return false;
   };
+  void Display(const baulk::Package &pkg) {
+    bela::error_code ec;
+    auto lopkg = baulk::bucket::PackageLocalMeta(pkg.name, ec);
+    if (lopkg && bela::EndsWithIgnoreCase(lopkg->bucket, pkg.bucket)) {
+      bela::FPrintF(stderr,
+                    L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s [installed "
+                    L"\x1b[33m%s\x1b[0m]%s\n  %s\n",
+                    pkg.name, pkg.bucket, pkg.version, lopkg->version, StringCategory(pkg), pkg.description);
+      return;
+    }
+    bela::FPrintF(stderr, L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s%s\n  %s\n", pkg.name, pkg.bucket, pkg.version,
+                  StringCategory(pkg), pkg.description);
+  }
+  // SearchIndexed match names in the binary bucket index, no manifest is parsed
+  bool SearchIndexed(const baulk::bucket::BucketIndex &index, std::wstring_view bucket) {
+    for (size_t i = 0; i < index.size(); i++) {
+      auto sm = index.At(i);
+      if (!PkgMatch(bela::AsciiStrToLower(sm.name))) {
+        continue;
+      }
+      baulk::Package pkg;
+      pkg.name = sm.name;
+      pkg.bucket = bucket;
+      pkg.version = sm.version;
+      pkg.description = sm.description;
+      pkg.venv.category = sm.category;
+      Display(pkg);
+    }
+    return true;
+  }
   bool SearchMatched(std::wstring_view bucketdir, std::wstring_view bucket) {
+    if (auto index = baulk::bucket::BucketIndexLookup(bucket); index != nullptr) {
+      return SearchIndexed(*index, bucket);
+    }
     bela::fs::Finder finder;
     bela::error_code ec;
     if (!finder.First(bucketdir, L"*.json", ec)) {
@@ -55,16 +88,7 @@ public:
         bela::FPrintF(stderr, L"Parse %s error: %s\n", pkgmeta, ec.message);
         continue;
       }
-      auto lopkg = baulk::bucket::PackageLocalMeta(pkgname, ec);
-      if (lopkg && bela::EndsWithIgnoreCase(lopkg->bucket, pkg->bucket)) {
-        bela::FPrintF(stderr,
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s [installed "
-                      L"\x1b[33m%s\x1b[0m]%s\n  %s\n",
-                      pkg->name, pkg->bucket, pkg->version, lopkg->version, StringCategory(*pkg), pkg->description);
-        continue;
-      }
-      bela::FPrintF(stderr, L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s%s\n  %s\n", pkg->name, pkg->bucket, pkg->version,
-                    StringCategory(*pkg), pkg->description);
+      Display(*pkg);
     } while (finder.Next());
 
     return true;
@@ -26,6 +26,7 @@ int uninstallone(std::wstring_view pkgname) {
     bela::FPrintF(stderr, L"baulk uninstall '%s' links: \x1b[31m%s\x1b[0m\n", pkgname, ec.message);
   }
   bela::fs::RemoveAll(lockfile, ec);
+  bela::fs::RemoveAll(bela::StringCat(baulk::BaulkRoot(), L"\\bin\\locks\\", pkgname, L".files"), ec);
   auto pkgdir = bela::StringCat(baulk::BaulkRoot(), L"\\bin\\pkgs\\", pkgname);
   if (!bela::fs::RemoveAll(pkgdir, ec)) {
     bela::FPrintF(stderr, L"baulk uninstall '%s' error: \x1b[31m%s\x1b[0m\n", pkgname, ec.message);
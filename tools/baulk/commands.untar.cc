@@ -2,6 +2,8 @@
 #include "baulk.hpp"
 #include "commands.hpp"
 #include "tar.hpp"
+#include <bela/datetime.hpp>
+#include <algorithm>
 
 namespace baulk::commands {
 inline std::wstring resolveDestination(const argv_t &argv, std::wstring_view tarfile) {
@@ -14,63 +16,135 @@ inline std::wstring resolveDestination(const argv_t &argv, std::wstring_view tar
   return bela::StringCat(tarfile, L".out");
 }
 
+inline std::vector<std::string> resolvePatterns(const argv_t &argv, size_t first) {
+  std::vector<std::string> patterns;
+  for (size_t i = first; i < argv.size(); i++) {
+    patterns.emplace_back(bela::ToNarrow(argv[i]));
+  }
+  return patterns;
+}
+
+inline std::wstring_view entryType(char typeflag) {
+  switch (typeflag) {
+  case baulk::archive::tar::TypeDir:
+    return L"d";
+  case baulk::archive::tar::TypeSymlink:
+    return L"l";
+  case baulk::archive::tar::TypeLink:
+    return L"h";
+  default:
+    break;
+  }
+  return L"-";
+}
+
+// listEntries: the index is built on the first listing, later listings only read the sidecar
+int listEntries(std::wstring_view file, baulk::archive::tar::FileReader &fr, const std::vector<std::string> &patterns) {
+  baulk::archive::tar::Index index;
+  bela::error_code ec;
+  if (!index.Open(file, fr, true, ec)) {
+    bela::FPrintF(stderr, L"unable list tar file %s error %s\n", file, ec.message);
+    return 1;
+  }
+  for (const auto &e : index.Entries()) {
+    if (!patterns.empty() && std::none_of(patterns.begin(), patterns.end(), [&](const std::string &p) {
+          return baulk::archive::tar::Match(p, e.Name);
+        })) {
+      continue;
+    }
+    auto t = bela::FormatTime(bela::FromUnix(e.ModTime, 0));
+    if (e.Typeflag == baulk::archive::tar::TypeSymlink || e.Typeflag == baulk::archive::tar::TypeLink) {
+      bela::FPrintF(stdout, L"%s %12d %s %s -> %s\n", entryType(e.Typeflag), e.Size, t, e.Name, e.LinkName);
+      continue;
+    }
+    bela::FPrintF(stdout, L"%s %12d %s %s\n", entryType(e.Typeflag), e.Size, t, e.Name);
+  }
+  return 0;
+}
+
 int cmd_untar(const argv_t &argv) {
   if (argv.empty()) {
-    bela::FPrintF(stderr, L"usage: baulk untar tarfile dest\n");
+    bela::FPrintF(stderr, L"usage: baulk untar tarfile [dest] [pattern ...]\n       baulk --list untar tarfile "
+                          L"[pattern ...]\n");
     return 1;
   }
   auto file = bela::PathAbsolute(argv[0]);
-  auto root = resolveDestination(argv, file);
-  DbgPrint(L"destination %s", root);
   bela::error_code ec;
   auto fr = baulk::archive::tar::OpenFile(file, ec);
   if (fr == nullptr) {
     bela::FPrintF(stderr, L"unable open file %s error %s\n", file, ec.message);
     return 1;
   }
+  if (baulk::IsListMode) {
+    return listEntries(file, *fr, resolvePatterns(argv, 1));
+  }
+  auto root = resolveDestination(argv, file);
+  DbgPrint(L"destination %s", root);
+  baulk::archive::tar::ExtractorOptions opts;
+  opts.patterns = resolvePatterns(argv, 2);
+  opts.onSkip = [](const baulk::archive::tar::Header &h, std::wstring_view reason) {
+    bela::FPrintF(stderr, L"\x1b[2K\rskip %s: %s\n", h.Name, reason);
+  };
+  if (!baulk::IsQuietMode) {
+    auto prefix = root.size() + 1;
+    opts.onEntry = [prefix](const baulk::archive::tar::Header &, std::wstring_view path) {
+      bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx %s\x1b[0m", path.size() > prefix ? path.substr(prefix) : path);
+    };
+  }
+  auto report = [&](const baulk::archive::tar::Extractor &extractor) {
+    if (!baulk::IsQuietMode) {
+      // every cached lookup replaces the stat and mkdir of an existing parent directory
+      const auto &dirs = extractor.Dirs();
+      bela::FPrintF(stderr,
+                    L"\x1b[2K\r\x1b[32mextracted %d entries, %d directories created, %d lookups cached\x1b[0m\n",
+                    extractor.Extracted(), dirs.Created(), dirs.Cached());
+    }
+  };
+  baulk::archive::tar::Index index;
+  if (!opts.patterns.empty()) {
+    // uncompressed tar and seekable zstd: read only the selected members
+    if (auto rr = baulk::archive::tar::MakeRandomReader(*fr); rr) {
+      if (!index.Open(file, *fr, true, ec)) {
+        bela::FPrintF(stderr, L"unable index tar file %s error %s\n", file, ec.message);
+        return 1;
+      }
+      baulk::archive::tar::Extractor extractor(fr.get(), root, opts);
+      if (!extractor.ExtractIndexed(index, *rr, ec)) {
+        bela::FPrintF(stderr, L"\nuntar error %s\n", ec.message);
+        return 1;
+      }
+      report(extractor);
+      return 0;
+    }
+  }
+  // other archives are streamed, an existing index stops the stream after the last selected entry. Without one the
+  // extraction scans the whole stream and records it for the next --list or selective run.
+  if (bela::error_code le; index.Open(file, *fr, false, le)) {
+    opts.index = opts.patterns.empty() ? nullptr : &index;
+  } else if (index.Prepare(*fr, le)) {
+    opts.record = &index;
+  }
   auto wr = baulk::archive::tar::MakeReader(*fr, ec);
-  std::shared_ptr<baulk::archive::tar::Reader> tr;
-  if (wr != nullptr) {
-    tr = std::make_shared<baulk::archive::tar::Reader>(wr.get());
-  } else if (ec.code == baulk::archive::tar::ErrNoFilter) {
-    tr = std::make_shared<baulk::archive::tar::Reader>(fr.get());
-  } else {
+  if (wr == nullptr && ec.code != baulk::archive::tar::ErrNoFilter) {
     bela::FPrintF(stderr, L"unable open tar file %s error %s\n", file, ec.message);
     return 1;
   }
-  for (;;) {
-    auto fh = tr->Next(ec);
-    if (!fh) {
-      if (ec.code == bela::ErrEnded) {
-        break;
-      }
-      bela::FPrintF(stderr, L"\nuntar error %s\n", ec.message);
-      break;
-    }
-    bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx %s\x1b[0m", fh->Name);
-    auto dest = baulk::archive::tar::PathRemoveExtension(file);
-    auto out = baulk::archive::PathCat(dest, fh->Name);
-    if (!out) {
-      continue;
-    }
-    if (fh->Size == 0) {
-      continue;
-    }
-    auto fd = baulk::archive::NewFD(*out, ec, true);
-    if (!fd) {
-      bela::FPrintF(stderr, L"newFD %s error: %s\n", *out, ec.message);
-      continue;
-    }
-    fd->SetTime(fh->ModTime, ec);
-    if (!tr->WriteTo(
-            [&](const void *data, size_t len, bela::error_code &ec) -> bool {
-              //
-              return fd->Write(data, len, ec);
-            },
-            fh->Size, ec)) {
-      fd->Discard();
-    }
+  if (baulk::ParallelJobs != 1) {
+    opts.memoryLimit = baulk::BaulkExtractMemory();
+    opts.writers = baulk::ParallelJobs;
+  }
+  baulk::archive::tar::Extractor extractor(
+      wr != nullptr ? wr.get() : static_cast<baulk::archive::tar::ExtractReader *>(fr.get()), root, opts);
+  if (!extractor.Extract(ec)) {
+    bela::FPrintF(stderr, L"\nuntar error %s\n", ec.message);
+    return 1;
+  }
+  if (opts.record != nullptr) {
+    // an unwritable archive directory only costs the next run another scan
+    bela::error_code se;
+    index.Save(file, se);
   }
+  report(extractor);
   return 0;
 }
-} // namespace baulk::commands
\ No newline at end of file
+} // namespace baulk::commands
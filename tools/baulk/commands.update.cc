@@ -29,6 +29,7 @@ public:
   bool Update(const baulk::Bucket &bucket);
 
 private:
+  bool BuildIndex(const baulk::Bucket &bucket);
   bucket_status_t status;
   std::wstring bucketslock;
   bool updated{false};
@@ -102,6 +103,10 @@ bool BucketUpdater::Update(const baulk::Bucket &bucket) {
   auto it = status.find(bucket.name);
   if (it != status.end() && bela::EqualsIgnoreCase(it->second.latest, *latest)) {
     baulk::DbgPrint(L"bucket: %s is up to date. id: %s", bucket.name, *latest);
+    // index missing or built by an older baulk
+    if (baulk::bucket::BucketIndexLookup(bucket.name) == nullptr) {
+      return BuildIndex(bucket);
+    }
     return true;
   }
   baulk::DbgPrint(L"bucket: %s latest id: %s", bucket.name, *latest);
@@ -112,6 +117,15 @@ bool BucketUpdater::Update(const baulk::Bucket &bucket) {
   bela::FPrintF(stderr, L"\x1b[32m'%s' is up to date: %s\x1b[0m\n", bucket.name, *latest);
   status[bucket.name] = bucket_metadata{*latest, baulk::time::TimeNow()};
   updated = true;
+  return BuildIndex(bucket);
+}
+
+bool BucketUpdater::BuildIndex(const baulk::Bucket &bucket) {
+  bela::error_code ec;
+  if (!baulk::bucket::BucketIndexBuild(bucket, ec)) {
+    bela::FPrintF(stderr, L"baulk build \x1b[34m%s\x1b[0m index error: \x1b[31m%s\x1b[0m\n", bucket.name, ec.message);
+    return false;
+  }
   return true;
 }
 
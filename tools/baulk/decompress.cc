@@ -11,6 +11,11 @@ bool Regularize(std::wstring_view path) {
   // TODO some zip code
   return baulk::fs::FlatPackageInitialize(path, path, ec);
 }
+
+bool Regularize(std::wstring_view path, std::wstring &flattened) {
+  bela::error_code ec;
+  return baulk::fs::FlatPackageInitialize(path, path, ec, &flattened);
+}
 } // namespace standard
 
 namespace exe {
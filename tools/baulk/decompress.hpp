@@ -2,11 +2,14 @@
 #ifndef BAULK_DECOMPRESS_HPP
 #define BAULK_DECOMPRESS_HPP
 #include <bela/base.hpp>
+#include "manifest.hpp"
 
 namespace baulk {
 namespace standard {
 bool Regularize(std::wstring_view path);
-}
+// Regularize flattened is set to the directory moved to the package root, relative to path
+bool Regularize(std::wstring_view path, std::wstring &flattened);
+} // namespace standard
 namespace exe {
 bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec);
 bool Regularize(std::wstring_view path);
@@ -18,27 +21,39 @@ bool Regularize(std::wstring_view path);
 } // namespace msi
 namespace zip {
 bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec);
+// DecompressIncremental record the regular files in m and link those identical to an installed file
+bool DecompressIncremental(std::wstring_view src, std::wstring_view outdir, manifest::Manifest &m,
+                           bela::error_code &ec);
+// Record the regular files of src extracted to outdir in m, Decompress records nothing
+bool Record(std::wstring_view src, std::wstring_view outdir, manifest::Manifest &m, bela::error_code &ec);
 } // namespace zip
 namespace sevenzip {
 bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec);
 } // namespace sevenzip
 namespace tar {
 bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec);
-}
+bool DecompressIncremental(std::wstring_view src, std::wstring_view outdir, manifest::Manifest &m,
+                           bela::error_code &ec);
+} // namespace tar
 
 struct decompress_handler_t {
   std::wstring_view extension;
   decltype(&exe::Decompress) decompress;
   decltype(&exe::Regularize) regularize;
+  // incremental extraction for upgrades, nullptr when the format has no manifest
+  decltype(&zip::DecompressIncremental) incremental;
+  // record the keys of a package extracted by decompress, nullptr when the manifest needs none
+  decltype(&zip::Record) record;
+  manifest::Kind kind;
 };
 
 inline std::optional<decompress_handler_t> LookupHandler(std::wstring_view ext) {
   static constexpr decompress_handler_t hs[] = {
-      {L"exe", exe::Decompress, exe::Regularize},
-      {L"msi", msi::Decompress, msi::Regularize},
-      {L"zip", zip::Decompress, standard::Regularize},
-      {L"7z", sevenzip::Decompress, standard::Regularize},
-      {L"tar", tar::Decompress, standard::Regularize}
+      {L"exe", exe::Decompress, exe::Regularize, nullptr, nullptr, manifest::Kind::Zip},
+      {L"msi", msi::Decompress, msi::Regularize, nullptr, nullptr, manifest::Kind::Zip},
+      {L"zip", zip::Decompress, standard::Regularize, zip::DecompressIncremental, zip::Record, manifest::Kind::Zip},
+      {L"7z", sevenzip::Decompress, standard::Regularize, nullptr, nullptr, manifest::Kind::Zip},
+      {L"tar", tar::Decompress, standard::Regularize, tar::DecompressIncremental, nullptr, manifest::Kind::Tar}
       //
   };
   for (const auto &h : hs) {
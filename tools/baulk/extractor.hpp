@@ -0,0 +1,54 @@
+///
+#ifndef BAULK_EXTRACTOR_HPP
+#define BAULK_EXTRACTOR_HPP
+#include <zip.hpp>
+#include <bela/terminal.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include "manifest.hpp"
+
+namespace baulk::zip {
+// Extractor native zip extraction of baulk unzip and zip packages. Directories are created and entries are named on
+// the calling thread, files and symlinks are then written by a pool of decoders or, with a single one, through a
+// write-behind thread. Entries repeating an earlier path are written after the pool in archive order, the last one
+// wins. With a manifest the unchanged files of the installed package are linked before any file is written.
+class Extractor {
+public:
+  Extractor(std::wstring_view destination_, manifest::Manifest *manifest_ = nullptr);
+  Extractor(const Extractor &) = delete;
+  Extractor &operator=(const Extractor &) = delete;
+  bool OpenReader(std::wstring_view file, bela::error_code &ec);
+  // Extract with jobs decoders, 0 for the processor count
+  bool Extract(int jobs, bela::error_code &ec);
+  void Report() const;
+
+private:
+  struct entry {
+    const baulk::archive::zip::File *file;
+    std::wstring path;
+  };
+  baulk::archive::zip::Reader reader;
+  baulk::archive::DirCache dirs;
+  baulk::archive::WriteBehind *behind{nullptr};
+  manifest::Manifest *manifest{nullptr};
+  bela::terminal::terminal_size termsz{0};
+  std::wstring destination;
+  std::mutex mtx; // guard progress output and first error
+  std::atomic_int64_t decompressed{0};
+  std::atomic_size_t extracted{0};
+  std::atomic_bool canceled{false};
+  std::chrono::steady_clock::time_point startTime;
+  std::chrono::steady_clock::time_point endTime;
+  int workers{1};
+  bool owfile{true};
+  void show(std::wstring_view path);
+  bool prepare(bool parallel, std::vector<entry> &entries, std::vector<entry> &later, bela::error_code &ec);
+  bool extractSerial(const std::vector<entry> &entries, bela::error_code &ec);
+  bool extractParallel(int jobs, std::vector<entry> &entries, bela::error_code &ec);
+  bool extractFile(const entry &e, bela::error_code &ec);
+  bool extractSymlink(const entry &e, bela::error_code &ec);
+};
+} // namespace baulk::zip
+
+#endif
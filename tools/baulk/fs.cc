@@ -82,7 +82,8 @@ std::optional<std::wstring> FindExecutablePath(std::wstring_view p) {
   return std::nullopt;
 }
 
-bool FlatPackageInitialize(std::wstring_view dir, std::wstring_view dest, bela::error_code &ec) {
+bool FlatPackageInitialize(std::wstring_view dir, std::wstring_view dest, bela::error_code &ec,
+                           std::wstring *flattened) {
   auto subfirst = UniqueSubdirectory(dir);
   if (!subfirst) {
     return true;
@@ -95,6 +96,9 @@ bool FlatPackageInitialize(std::wstring_view dir, std::wstring_view dest, bela::
     }
     currentdir.assign(std::move(*subdir_));
   }
+  if (flattened != nullptr) {
+    flattened->assign(std::wstring_view(currentdir).substr(dir.size() + 1));
+  }
   std::error_code e;
   std::filesystem::path destpath(dest);
   for (const auto &p : std::filesystem::directory_iterator(currentdir)) {
@@ -15,6 +15,13 @@ inline std::wstring FileName(std::wstring_view p) {
   return std::filesystem::path(p).filename().wstring();
 }
 
+// PathKey NTFS names are case-insensitive, "README" and "readme" are one file
+inline std::wstring PathKey(std::wstring_view path) {
+  std::wstring key(path);
+  CharLowerBuffW(key.data(), static_cast<DWORD>(key.size()));
+  return key;
+}
+
 inline bool MakeDir(std::wstring_view path, bela::error_code &ec) {
   std::error_code e;
   if (std::filesystem::exists(path, e)) {
@@ -51,7 +58,10 @@ inline bool SymLink(std::wstring_view _To, std::wstring_view NewLink, bela::erro
   return true;
 }
 std::optional<std::wstring> UniqueSubdirectory(std::wstring_view dir);
-bool FlatPackageInitialize(std::wstring_view dir, std::wstring_view dest, bela::error_code &ec);
+// FlatPackageInitialize move the content of nested unique subdirectories of dir to dest, flattened is set to the moved
+// directory relative to dir
+bool FlatPackageInitialize(std::wstring_view dir, std::wstring_view dest, bela::error_code &ec,
+                           std::wstring *flattened = nullptr);
 std::optional<std::wstring> BaulkMakeTempDir(bela::error_code &ec);
 } // namespace baulk::fs
 
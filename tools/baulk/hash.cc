@@ -4,9 +4,106 @@
 #include <bela/match.hpp>
 #include <bela/hash.hpp>
 #include <bela/ascii.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "hash.hpp"
 
 namespace baulk::hash {
+// below this size a single Update on the mapping is faster than spawning threads
+constexpr size_t blake3ParallelMinimum = 4 * 1024 * 1024;
+constexpr size_t blake3SubtreeMinimum = 1024 * 1024;
+// map the file window by window, 32-bit processes cannot map multi-GB archives at once
+constexpr uint64_t blake3ViewSize = sizeof(void *) == 8 ? (1ull << 30) : (256ull << 20);
+
+void Blake3Update(bela::hash::blake3::Hasher &hasher, const uint8_t *data, size_t len, int jobs) {
+  if (jobs <= 0) {
+    jobs = static_cast<int>((std::max)(std::thread::hardware_concurrency(), 1u));
+  }
+  if (jobs == 1 || len < blake3ParallelMinimum) {
+    hasher.Update(data, len);
+    return;
+  }
+  // power of 2 subtrees, about 4 subtrees per worker
+  size_t subtree = blake3SubtreeMinimum;
+  while (subtree * 2 <= len / (static_cast<size_t>(jobs) * 4) && subtree * 2 <= blake3ViewSize) {
+    subtree *= 2;
+  }
+  const auto subtrees = len / subtree;
+  const auto counter = hasher.ChunkCounter();
+  std::vector<uint8_t> cvs(subtrees * 2 * BLAKE3_OUT_LEN);
+  std::atomic_size_t index{0};
+  auto worker = [&]() {
+    for (;;) {
+      auto i = index.fetch_add(1);
+      if (i >= subtrees) {
+        return;
+      }
+      hasher.SubtreeChainingValues(data + i * subtree, subtree, counter + i * (subtree / BLAKE3_CHUNK_LEN),
+                                   cvs.data() + i * 2 * BLAKE3_OUT_LEN);
+    }
+  };
+  auto workers = (std::min)(static_cast<size_t>(jobs), subtrees);
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (size_t i = 1; i < workers; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : threads) {
+    t.join();
+  }
+  for (size_t i = 0; i < subtrees; i++) {
+    hasher.PushSubtree(cvs.data() + i * 2 * BLAKE3_OUT_LEN, subtree);
+  }
+  // the rest is smaller than a subtree and only exists at the end of the file
+  if (auto consumed = subtrees * subtree; consumed < len) {
+    hasher.Update(data + consumed, len - consumed);
+  }
+}
+
+// blake3checksum maps the file into memory and hashes subtrees on multiple threads, output is identical to the
+// streaming Sumizer
+bool blake3checksum(std::wstring_view file, std::wstring &hv, bela::error_code &ec) {
+  HANDLE FileHandle = CreateFileW(file.data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code();
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  LARGE_INTEGER li;
+  if (GetFileSizeEx(FileHandle, &li) != TRUE) {
+    ec = bela::make_system_error_code(L"GetFileSizeEx: ");
+    return false;
+  }
+  bela::hash::blake3::Hasher hasher;
+  hasher.Initialize();
+  auto size = static_cast<uint64_t>(li.QuadPart);
+  if (size == 0) {
+    // empty files cannot be mapped
+    hv = hasher.Finalize();
+    return true;
+  }
+  auto FileMap = CreateFileMappingW(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (FileMap == nullptr) {
+    ec = bela::make_system_error_code(L"CreateFileMappingW: ");
+    return false;
+  }
+  auto mapcloser = bela::finally([&] { CloseHandle(FileMap); });
+  for (uint64_t offset = 0; offset < size; offset += blake3ViewSize) {
+    auto len = static_cast<size_t>((std::min)(size - offset, blake3ViewSize));
+    auto view = MapViewOfFile(FileMap, FILE_MAP_READ, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), len);
+    if (view == nullptr) {
+      ec = bela::make_system_error_code(L"MapViewOfFile: ");
+      return false;
+    }
+    Blake3Update(hasher, reinterpret_cast<const uint8_t *>(view), len);
+    UnmapViewOfFile(view);
+  }
+  hv = hasher.Finalize();
+  return true;
+}
 
 template <typename Hasher> struct Sumizer {
   Hasher hasher;
@@ -87,9 +184,11 @@ std::optional<std::wstring> FileHash(std::wstring_view file, hash_t method, bela
     return sumizer(file, ec);
   }
   case hash_t::BLAKE3: {
-    Sumizer<bela::hash::blake3::Hasher> sumizer;
-    sumizer.hasher.Initialize();
-    return sumizer(file, ec);
+    std::wstring hv;
+    if (blake3checksum(file, hv, ec)) {
+      return std::make_optional(std::move(hv));
+    }
+    return std::nullopt;
   }
   default:
     break;
@@ -114,35 +213,106 @@ constexpr HashPrefix hnmaps[] = {
     {L"SHA3-512", hash_t::SHA3_512}, // SHA3-512
     {L"SHA3", hash_t::SHA3},         // SHA3 alias for SHA3-256
 };
+bool ResolveHashValue(std::wstring_view hashvalue, hash_t &method, std::wstring_view &value, bela::error_code &ec) {
+  value = hashvalue;
+  method = hash_t::SHA256;
+  auto pos = hashvalue.find(':');
+  if (pos == std::wstring_view::npos) {
+    return true;
+  }
+  value = hashvalue.substr(pos + 1);
+  auto prefix = bela::AsciiStrToUpper(hashvalue.substr(0, pos));
+  for (const auto &h : hnmaps) {
+    if (h.prefix == prefix) {
+      method = h.method;
+      return true;
+    }
+  }
+  ec = bela::make_error_code(bela::ErrGeneral, L"unsupported hash method '", prefix, L"'");
+  return false;
+}
+
+bool DigestEqual(std::wstring_view digest, std::wstring_view value, bela::error_code &ec) {
+  if (!bela::EndsWithIgnoreCase(digest, value)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"checksum mismatch expected ", value, L" actual ", digest);
+    return false;
+  }
+  return true;
+}
+
+template <typename H> class HasherImpl final : public Hasher {
+public:
+  H hasher;
+  void Update(const void *data, size_t len) override { hasher.Update(data, len); }
+  std::wstring Finalize() override { return hasher.Finalize(); }
+};
+
+std::unique_ptr<Hasher> NewHasher(hash_t method) {
+  switch (method) {
+  case hash_t::SHA224: {
+    auto h = std::make_unique<HasherImpl<bela::hash::sha256::Hasher>>();
+    h->hasher.Initialize(bela::hash::sha256::HashBits::SHA224);
+    return h;
+  }
+  case hash_t::SHA256: {
+    auto h = std::make_unique<HasherImpl<bela::hash::sha256::Hasher>>();
+    h->hasher.Initialize();
+    return h;
+  }
+  case hash_t::SHA384: {
+    auto h = std::make_unique<HasherImpl<bela::hash::sha512::Hasher>>();
+    h->hasher.Initialize(bela::hash::sha512::HashBits::SHA384);
+    return h;
+  }
+  case hash_t::SHA512: {
+    auto h = std::make_unique<HasherImpl<bela::hash::sha512::Hasher>>();
+    h->hasher.Initialize();
+    return h;
+  }
+  case hash_t::SHA3_224: {
+    auto h = std::make_unique<HasherImpl<bela::hash::sha3::Hasher>>();
+    h->hasher.Initialize(bela::hash::sha3::HashBits::SHA3224);
+    return h;
+  }
+  case hash_t::SHA3_256:
+    [[fallthrough]];
+  case hash_t::SHA3: {
+    auto h = std::make_unique<HasherImpl<bela::hash::sha3::Hasher>>();
+    h->hasher.Initialize();
+    return h;
+  }
+  case hash_t::SHA3_384: {
+    auto h = std::make_unique<HasherImpl<bela::hash::sha3::Hasher>>();
+    h->hasher.Initialize(bela::hash::sha3::HashBits::SHA3384);
+    return h;
+  }
+  case hash_t::SHA3_512: {
+    auto h = std::make_unique<HasherImpl<bela::hash::sha3::Hasher>>();
+    h->hasher.Initialize(bela::hash::sha3::HashBits::SHA3512);
+    return h;
+  }
+  case hash_t::BLAKE3: {
+    auto h = std::make_unique<HasherImpl<bela::hash::blake3::Hasher>>();
+    h->hasher.Initialize();
+    return h;
+  }
+  default:
+    break;
+  }
+  return nullptr;
+}
+
 bool HashEqual(std::wstring_view file, std::wstring_view hashvalue, bela::error_code &ec) {
-  std::wstring_view value = hashvalue;
+  std::wstring_view value;
   auto m = hash_t::SHA256;
-  if (auto pos = hashvalue.find(':'); pos != std::wstring_view::npos) {
-    value = hashvalue.substr(pos + 1);
-    auto prefix = bela::AsciiStrToUpper(hashvalue.substr(0, pos));
-    auto fn = [&]() {
-      for (const auto &h : hnmaps) {
-        if (h.prefix == prefix) {
-          m = h.method;
-          return true;
-        }
-      }
-      return false;
-    };
-    if (!fn()) {
-      ec = bela::make_error_code(bela::ErrGeneral, L"unsupported hash method '", prefix, L"'");
-      return false;
-    }
+  if (!ResolveHashValue(hashvalue, m, value, ec)) {
+    return false;
   }
   auto ha = FileHash(file, m, ec);
   if (!ha) {
     return false;
   }
-  if (!bela::EndsWithIgnoreCase(*ha, value)) {
-    ec = bela::make_error_code(bela::ErrGeneral, L"checksum mismatch expected ", value, L" actual ", *ha);
-    return false;
-  }
-  return true;
+  return DigestEqual(*ha, value, ec);
 }
 
 } // namespace baulk::hash
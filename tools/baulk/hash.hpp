@@ -2,6 +2,8 @@
 #ifndef BAULK_HASH_HPP
 #define BAULK_HASH_HPP
 #include <bela/base.hpp>
+#include <bela/hash.hpp>
+#include <memory>
 
 namespace baulk::hash {
 enum class hash_t {
@@ -16,6 +18,21 @@ enum class hash_t {
   SHA3_512, //
   BLAKE3
 };
+// Blake3Update hashes data with complete subtrees compressed on up to jobs threads (0: hardware concurrency).
+// The hasher must not hold a partial chunk, callers feed data at offsets aligned to the subtree size.
+void Blake3Update(bela::hash::blake3::Hasher &hasher, const uint8_t *data, size_t len, int jobs = 0);
+// Hasher incremental digest, fed while the data streams in (e.g. during download)
+class Hasher {
+public:
+  virtual ~Hasher() = default;
+  virtual void Update(const void *data, size_t len) = 0;
+  virtual std::wstring Finalize() = 0;
+};
+std::unique_ptr<Hasher> NewHasher(hash_t method);
+// ResolveHashValue splits 'PREFIX:value' checksum, without prefix the method is SHA256
+bool ResolveHashValue(std::wstring_view hashvalue, hash_t &method, std::wstring_view &value, bela::error_code &ec);
+// DigestEqual compares a computed digest with the checksum value
+bool DigestEqual(std::wstring_view digest, std::wstring_view value, bela::error_code &ec);
 bool HashEqual(std::wstring_view file, std::wstring_view hashvalue, bela::error_code &ec);
 std::optional<std::wstring> FileHash(std::wstring_view file, hash_t method, bela::error_code &ec);
 } // namespace baulk::hash
@@ -4,10 +4,31 @@
 #include <bela/ascii.hpp>
 #include <bela/escapeargv.hpp>
 #include <bela/process.hpp>
+#include <bela/path.hpp>
+#include <bela/codecvt.hpp>
 #include "indicators.hpp"
 
 namespace baulk {
 
+// ShowEntry progress line of an extracted entry, long names shrink to their base name cut to the terminal width
+void ShowEntry(const bela::terminal::terminal_size &termsz, std::wstring_view filename) {
+  if (termsz.columns <= 8) {
+    return;
+  }
+  auto suglen = static_cast<size_t>(termsz.columns) - 8;
+  if (auto n = bela::StringWidth(filename); n <= suglen) {
+    bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx %s\x1b[0m", filename);
+    return;
+  }
+  auto basename = bela::BaseName(filename);
+  auto n = bela::StringWidth(basename);
+  if (n <= suglen) {
+    bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx ...\\%s\x1b[0m", basename);
+    return;
+  }
+  bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx ...%s\x1b[0m", basename.substr(n - suglen));
+}
+
 // CygwinTerminalSize resolve cygwin terminal size use stty,
 // When running under Cygwin terminal, stty should be available
 bool CygwinTerminalSize(bela::terminal::terminal_size &termsz) {
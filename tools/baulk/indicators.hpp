@@ -87,6 +87,8 @@ private:
   void Draw();
 };
 bool CygwinTerminalSize(bela::terminal::terminal_size &termsz);
+// ShowEntry progress line of an extracted entry, long names shrink to their base name cut to the terminal width
+void ShowEntry(const bela::terminal::terminal_size &termsz, std::wstring_view filename);
 } // namespace baulk
 
 #endif
@@ -8,14 +8,60 @@
 #include <bela/str_split.hpp>
 #include <time.hpp>
 #include <jsonex.hpp>
+#include <linkmeta.hpp>
 #include "launcher.hpp"
 #include "fs.hpp"
 #include "rcwriter.hpp"
+#include "stub.hpp"
 // template
 #include "launcher.template.ipp"
 
 namespace baulk {
 
+bool LinkTargetIsConsole(std::wstring_view pkg, std::wstring_view path) {
+  auto target = bela::StringCat(baulk::BaulkRoot(), L"\\bin\\pkgs\\", pkg, L"\\", path);
+  bela::error_code ec;
+  auto realtarget = bela::RealPathEx(target, ec);
+  if (!realtarget) {
+    return true;
+  }
+  return bela::pe::IsSubsystemConsole(*realtarget);
+}
+
+// BaulkLinkMetaCompile write baulk.linkmeta.bin, baulk-lnk maps it instead of parsing baulk.linkmeta.json
+bool BaulkLinkMetaCompile(const nlohmann::json &links, bela::error_code &ec) {
+  auto table = bela::StringCat(baulk::BaulkRoot(), L"\\", baulk::BaulkLinkDir, L"\\", linkmeta::LinkMetaTableName);
+  std::vector<std::wstring> values;
+  std::vector<linkmeta::Link> entries;
+  try {
+    values.reserve(links.size() * 2);
+    for (const auto &item : links.items()) {
+      if (!item.value().is_string()) {
+        continue;
+      }
+      auto &alias = values.emplace_back(bela::ToWide(item.key()));
+      auto &value = values.emplace_back(bela::ToWide(item.value().get<std::string>()));
+      std::vector<std::wstring_view> mv = bela::StrSplit(value, bela::ByChar('@'), bela::SkipEmpty());
+      if (mv.size() < 2) {
+        continue;
+      }
+      entries.emplace_back(linkmeta::Link{alias, mv[0], mv[1], LinkTargetIsConsole(mv[0], mv[1])});
+    }
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::ToWide(e.what()));
+    return false;
+  }
+  auto buffer = linkmeta::Encode(std::move(entries));
+  if (buffer.empty()) {
+    // baulk-lnk falls back to baulk.linkmeta.json
+    DbgPrint(L"unable build link table, remove %s", table);
+    std::error_code e;
+    std::filesystem::remove(table, e);
+    return true;
+  }
+  return bela::io::WriteTextAtomic(buffer, table, ec);
+}
+
 bool BaulkLinkMetaStore(const std::vector<LinkMeta> &metas, const Package &pkg, bela::error_code &ec) {
   if (metas.empty()) {
     return true;
@@ -58,7 +104,10 @@ bool BaulkLinkMetaStore(const std::vector<LinkMeta> &metas, const Package &pkg,
   if (newjson.empty()) {
     return true;
   }
-  return bela::io::WriteTextAtomic(newjson, linkmeta, ec);
+  if (!bela::io::WriteTextAtomic(newjson, linkmeta, ec)) {
+    return false;
+  }
+  return BaulkLinkMetaCompile(obj["links"], ec);
 }
 
 bool BaulkRemovePkgLinks(std::wstring_view pkg, bela::error_code &ec) {
@@ -112,7 +161,10 @@ bool BaulkRemovePkgLinks(std::wstring_view pkg, bela::error_code &ec) {
   if (newjson.empty()) {
     return true;
   }
-  return bela::io::WriteTextAtomic(newjson, linkmeta, ec);
+  if (!bela::io::WriteTextAtomic(newjson, linkmeta, ec)) {
+    return false;
+  }
+  return BaulkLinkMetaCompile(obj["links"], ec);
 }
 
 // GenerateLinkSource generate link sources
@@ -183,6 +235,32 @@ inline void StringNonEmpty(std::wstring &s, std::wstring_view d) {
   }
 }
 
+// LauncherVersion version metadata of the launcher, taken from the target and completed with package metadata
+bela::pe::Version LauncherVersion(const baulk::Package &pkg, std::wstring_view source, const baulk::LinkMeta &lm) {
+  bela::error_code ec;
+  if (auto vi = bela::pe::Lookup(source, ec); vi) {
+    if (vi->CompanyName.empty()) {
+      vi->CompanyName = bela::StringCat(pkg.name, L" contributors");
+    }
+    StringNonEmpty(vi->FileDescription, pkg.description);
+    StringNonEmpty(vi->FileVersion, pkg.version);
+    StringNonEmpty(vi->ProductVersion, pkg.version);
+    StringNonEmpty(vi->ProductName, pkg.name);
+    StringNonEmpty(vi->OriginalFileName, lm.alias);
+    StringNonEmpty(vi->InternalName, lm.alias);
+    return std::move(*vi);
+  }
+  bela::pe::Version nvi;
+  nvi.CompanyName = bela::StringCat(pkg.name, L" contributors");
+  nvi.FileDescription = pkg.description;
+  nvi.FileVersion = pkg.version;
+  nvi.ProductVersion = pkg.version;
+  nvi.ProductName = pkg.name;
+  nvi.OriginalFileName = lm.alias;
+  nvi.InternalName = lm.alias;
+  return nvi;
+}
+
 bool LinkExecutor::Compile(const baulk::Package &pkg, std::wstring_view source, std::wstring_view linkdir,
                            const baulk::LinkMeta &lm, bela::error_code &ec) {
   constexpr const std::wstring_view entry[] = {L"-ENTRY:wmain", L"-ENTRY:wWinMain"};
@@ -201,31 +279,9 @@ bool LinkExecutor::Compile(const baulk::Package &pkg, std::wstring_view source,
   if (!bela::io::WriteText(GenerateLinkSource(source, isConsole), cxxsrc, ec)) {
     return false;
   }
-  bool rcwrited = false;
-  if (auto vi = bela::pe::Lookup(source, ec); vi) {
-    baulk::rc::Writer w;
-    if (vi->CompanyName.empty()) {
-      vi->CompanyName = bela::StringCat(pkg.name, L" contributors");
-    }
-    StringNonEmpty(vi->FileDescription, pkg.description);
-    StringNonEmpty(vi->FileVersion, pkg.version);
-    StringNonEmpty(vi->ProductVersion, pkg.version);
-    StringNonEmpty(vi->ProductName, pkg.name);
-    StringNonEmpty(vi->OriginalFileName, lm.alias);
-    StringNonEmpty(vi->InternalName, lm.alias);
-    rcwrited = w.WriteVersion(*vi, rcsrc, ec);
-  } else {
-    bela::pe::Version nvi;
-    nvi.CompanyName = bela::StringCat(pkg.name, L" contributors");
-    nvi.FileDescription = pkg.description;
-    nvi.FileVersion = pkg.version;
-    nvi.ProductVersion = pkg.version;
-    nvi.ProductName = pkg.name;
-    nvi.OriginalFileName = lm.alias;
-    nvi.InternalName = lm.alias;
-    baulk::rc::Writer w;
-    rcwrited = w.WriteVersion(nvi, rcsrc, ec);
-  }
+  baulk::rc::Writer w;
+  auto vi = LauncherVersion(pkg, source, lm);
+  bool rcwrited = w.WriteVersion(vi, rcsrc, ec);
   if (rcwrited) {
     if (baulk::BaulkExecutor().Execute(baulktemp, L"rc", L"-nologo", L"-c65001", rcsrcname) != 0) {
       rcwrited = false;
@@ -268,6 +324,87 @@ bool LinkExecutor::Compile(const baulk::Package &pkg, std::wstring_view source,
   return true;
 }
 
+// prebuilt launcher templates installed next to baulk.exe
+struct LauncherStubs {
+  std::wstring console;
+  std::wstring windows;
+  static std::optional<LauncherStubs> Lookup() {
+    LauncherStubs stubs;
+    stubs.console = bela::StringCat(baulk::BaulkRoot(), L"\\bin\\baulk-stub-console.exe");
+    stubs.windows = bela::StringCat(baulk::BaulkRoot(), L"\\bin\\baulk-stub-windows.exe");
+    if (!bela::PathExists(stubs.console) || !bela::PathExists(stubs.windows)) {
+      return std::nullopt;
+    }
+    return std::make_optional(std::move(stubs));
+  }
+};
+
+inline bool ReadImage(std::wstring_view file, std::string &image, bela::error_code &ec) {
+  FILE *fd = nullptr;
+  if (auto en = _wfopen_s(&fd, file.data(), L"rb"); en != 0) {
+    ec = bela::make_stdc_error_code(en);
+    return false;
+  }
+  auto closer = bela::finally([&] { fclose(fd); });
+  char buffer[16384];
+  size_t n = 0;
+  while ((n = fread(buffer, 1, sizeof(buffer), fd)) != 0) {
+    image.append(buffer, n);
+  }
+  return true;
+}
+
+// MakeStubLauncher copy stub to linkdir, patch target slot and version resource
+bool MakeStubLauncher(const baulk::Package &pkg, const LauncherStubs &stubs, std::wstring_view source,
+                      std::wstring_view linkdir, const baulk::LinkMeta &lm, bela::error_code &ec) {
+  auto realexe = bela::RealPathEx(source, ec);
+  if (!realexe) {
+    return false;
+  }
+  auto isConsole = bela::pe::IsSubsystemConsole(*realexe);
+  DbgPrint(L"executable %s is subsystem console: %v\n", *realexe, isConsole);
+  std::string image;
+  if (!ReadImage(isConsole ? stubs.console : stubs.windows, image, ec)) {
+    return false;
+  }
+  baulk::stub::StubPatcher patcher(image);
+  if (!patcher.Parse(ec) || !patcher.PatchTarget(source, ec)) {
+    return false;
+  }
+  baulk::rc::VersionEncoder encoder;
+  if (bela::error_code vec; !patcher.PatchVersion(encoder.Encode(LauncherVersion(pkg, source, lm)), vec)) {
+    // launcher still works, explorer shows the stub's metadata
+    DbgPrint(L"launcher %s keep stub version: %s", lm.alias, vec.message);
+  }
+  return bela::io::WriteTextAtomic(image, bela::StringCat(linkdir, L"\\", lm.alias), ec);
+}
+
+bool MakeStubLaunchers(const baulk::Package &pkg, const LauncherStubs &stubs, bela::error_code &ec) {
+  auto pkgroot = bela::StringCat(baulk::BaulkRoot(), L"\\", BaulkPkgsDir, L"\\", pkg.name);
+  auto linkdir = bela::StringCat(baulk::BaulkRoot(), L"\\", BaulkLinkDir);
+  if (!baulk::fs::MakeDir(linkdir, ec)) {
+    return false;
+  }
+  std::vector<LinkMeta> linkmetas;
+  for (const auto &lm : pkg.launchers) {
+    auto source = bela::PathCat(pkgroot, L"\\", lm.path);
+    DbgPrint(L"make launcher %s from stub", source);
+    if (!MakeStubLauncher(pkg, stubs, source, linkdir, lm, ec)) {
+      bela::FPrintF(stderr, L"'%s' unable create launcher: \x1b[31m%s\x1b[0m\n", source, ec.message);
+      continue;
+    }
+    linkmetas.emplace_back(lm);
+  }
+  if (!BaulkLinkMetaStore(linkmetas, pkg, ec)) {
+    bela::FPrintF(stderr,
+                  L"%s create links error: %s\nYour can run 'baulk uninstall' "
+                  L"and retry\n",
+                  pkg.name, ec.message);
+    return false;
+  }
+  return true;
+}
+
 bool MakeLaunchers(const baulk::Package &pkg, bool forceoverwrite, bela::error_code &ec) {
   auto pkgroot = bela::StringCat(baulk::BaulkRoot(), L"\\", BaulkPkgsDir, L"\\", pkg.name);
   auto linkdir = bela::StringCat(baulk::BaulkRoot(), L"\\", BaulkLinkDir);
@@ -380,6 +517,10 @@ bool BaulkMakePkgLinks(const baulk::Package &pkg, bool forceoverwrite, bela::err
   if (pkg.launchers.empty()) {
     return true;
   }
+  // patching prebuilt stubs needs no Visual C++ toolchain and takes milliseconds
+  if (auto stubs = LauncherStubs::Lookup(); stubs) {
+    return MakeStubLaunchers(pkg, *stubs, ec);
+  }
   if (!baulk::BaulkExecutor().Initialized()) {
     return MakeSimulatedLauncher(pkg, forceoverwrite, ec);
   }
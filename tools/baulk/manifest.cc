@@ -0,0 +1,192 @@
+//
+#include <bela/base.hpp>
+#include <bela/fs.hpp>
+#include <bela/io.hpp>
+#include <jsonex.hpp>
+#include <algorithm>
+#include <filesystem>
+#include "baulk.hpp"
+#include "fs.hpp"
+#include "manifest.hpp"
+
+namespace baulk::manifest {
+constexpr std::string_view kindNames[] = {"zip", "tar"};
+
+inline bool fileStat(std::wstring_view path, int64_t &size, int64_t &ticks) {
+  WIN32_FILE_ATTRIBUTE_DATA fa;
+  if (GetFileAttributesExW(path.data(), GetFileExInfoStandard, &fa) != TRUE ||
+      (fa.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT)) != 0) {
+    return false;
+  }
+  size = (static_cast<int64_t>(fa.nFileSizeHigh) << 32) | fa.nFileSizeLow;
+  ticks = (static_cast<int64_t>(fa.ftLastWriteTime.dwHighDateTime) << 32) | fa.ftLastWriteTime.dwLowDateTime;
+  return true;
+}
+
+inline std::wstring installedPath(std::wstring_view pkgdir, std::string_view path) {
+  auto p = bela::StringCat(pkgdir, L"\\", bela::ToWide(path));
+  std::replace(p.begin() + pkgdir.size(), p.end(), L'/', L'\\');
+  return p;
+}
+
+// stripPath path without its first n components, empty when it has no more
+inline std::string_view stripPath(std::string_view path, int n) {
+  for (int i = 0; i < n; i++) {
+    auto pos = path.find('/');
+    if (pos == std::string_view::npos) {
+      return {};
+    }
+    path.remove_prefix(pos + 1);
+  }
+  return path;
+}
+
+std::wstring Manifest::file() const {
+  return bela::StringCat(baulk::BaulkRoot(), L"\\bin\\locks\\", pkgname, L".files");
+}
+
+// relative path below outdir, '/' separated
+std::string Manifest::relative(std::wstring_view path) const {
+  if (path.size() <= outdir.size() + 1 || !path.starts_with(outdir)) {
+    return {};
+  }
+  auto p = bela::ToNarrow(path.substr(outdir.size() + 1));
+  std::replace(p.begin(), p.end(), '\\', '/');
+  return p;
+}
+
+bool Manifest::Load(bela::error_code &ec) {
+  auto mf = file();
+  FILE *fd = nullptr;
+  if (auto en = _wfopen_s(&fd, mf.data(), L"rb"); en != 0) {
+    ec = bela::make_stdc_error_code(en);
+    return false;
+  }
+  auto closer = bela::finally([&] { fclose(fd); });
+  try {
+    auto j = nlohmann::json::parse(fd);
+    if (j.value("kind", "") != kindNames[static_cast<int>(kind)]) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"manifest of another archive format");
+      return false;
+    }
+    strip = j.value("strip", 0);
+    const auto &files = j.at("files");
+    installed.reserve(files.size());
+    for (const auto &e : files) {
+      // [path, size, key, ticks]
+      auto path = e.at(0).get<std::string>();
+      installed.emplace(path, Entry{path, e.at(1).get<int64_t>(), e.at(2).get<uint64_t>(), e.at(3).get<int64_t>()});
+    }
+  } catch (const std::exception &e) {
+    installed.clear();
+    ec = bela::make_error_code(bela::ErrGeneral, bela::ToWide(e.what()));
+    return false;
+  }
+  return true;
+}
+
+std::optional<std::wstring> Manifest::Source(std::wstring_view path, int64_t size, uint64_t key) const {
+  auto rel = relative(path);
+  auto it = installed.find(std::string(stripPath(rel, strip)));
+  if (it == installed.end() || it->second.size != size || it->second.key != key) {
+    return std::nullopt;
+  }
+  auto source = installedPath(pkgdir, it->first);
+  int64_t fsize = 0;
+  int64_t ticks = 0;
+  // modified after the install
+  if (!fileStat(source, fsize, ticks) || fsize != size || ticks != it->second.ticks) {
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(source));
+}
+
+bool Manifest::Reuse(std::wstring_view path, int64_t size, uint64_t key) {
+  auto source = Source(path, size, key);
+  if (!source) {
+    return false;
+  }
+  bela::error_code ec;
+  if (!baulk::fs::MakeParentDir(path, ec)) {
+    return false;
+  }
+  // another volume or a file system without hard links: extract it
+  if (CreateHardLinkW(path.data(), source->data(), nullptr) != TRUE) {
+    DbgPrint(L"link %s to %s: %s", *source, path, bela::make_system_error_code().message);
+    return false;
+  }
+  linked.emplace(baulk::fs::PathKey(path));
+  Linked(size);
+  return true;
+}
+
+void Manifest::Release(std::wstring_view path) {
+  if (linked.empty()) {
+    return;
+  }
+  if (auto it = linked.find(baulk::fs::PathKey(path)); it != linked.end()) {
+    DeleteFileW(path.data());
+    linked.erase(it);
+  }
+}
+
+void Manifest::Record(std::wstring_view path, int64_t size, uint64_t key) {
+  auto rel = relative(path);
+  recorded.insert_or_assign(rel, Entry{rel, size, key, 0});
+}
+
+bool Manifest::Remove(bela::error_code &ec) { return bela::fs::Remove(file(), ec); }
+
+// Save walks the installed package, zip files take the key recorded for them and files without one are left out
+bool Manifest::Save(std::wstring_view flattened, bela::error_code &ec) {
+  std::string prefix;
+  int depth = 0;
+  if (!flattened.empty()) {
+    prefix = bela::ToNarrow(flattened);
+    std::replace(prefix.begin(), prefix.end(), '\\', '/');
+    depth = static_cast<int>(std::count(prefix.begin(), prefix.end(), '/')) + 1;
+    prefix.push_back('/');
+  }
+  try {
+    auto files = nlohmann::json::array();
+    std::error_code e;
+    for (auto it = std::filesystem::recursive_directory_iterator(pkgdir, e);
+         it != std::filesystem::recursive_directory_iterator(); it.increment(e)) {
+      if (e) {
+        break;
+      }
+      auto p = it->path().wstring();
+      auto path = bela::ToNarrow(std::wstring_view(p).substr(pkgdir.size() + 1));
+      std::replace(path.begin(), path.end(), '\\', '/');
+      int64_t size = 0;
+      int64_t ticks = 0;
+      // directories and symlinks
+      if (!fileStat(p, size, ticks)) {
+        continue;
+      }
+      uint64_t key = 0;
+      if (kind == Kind::Zip) {
+        auto r = recorded.find(bela::StringCat(prefix, path));
+        // renamed or replaced after extraction
+        if (r == recorded.end() || r->second.size != size) {
+          continue;
+        }
+        key = r->second.key;
+      }
+      files.emplace_back(nlohmann::json::array({path, size, key, ticks}));
+    }
+    if (e) {
+      ec = bela::make_error_code(bela::ErrGeneral, bela::ToWide(e.message()));
+      return false;
+    }
+    nlohmann::json j;
+    j["kind"] = std::string(kindNames[static_cast<int>(kind)]);
+    j["strip"] = depth;
+    j["files"] = std::move(files);
+    return bela::io::WriteTextAtomic(j.dump(), file(), ec);
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::ToWide(e.what()));
+  }
+  return false;
+}
+} // namespace baulk::manifest
@@ -0,0 +1,72 @@
+//
+#ifndef BAULK_MANIFEST_HPP
+#define BAULK_MANIFEST_HPP
+#include <bela/base.hpp>
+#include <bela/phmap.hpp>
+#include <optional>
+
+namespace baulk::manifest {
+// Kind archive format of the recorded keys, a manifest of another format is ignored
+enum class Kind : int { Zip = 0, Tar = 1 };
+
+// Entry regular file of a package
+struct Entry {
+  std::string path; // '/' separated, relative to the package root once installed
+  int64_t size{0};
+  uint64_t key{0};  // crc32 of zip entries, 0 for tar entries
+  int64_t ticks{0}; // last write time of the installed file (FILETIME), unchanged since the install
+};
+
+// Manifest regular files of the package installed in bin\pkgs\<name>, saved as bin\locks\<name>.files. Upgrades link
+// the installed files identical to an archive entry into the new package instead of extracting them again, only new
+// and changed entries are written and files missing from the new archive go away with the old package directory.
+// An entry matches the installed file at the same path below the top level directories Regularize flattened, with
+// the same size and key. Tar headers carry no checksum, the extractor compares tar entries with the installed file
+// while decoding them. Extractors call Source, Reuse, Release and Record from the thread reading the archive.
+class Manifest {
+public:
+  Manifest(std::wstring_view pkgname_, std::wstring_view pkgdir_, std::wstring_view outdir_, Kind kind_)
+      : pkgname(pkgname_), pkgdir(pkgdir_), outdir(outdir_), kind(kind_) {}
+  Manifest(const Manifest &) = delete;
+  Manifest &operator=(const Manifest &) = delete;
+  // Load the manifest of the installed package, false when there is none or it has another kind
+  bool Load(bela::error_code &ec);
+  // Source installed file matching the entry extracted to path, unmodified since the install
+  std::optional<std::wstring> Source(std::wstring_view path, int64_t size, uint64_t key) const;
+  // Reuse hard link Source to path, false when the entry must be extracted
+  bool Reuse(std::wstring_view path, int64_t size, uint64_t key);
+  // Release remove the link Reuse created at path before another entry is written there, writing through it would
+  // change the installed package
+  void Release(std::wstring_view path);
+  // Linked count a file the extractor linked to a Source
+  void Linked(int64_t size) {
+    reused++;
+    reusedBytes += size;
+  }
+  // Record the key of a regular file extracted to path
+  void Record(std::wstring_view path, int64_t size, uint64_t key);
+  // Save the manifest of the new package once it replaced the installed one, the old manifest is replaced atomically.
+  // flattened is the directory Regularize moved to the package root.
+  bool Save(std::wstring_view flattened, bela::error_code &ec);
+  // Remove the manifest of the installed package when the new one cannot be saved
+  bool Remove(bela::error_code &ec);
+  size_t Reused() const { return reused; }
+  int64_t ReusedBytes() const { return reusedBytes; }
+
+private:
+  std::wstring pkgname;
+  std::wstring pkgdir;
+  std::wstring outdir;
+  bela::flat_hash_map<std::string, Entry> installed; // by path
+  bela::flat_hash_map<std::string, Entry> recorded;  // by path relative to outdir
+  bela::flat_hash_set<std::wstring> linked;          // paths Reuse linked, lower case
+  int strip{0};                                      // directories flattened out of the installed package
+  size_t reused{0};
+  int64_t reusedBytes{0};
+  Kind kind;
+  std::wstring file() const;
+  std::string relative(std::wstring_view path) const;
+};
+} // namespace baulk::manifest
+
+#endif
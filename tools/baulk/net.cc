@@ -61,10 +61,16 @@ public:
     if (WriteFile(FileHandle, data, len, &dwlen, nullptr) != TRUE) {
       return false;
     }
+    if (hasher != nullptr) {
+      // data is still hot in cache, avoid re-reading the file after download
+      hasher->Update(data, dwlen);
+    }
     return len == dwlen;
   }
-  static std::optional<FilePart> MakeFilePart(std::wstring_view p, bela::error_code &ec) {
+  static std::optional<FilePart> MakeFilePart(std::wstring_view p, baulk::hash::Hasher *hasher,
+                                              bela::error_code &ec) {
     FilePart file;
+    file.hasher = hasher;
     file.path = bela::PathAbsolute(p); // Path cleanup
     auto part = bela::StringCat(file.path, L".part");
     file.FileHandle = ::CreateFileW(part.data(), FILE_GENERIC_READ | FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr,
@@ -78,6 +84,7 @@ public:
 
 private:
   HANDLE FileHandle{INVALID_HANDLE_VALUE};
+  baulk::hash::Hasher *hasher{nullptr};
   std::wstring path;
   void transfer_ownership(FilePart &&other) {
     if (FileHandle != INVALID_HANDLE_VALUE) {
@@ -85,6 +92,8 @@ private:
     }
     FileHandle = other.FileHandle;
     other.FileHandle = INVALID_HANDLE_VALUE;
+    hasher = other.hasher;
+    other.hasher = nullptr;
     path = other.path;
     other.path.clear();
   }
@@ -405,6 +414,15 @@ std::optional<Response> HttpClient::WinRest(std::wstring_view method, std::wstri
 
 std::optional<std::wstring> WinGet(std::wstring_view url, std::wstring_view workdir, bool forceoverwrite,
                                    bela::error_code &ec) {
+  auto d = WinGet(url, workdir, nullptr, forceoverwrite, ec);
+  if (!d) {
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(d->path));
+}
+
+std::optional<Downloaded> WinGet(std::wstring_view url, std::wstring_view workdir, baulk::hash::Hasher *hasher,
+                                 bool forceoverwrite, bela::error_code &ec) {
   HINTERNET hSession = nullptr;
   HINTERNET hConnect = nullptr;
   HINTERNET hRequest = nullptr;
@@ -490,7 +508,10 @@ std::optional<std::wstring> WinGet(std::wstring_view url, std::wstring_view work
   dwSize = 0;
   std::vector<char> buffer;
   buffer.reserve(64 * 1024);
-  auto file = FilePart::MakeFilePart(dest, ec);
+  auto file = FilePart::MakeFilePart(dest, hasher, ec);
+  if (!file) {
+    return std::nullopt;
+  }
   bar.FileName(uc.filename);
   bar.Execute();
   auto finish = bela::finally([&] {
@@ -512,7 +533,11 @@ std::optional<std::wstring> WinGet(std::wstring_view url, std::wstring_view work
       bar.MarkFault();
       return std::nullopt;
     }
-    file->Write(buffer.data(), downloaded_size);
+    if (!file->Write(buffer.data(), downloaded_size)) {
+      ec = bela::make_system_error_code(L"write download file: ");
+      bar.MarkFault();
+      return std::nullopt;
+    }
     total_downloaded_size += downloaded_size;
     bar.Update(total_downloaded_size);
   } while (dwSize > 0);
@@ -524,7 +549,11 @@ std::optional<std::wstring> WinGet(std::wstring_view url, std::wstring_view work
   }
   file->Finish();
   bar.MarkCompleted();
-  return std::make_optional(std::move(dest));
+  Downloaded d{std::move(dest)};
+  if (hasher != nullptr) {
+    d.hashvalue = hasher->Finalize();
+  }
+  return std::make_optional(std::move(d));
 }
 
 constexpr auto MaximumTime = (std::numeric_limits<std::uint64_t>::max)();
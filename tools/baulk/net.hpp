@@ -6,6 +6,7 @@
 #include <bela/ascii.hpp>
 #include <bela/phmap.hpp>
 #include <chrono>
+#include "hash.hpp"
 
 namespace baulk::net {
 using BAULKSOCK = UINT_PTR;
@@ -110,6 +111,13 @@ inline std::optional<Response> RestGet(std::wstring_view url, bela::error_code &
 // download some file to spec workdir
 std::optional<std::wstring> WinGet(std::wstring_view url, std::wstring_view workdir, bool forceoverwrite,
                                    bela::error_code &ec);
+struct Downloaded {
+  std::wstring path;
+  std::wstring hashvalue; // digest computed while downloading, empty without hasher
+};
+// download some file to spec workdir, every received block is fed to hasher (optional)
+std::optional<Downloaded> WinGet(std::wstring_view url, std::wstring_view workdir, baulk::hash::Hasher *hasher,
+                                 bool forceoverwrite, bela::error_code &ec);
 std::uint64_t UrlResponseTime(std::wstring_view url);
 std::wstring_view BestUrl(const std::vector<std::wstring> &urls);
 std::wstring_view UrlFileName(std::wstring_view url);
@@ -13,6 +13,7 @@
 #include "hash.hpp"
 #include "fs.hpp"
 #include "decompress.hpp"
+#include "manifest.hpp"
 
 namespace baulk::package {
 
@@ -94,6 +95,38 @@ std::optional<std::wstring> PackageCached(std::wstring_view filename, std::wstri
   return std::make_optional(std::move(pkgfile));
 }
 
+// PackageDownload download package, the checksum is computed while downloading and retried once on mismatch
+std::optional<std::wstring> PackageDownload(std::wstring_view url, std::wstring_view pkgtmpdir,
+                                            std::wstring_view checksum) {
+  bela::error_code ec;
+  if (checksum.empty()) {
+    auto pkgfile = baulk::net::WinGet(url, pkgtmpdir, true, ec);
+    if (!pkgfile) {
+      bela::FPrintF(stderr, L"baulk get %s: \x1b[31m%s\x1b[0m\n", url, ec.message);
+    }
+    return pkgfile;
+  }
+  auto method = baulk::hash::hash_t::SHA256;
+  std::wstring_view value;
+  if (!baulk::hash::ResolveHashValue(checksum, method, value, ec)) {
+    bela::FPrintF(stderr, L"baulk get %s: \x1b[31m%s\x1b[0m\n", url, ec.message);
+    return std::nullopt;
+  }
+  for (int i = 0; i < 2; i++) {
+    auto hasher = baulk::hash::NewHasher(method);
+    auto d = baulk::net::WinGet(url, pkgtmpdir, hasher.get(), true, ec);
+    if (!d) {
+      bela::FPrintF(stderr, L"baulk get %s: \x1b[31m%s\x1b[0m\n", url, ec.message);
+      return std::nullopt;
+    }
+    if (baulk::hash::DigestEqual(d->hashvalue, value, ec)) {
+      return std::make_optional(std::move(d->path));
+    }
+    bela::FPrintF(stderr, L"baulk get %s: \x1b[31m%s\x1b[0m\n", url, ec.message);
+  }
+  return std::nullopt;
+}
+
 int PackageMakeLinks(const baulk::Package &pkg) {
   if (!pkg.venv.mkdirs.empty()) {
     bela::env::Simulator sim;
@@ -159,17 +192,45 @@ int PackageExpand(const baulk::Package &pkg, std::wstring_view pkgfile) {
     return 1;
   }
   auto outdir = UnarchivePath(pkgfile);
+  auto pkgdir = bela::StringCat(baulk::BaulkRoot(), L"\\bin\\pkgs\\", pkg.name);
   baulk::DbgPrint(L"Decompress %s to %s\n", pkg.name, outdir);
   bela::error_code ec;
   if (bela::PathExists(outdir)) {
     bela::fs::RemoveAll(outdir, ec);
   }
-  if (!h->decompress(pkgfile, outdir, ec)) {
+  // incremental: unchanged files of the installed package are linked into outdir, the swap below stays atomic.
+  // First installs and --force extract everything and only record the manifest for the next upgrade, --force
+  // repairs a modified installation.
+  std::optional<baulk::manifest::Manifest> manifest;
+  auto incremental = false;
+  if (h->incremental != nullptr) {
+    manifest.emplace(pkg.name, pkgdir, outdir, h->kind);
+    bela::error_code lec;
+    if (!baulk::IsForceMode && bela::PathExists(pkgdir) && !(incremental = manifest->Load(lec))) {
+      baulk::DbgPrint(L"%s no incremental upgrade: %s", pkg.name, lec.message);
+    }
+  }
+  auto decompressed = incremental ? h->incremental(pkgfile, outdir, *manifest, ec) : h->decompress(pkgfile, outdir, ec);
+  if (!decompressed) {
     bela::FPrintF(stderr, L"baulk decompress %s error: %s\n", pkgfile, ec.message);
     return 1;
   }
-  h->regularize(outdir);
-  auto pkgdir = bela::StringCat(baulk::BaulkRoot(), L"\\bin\\pkgs\\", pkg.name);
+  if (manifest && !incremental && h->record != nullptr) {
+    // files without a recorded key are left out of the manifest, the next upgrade extracts them
+    if (bela::error_code rec; !h->record(pkgfile, outdir, *manifest, rec)) {
+      baulk::DbgPrint(L"%s record manifest: %s", pkg.name, rec.message);
+    }
+  }
+  std::wstring flattened;
+  if (manifest) {
+    baulk::standard::Regularize(outdir, flattened);
+    if (manifest->Reused() != 0) {
+      bela::FPrintF(stderr, L"baulk reuse \x1b[32m%d\x1b[0m unchanged files (%d bytes) of %s\n", manifest->Reused(),
+                    manifest->ReusedBytes(), pkg.name);
+    }
+  } else {
+    h->regularize(outdir);
+  }
   std::wstring pkgold;
   std::error_code e;
   if (bela::PathExists(pkgdir)) {
@@ -208,6 +269,12 @@ int PackageExpand(const baulk::Package &pkg, std::wstring_view pkgfile) {
   if (!pkgold.empty()) {
     bela::fs::RemoveAll(pkgold, ec);
   }
+  // the manifest of the installed package is replaced once the new package is in place, a failed swap keeps it
+  if (manifest && !manifest->Save(flattened, ec)) {
+    bela::FPrintF(stderr, L"baulk unable write %s manifest: %s\n", pkg.name, ec.message);
+    // the old manifest must not describe the new files
+    manifest->Remove(ec);
+  }
   // create a links
   if (!PackageLocalMetaWrite(pkg, ec)) {
     bela::FPrintF(stderr, L"baulk unable write local meta: %s\n", ec.message);
@@ -279,24 +346,10 @@ int BaulkInstall(const baulk::Package &pkg) {
     bela::FPrintF(stderr, L"baulk unable make %s error: %s\n", pkgtmpdir, ec.message);
     return 1;
   }
-  auto pkgfile = baulk::net::WinGet(url, pkgtmpdir, true, ec);
+  auto pkgfile = PackageDownload(url, pkgtmpdir, pkg.checksum);
   if (!pkgfile) {
-    bela::FPrintF(stderr, L"baulk get %s: \x1b[31m%s\x1b[0m\n", url, ec.message);
     return 1;
   }
-  if (!pkg.checksum.empty() && !baulk::hash::HashEqual(*pkgfile, pkg.checksum, ec)) {
-    bela::FPrintF(stderr, L"baulk get %s: \x1b[31m%s\x1b[0m\n", url, ec.message);
-    // retry download
-    pkgfile = baulk::net::WinGet(url, pkgtmpdir, true, ec);
-    if (!pkgfile) {
-      bela::FPrintF(stderr, L"baulk get %s: \x1b[31m%s\x1b[0m\n", url, ec.message);
-      return 1;
-    }
-    if (!baulk::hash::HashEqual(*pkgfile, pkg.checksum, ec)) {
-      bela::FPrintF(stderr, L"baulk get %s: \x1b[31m%s\x1b[0m\n", url, ec.message);
-      return 1;
-    }
-  }
   if (auto ret = PackageExpand(pkg, *pkgfile); ret != 0) {
     return ret;
   }
@@ -99,6 +99,102 @@ public:
 private:
   std::wstring buffer;
 };
+
+// VersionEncoder build binary VS_VERSIONINFO, the resource data rc.exe would emit for Writer::WriteVersion.
+// https://docs.microsoft.com/en-us/windows/win32/menurc/vs-versioninfo
+class VersionEncoder {
+public:
+  VersionEncoder() { buffer.reserve(2048); }
+  VersionEncoder(const VersionEncoder &) = delete;
+  VersionEncoder &operator=(const VersionEncoder &) = delete;
+  std::string &Encode(const bela::pe::Version &vi) {
+    buffer.clear();
+    auto fvp = MakeVersionPart(vi.FileVersion);
+    auto pvp = MakeVersionPart(vi.ProductVersion);
+    std::wstring legalCopyright;
+    if (vi.LegalCopyright.empty()) {
+      legalCopyright = L"No checked copyright";
+    } else {
+      legalCopyright = bela::StrReplaceAll(vi.LegalCopyright, {{L"(c)", L"\xA9"}, {L"(C)", L"\xA9"}});
+    }
+    auto root = begin(L"VS_VERSION_INFO", 52, 0);
+    dword(0xFEEF04BD); // VS_FIXEDFILEINFO signature
+    dword(0x00010000);
+    dword(versionMS(fvp));
+    dword(versionLS(fvp));
+    dword(versionMS(pvp));
+    dword(versionLS(pvp));
+    dword(0x3f); // FILEFLAGSMASK
+    dword(0);    // FILEFLAGS
+    dword(0x40004);
+    dword(1); // VFT_APP
+    dword(0);
+    dword(0);
+    dword(0);
+    auto sfi = begin(L"StringFileInfo", 0, 1);
+    auto st = begin(L"000904b0", 0, 1);
+    Value(L"CompanyName", vi.CompanyName);
+    Value(L"FileDescription", vi.FileDescription);
+    Value(L"InternalName", vi.InternalName);
+    Value(L"LegalCopyright", legalCopyright);
+    Value(L"OriginalFileName", vi.OriginalFileName);
+    Value(L"ProductName", vi.ProductName);
+    Value(L"ProductVersion", vi.ProductVersion);
+    Value(L"FileVersion", vi.FileVersion);
+    end(st);
+    end(sfi);
+    auto vfi = begin(L"VarFileInfo", 0, 1);
+    auto var = begin(L"Translation", 4, 0);
+    word(0x9);
+    word(1200);
+    end(var);
+    end(vfi);
+    end(root);
+    return buffer;
+  }
+
+private:
+  std::string buffer;
+  static uint32_t versionMS(const VersionPart &vp) {
+    return (static_cast<uint32_t>(vp.MajorPart & 0xFFFF) << 16) | static_cast<uint32_t>(vp.MinorPart & 0xFFFF);
+  }
+  static uint32_t versionLS(const VersionPart &vp) {
+    return (static_cast<uint32_t>(vp.BuildPart & 0xFFFF) << 16) | static_cast<uint32_t>(vp.PrivatePart & 0xFFFF);
+  }
+  void word(uint16_t v) { buffer.append(reinterpret_cast<const char *>(&v), sizeof(v)); }
+  void dword(uint32_t v) { buffer.append(reinterpret_cast<const char *>(&v), sizeof(v)); }
+  void wstr(std::wstring_view s) {
+    for (auto c : s) {
+      word(static_cast<uint16_t>(c));
+    }
+    word(0);
+  }
+  void align() {
+    while (buffer.size() % 4 != 0) {
+      buffer.push_back(0);
+    }
+  }
+  // every block: wLength, wValueLength, wType, szKey, padding to DWORD
+  size_t begin(std::wstring_view key, uint16_t valueLength, uint16_t type) {
+    align();
+    auto pos = buffer.size();
+    word(0);
+    word(valueLength);
+    word(type);
+    wstr(key);
+    align();
+    return pos;
+  }
+  void end(size_t pos) {
+    auto len = static_cast<uint16_t>(buffer.size() - pos);
+    memcpy(buffer.data() + pos, &len, sizeof(len));
+  }
+  void Value(std::wstring_view name, std::wstring_view value) {
+    auto pos = begin(name, static_cast<uint16_t>(value.size() + 1), 1);
+    wstr(value);
+    end(pos);
+  }
+};
 } // namespace baulk::rc
 
 #endif
@@ -0,0 +1,186 @@
+// launcher stub patcher
+#include "stub.hpp"
+
+namespace baulk::stub {
+constexpr uint16_t imageDosSignature = 0x5A4D;   // MZ
+constexpr uint32_t imageNtSignature = 0x00004550; // PE00
+constexpr uint16_t optionalHeader32Magic = 0x10b;
+constexpr uint16_t optionalHeader64Magic = 0x20b;
+constexpr uint32_t resourceDirectoryIndex = 2;
+constexpr uint32_t resourceVersion = 16; // RT_VERSION
+constexpr uint32_t resourceSubdirectory = 0x80000000;
+
+#pragma pack(push, 1)
+struct ResourceDirectory {
+  uint32_t Characteristics;
+  uint32_t TimeDateStamp;
+  uint16_t MajorVersion;
+  uint16_t MinorVersion;
+  uint16_t NumberOfNamedEntries;
+  uint16_t NumberOfIdEntries;
+};
+struct ResourceDirectoryEntry {
+  uint32_t Name;
+  uint32_t OffsetToData;
+};
+struct ResourceDataEntry {
+  uint32_t OffsetToData; // RVA
+  uint32_t Size;
+  uint32_t CodePage;
+  uint32_t Reserved;
+};
+#pragma pack(pop)
+
+bool StubPatcher::Parse(bela::error_code &ec) {
+  bela::pe::DosHeader dh;
+  if (!readAt(0, dh) || dh.e_magic != imageDosSignature) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"stub is not a PE file");
+    return false;
+  }
+  uint32_t signature = 0;
+  bela::pe::FileHeader fh;
+  if (!readAt(dh.e_lfanew, signature) || signature != imageNtSignature ||
+      !readAt(dh.e_lfanew + sizeof(signature), fh)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"stub has no PE header");
+    return false;
+  }
+  auto ohoffset = static_cast<size_t>(dh.e_lfanew) + sizeof(signature) + sizeof(fh);
+  uint16_t magic = 0;
+  if (!readAt(ohoffset, magic)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"stub optional header truncated");
+    return false;
+  }
+  if (magic == optionalHeader64Magic) {
+    bela::pe::OptionalHeader64 oh;
+    if (!readAt(ohoffset, oh) || oh.NumberOfRvaAndSizes <= resourceDirectoryIndex) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"stub optional header truncated");
+      return false;
+    }
+    resource = oh.DataDirectory[resourceDirectoryIndex];
+    subsystem = static_cast<bela::pe::Subsystem>(oh.Subsystem);
+  } else if (magic == optionalHeader32Magic) {
+    bela::pe::OptionalHeader32 oh;
+    if (!readAt(ohoffset, oh) || oh.NumberOfRvaAndSizes <= resourceDirectoryIndex) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"stub optional header truncated");
+      return false;
+    }
+    resource = oh.DataDirectory[resourceDirectoryIndex];
+    subsystem = static_cast<bela::pe::Subsystem>(oh.Subsystem);
+  } else {
+    ec = bela::make_error_code(bela::ErrGeneral, L"stub optional header magic ", magic, L" unsupported");
+    return false;
+  }
+  auto shoffset = ohoffset + fh.SizeOfOptionalHeader;
+  sections.resize(fh.NumberOfSections);
+  for (size_t i = 0; i < sections.size(); i++) {
+    if (!readAt(shoffset + i * sizeof(bela::pe::SectionHeader32), sections[i])) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"stub section table truncated");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool StubPatcher::rvaToOffset(uint32_t rva, uint32_t len, size_t &offset) const {
+  for (const auto &sh : sections) {
+    if (rva < sh.VirtualAddress || rva - sh.VirtualAddress >= sh.SizeOfRawData) {
+      continue;
+    }
+    auto delta = rva - sh.VirtualAddress;
+    if (sh.SizeOfRawData - delta < len) {
+      return false;
+    }
+    offset = static_cast<size_t>(sh.PointerToRawData) + delta;
+    return offset <= image.size() && image.size() - offset >= len;
+  }
+  return false;
+}
+
+bool StubPatcher::PatchTarget(std::wstring_view target, bela::error_code &ec) {
+  if (target.empty() || target.size() >= TargetCapacity) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"launcher target length ", target.size(), L" exceeds stub capacity ",
+                               TargetCapacity - 1);
+    return false;
+  }
+  for (const auto &sh : sections) {
+    if (memcmp(sh.Name, SlotSection, sizeof(SlotSection)) != 0) {
+      continue;
+    }
+    auto offset = static_cast<size_t>(sh.PointerToRawData);
+    if (sh.SizeOfRawData < sizeof(Slot) || offset > image.size() || image.size() - offset < sizeof(Slot)) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"stub slot section truncated");
+      return false;
+    }
+    Slot slot;
+    memcpy(&slot, image.data() + offset, sizeof(Slot));
+    if (memcmp(slot.magic, SlotMagic, sizeof(SlotMagic)) != 0 || slot.capacity != TargetCapacity) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"stub slot magic mismatch");
+      return false;
+    }
+    slot.length = static_cast<uint32_t>(target.size());
+    memset(slot.target, 0, sizeof(slot.target));
+    memcpy(slot.target, target.data(), target.size() * sizeof(wchar_t));
+    memcpy(image.data() + offset, &slot, sizeof(Slot));
+    return true;
+  }
+  ec = bela::make_error_code(bela::ErrGeneral, L"stub has no .bkslot section");
+  return false;
+}
+
+bool StubPatcher::PatchVersion(std::string_view block, bela::error_code &ec) {
+  size_t base = 0;
+  if (resource.VirtualAddress == 0 || !rvaToOffset(resource.VirtualAddress, resource.Size, base)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"stub has no resource directory");
+    return false;
+  }
+  // RT_VERSION -> first name -> first language
+  auto lookup = [&](uint32_t dirOffset, bool matchVersion, uint32_t &entryOffset) -> bool {
+    ResourceDirectory dir;
+    if (dirOffset >= resource.Size || !readAt(base + dirOffset, dir)) {
+      return false;
+    }
+    uint32_t n = dir.NumberOfNamedEntries + dir.NumberOfIdEntries;
+    for (uint32_t i = 0; i < n; i++) {
+      ResourceDirectoryEntry e;
+      if (!readAt(base + dirOffset + sizeof(dir) + i * sizeof(e), e)) {
+        return false;
+      }
+      if (matchVersion && e.Name != resourceVersion) {
+        continue;
+      }
+      entryOffset = e.OffsetToData;
+      return true;
+    }
+    return false;
+  };
+  uint32_t level = 0;
+  if (!lookup(0, true, level) || (level & resourceSubdirectory) == 0 ||
+      !lookup(level & ~resourceSubdirectory, false, level) || (level & resourceSubdirectory) == 0 ||
+      !lookup(level & ~resourceSubdirectory, false, level) || (level & resourceSubdirectory) != 0) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"stub has no version resource");
+    return false;
+  }
+  ResourceDataEntry de;
+  auto deoffset = base + level;
+  if (!readAt(deoffset, de)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"stub version resource truncated");
+    return false;
+  }
+  size_t offset = 0;
+  if (!rvaToOffset(de.OffsetToData, de.Size, offset)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"stub version resource out of image");
+    return false;
+  }
+  if (block.size() > de.Size) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"version resource ", block.size(), L" bytes exceeds stub reserved ",
+                               de.Size, L" bytes");
+    return false;
+  }
+  memcpy(image.data() + offset, block.data(), block.size());
+  memset(image.data() + offset + block.size(), 0, de.Size - block.size());
+  de.Size = static_cast<uint32_t>(block.size());
+  memcpy(image.data() + deoffset, &de, sizeof(de));
+  return true;
+}
+
+} // namespace baulk::stub
@@ -0,0 +1,38 @@
+// launcher stub patcher
+#ifndef BAULK_STUB_PATCH_HPP
+#define BAULK_STUB_PATCH_HPP
+#include <bela/base.hpp>
+#include <bela/pe.hpp>
+#include <baulkstub.hpp>
+
+namespace baulk::stub {
+// StubPatcher rewrites a copy of baulk-stub in memory: target slot and RT_VERSION resource data.
+// Plain buffer manipulation, no process or file API involved.
+class StubPatcher {
+public:
+  StubPatcher(std::string &image_) : image(image_) {}
+  StubPatcher(const StubPatcher &) = delete;
+  StubPatcher &operator=(const StubPatcher &) = delete;
+  bool Parse(bela::error_code &ec);
+  bool PatchTarget(std::wstring_view target, bela::error_code &ec);
+  // PatchVersion replace version resource in place, block must fit in the template reserved size
+  bool PatchVersion(std::string_view block, bela::error_code &ec);
+  bela::pe::Subsystem Subsystem() const { return subsystem; }
+
+private:
+  std::string &image;
+  std::vector<bela::pe::SectionHeader32> sections;
+  bela::pe::DataDirectory resource{0, 0};
+  bela::pe::Subsystem subsystem{bela::pe::Subsystem::UNKNOWN};
+  bool rvaToOffset(uint32_t rva, uint32_t len, size_t &offset) const;
+  template <typename T> bool readAt(size_t offset, T &t) const {
+    if (offset > image.size() || image.size() - offset < sizeof(T)) {
+      return false;
+    }
+    memcpy(&t, image.data() + offset, sizeof(T));
+    return true;
+  }
+};
+} // namespace baulk::stub
+
+#endif
@@ -3,9 +3,14 @@
 #include <bela/path.hpp>
 #include <bela/process.hpp>
 #include <bela/simulator.hpp>
+#include <bela/terminal.hpp>
+#include <bela/codecvt.hpp>
 #include <regutils.hpp>
+#include <tar.hpp>
 #include "decompress.hpp"
+#include "indicators.hpp"
 #include "fs.hpp"
+#include "baulk.hpp"
 
 namespace baulk::tar {
 
@@ -56,10 +61,8 @@ inline bool initialize_msys2tar(std::wstring &tar, bela::env::Simulator &simulat
   return true;
 }
 
-bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec) {
-  if (!baulk::fs::MakeDir(outdir, ec)) {
-    return false;
-  }
+// external tar only handles formats the archive library cannot decode
+bool decompressExternal(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec) {
   bela::env::Simulator simulator;
   simulator.InitializeEnv();
   std::wstring tar;
@@ -75,4 +78,62 @@ bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_cod
   }
   return true;
 }
-} // namespace baulk::tar
+
+// extract link the regular files identical to an installed file of m when m is not nullptr, tar headers have no
+// checksum: the extractor compares the data of an entry with the installed file at its path
+bool extract(std::wstring_view src, std::wstring_view outdir, manifest::Manifest *m, bela::error_code &ec) {
+  if (!baulk::fs::MakeDir(outdir, ec)) {
+    return false;
+  }
+  bela::terminal::terminal_size termsz{0};
+  baulk::archive::tar::ExtractorOptions opts;
+  opts.onSkip = [](const baulk::archive::tar::Header &h, std::wstring_view reason) {
+    bela::FPrintF(stderr, L"\x1b[2K\rskip %s: %s\n", h.Name, reason);
+  };
+  if (!baulk::IsQuietMode) {
+    if (bela::terminal::IsSameTerminal(stderr)) {
+      if (auto cygwinterminal = bela::terminal::IsCygwinTerminal(stderr); cygwinterminal) {
+        CygwinTerminalSize(termsz);
+      } else {
+        bela::terminal::TerminalSize(stderr, termsz);
+      }
+    }
+    auto prefix = outdir.size() + 1;
+    opts.onEntry = [&, prefix](const baulk::archive::tar::Header &, std::wstring_view path) {
+      ShowEntry(termsz, path.size() > prefix ? path.substr(prefix) : path);
+    };
+  }
+  if (m != nullptr) {
+    opts.onReuse = [m](const baulk::archive::tar::Header &h, std::wstring_view path) {
+      return m->Source(path, h.Size, 0);
+    };
+    opts.onReused = [m](const baulk::archive::tar::Header &h, std::wstring_view) { m->Linked(h.Size); };
+  }
+  // -j 1 keeps extraction on the calling thread
+  if (baulk::ParallelJobs != 1) {
+    opts.memoryLimit = baulk::BaulkExtractMemory();
+    opts.writers = baulk::ParallelJobs;
+  }
+  if (!baulk::archive::tar::Extract(src, outdir, opts, ec)) {
+    if (ec.code != baulk::archive::tar::ErrNotTarFile) {
+      return false;
+    }
+    // external tar extracts everything
+    DbgPrint(L"%s: %s, fallback to external tar", src, ec.message);
+    return decompressExternal(src, outdir, ec);
+  }
+  if (!baulk::IsQuietMode) {
+    bela::FPrintF(stderr, L"\n");
+  }
+  return true;
+}
+
+bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec) {
+  return extract(src, outdir, nullptr, ec);
+}
+
+bool DecompressIncremental(std::wstring_view src, std::wstring_view outdir, manifest::Manifest &m,
+                           bela::error_code &ec) {
+  return extract(src, outdir, &m, ec);
+}
+} // namespace baulk::tar
\ No newline at end of file
@@ -98,6 +98,33 @@ int wmain(int argc, wchar_t **argv) {
   auto resptime = baulk::net::UrlResponseTime(argv[1]);
   bela::FPrintF(stderr, L"RespTimeout %d ms\n", resptime / 1000'000);
   bela::error_code ec;
+  if (argc >= 3) {
+    // windl_test http://127.0.0.1:8000/payload.zip BLAKE3:xxx (python -m http.server serves local payloads)
+    auto method = baulk::hash::hash_t::SHA256;
+    std::wstring_view value;
+    if (!baulk::hash::ResolveHashValue(argv[2], method, value, ec)) {
+      bela::FPrintF(stderr, L"checksum: %s error: %s\n", argv[2], ec.message);
+      return 1;
+    }
+    auto hasher = baulk::hash::NewHasher(method);
+    auto d = baulk::net::WinGet(argv[1], L".", hasher.get(), true, ec);
+    if (!d) {
+      bela::FPrintF(stderr, L"download: %s error: %s\n", argv[1], ec.message);
+      return 1;
+    }
+    auto filehash = baulk::hash::FileHash(d->path, method, ec);
+    bela::FPrintF(stderr, L"download: %s => %s\nstreaming: %s\nfile:      %s\n", argv[1], d->path, d->hashvalue,
+                  filehash ? *filehash : ec.message);
+    if (!filehash || *filehash != d->hashvalue) {
+      bela::FPrintF(stderr, L"streaming checksum differs from file checksum\n");
+      return 1;
+    }
+    if (!baulk::hash::DigestEqual(d->hashvalue, value, ec)) {
+      bela::FPrintF(stderr, L"download: %s error: %s\n", argv[1], ec.message);
+      return 1;
+    }
+    return 0;
+  }
   auto file = baulk::net::WinGet(argv[1], L".", true, ec);
   if (!file) {
     bela::FPrintF(stderr, L"download: %s error: %s\n", argv[1], ec.message);
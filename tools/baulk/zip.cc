@@ -3,49 +3,231 @@
 #include <bela/terminal.hpp>
 #include <bela/codecvt.hpp>
 #include <bela/path.hpp>
-#include <oldzip.hpp>
+#include <baulkmisc.hpp>
+#include <algorithm>
+#include <thread>
+#include "decompress.hpp"
+#include "extractor.hpp"
 #include "indicators.hpp"
 #include "fs.hpp"
 #include "baulk.hpp"
 
 namespace baulk::zip {
-// avoid filename too long
-int32_t OnEntry(void *handle, void *userdata, mz_zip_file *file_info, const char *path) {
-  auto termsz = reinterpret_cast<const bela::terminal::terminal_size *>(userdata);
-  if (termsz == nullptr || termsz->columns <= 8) {
-    return 0;
+Extractor::Extractor(std::wstring_view destination_, manifest::Manifest *manifest_)
+    : manifest(manifest_), destination(destination_) {
+  if (baulk::IsQuietMode || !bela::terminal::IsSameTerminal(stderr)) {
+    return;
   }
-  auto suglen = static_cast<size_t>(termsz->columns) - 8;
-  auto filename = bela::ToWide(std::string_view{file_info->filename, file_info->filename_size});
-  if (auto n = bela::StringWidth(filename); n <= suglen) {
-    bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx %s\x1b[0m", filename);
-    return 0;
+  if (auto cygwinterminal = bela::terminal::IsCygwinTerminal(stderr); cygwinterminal) {
+    CygwinTerminalSize(termsz);
+    return;
   }
-  auto basename = bela::BaseName(filename);
-  auto n = bela::StringWidth(basename);
-  if (n <= suglen) {
-    bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx ...\\%s\x1b[0m", basename);
-    return 0;
+  bela::terminal::TerminalSize(stderr, termsz);
+}
+
+bool Extractor::OpenReader(std::wstring_view file, bela::error_code &ec) {
+  // mapped: the central directory, stored entries and decoder input are read from the mapping without copies
+  return reader.OpenReader(file, ec, baulk::IsMappedMode);
+}
+
+void Extractor::show(std::wstring_view path) {
+  if (termsz.columns == 0) {
+    return;
   }
-  bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx ...%s\x1b[0m", basename.substr(n - suglen));
-  return 0;
+  std::scoped_lock lock(mtx);
+  ShowEntry(termsz, path.substr(destination.size() + 1));
 }
 
-bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec) {
-  bela::terminal::terminal_size termsz{0};
-  baulk::archive::zip::zip_closure closure{nullptr};
-  if (!baulk::IsQuietMode) {
-    if (bela::terminal::IsSameTerminal(stderr)) {
-      if (auto cygwinterminal = bela::terminal::IsCygwinTerminal(stderr); cygwinterminal) {
-        CygwinTerminalSize(termsz);
-      } else {
-        bela::terminal::TerminalSize(stderr, termsz);
+bool Extractor::Extract(int jobs, bela::error_code &ec) {
+  startTime = std::chrono::steady_clock::now();
+  auto closer = bela::finally([&] { endTime = std::chrono::steady_clock::now(); });
+  if (jobs <= 0) {
+    jobs = static_cast<int>((std::max)(std::thread::hardware_concurrency(), 1u));
+  }
+  std::vector<entry> entries;
+  std::vector<entry> later;
+  if (!prepare(jobs > 1, entries, later, ec)) {
+    return false;
+  }
+  if (jobs > 1 && entries.size() > 1) {
+    if (!extractParallel(jobs, entries, ec)) {
+      return false;
+    }
+  } else if (!extractSerial(entries, ec)) {
+    return false;
+  }
+  return extractSerial(later, ec);
+}
+
+// prepare create the directories, name the files and symlinks and link the unchanged files of the installed package.
+// Entries repeating a path go to later when the rest is extracted in parallel.
+bool Extractor::prepare(bool parallel, std::vector<entry> &entries, std::vector<entry> &later, bela::error_code &ec) {
+  const auto &files = reader.Files();
+  entries.reserve(files.size());
+  bela::flat_hash_set<std::wstring> seen;
+  for (const auto &file : files) {
+    auto dest = baulk::archive::zip::PathCat(destination, file, reader);
+    if (!dest) {
+      bela::FPrintF(stderr, L"\x1b[2K\rskip dangerous path %s\n", file.name);
+      continue;
+    }
+    if (file.IsDir() && !file.IsSymlink()) {
+      show(*dest);
+      extracted++;
+      if (!dirs.MakeDir(*dest, ec)) {
+        return false;
+      }
+      continue;
+    }
+    auto repeated = !seen.emplace(baulk::fs::PathKey(*dest)).second;
+    if (manifest != nullptr) {
+      // a repeated path replaces the earlier entry, its link and its key
+      if (repeated) {
+        manifest->Release(*dest);
+      }
+      if (!file.IsSymlink()) {
+        auto size = static_cast<int64_t>(file.uncompressedSize);
+        manifest->Record(*dest, size, file.crc32sum);
+        if (!repeated && manifest->Reuse(*dest, size, file.crc32sum)) {
+          show(*dest);
+          extracted++;
+          continue;
+        }
       }
     }
-    closure.userdata = &termsz;
-    closure.entry = OnEntry;
+    (repeated && parallel ? later : entries).emplace_back(entry{&file, std::move(*dest)});
+  }
+  return true;
+}
+
+// extractSerial a single decoder: files are written and closed on the write-behind thread
+bool Extractor::extractSerial(const std::vector<entry> &entries, bela::error_code &ec) {
+  if (entries.empty()) {
+    return true;
+  }
+  baulk::archive::WriteBehind wb;
+  behind = &wb;
+  auto reset = bela::finally([&] { behind = nullptr; });
+  for (const auto &e : entries) {
+    if (!extractFile(e, ec)) {
+      // the decoder stopped on the write error
+      wb.Wait(ec);
+      return false;
+    }
+  }
+  return wb.Wait(ec);
+}
+
+// extractParallel: files and symlinks are handed to a worker pool. Reader::Decompress only does positional reads and
+// keeps decoder state per thread, so every worker owns its decompressor and no file pointer is shared.
+bool Extractor::extractParallel(int jobs, std::vector<entry> &entries, bela::error_code &ec) {
+  // large entries first, keep workers busy until the tail
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const entry &a, const entry &b) { return a.file->compressedSize > b.file->compressedSize; });
+  workers = (std::min)(jobs, static_cast<int>(entries.size()));
+  std::atomic_size_t index{0};
+  bela::error_code firstEc;
+  auto worker = [&]() {
+    while (!canceled) {
+      auto i = index.fetch_add(1);
+      if (i >= entries.size()) {
+        return;
+      }
+      bela::error_code wec;
+      if (!extractFile(entries[i], wec)) {
+        std::scoped_lock lock(mtx);
+        if (!canceled.exchange(true)) {
+          firstEc = std::move(wec);
+        }
+        return;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (int i = 1; i < workers; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (canceled) {
+    ec = std::move(firstEc);
+    return false;
+  }
+  return true;
+}
+
+void Extractor::Report() const {
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+  auto bytes = static_cast<uint64_t>(decompressed.load());
+  wchar_t total[64];
+  wchar_t rate[64];
+  baulk::misc::EncodeRate(total, bytes);
+  baulk::misc::EncodeRate(rate, elapsed > 0 ? bytes * 1000 / static_cast<uint64_t>(elapsed) : bytes);
+  bela::FPrintF(stderr,
+                L"\x1b[2K\r\x1b[32mextracted %d files, %s in %d.%03ds, %s/s (%d workers), %d directories created, %d "
+                L"lookups cached\x1b[0m\n",
+                extracted.load(), total, elapsed / 1000, elapsed % 1000, rate, workers, dirs.Created(), dirs.Cached());
+}
+
+bool Extractor::extractSymlink(const entry &e, bela::error_code &ec) {
+  std::string linkname;
+  auto ret = reader.Decompress(
+      *e.file,
+      [&](const void *data, size_t len) {
+        linkname.append(reinterpret_cast<const char *>(data), len);
+        return true;
+      },
+      ec);
+  if (!ret) {
+    return false;
+  }
+  auto wn = bela::ToWide(linkname);
+  if (!baulk::archive::NewSymlink(e.path, wn, ec, owfile)) {
+    ec = bela::make_error_code(ec.code, L"create symlink '", e.path, L"' to linkname '", wn, L"' error ", ec.message);
+    return false;
+  }
+  return true;
+}
+
+bool Extractor::extractFile(const entry &e, bela::error_code &ec) {
+  show(e.path);
+  extracted++;
+  if (e.file->IsSymlink()) {
+    return extractSymlink(e, ec);
+  }
+  auto fd = baulk::archive::NewFD(e.path, ec, owfile, &dirs);
+  if (!fd) {
+    ec = bela::make_error_code(ec.code, L"create '", e.path, L"' error: ", ec.message);
+    return false;
+  }
+  baulk::archive::FileSink sink(std::move(*fd), e.path, static_cast<int64_t>(e.file->uncompressedSize), behind);
+  bela::error_code ec2;
+  auto ret = reader.Decompress(
+      *e.file,
+      [&](const void *data, size_t len) {
+        decompressed += static_cast<int64_t>(len);
+        return sink.Write(data, len, ec2);
+      },
+      ec);
+  if (!ret) {
+    // a write error stopped the decoder
+    ec = bela::make_error_code(ec.code, L"decompress '", e.path, L"' error: ", ec.message, L" ", ec2.message);
+    return false;
+  }
+  if (!sink.Close(e.file->time, ec)) {
+    ec = bela::make_error_code(ec.code, L"close '", e.path, L"' error: ", ec.message);
+    return false;
   }
-  if (!baulk::archive::zip::ZipExtract(src, outdir, ec, &closure)) {
+  return true;
+}
+
+// extract zip packages through the native reader, first installs and upgrades name their files alike
+static bool extract(std::wstring_view src, std::wstring_view outdir, manifest::Manifest *m, bela::error_code &ec) {
+  Extractor extractor(outdir, m);
+  if (!extractor.OpenReader(src, ec) || !extractor.Extract(baulk::ParallelJobs, ec)) {
     return false;
   }
   if (!baulk::IsQuietMode) {
@@ -54,4 +236,30 @@ bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_cod
   return true;
 }
 
-} // namespace baulk::zip
\ No newline at end of file
+bool Decompress(std::wstring_view src, std::wstring_view outdir, bela::error_code &ec) {
+  return extract(src, outdir, nullptr, ec);
+}
+
+bool Record(std::wstring_view src, std::wstring_view outdir, manifest::Manifest &m, bela::error_code &ec) {
+  baulk::archive::zip::Reader reader;
+  if (!reader.OpenReader(src, ec)) {
+    return false;
+  }
+  for (const auto &file : reader.Files()) {
+    if (file.IsDir() || file.IsSymlink()) {
+      continue;
+    }
+    if (auto dest = baulk::archive::zip::PathCat(outdir, file, reader); dest) {
+      m.Record(*dest, static_cast<int64_t>(file.uncompressedSize), file.crc32sum);
+    }
+  }
+  return true;
+}
+
+// DecompressIncremental the crc32 and size of the central directory identify unchanged files
+bool DecompressIncremental(std::wstring_view src, std::wstring_view outdir, manifest::Manifest &m,
+                           bela::error_code &ec) {
+  return extract(src, outdir, &m, ec);
+}
+
+} // namespace baulk::zip